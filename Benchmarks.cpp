@@ -0,0 +1,2231 @@
+#include "Benchmarks.h"
+#include "CommandBuffer.h"
+#include "EntityStore.h"
+#include "FixedTimestep.h"
+#include "FrustumCulling.h"
+#include "InstanceBatcher.h"
+#include "LooseOctree.h"
+#include "MeshBVH.h"
+#include "MeshProcessing.h"
+#include "ObjParser.h"
+#include "OcclusionBuffer.h"
+#include "RecordingBackend.h"
+#include "RenderQueue.h"
+#include "SceneFile.h"
+#include "TransformSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+// Anonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// Milliseconds since some fixed point, for timing blocks of work
+	double NowMilliseconds()
+	{
+		return std::chrono::duration<double, std::milli>(
+			std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+	}
+
+	// For printing results
+	const char* YesNo(bool value) { return value ? "yes" : "no"; }
+
+	// Box tests matching LooseOctree's, one box at a time
+	bool BoxInFrustum(const DirectX::XMFLOAT4 planes[6], DirectX::XMFLOAT3 c, DirectX::XMFLOAT3 e)
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			const DirectX::XMFLOAT4& p = planes[i];
+			if (c.x * p.x + c.y * p.y + c.z * p.z + p.w < -(e.x * fabsf(p.x) + e.y * fabsf(p.y) + e.z * fabsf(p.z)))
+				return false;
+		}
+		return true;
+	}
+
+	bool BoxTouchesSphere(DirectX::XMFLOAT3 center, float radius, DirectX::XMFLOAT3 c, DirectX::XMFLOAT3 e)
+	{
+		float nx = std::max(fabsf(center.x - c.x) - e.x, 0.0f);
+		float ny = std::max(fabsf(center.y - c.y) - e.y, 0.0f);
+		float nz = std::max(fabsf(center.z - c.z) - e.z, 0.0f);
+		return nx * nx + ny * ny + nz * nz <= radius * radius;
+	}
+
+	bool RayHitsBox(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 inverseDirection, float maxDistance, DirectX::XMFLOAT3 c, DirectX::XMFLOAT3 e)
+	{
+		float t1 = (c.x - e.x - origin.x) * inverseDirection.x, t2 = (c.x + e.x - origin.x) * inverseDirection.x;
+		float tMin = std::min(t1, t2), tMax = std::max(t1, t2);
+		t1 = (c.y - e.y - origin.y) * inverseDirection.y; t2 = (c.y + e.y - origin.y) * inverseDirection.y;
+		tMin = std::max(tMin, std::min(t1, t2)); tMax = std::min(tMax, std::max(t1, t2));
+		t1 = (c.z - e.z - origin.z) * inverseDirection.z; t2 = (c.z + e.z - origin.z) * inverseDirection.z;
+		tMin = std::max(tMin, std::min(t1, t2)); tMax = std::min(tMax, std::max(t1, t2));
+		return tMax >= std::max(tMin, 0.0f) && tMin <= maxDistance;
+	}
+
+	// Shader, material and mesh binds needed to draw a queue in its
+	// current order (the first draw binds all three)
+	unsigned int CountStateChanges(RenderQueue& queue)
+	{
+		unsigned int changes = 0;
+		uint64_t previous = 0;
+		const unsigned int meshShift = RenderQueue::DepthBits;
+		const unsigned int materialShift = meshShift + RenderQueue::MeshBits;
+		const unsigned int shaderShift = materialShift + RenderQueue::MaterialBits;
+		for (unsigned int i = 0; i < queue.GetCount(); i++)
+		{
+			uint64_t key = queue.GetKey(i);
+			uint64_t different = i == 0 ? ~0ull : key ^ previous;
+			changes += (different >> meshShift) & ((1ull << RenderQueue::MeshBits) - 1) ? 1 : 0;
+			changes += (different >> materialShift) & ((1ull << RenderQueue::MaterialBits) - 1) ? 1 : 0;
+			changes += (different >> shaderShift) & ((1ull << RenderQueue::ShaderBits) - 1) ? 1 : 0;
+			previous = key;
+		}
+		return changes;
+	}
+
+	// Closest hit of a ray against every triangle, one at a time
+	// (Moller-Trumbore, both sides), or -1 for a miss
+	float BruteForceIntersect(const std::vector<DirectX::XMFLOAT3>& positions, const std::vector<unsigned int>& indices,
+		DirectX::XMFLOAT3 o, DirectX::XMFLOAT3 d)
+	{
+		float closest = INFINITY;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			DirectX::XMFLOAT3 a = positions[indices[i]];
+			DirectX::XMFLOAT3 b = positions[indices[i + 1]];
+			DirectX::XMFLOAT3 c = positions[indices[i + 2]];
+			float e1[3] = { b.x - a.x, b.y - a.y, b.z - a.z };
+			float e2[3] = { c.x - a.x, c.y - a.y, c.z - a.z };
+			float p[3] = { d.y * e2[2] - d.z * e2[1], d.z * e2[0] - d.x * e2[2], d.x * e2[1] - d.y * e2[0] };
+			float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+			if (fabsf(det) < 1e-12f)
+				continue;
+
+			float inv = 1.0f / det;
+			float t0[3] = { o.x - a.x, o.y - a.y, o.z - a.z };
+			float u = (t0[0] * p[0] + t0[1] * p[1] + t0[2] * p[2]) * inv;
+			if (u < 0.0f || u > 1.0f)
+				continue;
+
+			float q[3] = { t0[1] * e1[2] - t0[2] * e1[1], t0[2] * e1[0] - t0[0] * e1[2], t0[0] * e1[1] - t0[1] * e1[0] };
+			float v = (d.x * q[0] + d.y * q[1] + d.z * q[2]) * inv;
+			if (v < 0.0f || u + v > 1.0f)
+				continue;
+
+			float t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inv;
+			if (t >= 0.0f && t < closest)
+				closest = t;
+		}
+		return closest == INFINITY ? -1.0f : closest;
+	}
+
+	// The old Entity layout: every component behind its own
+	// shared_ptr, and every getter returning a copy of one
+	class LegacyEntity
+	{
+	private:
+		std::shared_ptr<Mesh> mesh;
+		std::shared_ptr<Transform> transform;
+		std::shared_ptr<Material> material;
+
+	public:
+		LegacyEntity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material, TransformSystem& system) :
+			mesh(mesh),
+			transform(std::make_shared<Transform>(system)),
+			material(material)
+		{
+		}
+
+		std::shared_ptr<Mesh> GetMesh() { return mesh; }
+		std::shared_ptr<Transform> GetTransform() { return transform; }
+		std::shared_ptr<Material> GetMaterial() { return material; }
+	};
+
+	// What a draw list needs to know about each entity
+	struct DrawItem
+	{
+		Mesh* mesh;
+		Material* material;
+		Transform* transform;
+		int lod;
+	};
+
+	// --------------------------------------------------------
+	// Records a pass of made-up draws the way the opaque pass
+	// does: new shaders every 32 draws, a texture every 8, mesh
+	// buffers every 4, and a full constant buffer for both
+	// stages every draw.  Handles point into "resources" but are
+	// never used.  Everything comes from the pass number, so
+	// recording it again on any thread gives the same bytes.
+	// --------------------------------------------------------
+	void RecordSyntheticPass(CommandBuffer& commands, unsigned int pass, unsigned int drawCount, char* resources)
+	{
+		std::mt19937 rng(1357 + pass);
+		float vertexConstants[64] = {};
+		float pixelConstants[32] = {};
+
+		commands.Clear();
+		commands.ClearTarget(resources + pass, pixelConstants);
+		commands.SetTargets(resources + pass, resources + 64);
+		commands.SetViewport(1280.0f, 720.0f);
+		for (unsigned int i = 0; i < drawCount; i++)
+		{
+			if (i % 32 == 0)
+				commands.SetPipeline(resources + 128 + rng() % 16, resources + 160, resources + 192 + rng() % 16);
+			if (i % 8 == 0)
+			{
+				commands.SetResource(CommandBuffer::StagePixel, 0, resources + 256 + rng() % 128);
+				commands.SetSampler(CommandBuffer::StagePixel, 0, resources + 384);
+			}
+			if (i % 4 == 0)
+			{
+				unsigned int mesh = rng() % 256;
+				commands.SetVertexBuffer(0, resources + 512 + mesh * 2, 16);
+				commands.SetIndexBuffer(resources + 513 + mesh * 2, 2);
+			}
+
+			vertexConstants[12] = (float)i;
+			vertexConstants[13] = (float)(rng() % 1000);
+			pixelConstants[0] = (float)pass;
+			commands.SetConstants(CommandBuffer::StageVertex, 0, resources + 1024, vertexConstants, sizeof(vertexConstants));
+			commands.SetConstants(CommandBuffer::StagePixel, 0, resources + 1025, pixelConstants, sizeof(pixelConstants));
+			commands.DrawIndexed(384 + rng() % 4096, rng() % 65536);
+		}
+	}
+
+	// A UV sphere of unit radius with outward facing triangles, rings
+	// running from pole to pole (the pole triangles are degenerate)
+	void BuildSphere(unsigned int segments, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+	{
+		unsigned int rings = segments / 2;
+		verts.clear();
+		indices.clear();
+		for (unsigned int r = 0; r <= rings; r++)
+		{
+			float theta = 3.14159265f * r / rings;
+			for (unsigned int s = 0; s <= segments; s++)
+			{
+				float phi = 6.28318531f * s / segments;
+				Vertex v = {};
+				v.Position = DirectX::XMFLOAT3(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+				v.Normal = v.Position;
+				v.UV = DirectX::XMFLOAT2((float)s / segments, (float)r / rings);
+				verts.push_back(v);
+			}
+		}
+		for (unsigned int r = 0; r < rings; r++)
+		{
+			for (unsigned int s = 0; s < segments; s++)
+			{
+				unsigned int a = r * (segments + 1) + s;
+				unsigned int b = a + 1;
+				unsigned int c = a + segments + 1;
+				unsigned int d = c + 1;
+				unsigned int quad[6] = { a, b, c, b, d, c };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	// A flat size x size grid of unit squares on y = 0, facing +Y
+	void BuildGrid(unsigned int size, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+	{
+		verts.clear();
+		indices.clear();
+		for (unsigned int z = 0; z <= size; z++)
+		{
+			for (unsigned int x = 0; x <= size; x++)
+			{
+				Vertex v = {};
+				v.Position = DirectX::XMFLOAT3((float)x, 0.0f, (float)z);
+				v.Normal = DirectX::XMFLOAT3(0, 1, 0);
+				v.UV = DirectX::XMFLOAT2((float)x / size, (float)z / size);
+				verts.push_back(v);
+			}
+		}
+		for (unsigned int z = 0; z < size; z++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				unsigned int a = z * (size + 1) + x;
+				unsigned int b = a + size + 1;
+				unsigned int c = a + 1;
+				unsigned int d = b + 1;
+				unsigned int quad[6] = { a, b, c, b, d, c };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	// Every triangle rotated to start at its smallest index (keeping
+	// its winding), then sorted, so two index lists holding the same
+	// triangles in any order compare equal
+	std::vector<uint64_t> SortedTriangles(const std::vector<unsigned int>& indices, size_t indexStart, size_t indexCount)
+	{
+		std::vector<uint64_t> triangles;
+		for (size_t i = indexStart; i + 2 < indexStart + indexCount; i += 3)
+		{
+			unsigned int t[3] = { indices[i], indices[i + 1], indices[i + 2] };
+			int first = t[0] <= t[1] && t[0] <= t[2] ? 0 : (t[1] <= t[2] ? 1 : 2);
+			uint64_t a = t[first], b = t[(first + 1) % 3], c = t[(first + 2) % 3];
+			triangles.push_back((a << 42) | (b << 21) | c);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+}
+
+// --------------------------------------------------------
+// Loads the same OBJ repeatedly with both loaders, reporting the
+// average time of each and whether their output matches exactly
+// --------------------------------------------------------
+Benchmarks::ObjLoadResult Benchmarks::CompareObjLoaders(const char* filename, int iterations)
+{
+	ObjLoadResult result = {};
+	if (iterations < 1)
+		iterations = 1;
+
+	std::vector<Vertex> legacyVerts, fastVerts;
+	std::vector<unsigned int> legacyIndices, fastIndices;
+
+	double start = NowMilliseconds();
+	for (int i = 0; i < iterations; i++)
+		ObjParser::LoadLegacy(filename, legacyVerts, legacyIndices);
+	result.legacyMilliseconds = (NowMilliseconds() - start) / iterations;
+
+	start = NowMilliseconds();
+	for (int i = 0; i < iterations; i++)
+		ObjParser::Load(filename, fastVerts, fastIndices);
+	result.fastMilliseconds = (NowMilliseconds() - start) / iterations;
+
+	// Compare the raw bytes of everything read from the file, since both
+	// should produce exactly the same floats (tangents aren't loaded, and
+	// the legacy loader leaves them uninitialized)
+	result.vertexCount = (unsigned int)fastVerts.size();
+	result.identical = legacyVerts.size() == fastVerts.size() && legacyIndices == fastIndices;
+	for (size_t i = 0; result.identical && i < fastVerts.size(); i++)
+		result.identical = memcmp(&legacyVerts[i], &fastVerts[i], offsetof(Vertex, Tangent)) == 0;
+
+	std::error_code error;
+	result.megabytes = std::filesystem::file_size(filename, error) / (1024.0 * 1024.0);
+	result.threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	return result;
+}
+
+// --------------------------------------------------------
+// Writes a large scan-like OBJ to a temporary file (a noisy
+// height field, every corner with its own position, UV and
+// normal indices), compares the loaders on it, then deletes it.
+// A grid of 1000 makes a file of a little over 200 MB.
+// --------------------------------------------------------
+Benchmarks::ObjLoadResult Benchmarks::CompareObjLoadersOnScan(unsigned int gridSize, int iterations)
+{
+	ObjLoadResult result = {};
+	if (gridSize < 2)
+		return result;
+
+	std::string path = (std::filesystem::temp_directory_path() / "ObjLoadBenchmark.scan.obj").string();
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return result;
+
+	// Lines are formatted into a block at a time, rather than
+	// one fprintf() per number
+	std::vector<char> block(1 << 20);
+	size_t used = 0;
+	std::mt19937 rng(2024);
+	std::uniform_real_distribution<float> noise(-0.01f, 0.01f);
+	for (unsigned int y = 0; y < gridSize; y++)
+	{
+		for (unsigned int x = 0; x < gridSize; x++)
+		{
+			float u = (float)x / (gridSize - 1);
+			float v = (float)y / (gridSize - 1);
+			float height = sinf(u * 12.0f) * cosf(v * 9.0f) * 0.5f + noise(rng);
+			float nx = -cosf(u * 12.0f) * 0.3f;
+			float nz = sinf(v * 9.0f) * 0.3f;
+			float length = sqrtf(nx * nx + 1.0f + nz * nz);
+
+			if (block.size() - used < 256)
+			{
+				file.write(block.data(), used);
+				used = 0;
+			}
+			used += snprintf(block.data() + used, block.size() - used,
+				"v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n",
+				u * 100.0f - 50.0f, height, v * 100.0f - 50.0f, u, v, nx / length, 1.0f / length, nz / length);
+		}
+	}
+	for (unsigned int y = 0; y + 1 < gridSize; y++)
+	{
+		for (unsigned int x = 0; x + 1 < gridSize; x++)
+		{
+			// Two triangles per cell (OBJ indices start at 1)
+			unsigned int a = y * gridSize + x + 1;
+			unsigned int b = a + 1;
+			unsigned int c = a + gridSize;
+			unsigned int d = c + 1;
+
+			if (block.size() - used < 256)
+			{
+				file.write(block.data(), used);
+				used = 0;
+			}
+			used += snprintf(block.data() + used, block.size() - used,
+				"f %u/%u/%u %u/%u/%u %u/%u/%u\nf %u/%u/%u %u/%u/%u %u/%u/%u\n",
+				a, a, a, c, c, c, b, b, b,
+				b, b, b, c, c, c, d, d, d);
+		}
+	}
+	file.write(block.data(), used);
+	file.close();
+	if (!file)
+		return result;
+
+	result = CompareObjLoaders(path.c_str(), iterations);
+
+	std::error_code error;
+	std::filesystem::remove(path, error);
+	return result;
+}
+
+// --------------------------------------------------------
+// Generates tangents for a welded OBJ with the reference and the
+// SIMD/threaded version, reporting the time of each and how far
+// apart their results are.  The fast version is also run on a
+// single thread to make sure threading doesn't change any bits.
+// --------------------------------------------------------
+Benchmarks::TangentResult Benchmarks::CompareTangents(const char* filename, int iterations)
+{
+	TangentResult result = {};
+	if (iterations < 1)
+		iterations = 1;
+
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	if (!ObjParser::Load(filename, verts, indices) || verts.empty())
+		return result;
+	MeshProcessing::WeldVertices(verts, indices);
+
+	std::vector<Vertex> reference = verts;
+	std::vector<Vertex> fast = verts;
+	std::vector<Vertex> single = verts;
+	std::vector<Vertex> angle = verts;
+
+	double start = NowMilliseconds();
+	for (int i = 0; i < iterations; i++)
+		MeshProcessing::CalculateTangentsReference(reference.data(), reference.size(), indices.data(), indices.size());
+	result.referenceMilliseconds = (NowMilliseconds() - start) / iterations;
+
+	start = NowMilliseconds();
+	for (int i = 0; i < iterations; i++)
+		MeshProcessing::CalculateTangents(fast.data(), fast.size(), indices.data(), indices.size());
+	result.fastMilliseconds = (NowMilliseconds() - start) / iterations;
+
+	start = NowMilliseconds();
+	for (int i = 0; i < iterations; i++)
+		MeshProcessing::CalculateTangents(angle.data(), angle.size(), indices.data(), indices.size(), MeshProcessing::TangentWeighting::Angle);
+	result.angleMilliseconds = (NowMilliseconds() - start) / iterations;
+
+	MeshProcessing::CalculateTangents(single.data(), single.size(), indices.data(), indices.size(), MeshProcessing::TangentWeighting::Classic, 1);
+
+	result.vertexCount = (unsigned int)verts.size();
+	result.deterministic = true;
+	for (size_t i = 0; i < verts.size(); i++)
+	{
+		const DirectX::XMFLOAT3& r = reference[i].Tangent;
+		const DirectX::XMFLOAT3& f = fast[i].Tangent;
+		const DirectX::XMFLOAT3& a = angle[i].Tangent;
+
+		// Degenerate UVs give NaN tangents in both, which count as a match
+		float difference = fmaxf(fabsf(r.x - f.x), fmaxf(fabsf(r.y - f.y), fabsf(r.z - f.z)));
+		if (difference > result.maxDifference)
+			result.maxDifference = difference;
+		if (std::isnan(r.x) != std::isnan(f.x))
+			result.maxDifference = INFINITY;
+
+		float cosine = r.x * a.x + r.y * a.y + r.z * a.z;
+		if (cosine == cosine)
+		{
+			float degrees = acosf(fminf(fmaxf(cosine, -1.0f), 1.0f)) * 180.0f / 3.14159265f;
+			if (degrees > result.maxAngleDegrees)
+				result.maxAngleDegrees = degrees;
+		}
+
+		result.deterministic = result.deterministic && memcmp(&fast[i].Tangent, &single[i].Tangent, sizeof(DirectX::XMFLOAT3)) == 0;
+	}
+
+	return result;
+}
+
+// --------------------------------------------------------
+// Builds a BVH for a welded OBJ and traces a fixed set of random
+// rays through it, from points around the mesh toward points
+// inside its bounds.  Every 16th ray is also tested against each
+// triangle directly to make sure the BVH finds the same hit.
+// --------------------------------------------------------
+Benchmarks::RayResult Benchmarks::MeasureRayThroughput(const char* filename, unsigned int rayCount)
+{
+	RayResult result = {};
+	if (rayCount < 1)
+		rayCount = 1;
+
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	if (!ObjParser::Load(filename, verts, indices) || verts.empty())
+		return result;
+	MeshProcessing::WeldVertices(verts, indices);
+
+	std::vector<DirectX::XMFLOAT3> positions(verts.size());
+	DirectX::XMFLOAT3 boundsMin = verts[0].Position;
+	DirectX::XMFLOAT3 boundsMax = verts[0].Position;
+	for (size_t i = 0; i < verts.size(); i++)
+	{
+		positions[i] = verts[i].Position;
+		boundsMin.x = fminf(boundsMin.x, positions[i].x); boundsMax.x = fmaxf(boundsMax.x, positions[i].x);
+		boundsMin.y = fminf(boundsMin.y, positions[i].y); boundsMax.y = fmaxf(boundsMax.y, positions[i].y);
+		boundsMin.z = fminf(boundsMin.z, positions[i].z); boundsMax.z = fmaxf(boundsMax.z, positions[i].z);
+	}
+
+	MeshBVH bvh(positions.data(), indices.data(), indices.size());
+	result.buildMilliseconds = bvh.GetBuildMilliseconds();
+	result.nodeCount = bvh.GetNodeCount();
+	result.triangleCount = bvh.GetTriangleCount();
+
+	// Same seed every run so results can be compared between builds
+	DirectX::XMFLOAT3 center(
+		(boundsMin.x + boundsMax.x) * 0.5f,
+		(boundsMin.y + boundsMax.y) * 0.5f,
+		(boundsMin.z + boundsMax.z) * 0.5f);
+	DirectX::XMFLOAT3 extents(boundsMax.x - center.x, boundsMax.y - center.y, boundsMax.z - center.z);
+	float radius = 2.0f * sqrtf(extents.x * extents.x + extents.y * extents.y + extents.z * extents.z) + 1e-3f;
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<DirectX::XMFLOAT3> origins(rayCount), directions(rayCount);
+	for (unsigned int i = 0; i < rayCount; i++)
+	{
+		// Random point on a sphere around the mesh
+		DirectX::XMFLOAT3 o;
+		float lengthSq;
+		do
+		{
+			o = DirectX::XMFLOAT3(unit(rng), unit(rng), unit(rng));
+			lengthSq = o.x * o.x + o.y * o.y + o.z * o.z;
+		} while (lengthSq > 1.0f || lengthSq < 1e-4f);
+		float scale = radius / sqrtf(lengthSq);
+		origins[i] = DirectX::XMFLOAT3(center.x + o.x * scale, center.y + o.y * scale, center.z + o.z * scale);
+
+		// Aimed at a random point in the bounds
+		DirectX::XMFLOAT3 target(
+			center.x + unit(rng) * extents.x,
+			center.y + unit(rng) * extents.y,
+			center.z + unit(rng) * extents.z);
+		DirectX::XMFLOAT3 d(target.x - origins[i].x, target.y - origins[i].y, target.z - origins[i].z);
+		float invLength = 1.0f / sqrtf(d.x * d.x + d.y * d.y + d.z * d.z);
+		directions[i] = DirectX::XMFLOAT3(d.x * invLength, d.y * invLength, d.z * invLength);
+	}
+
+	std::vector<float> distances(rayCount);
+	unsigned int hits = 0;
+	double start = NowMilliseconds();
+	for (unsigned int i = 0; i < rayCount; i++)
+	{
+		MeshBVH::RayHit hit;
+		bool found = bvh.Intersect(origins[i], directions[i], INFINITY, hit);
+		distances[i] = found ? hit.distance : -1.0f;
+		hits += found;
+	}
+	double elapsed = NowMilliseconds() - start;
+
+	result.rayCount = rayCount;
+	result.raysPerSecond = elapsed > 0.0 ? rayCount * 1000.0 / elapsed : 0.0;
+	result.hitRate = (float)hits / rayCount;
+
+	// Distances may differ slightly since the BVH works from edges
+	// precomputed in its packets
+	for (unsigned int i = 0; i < rayCount; i += 16)
+	{
+		float expected = BruteForceIntersect(positions, indices, origins[i], directions[i]);
+		bool match = (expected < 0.0f) == (distances[i] < 0.0f);
+		if (match && expected >= 0.0f)
+			match = fabsf(expected - distances[i]) <= 1e-4f * (1.0f + expected);
+		result.mismatches += !match;
+	}
+
+	return result;
+}
+
+// --------------------------------------------------------
+// Fills a transform system with random transforms and times
+// rebuilding all of their matrices: one slot at a time (how
+// every Transform used to work), then as a single batch on
+// one thread and on every core.  Marking the slots dirty
+// again between iterations isn't timed.
+// --------------------------------------------------------
+Benchmarks::TransformResult Benchmarks::MeasureTransformUpdates(unsigned int transformCount, int iterations)
+{
+	TransformResult result = {};
+	if (iterations < 1)
+		iterations = 1;
+
+	TransformSystem system;
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	for (unsigned int i = 0; i < transformCount; i++)
+	{
+		unsigned int slot = system.Create();
+		system.SetPosition(slot, DirectX::XMFLOAT3(unit(rng) * 100.0f, unit(rng) * 100.0f, unit(rng) * 100.0f));
+		system.SetPitchYawRoll(slot, DirectX::XMFLOAT3(unit(rng) * 3.14159265f, unit(rng) * 3.14159265f, unit(rng) * 3.14159265f));
+		system.SetScale(slot, DirectX::XMFLOAT3(unit(rng) + 2.0f, unit(rng) + 2.0f, unit(rng) + 2.0f));
+	}
+	result.transformCount = transformCount;
+
+	double total = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		for (unsigned int slot = 0; slot < transformCount; slot++)
+			system.MarkDirty(slot);
+
+		double start = NowMilliseconds();
+		for (unsigned int slot = 0; slot < transformCount; slot++)
+			system.GetVersion(slot);
+		total += NowMilliseconds() - start;
+	}
+	result.perObjectMilliseconds = total / iterations;
+
+	total = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		for (unsigned int slot = 0; slot < transformCount; slot++)
+			system.MarkDirty(slot);
+
+		double start = NowMilliseconds();
+		system.UpdateMatrices(1);
+		total += NowMilliseconds() - start;
+	}
+	result.batchMilliseconds = total / iterations;
+
+	unsigned int cores = std::thread::hardware_concurrency();
+	result.threadCount = cores > 0 ? cores : 1;
+	total = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		for (unsigned int slot = 0; slot < transformCount; slot++)
+			system.MarkDirty(slot);
+
+		double start = NowMilliseconds();
+		system.UpdateMatrices(result.threadCount);
+		total += NowMilliseconds() - start;
+	}
+	result.threadedMilliseconds = total / iterations;
+
+	return result;
+}
+
+// --------------------------------------------------------
+// Builds a tree where each node has the same number of children
+// (one child per node gives a single deep chain) and times batch
+// updates after moving the root, after moving one of the root's
+// children, and with nothing moved at all
+// --------------------------------------------------------
+Benchmarks::HierarchyResult Benchmarks::MeasureHierarchyUpdates(unsigned int nodeCount, unsigned int childrenPerNode, int iterations)
+{
+	HierarchyResult result = {};
+	if (iterations < 1)
+		iterations = 1;
+	if (nodeCount < 2 || childrenPerNode < 1)
+		return result;
+
+	TransformSystem system;
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	for (unsigned int i = 0; i < nodeCount; i++)
+	{
+		unsigned int slot = system.Create();
+		system.SetPosition(slot, DirectX::XMFLOAT3(unit(rng), unit(rng), unit(rng)));
+		system.SetPitchYawRoll(slot, DirectX::XMFLOAT3(unit(rng) * 0.1f, unit(rng) * 0.1f, unit(rng) * 0.1f));
+		if (i > 0)
+			system.SetParent(slot, (i - 1) / childrenPerNode);
+	}
+	system.UpdateMatrices();
+
+	result.nodeCount = nodeCount;
+	result.depthCount = system.GetDepthCount();
+
+	double total = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		system.SetPosition(0, DirectX::XMFLOAT3((float)i, 0.0f, 0.0f));
+
+		double start = NowMilliseconds();
+		system.UpdateMatrices();
+		total += NowMilliseconds() - start;
+	}
+	result.fullMilliseconds = total / iterations;
+
+	total = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		system.SetPosition(1, DirectX::XMFLOAT3((float)i, 1.0f, 0.0f));
+
+		double start = NowMilliseconds();
+		result.subtreeUpdated = system.UpdateMatrices();
+		total += NowMilliseconds() - start;
+	}
+	result.subtreeMilliseconds = total / iterations;
+
+	double start = NowMilliseconds();
+	for (int i = 0; i < iterations; i++)
+		system.UpdateMatrices();
+	result.idleMilliseconds = (NowMilliseconds() - start) / iterations;
+
+	return result;
+}
+
+// --------------------------------------------------------
+// Times the general inverse against the affine shortcut over
+// random scale * rotation * translation matrices, and checks
+// every fast result against the general one (scales go from 0.1
+// to 10, so the relative error is what matters).  The fast path
+// is also timed on uniform and unit scales, where it skips work.
+// --------------------------------------------------------
+Benchmarks::InverseTransposeResult Benchmarks::CompareInverseTranspose(unsigned int matrixCount, int iterations)
+{
+	using namespace DirectX;
+
+	InverseTransposeResult result = {};
+	if (iterations < 1)
+		iterations = 1;
+	if (matrixCount < 1)
+		matrixCount = 1;
+	result.matrixCount = matrixCount;
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<XMFLOAT4X4> rotations(matrixCount), worlds(matrixCount), generic(matrixCount), fast(matrixCount);
+	std::vector<XMFLOAT3> scales(matrixCount), uniformScales(matrixCount), unitScales(matrixCount, XMFLOAT3(1, 1, 1)), positions(matrixCount);
+	for (unsigned int i = 0; i < matrixCount; i++)
+	{
+		XMMATRIX r = XMMatrixRotationRollPitchYaw(unit(rng) * XM_PI, unit(rng) * XM_PI, unit(rng) * XM_PI);
+		scales[i] = XMFLOAT3(powf(10.0f, unit(rng)), powf(10.0f, unit(rng)), powf(10.0f, unit(rng)));
+		uniformScales[i] = XMFLOAT3(scales[i].x, scales[i].x, scales[i].x);
+		positions[i] = XMFLOAT3(unit(rng) * 100.0f, unit(rng) * 100.0f, unit(rng) * 100.0f);
+
+		XMStoreFloat4x4(&rotations[i], r);
+		XMStoreFloat4x4(&worlds[i], XMMatrixScaling(scales[i].x, scales[i].y, scales[i].z) * r *
+			XMMatrixTranslation(positions[i].x, positions[i].y, positions[i].z));
+	}
+
+	double start = NowMilliseconds();
+	for (int i = 0; i < iterations; i++)
+	{
+		for (unsigned int m = 0; m < matrixCount; m++)
+			XMStoreFloat4x4(&generic[m], XMMatrixInverse(0, XMMatrixTranspose(XMLoadFloat4x4(&worlds[m]))));
+	}
+	result.genericMilliseconds = (NowMilliseconds() - start) / iterations;
+
+	// Same loop for each kind of scale
+	auto timeFast = [&](const std::vector<XMFLOAT3>& scaleSet)
+	{
+		double begin = NowMilliseconds();
+		for (int i = 0; i < iterations; i++)
+		{
+			for (unsigned int m = 0; m < matrixCount; m++)
+				XMStoreFloat4x4(&fast[m], TransformSystem::InverseTranspose(XMLoadFloat4x4(&rotations[m]), scaleSet[m], positions[m]));
+		}
+		return (NowMilliseconds() - begin) / iterations;
+	};
+
+	result.fastMilliseconds = timeFast(scales);
+	for (unsigned int m = 0; m < matrixCount; m++)
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			for (int col = 0; col < 4; col++)
+			{
+				float expected = generic[m].m[row][col];
+				float error = fabsf(fast[m].m[row][col] - expected) / (1.0f + fabsf(expected));
+				if (!(error <= result.maxError))
+					result.maxError = error;
+			}
+		}
+	}
+
+	result.uniformMilliseconds = timeFast(uniformScales);
+	result.unscaledMilliseconds = timeFast(unitScales);
+	return result;
+}
+
+// --------------------------------------------------------
+// Builds the same scene both ways and times two passes over it:
+// moving every entity, and gathering a draw list.  The meshes
+// and materials are empty stand-ins that are never touched,
+// but they have real reference counts, so copying them costs
+// what it always did.
+// --------------------------------------------------------
+Benchmarks::EntityResult Benchmarks::CompareEntityIteration(unsigned int entityCount, int iterations)
+{
+	EntityResult result = {};
+	if (iterations < 1)
+		iterations = 1;
+
+	// A handful of shared meshes and materials, as in a real scene
+	const unsigned int sharedCount = 8;
+	std::shared_ptr<Mesh> meshes[sharedCount];
+	std::shared_ptr<Material> materials[sharedCount];
+	for (unsigned int i = 0; i < sharedCount; i++)
+	{
+		meshes[i] = std::shared_ptr<Mesh>((Mesh*)0, [](Mesh*) {});
+		materials[i] = std::shared_ptr<Material>((Material*)0, [](Material*) {});
+	}
+
+	TransformSystem legacySystem;
+	std::vector<std::shared_ptr<LegacyEntity>> legacy;
+	legacy.reserve(entityCount);
+	for (unsigned int i = 0; i < entityCount; i++)
+		legacy.push_back(std::make_shared<LegacyEntity>(meshes[i % sharedCount], materials[(i / 3) % sharedCount], legacySystem));
+
+	TransformSystem storeSystem;
+	EntityStore store(storeSystem);
+	for (unsigned int i = 0; i < entityCount; i++)
+		store.Create(meshes[i % sharedCount], materials[(i / 3) % sharedCount]);
+	result.entityCount = entityCount;
+
+	std::vector<DrawItem> drawList;
+	drawList.reserve(entityCount);
+
+	double updateTotal = 0.0;
+	double drawListTotal = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		double start = NowMilliseconds();
+		for (std::shared_ptr<LegacyEntity> e : legacy)
+			e->GetTransform()->MoveAbsolute(0.0f, 0.001f, 0.0f);
+		updateTotal += NowMilliseconds() - start;
+
+		drawList.clear();
+		start = NowMilliseconds();
+		for (std::shared_ptr<LegacyEntity> e : legacy)
+			drawList.push_back({ e->GetMesh().get(), e->GetMaterial().get(), e->GetTransform().get(), 0 });
+		drawListTotal += NowMilliseconds() - start;
+	}
+	result.legacyUpdateMilliseconds = updateTotal / iterations;
+	result.legacyDrawListMilliseconds = drawListTotal / iterations;
+
+	updateTotal = 0.0;
+	drawListTotal = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		double start = NowMilliseconds();
+		for (unsigned int row = 0; row < store.GetCount(); row++)
+			store.GetTransform(row).MoveAbsolute(0.0f, 0.001f, 0.0f);
+		updateTotal += NowMilliseconds() - start;
+
+		drawList.clear();
+		start = NowMilliseconds();
+		for (unsigned int row = 0; row < store.GetCount(); row++)
+			drawList.push_back({ store.GetMesh(row), store.GetMaterial(row), &store.GetTransform(row), store.GetLod(row) });
+		drawListTotal += NowMilliseconds() - start;
+	}
+	result.storeUpdateMilliseconds = updateTotal / iterations;
+	result.storeDrawListMilliseconds = drawListTotal / iterations;
+
+	return result;
+}
+
+// --------------------------------------------------------
+// Scatters objects of random sizes through a cube around a
+// camera and times culling them both ways.  The camera looks
+// down +Z with a 60 degree, 16:9 view reaching 500 units, so
+// a bit under a tenth of the scene is visible.
+// --------------------------------------------------------
+Benchmarks::CullingResult Benchmarks::CompareCulling(unsigned int objectCount, int iterations)
+{
+	CullingResult result = {};
+	if (iterations < 1)
+		iterations = 1;
+
+	std::vector<float> sphereX(objectCount), sphereY(objectCount), sphereZ(objectCount), sphereRadius(objectCount);
+	std::vector<float> boxX(objectCount), boxY(objectCount), boxZ(objectCount);
+	std::vector<float> extentX(objectCount), extentY(objectCount), extentZ(objectCount);
+
+	std::mt19937 rng(4321);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	for (unsigned int i = 0; i < objectCount; i++)
+	{
+		// Mostly small objects with the odd large one
+		float size = 0.5f + 20.0f * powf(unit(rng) * 0.5f + 0.5f, 8.0f);
+		boxX[i] = sphereX[i] = unit(rng) * 500.0f;
+		boxY[i] = sphereY[i] = unit(rng) * 500.0f;
+		boxZ[i] = sphereZ[i] = unit(rng) * 500.0f;
+		extentX[i] = size * (unit(rng) * 0.45f + 0.55f);
+		extentY[i] = size * (unit(rng) * 0.45f + 0.55f);
+		extentZ[i] = size * (unit(rng) * 0.45f + 0.55f);
+		sphereRadius[i] = sqrtf(extentX[i] * extentX[i] + extentY[i] * extentY[i] + extentZ[i] * extentZ[i]);
+	}
+	result.objectCount = objectCount;
+
+	FrustumCulling::Bounds bounds = {
+		sphereX.data(), sphereY.data(), sphereZ.data(), sphereRadius.data(),
+		boxX.data(), boxY.data(), boxZ.data(), extentX.data(), extentY.data(), extentZ.data() };
+
+	float fov = DirectX::XM_PI / 3.0f;
+	DirectX::XMFLOAT4X4 viewProjection;
+	DirectX::XMStoreFloat4x4(&viewProjection, DirectX::XMMatrixMultiply(
+		DirectX::XMMatrixLookToLH(DirectX::XMVectorZero(), DirectX::XMVectorSet(0, 0, 1, 0), DirectX::XMVectorSet(0, 1, 0, 0)),
+		DirectX::XMMatrixPerspectiveFovLH(fov, 16.0f / 9.0f, 0.1f, 500.0f)));
+
+	FrustumCulling::View view = {};
+	MeshProcessing::ExtractFrustumPlanes(viewProjection, view.planes);
+	view.tanHalfFov = tanf(fov * 0.5f);
+
+	std::vector<unsigned int> reference;
+	std::vector<unsigned int> simd;
+	reference.reserve(objectCount);
+	simd.reserve(objectCount);
+
+	double total = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		double start = NowMilliseconds();
+		FrustumCulling::CullReference(bounds, objectCount, view, reference);
+		total += NowMilliseconds() - start;
+	}
+	result.referenceMilliseconds = total / iterations;
+
+	total = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		double start = NowMilliseconds();
+		FrustumCulling::Cull(bounds, objectCount, view, simd);
+		total += NowMilliseconds() - start;
+	}
+	result.simdMilliseconds = total / iterations;
+	result.visibleCount = (unsigned int)simd.size();
+	result.identical = simd == reference;
+
+	// Shadow casters, from a light shining down and across the camera
+	// with an ortho box that takes in about half the scene, so casters
+	// off the screen (and outside the box, toward the light) still count
+	std::vector<unsigned int> visible = simd;
+	DirectX::XMVECTOR lightDirection = DirectX::XMVector3Normalize(DirectX::XMVectorSet(1.0f, -2.0f, 0.5f, 0.0f));
+	DirectX::XMFLOAT4X4 lightView, lightProjection;
+	DirectX::XMStoreFloat4x4(&lightView, DirectX::XMMatrixLookToLH(
+		DirectX::XMVectorScale(lightDirection, -400.0f), lightDirection, DirectX::XMVectorSet(0, 1, 0, 0)));
+	DirectX::XMStoreFloat4x4(&lightProjection, DirectX::XMMatrixOrthographicLH(800.0f, 800.0f, 0.1f, 1000.0f));
+
+	std::vector<unsigned int> referenceCasters;
+	std::vector<unsigned int> simdCasters;
+	total = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		double start = NowMilliseconds();
+		FrustumCulling::CullShadowCastersReference(bounds, objectCount, lightView, lightProjection, visible, referenceCasters);
+		total += NowMilliseconds() - start;
+	}
+	result.shadowReferenceMilliseconds = total / iterations;
+
+	total = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		double start = NowMilliseconds();
+		FrustumCulling::CullShadowCasters(bounds, objectCount, lightView, lightProjection, visible, simdCasters);
+		total += NowMilliseconds() - start;
+	}
+	result.shadowSimdMilliseconds = total / iterations;
+	result.casterCount = (unsigned int)simdCasters.size();
+	result.shadowIdentical = simdCasters == referenceCasters;
+	for (unsigned int i : simdCasters)
+	{
+		if (!std::binary_search(visible.begin(), visible.end(), i))
+			result.offscreenCasters++;
+	}
+
+	// Receivers picked without regard to the camera, most of them off
+	// the screen, some outside the light's box; then spheres alone, over
+	// a count that leaves a partial group of four at the end
+	std::vector<unsigned int> scattered;
+	for (unsigned int i = 0; i < objectCount; i += 97)
+		scattered.push_back(i);
+	FrustumCulling::CullShadowCastersReference(bounds, objectCount, lightView, lightProjection, scattered, referenceCasters);
+	FrustumCulling::CullShadowCasters(bounds, objectCount, lightView, lightProjection, scattered, simdCasters);
+	result.shadowIdentical = result.shadowIdentical && simdCasters == referenceCasters;
+
+	FrustumCulling::Bounds spheres = { sphereX.data(), sphereY.data(), sphereZ.data(), sphereRadius.data() };
+	size_t partialCount = objectCount > 0 ? objectCount - 1 : 0;
+	FrustumCulling::CullShadowCastersReference(spheres, partialCount, lightView, lightProjection, visible, referenceCasters);
+	FrustumCulling::CullShadowCasters(spheres, partialCount, lightView, lightProjection, visible, simdCasters);
+	result.shadowIdentical = result.shadowIdentical && simdCasters == referenceCasters;
+
+	// The screen-size cutoff, checked the same way
+	view.minScreenSize = 0.01f;
+	FrustumCulling::CullReference(bounds, objectCount, view, reference);
+	FrustumCulling::Cull(bounds, objectCount, view, simd);
+	result.smallCulled = result.visibleCount - (unsigned int)simd.size();
+	result.identical = result.identical && simd == reference;
+
+	return result;
+}
+
+
+// --------------------------------------------------------
+// Queues a frame's worth of opaque draws the way EntityStore
+// does, in scene order: 8 shader programs, 128 materials
+// (each with one of those shaders) and 512 meshes, picked at
+// random, at random depths.  Both sorts start from the same
+// unsorted queue every iteration; only the sorting is timed.
+// --------------------------------------------------------
+Benchmarks::RenderQueueResult Benchmarks::CompareRenderQueueSort(unsigned int drawCount, int iterations)
+{
+	RenderQueueResult result = {};
+	if (iterations < 1)
+		iterations = 1;
+
+	// Stand-ins for the resources, so ids come from real addresses
+	const unsigned int shaderCount = 8;
+	const unsigned int materialCount = 128;
+	const unsigned int meshCount = 512;
+	std::vector<char> shaders(shaderCount), materials(materialCount), meshes(meshCount);
+
+	RenderQueue queue;
+	std::vector<uint64_t> keys(drawCount);
+	std::mt19937 rng(2468);
+	std::uniform_real_distribution<float> depth(0.0f, 500.0f);
+	for (unsigned int i = 0; i < drawCount; i++)
+	{
+		unsigned int material = rng() % materialCount;
+		unsigned int shader = material % shaderCount;
+		keys[i] = RenderQueue::MakeKey(
+			RenderQueue::PassOpaque,
+			queue.GetShaderId(&shaders[shader], &shaders[shader]),
+			queue.GetMaterialId(&materials[material]),
+			queue.GetMeshId(&meshes[rng() % meshCount]),
+			RenderQueue::QuantizeDepth(depth(rng), 500.0f));
+	}
+	result.drawCount = drawCount;
+
+	auto refill = [&]()
+	{
+		queue.Clear();
+		for (unsigned int i = 0; i < drawCount; i++)
+			queue.Add(keys[i], i);
+	};
+
+	refill();
+	result.unsortedChanges = CountStateChanges(queue);
+
+	std::vector<unsigned int> reference(drawCount);
+	double total = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		refill();
+		double start = NowMilliseconds();
+		queue.SortReference();
+		total += NowMilliseconds() - start;
+	}
+	result.referenceMilliseconds = total / iterations;
+	for (unsigned int i = 0; i < drawCount; i++)
+		reference[i] = queue.GetValue(i);
+
+	total = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		refill();
+		double start = NowMilliseconds();
+		queue.Sort();
+		total += NowMilliseconds() - start;
+	}
+	result.radixMilliseconds = total / iterations;
+	result.skippedPasses = queue.GetSkippedPasses();
+	result.sortedChanges = CountStateChanges(queue);
+
+	result.identical = true;
+	for (unsigned int i = 0; i < drawCount; i++)
+		result.identical = result.identical && queue.GetValue(i) == reference[i];
+
+	return result;
+}
+
+// --------------------------------------------------------
+// Builds a scene of a grid of entities sharing 8 meshes and
+// 8 materials, with random rotations and every fourth entity
+// parented to the one before it, then times each step of
+// loading it.  The binary file goes in the temp directory
+// and is removed afterwards.
+// --------------------------------------------------------
+Benchmarks::SceneLoadResult Benchmarks::MeasureSceneLoad(unsigned int entityCount, int iterations)
+{
+	SceneLoadResult result = {};
+	if (iterations < 1)
+		iterations = 1;
+
+	const unsigned int sharedCount = 8;
+	SceneFile::Scene scene;
+	for (unsigned int i = 0; i < sharedCount; i++)
+	{
+		SceneFile::MeshRecord mesh = {};
+		mesh.Name = SceneFile::AddString(scene, "Mesh " + std::to_string(i));
+		mesh.Path = SceneFile::AddString(scene, "../../Assets/Models/mesh" + std::to_string(i) + ".obj");
+		scene.Meshes.push_back(mesh);
+	}
+	for (unsigned int i = 0; i < sharedCount; i++)
+	{
+		SceneFile::MaterialRecord material = SceneFile::DefaultMaterial();
+		material.Name = SceneFile::AddString(scene, "Material " + std::to_string(i));
+		material.Roughness = i / (float)sharedCount;
+		scene.Materials.push_back(material);
+	}
+
+	std::mt19937 rng(2468);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	unsigned int side = (unsigned int)std::ceil(std::sqrt((double)entityCount));
+	for (unsigned int i = 0; i < entityCount; i++)
+	{
+		SceneFile::EntityRecord entity = SceneFile::DefaultEntity();
+		entity.Mesh = i % sharedCount;
+		entity.Material = (i / 3) % sharedCount;
+		entity.Position = DirectX::XMFLOAT3((float)(i % side) * 2.0f, 0.0f, (float)(i / side) * 2.0f);
+		DirectX::XMStoreFloat4(&entity.Rotation, DirectX::XMQuaternionNormalize(DirectX::XMVectorSet(unit(rng), unit(rng), unit(rng), 1.0f)));
+		if (i % 4 == 3)
+		{
+			entity.Parent = i - 1;
+			entity.Position = DirectX::XMFLOAT3(0.0f, 1.5f, 0.0f);
+			entity.Scale = DirectX::XMFLOAT3(0.5f, 0.5f, 0.5f);
+		}
+		scene.Entities.push_back(entity);
+	}
+	scene.Lights.push_back(SceneFile::DefaultLight());
+	scene.Cameras.push_back(SceneFile::DefaultCamera());
+	result.entityCount = entityCount;
+
+	// Meshes and materials are only handed around, never used
+	std::shared_ptr<Mesh> meshes[sharedCount];
+	std::shared_ptr<Material> materials[sharedCount];
+	for (unsigned int i = 0; i < sharedCount; i++)
+	{
+		meshes[i] = std::shared_ptr<Mesh>((Mesh*)0, [](Mesh*) {});
+		materials[i] = std::shared_ptr<Material>((Material*)0, [](Material*) {});
+	}
+
+	// Text first, as a scene would be authored
+	std::string text;
+	double start = 0.0;
+	double total = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		start = NowMilliseconds();
+		text = SceneFile::FormatText(scene);
+		total += NowMilliseconds() - start;
+	}
+	result.formatMilliseconds = total / iterations;
+	result.textBytes = (unsigned int)text.size();
+
+	SceneFile::Scene parsed;
+	total = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		start = NowMilliseconds();
+		SceneFile::ParseText(text.data(), text.size(), parsed);
+		total += NowMilliseconds() - start;
+	}
+	result.parseMilliseconds = total / iterations;
+
+	// Then the binary built from the parsed text
+	std::string path = (std::filesystem::temp_directory_path() / "SceneLoadBenchmark.scene.bin").string();
+	if (!SceneFile::Write(path.c_str(), 0, parsed))
+		return result;
+	result.binaryBytes = (unsigned int)std::filesystem::file_size(path);
+
+	double openTotal = 0.0;
+	double createTotal = 0.0;
+	SceneFile::Scene loaded;
+	for (int i = 0; i < iterations; i++)
+	{
+		MappedFile file;
+		start = NowMilliseconds();
+		const SceneFile::Header* header = SceneFile::Open(path.c_str(), 0, file);
+		openTotal += NowMilliseconds() - start;
+		if (!header)
+			break;
+
+		TransformSystem system;
+		EntityStore store(system);
+		start = NowMilliseconds();
+		store.CreateFromScene(SceneFile::GetEntities(header), header->EntityCount, meshes, materials);
+		createTotal += NowMilliseconds() - start;
+
+		if (i == 0)
+			SceneFile::Read(header, loaded);
+	}
+	result.openMilliseconds = openTotal / iterations;
+	result.createMilliseconds = createTotal / iterations;
+
+	// Same text back out, and the same records as the scene started with
+	result.roundTrip =
+		SceneFile::FormatText(loaded) == text &&
+		loaded.Entities.size() == scene.Entities.size() &&
+		memcmp(loaded.Entities.data(), scene.Entities.data(), scene.Entities.size() * sizeof(SceneFile::EntityRecord)) == 0;
+
+	std::error_code error;
+	std::filesystem::remove(path, error);
+	return result;
+}
+
+// --------------------------------------------------------
+// Scatters boxes through a cube as CompareCulling does, then
+// runs a number of frames in which a fraction of them drift
+// (bouncing off the cube's walls).  Each frame re-files the
+// movers and runs a frustum query plus 64 random sphere and
+// ray queries, both through the octree and against every box.
+// --------------------------------------------------------
+Benchmarks::SpatialIndexResult Benchmarks::MeasureSpatialIndex(unsigned int objectCount, float movingFraction, int frames)
+{
+	SpatialIndexResult result = {};
+	if (frames < 1)
+		frames = 1;
+
+	std::vector<DirectX::XMFLOAT3> centers(objectCount), extents(objectCount), velocities(objectCount);
+	std::mt19937 rng(8642);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	for (unsigned int i = 0; i < objectCount; i++)
+	{
+		// Mostly small objects with the odd large one
+		float size = 0.5f + 20.0f * powf(unit(rng) * 0.5f + 0.5f, 8.0f);
+		centers[i] = DirectX::XMFLOAT3(unit(rng) * 500.0f, unit(rng) * 500.0f, unit(rng) * 500.0f);
+		extents[i] = DirectX::XMFLOAT3(
+			size * (unit(rng) * 0.45f + 0.55f),
+			size * (unit(rng) * 0.45f + 0.55f),
+			size * (unit(rng) * 0.45f + 0.55f));
+		velocities[i] = DirectX::XMFLOAT3(unit(rng), unit(rng), unit(rng));
+	}
+	result.objectCount = objectCount;
+	result.movingCount = (unsigned int)(objectCount * std::min(std::max(movingFraction, 0.0f), 1.0f));
+
+	LooseOctree octree(DirectX::XMFLOAT3(0, 0, 0), 512.0f);
+	double start = NowMilliseconds();
+	for (unsigned int i = 0; i < objectCount; i++)
+		octree.Update(i, centers[i], extents[i]);
+	result.buildMilliseconds = NowMilliseconds() - start;
+
+	// The same camera as CompareCulling
+	float fov = DirectX::XM_PI / 3.0f;
+	DirectX::XMFLOAT4X4 viewProjection;
+	DirectX::XMStoreFloat4x4(&viewProjection, DirectX::XMMatrixMultiply(
+		DirectX::XMMatrixLookToLH(DirectX::XMVectorZero(), DirectX::XMVectorSet(0, 0, 1, 0), DirectX::XMVectorSet(0, 1, 0, 0)),
+		DirectX::XMMatrixPerspectiveFovLH(fov, 16.0f / 9.0f, 0.1f, 500.0f)));
+	DirectX::XMFLOAT4 planes[6];
+	MeshProcessing::ExtractFrustumPlanes(viewProjection, planes);
+
+	const int queryCount = 64;
+	DirectX::XMFLOAT3 sphereCenters[queryCount], rayOrigins[queryCount], rayDirections[queryCount];
+	float sphereRadii[queryCount];
+
+	std::vector<unsigned int> found, expected;
+	found.reserve(objectCount);
+	expected.reserve(objectCount);
+	result.identical = true;
+
+	unsigned int relinksBefore = octree.GetRelinkCount();
+	double updateTotal = 0.0, frustumTotal = 0.0, linearFrustumTotal = 0.0;
+	double sphereTotal = 0.0, linearSphereTotal = 0.0, rayTotal = 0.0, linearRayTotal = 0.0;
+	for (int frame = 0; frame < frames; frame++)
+	{
+		for (unsigned int i = 0; i < result.movingCount; i++)
+		{
+			float* c = &centers[i].x;
+			float* v = &velocities[i].x;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				c[axis] += v[axis];
+				if (fabsf(c[axis]) > 500.0f)
+					v[axis] = -v[axis];
+			}
+		}
+
+		start = NowMilliseconds();
+		for (unsigned int i = 0; i < result.movingCount; i++)
+			octree.Update(i, centers[i], extents[i]);
+		updateTotal += NowMilliseconds() - start;
+
+		// Frustum
+		found.clear();
+		start = NowMilliseconds();
+		octree.QueryFrustum(planes, found);
+		frustumTotal += NowMilliseconds() - start;
+
+		expected.clear();
+		start = NowMilliseconds();
+		for (unsigned int i = 0; i < objectCount; i++)
+		{
+			if (BoxInFrustum(planes, centers[i], extents[i]))
+				expected.push_back(i);
+		}
+		linearFrustumTotal += NowMilliseconds() - start;
+
+		std::sort(found.begin(), found.end());
+		result.identical = result.identical && found == expected;
+
+		// Spheres about the size of a point light's range
+		for (int q = 0; q < queryCount; q++)
+		{
+			sphereCenters[q] = DirectX::XMFLOAT3(unit(rng) * 500.0f, unit(rng) * 500.0f, unit(rng) * 500.0f);
+			sphereRadii[q] = 10.0f + 20.0f * (unit(rng) * 0.5f + 0.5f);
+		}
+
+		found.clear();
+		start = NowMilliseconds();
+		for (int q = 0; q < queryCount; q++)
+			octree.QuerySphere(sphereCenters[q], sphereRadii[q], found);
+		sphereTotal += NowMilliseconds() - start;
+
+		expected.clear();
+		start = NowMilliseconds();
+		for (int q = 0; q < queryCount; q++)
+		{
+			for (unsigned int i = 0; i < objectCount; i++)
+			{
+				if (BoxTouchesSphere(sphereCenters[q], sphereRadii[q], centers[i], extents[i]))
+					expected.push_back(i);
+			}
+		}
+		linearSphereTotal += NowMilliseconds() - start;
+
+		std::sort(found.begin(), found.end());
+		std::sort(expected.begin(), expected.end());
+		result.identical = result.identical && found == expected;
+
+		// Rays from random points in random directions, like picking
+		for (int q = 0; q < queryCount; q++)
+		{
+			rayOrigins[q] = DirectX::XMFLOAT3(unit(rng) * 500.0f, unit(rng) * 500.0f, unit(rng) * 500.0f);
+			DirectX::XMStoreFloat3(&rayDirections[q], DirectX::XMVector3Normalize(DirectX::XMVectorSet(unit(rng), unit(rng), unit(rng), 0)));
+		}
+
+		found.clear();
+		start = NowMilliseconds();
+		for (int q = 0; q < queryCount; q++)
+			octree.QueryRay(rayOrigins[q], rayDirections[q], 1000.0f, found);
+		rayTotal += NowMilliseconds() - start;
+
+		expected.clear();
+		start = NowMilliseconds();
+		for (int q = 0; q < queryCount; q++)
+		{
+			DirectX::XMFLOAT3 d = rayDirections[q];
+			DirectX::XMFLOAT3 inverseDirection(1.0f / d.x, 1.0f / d.y, 1.0f / d.z);
+			for (unsigned int i = 0; i < objectCount; i++)
+			{
+				if (RayHitsBox(rayOrigins[q], inverseDirection, 1000.0f, centers[i], extents[i]))
+					expected.push_back(i);
+			}
+		}
+		linearRayTotal += NowMilliseconds() - start;
+
+		std::sort(found.begin(), found.end());
+		std::sort(expected.begin(), expected.end());
+		result.identical = result.identical && found == expected;
+	}
+
+	result.nodeCount = octree.GetNodeCount();
+	result.updateMilliseconds = updateTotal / frames;
+	if (result.movingCount > 0)
+		result.relinkRate = (octree.GetRelinkCount() - relinksBefore) / (float)((double)result.movingCount * frames);
+	result.frustumMilliseconds = frustumTotal / frames;
+	result.linearFrustumMilliseconds = linearFrustumTotal / frames;
+	result.sphereMilliseconds = sphereTotal / frames;
+	result.linearSphereMilliseconds = linearSphereTotal / frames;
+	result.rayMilliseconds = rayTotal / frames;
+	result.linearRayMilliseconds = linearRayTotal / frames;
+	return result;
+}
+
+// --------------------------------------------------------
+// Builds MeasureSpatialIndex's scene out of entities, each a
+// copy of the mesh scaled to one of the boxes, and moves the
+// same fraction of them every frame.  Each frame refreshes
+// the store's bounds once, then runs the frustum, sphere and
+// ray queries through the store.  Every row's world box is
+// also checked one by one, which is both what each query cost
+// before the refresh was incremental and the reference the
+// query results are compared against.
+// --------------------------------------------------------
+Benchmarks::EntityQueryResult Benchmarks::MeasureEntityQueries(std::shared_ptr<Mesh> mesh, unsigned int entityCount, float movingFraction, int frames)
+{
+	EntityQueryResult result = {};
+	if (frames < 1)
+		frames = 1;
+	if (!mesh)
+		return result;
+
+	// Materials are never touched, so a stand-in will do
+	std::shared_ptr<Material> material((Material*)0, [](Material*) {});
+	DirectX::BoundingBox meshBox = mesh->GetBoundingBox();
+
+	TransformSystem system;
+	EntityStore store(system);
+	store.Reserve(entityCount);
+
+	std::vector<DirectX::XMFLOAT3> centers(entityCount), velocities(entityCount);
+	std::mt19937 rng(8642);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	for (unsigned int i = 0; i < entityCount; i++)
+	{
+		// Mostly small objects with the odd large one
+		float size = 0.5f + 20.0f * powf(unit(rng) * 0.5f + 0.5f, 8.0f);
+		centers[i] = DirectX::XMFLOAT3(unit(rng) * 500.0f, unit(rng) * 500.0f, unit(rng) * 500.0f);
+		DirectX::XMFLOAT3 extents(
+			size * (unit(rng) * 0.45f + 0.55f),
+			size * (unit(rng) * 0.45f + 0.55f),
+			size * (unit(rng) * 0.45f + 0.55f));
+		velocities[i] = DirectX::XMFLOAT3(unit(rng), unit(rng), unit(rng));
+
+		unsigned int row = store.GetRow(store.Create(mesh, material));
+		store.GetTransform(row).SetPosition(centers[i]);
+		store.GetTransform(row).SetScale(
+			extents.x / std::max(meshBox.Extents.x, 0.001f),
+			extents.y / std::max(meshBox.Extents.y, 0.001f),
+			extents.z / std::max(meshBox.Extents.z, 0.001f));
+	}
+	store.UpdateBounds();
+	result.entityCount = entityCount;
+	result.movingCount = (unsigned int)(entityCount * std::min(std::max(movingFraction, 0.0f), 1.0f));
+
+	// The same camera as CompareCulling
+	float fov = DirectX::XM_PI / 3.0f;
+	DirectX::XMFLOAT4X4 viewProjection;
+	DirectX::XMStoreFloat4x4(&viewProjection, DirectX::XMMatrixMultiply(
+		DirectX::XMMatrixLookToLH(DirectX::XMVectorZero(), DirectX::XMVectorSet(0, 0, 1, 0), DirectX::XMVectorSet(0, 1, 0, 0)),
+		DirectX::XMMatrixPerspectiveFovLH(fov, 16.0f / 9.0f, 0.1f, 500.0f)));
+	FrustumCulling::View view = {};
+	MeshProcessing::ExtractFrustumPlanes(viewProjection, view.planes);
+	view.tanHalfFov = tanf(fov * 0.5f);
+
+	const int queryCount = 64;
+	DirectX::XMFLOAT3 sphereCenters[queryCount], rayOrigins[queryCount], rayDirections[queryCount];
+	float sphereRadii[queryCount];
+
+	std::vector<DirectX::BoundingBox> boxes(entityCount);
+	std::vector<unsigned int> rows, found, expected;
+	found.reserve(entityCount);
+	expected.reserve(entityCount);
+	result.identical = true;
+
+	double boundsUpdated = 0.0;
+	double boundsTotal = 0.0, rescanTotal = 0.0, frustumTotal = 0.0, sphereTotal = 0.0, rayTotal = 0.0;
+	for (int frame = 0; frame < frames; frame++)
+	{
+		for (unsigned int i = 0; i < result.movingCount; i++)
+		{
+			float* c = &centers[i].x;
+			float* v = &velocities[i].x;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				c[axis] += v[axis];
+				if (fabsf(c[axis]) > 500.0f)
+					v[axis] = -v[axis];
+			}
+			store.GetTransform(i).SetPosition(centers[i]);
+		}
+
+		double start = NowMilliseconds();
+		boundsUpdated += store.UpdateBounds();
+		boundsTotal += NowMilliseconds() - start;
+
+		start = NowMilliseconds();
+		for (unsigned int row = 0; row < entityCount; row++)
+			boxes[row] = store.GetWorldBoundingBox(row);
+		rescanTotal += NowMilliseconds() - start;
+
+		// Frustum
+		start = NowMilliseconds();
+		store.QueryFrustum(view, found);
+		frustumTotal += NowMilliseconds() - start;
+
+		expected.clear();
+		for (unsigned int row = 0; row < entityCount; row++)
+		{
+			if (BoxInFrustum(view.planes, boxes[row].Center, boxes[row].Extents))
+				expected.push_back(row);
+		}
+		result.identical = result.identical && found == expected;
+
+		// Spheres about the size of a point light's range
+		for (int q = 0; q < queryCount; q++)
+		{
+			sphereCenters[q] = DirectX::XMFLOAT3(unit(rng) * 500.0f, unit(rng) * 500.0f, unit(rng) * 500.0f);
+			sphereRadii[q] = 10.0f + 20.0f * (unit(rng) * 0.5f + 0.5f);
+		}
+
+		found.clear();
+		start = NowMilliseconds();
+		for (int q = 0; q < queryCount; q++)
+		{
+			store.QuerySphere(sphereCenters[q], sphereRadii[q], rows);
+			found.insert(found.end(), rows.begin(), rows.end());
+		}
+		sphereTotal += NowMilliseconds() - start;
+
+		expected.clear();
+		for (int q = 0; q < queryCount; q++)
+		{
+			for (unsigned int row = 0; row < entityCount; row++)
+			{
+				if (BoxTouchesSphere(sphereCenters[q], sphereRadii[q], boxes[row].Center, boxes[row].Extents))
+					expected.push_back(row);
+			}
+		}
+		result.identical = result.identical && found == expected;
+
+		// Rays from random points in random directions, like picking
+		for (int q = 0; q < queryCount; q++)
+		{
+			rayOrigins[q] = DirectX::XMFLOAT3(unit(rng) * 500.0f, unit(rng) * 500.0f, unit(rng) * 500.0f);
+			DirectX::XMStoreFloat3(&rayDirections[q], DirectX::XMVector3Normalize(DirectX::XMVectorSet(unit(rng), unit(rng), unit(rng), 0)));
+		}
+
+		found.clear();
+		start = NowMilliseconds();
+		for (int q = 0; q < queryCount; q++)
+		{
+			store.QueryRay(rayOrigins[q], rayDirections[q], 1000.0f, rows);
+			found.insert(found.end(), rows.begin(), rows.end());
+		}
+		rayTotal += NowMilliseconds() - start;
+
+		expected.clear();
+		for (int q = 0; q < queryCount; q++)
+		{
+			DirectX::XMFLOAT3 d = rayDirections[q];
+			DirectX::XMFLOAT3 inverseDirection(1.0f / d.x, 1.0f / d.y, 1.0f / d.z);
+			for (unsigned int row = 0; row < entityCount; row++)
+			{
+				if (RayHitsBox(rayOrigins[q], inverseDirection, 1000.0f, boxes[row].Center, boxes[row].Extents))
+					expected.push_back(row);
+			}
+		}
+		result.identical = result.identical && found == expected;
+	}
+
+	result.boundsUpdated = (unsigned int)(boundsUpdated / frames);
+	result.boundsMilliseconds = boundsTotal / frames;
+	result.rescanMilliseconds = rescanTotal / frames;
+	result.frustumMilliseconds = frustumTotal / frames;
+	result.sphereMilliseconds = sphereTotal / frames;
+	result.rayMilliseconds = rayTotal / frames;
+	return result;
+}
+
+// --------------------------------------------------------
+// A camera a few units above rolling ground (a 64x64 grid of
+// quads) looks down a field of walls, with boxes scattered
+// through the view, some of them under the ground.  Each
+// frame the camera slides sideways, the occluders are drawn
+// with as many threads as OcclusionBuffer picks and with one,
+// and every box is tested.  The reference casts rays from the
+// eye to a grid of points on each box's faces (those on the
+// screen): a box is hidden if none of them gets past the
+// occluders, and any box the buffer hid that a ray did reach
+// is a false occlusion.
+// --------------------------------------------------------
+Benchmarks::OcclusionResult Benchmarks::MeasureOcclusion(unsigned int boxCount, int frames)
+{
+	OcclusionResult result = {};
+	if (frames < 1)
+		frames = 1;
+
+	// Ground, as one occluder in world space
+	const int gridSize = 64;
+	const float groundSize = 400.0f;
+	std::vector<DirectX::XMFLOAT3> groundPositions;
+	std::vector<unsigned int> groundIndices;
+	for (int z = 0; z <= gridSize; z++)
+	{
+		for (int x = 0; x <= gridSize; x++)
+		{
+			float px = (x / (float)gridSize - 0.5f) * groundSize;
+			float pz = (z / (float)gridSize) * groundSize - 20.0f;
+			groundPositions.push_back(DirectX::XMFLOAT3(px, 2.0f * sinf(px * 0.05f) * cosf(pz * 0.04f), pz));
+		}
+	}
+	for (int z = 0; z < gridSize; z++)
+	{
+		for (int x = 0; x < gridSize; x++)
+		{
+			unsigned int i = z * (gridSize + 1) + x;
+			unsigned int quad[6] = { i, i + gridSize + 1, i + 1, i + 1, i + gridSize + 1, i + gridSize + 2 };
+			groundIndices.insert(groundIndices.end(), quad, quad + 6);
+		}
+	}
+
+	// A unit cube for the walls, wound clockwise seen from outside
+	std::vector<DirectX::XMFLOAT3> cubePositions;
+	std::vector<unsigned int> cubeIndices;
+	for (int i = 0; i < 8; i++)
+		cubePositions.push_back(DirectX::XMFLOAT3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f));
+	const unsigned int faces[6][4] = { { 0, 2, 3, 1 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 }, { 2, 6, 7, 3 }, { 0, 4, 6, 2 }, { 1, 3, 7, 5 } };
+	for (const unsigned int* face : faces)
+	{
+		unsigned int quad[6] = { face[0], face[1], face[2], face[0], face[2], face[3] };
+		for (int t = 0; t < 6; t += 3)
+		{
+			DirectX::XMVECTOR a = DirectX::XMLoadFloat3(&cubePositions[quad[t]]);
+			DirectX::XMVECTOR b = DirectX::XMLoadFloat3(&cubePositions[quad[t + 1]]);
+			DirectX::XMVECTOR c = DirectX::XMLoadFloat3(&cubePositions[quad[t + 2]]);
+			DirectX::XMVECTOR normal = DirectX::XMVector3Cross(DirectX::XMVectorSubtract(b, a), DirectX::XMVectorSubtract(c, a));
+			if (DirectX::XMVectorGetX(DirectX::XMVector3Dot(normal, DirectX::XMVectorAdd(a, DirectX::XMVectorAdd(b, c)))) < 0)
+				std::swap(quad[t + 1], quad[t + 2]);
+			cubeIndices.insert(cubeIndices.end(), quad + t, quad + t + 3);
+		}
+	}
+
+	MeshProcessing::OccluderGeometry ground = MeshProcessing::BuildOccluderGeometry(groundPositions.data(), groundIndices.data(), groundIndices.size());
+	MeshProcessing::OccluderGeometry cube = MeshProcessing::BuildOccluderGeometry(cubePositions.data(), cubeIndices.data(), cubeIndices.size());
+	DirectX::XMFLOAT4X4 identity;
+	DirectX::XMStoreFloat4x4(&identity, DirectX::XMMatrixIdentity());
+
+	// Walls of varying width across the view, kept in world space too
+	// for the reference rays
+	std::mt19937 rng(1357);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	const int wallCount = 12;
+	std::vector<DirectX::XMFLOAT4X4> walls(wallCount);
+	std::vector<DirectX::XMFLOAT3> worldPositions(groundPositions);
+	std::vector<unsigned int> worldIndices(groundIndices);
+	for (int w = 0; w < wallCount; w++)
+	{
+		DirectX::XMMATRIX world = DirectX::XMMatrixMultiply(
+			DirectX::XMMatrixScaling(5.0f + 15.0f * unit(rng), 4.0f + 6.0f * unit(rng), 0.5f),
+			DirectX::XMMatrixTranslation(-100.0f + 200.0f * unit(rng), 3.0f, 20.0f + 180.0f * unit(rng)));
+		DirectX::XMStoreFloat4x4(&walls[w], world);
+
+		unsigned int first = (unsigned int)worldPositions.size();
+		for (const DirectX::XMFLOAT3& p : cubePositions)
+		{
+			DirectX::XMFLOAT3 transformed;
+			DirectX::XMStoreFloat3(&transformed, DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&p), world));
+			worldPositions.push_back(transformed);
+		}
+		for (unsigned int index : cubeIndices)
+			worldIndices.push_back(first + index);
+	}
+	MeshBVH occluderBVH(worldPositions.data(), worldIndices.data(), worldIndices.size());
+
+	// Boxes, from just above the camera's height to under the ground
+	std::vector<DirectX::XMFLOAT3> centers(boxCount), extents(boxCount);
+	for (unsigned int i = 0; i < boxCount; i++)
+	{
+		float size = 0.25f + 1.5f * unit(rng);
+		centers[i] = DirectX::XMFLOAT3(-150.0f + 300.0f * unit(rng), -8.0f + 14.0f * unit(rng), 5.0f + 300.0f * unit(rng));
+		extents[i] = DirectX::XMFLOAT3(size, size * (0.5f + unit(rng)), size);
+	}
+
+	OcclusionBuffer buffer;
+	OcclusionBuffer singleThreaded(buffer.GetWidth(), buffer.GetHeight(), 1);
+	result.width = buffer.GetWidth();
+	result.height = buffer.GetHeight();
+	result.threadCount = buffer.GetThreadCount();
+	result.identical = true;
+
+	DirectX::XMFLOAT4X4 projection;
+	DirectX::XMStoreFloat4x4(&projection, DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PI / 3.0f, 16.0f / 9.0f, 0.1f, 400.0f));
+
+	const int samples = 4;
+	double setupTotal = 0.0, rasterTotal = 0.0, singleTotal = 0.0, pyramidTotal = 0.0, testTotal = 0.0;
+	unsigned int testedTotal = 0, occludedTotal = 0, hiddenTotal = 0;
+	for (int frame = 0; frame < frames; frame++)
+	{
+		DirectX::XMVECTOR eye = DirectX::XMVectorSet(-20.0f + 40.0f * frame / frames, 5.0f, -10.0f, 0);
+		DirectX::XMFLOAT4X4 view;
+		DirectX::XMStoreFloat4x4(&view, DirectX::XMMatrixLookToLH(eye, DirectX::XMVectorSet(0, -0.1f, 1, 0), DirectX::XMVectorSet(0, 1, 0, 0)));
+		DirectX::XMFLOAT3 eyePosition;
+		DirectX::XMStoreFloat3(&eyePosition, eye);
+
+		DirectX::XMFLOAT4X4 viewProjection;
+		DirectX::XMStoreFloat4x4(&viewProjection, DirectX::XMMatrixMultiply(DirectX::XMLoadFloat4x4(&view), DirectX::XMLoadFloat4x4(&projection)));
+		DirectX::XMFLOAT4 planes[6];
+		MeshProcessing::ExtractFrustumPlanes(viewProjection, planes);
+
+		OcclusionBuffer* buffers[2] = { &buffer, &singleThreaded };
+		for (OcclusionBuffer* b : buffers)
+		{
+			b->Begin(view, projection);
+			b->AddOccluder(identity, ground);
+			for (const DirectX::XMFLOAT4X4& wall : walls)
+				b->AddOccluder(wall, cube);
+			b->Render();
+		}
+		setupTotal += buffer.GetSetupMilliseconds();
+		rasterTotal += buffer.GetRasterMilliseconds();
+		singleTotal += singleThreaded.GetRasterMilliseconds();
+		pyramidTotal += buffer.GetPyramidMilliseconds();
+		result.triangleCount = buffer.GetTriangleCount();
+
+		for (unsigned int y = 0; y < buffer.GetHeight(); y++)
+		{
+			for (unsigned int x = 0; x < buffer.GetWidth(); x++)
+				result.identical = result.identical && buffer.GetDepth(x, y) == singleThreaded.GetDepth(x, y);
+		}
+
+		// Only boxes in view count
+		std::vector<unsigned int> inView;
+		for (unsigned int i = 0; i < boxCount; i++)
+		{
+			if (BoxInFrustum(planes, centers[i], extents[i]))
+				inView.push_back(i);
+		}
+
+		std::vector<unsigned char> occluded(inView.size());
+		double start = NowMilliseconds();
+		for (size_t i = 0; i < inView.size(); i++)
+			occluded[i] = buffer.IsOccluded(centers[inView[i]], extents[inView[i]]);
+		testTotal += NowMilliseconds() - start;
+
+		for (size_t i = 0; i < inView.size(); i++)
+		{
+			DirectX::XMFLOAT3 c = centers[inView[i]], e = extents[inView[i]];
+			bool reached = false;
+			for (int face = 0; face < 6 && !reached; face++)
+			{
+				int axis = face / 2;
+				for (int s = 0; s < samples * samples && !reached; s++)
+				{
+					float point[3] = { c.x, c.y, c.z };
+					float size[3] = { e.x, e.y, e.z };
+					float u = (s % samples) / (float)(samples - 1) * 2.0f - 1.0f;
+					float v = (s / samples) / (float)(samples - 1) * 2.0f - 1.0f;
+					point[axis] += face % 2 ? size[axis] : -size[axis];
+					point[(axis + 1) % 3] += u * size[(axis + 1) % 3];
+					point[(axis + 2) % 3] += v * size[(axis + 2) % 3];
+
+					// Off the screen doesn't count
+					DirectX::XMFLOAT4 clip;
+					DirectX::XMStoreFloat4(&clip, DirectX::XMVector3Transform(DirectX::XMVectorSet(point[0], point[1], point[2], 1), DirectX::XMLoadFloat4x4(&viewProjection)));
+					if (clip.w <= 0 || fabsf(clip.x) > clip.w || fabsf(clip.y) > clip.w || clip.z < 0 || clip.z > clip.w)
+						continue;
+
+					MeshBVH::RayHit hit;
+					DirectX::XMFLOAT3 direction(point[0] - eyePosition.x, point[1] - eyePosition.y, point[2] - eyePosition.z);
+					reached = !occluderBVH.Intersect(eyePosition, direction, 0.9999f, hit);
+				}
+			}
+
+			testedTotal++;
+			occludedTotal += occluded[i];
+			hiddenTotal += reached ? 0 : 1;
+			result.falseOcclusions += occluded[i] && reached ? 1 : 0;
+		}
+	}
+
+	result.boxCount = testedTotal / frames;
+	result.occludedCount = occludedTotal / frames;
+	result.hiddenCount = hiddenTotal / frames;
+	result.setupMilliseconds = setupTotal / frames;
+	result.rasterMilliseconds = rasterTotal / frames;
+	result.singleThreadRasterMilliseconds = singleTotal / frames;
+	result.pyramidMilliseconds = pyramidTotal / frames;
+	result.testMilliseconds = testTotal / frames;
+	return result;
+}
+
+// --------------------------------------------------------
+// Splits "drawCount" draws over the passes and records them
+// all on one thread, then again with a thread per pass (the
+// way Game records its shadow pass alongside the rest).
+// Both sets are stitched in pass order and compared byte for
+// byte, and the stitched stream is replayed by a recording
+// backend, which should see every draw.
+// --------------------------------------------------------
+Benchmarks::CommandResult Benchmarks::MeasureCommandRecording(unsigned int drawCount, unsigned int passCount, int iterations)
+{
+	CommandResult result = {};
+	if (iterations < 1)
+		iterations = 1;
+	if (passCount < 1)
+		passCount = 1;
+
+	std::vector<char> resources(2048);
+	std::vector<CommandBuffer> serialPasses(passCount);
+	std::vector<CommandBuffer> parallelPasses(passCount);
+	unsigned int drawsPerPass = drawCount / passCount;
+	result.passCount = passCount;
+	result.drawCount = drawsPerPass * passCount;
+
+	double serialTotal = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		double start = NowMilliseconds();
+		for (unsigned int p = 0; p < passCount; p++)
+			RecordSyntheticPass(serialPasses[p], p, drawsPerPass, resources.data());
+		serialTotal += NowMilliseconds() - start;
+	}
+	result.serialMilliseconds = serialTotal / iterations;
+
+	double parallelTotal = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		double start = NowMilliseconds();
+		std::vector<std::thread> workers;
+		for (unsigned int p = 1; p < passCount; p++)
+			workers.emplace_back([&, p]() { RecordSyntheticPass(parallelPasses[p], p, drawsPerPass, resources.data()); });
+		RecordSyntheticPass(parallelPasses[0], 0, drawsPerPass, resources.data());
+		for (std::thread& t : workers)
+			t.join();
+		parallelTotal += NowMilliseconds() - start;
+	}
+	result.parallelMilliseconds = parallelTotal / iterations;
+
+	CommandBuffer serialFrame;
+	for (unsigned int p = 0; p < passCount; p++)
+		serialFrame.Append(serialPasses[p]);
+
+	CommandBuffer frame;
+	double stitchTotal = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		double start = NowMilliseconds();
+		frame.Clear();
+		for (unsigned int p = 0; p < passCount; p++)
+			frame.Append(parallelPasses[p]);
+		stitchTotal += NowMilliseconds() - start;
+	}
+	result.stitchMilliseconds = stitchTotal / iterations;
+	result.commandCount = frame.GetCommandCount();
+	result.kilobytes = frame.GetSize() / 1024.0;
+
+	RecordingBackend backend;
+	double replayTotal = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		backend.Reset();
+		double start = NowMilliseconds();
+		backend.Execute(frame);
+		replayTotal += NowMilliseconds() - start;
+	}
+	result.replayMilliseconds = replayTotal / iterations;
+
+	const RecordingBackend::Stats& stats = backend.GetStats();
+	result.identical =
+		frame.GetSize() == serialFrame.GetSize() &&
+		(frame.GetSize() == 0 || memcmp(frame.GetFirst(), serialFrame.GetFirst(), frame.GetSize()) == 0) &&
+		stats.commandCount == frame.GetCommandCount() &&
+		stats.drawCount == result.drawCount;
+	return result;
+}
+
+// --------------------------------------------------------
+// Builds meshlets for a sphere and checks them against the
+// limits and the source triangles, then checks cone culling
+// against triangles that really do face away, and against a
+// flat grid seen from either side
+// --------------------------------------------------------
+Benchmarks::MeshletCheckResult Benchmarks::CheckMeshlets(unsigned int segments)
+{
+	MeshletCheckResult result = {};
+
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	BuildSphere(segments < 8 ? 8 : segments, verts, indices);
+	std::vector<uint64_t> sourceTriangles = SortedTriangles(indices, 0, indices.size());
+
+	MeshProcessing::OptimizeVertexCache(indices, verts.size());
+	std::vector<MeshProcessing::Meshlet> meshlets = MeshProcessing::BuildMeshlets(indices, verts);
+	result.meshletCount = (unsigned int)meshlets.size();
+
+	// Limits, spheres, and meshlets tiling the index buffer with no gaps
+	// or overlaps (so each triangle is in exactly one of them)
+	bool tiled = true;
+	unsigned int nextIndex = 0;
+	std::vector<MeshProcessing::Meshlet> ordered = meshlets;
+	std::sort(ordered.begin(), ordered.end(),
+		[](const MeshProcessing::Meshlet& a, const MeshProcessing::Meshlet& b) { return a.indexStart < b.indexStart; });
+	for (const MeshProcessing::Meshlet& meshlet : ordered)
+	{
+		tiled = tiled && meshlet.indexStart == nextIndex && meshlet.indexCount % 3 == 0;
+		nextIndex = meshlet.indexStart + meshlet.indexCount;
+
+		std::vector<unsigned int> unique(indices.begin() + meshlet.indexStart, indices.begin() + nextIndex);
+		std::sort(unique.begin(), unique.end());
+		unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+		result.maxVertices = std::max(result.maxVertices, (unsigned int)unique.size());
+		result.maxTriangles = std::max(result.maxTriangles, meshlet.indexCount / 3);
+
+		for (unsigned int v : unique)
+		{
+			DirectX::XMFLOAT3 p = verts[v].Position;
+			float dx = p.x - meshlet.center.x, dy = p.y - meshlet.center.y, dz = p.z - meshlet.center.z;
+			result.sphereOvershoot = std::max(result.sphereOvershoot, sqrtf(dx * dx + dy * dy + dz * dz) - meshlet.radius);
+		}
+	}
+	result.trianglesPreserved = tiled && nextIndex == indices.size() &&
+		SortedTriangles(indices, 0, indices.size()) == sourceTriangles;
+
+	// On a closed mesh the vertex limit binds first, so build again with
+	// room for more vertices to make the triangle limit the one that does
+	std::vector<unsigned int> looseIndices = indices;
+	std::vector<MeshProcessing::Meshlet> looseMeshlets = MeshProcessing::BuildMeshlets(looseIndices, verts, 256);
+	for (const MeshProcessing::Meshlet& meshlet : looseMeshlets)
+		result.maxLooseTriangles = std::max(result.maxLooseTriangles, meshlet.indexCount / 3);
+
+	// Any meshlet the cone test rejects must have no triangle facing the
+	// viewer, from a few points around and inside the sphere
+	DirectX::XMFLOAT3 viewpoints[4] = { { 0, 0, -4 }, { 3, 3, 3 }, { 0, -10, 0.5f }, { 0.1f, 0.2f, 0.1f } };
+	for (const DirectX::XMFLOAT3& view : viewpoints)
+	{
+		for (const MeshProcessing::Meshlet& meshlet : meshlets)
+		{
+			if (!MeshProcessing::IsMeshletBackfacing(meshlet, view))
+				continue;
+
+			result.coneRejects++;
+			for (unsigned int i = meshlet.indexStart; i < meshlet.indexStart + meshlet.indexCount; i += 3)
+			{
+				DirectX::XMFLOAT3 a = verts[indices[i]].Position;
+				DirectX::XMFLOAT3 b = verts[indices[i + 1]].Position;
+				DirectX::XMFLOAT3 c = verts[indices[i + 2]].Position;
+				float e1[3] = { b.x - a.x, b.y - a.y, b.z - a.z };
+				float e2[3] = { c.x - a.x, c.y - a.y, c.z - a.z };
+				float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+				if (n[0] * (view.x - a.x) + n[1] * (view.y - a.y) + n[2] * (view.z - a.z) > 1e-6f)
+				{
+					result.falseRejects++;
+					break;
+				}
+			}
+		}
+	}
+
+	// A flat grid is all front facing from above and all back facing
+	// from below, through CullMeshlets with planes that keep everything
+	BuildGrid(24, verts, indices);
+	MeshProcessing::OptimizeVertexCache(indices, verts.size());
+	std::vector<MeshProcessing::Meshlet> gridMeshlets = MeshProcessing::BuildMeshlets(indices, verts);
+	DirectX::XMFLOAT4 planes[6];
+	for (int i = 0; i < 6; i++)
+		planes[i] = DirectX::XMFLOAT4(0, 0, 0, 1);
+	std::vector<MeshProcessing::DrawRange> ranges;
+	DirectX::XMFLOAT3 above(12, 50, 12);
+	DirectX::XMFLOAT3 below(12, -50, 12);
+	unsigned int aboveCount = MeshProcessing::CullMeshlets(gridMeshlets.data(), gridMeshlets.size(), planes, &above, ranges);
+	unsigned int belowCount = MeshProcessing::CullMeshlets(gridMeshlets.data(), gridMeshlets.size(), planes, &below, ranges);
+	result.gridFacingCorrect = !gridMeshlets.empty() && aboveCount == gridMeshlets.size() && belowCount == 0;
+
+	result.passed =
+		result.maxVertices <= MeshProcessing::MaxMeshletVertices &&
+		result.maxTriangles <= MeshProcessing::MaxMeshletTriangles &&
+		result.maxLooseTriangles == MeshProcessing::MaxMeshletTriangles &&
+		result.trianglesPreserved &&
+		result.sphereOvershoot <= 1e-5f &&
+		result.coneRejects > 0 &&
+		result.falseRejects == 0 &&
+		result.gridFacingCorrect;
+	return result;
+}
+
+// --------------------------------------------------------
+// Feeds FixedTimestep random frame times (seeded, so every
+// run sees the same ones) from a quarter of a step to three
+// steps, with a two second stall half way.  Real time less
+// whatever the cap dropped should always equal simulation
+// time plus the leftover alpha, however long it runs.
+// --------------------------------------------------------
+Benchmarks::TimestepCheckResult Benchmarks::CheckFixedTimestep(unsigned int frames)
+{
+	TimestepCheckResult result = {};
+	result.frameCount = frames;
+	result.minAlpha = 1.0f;
+
+	const double step = 1.0 / 60.0;
+	const unsigned int maxSteps = 5;
+	const double stallSeconds = 2.0;
+	FixedTimestep timestep(step, maxSteps);
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<double> frameTimes(step * 0.25, step * 3.0);
+	unsigned long long expectedTicks = 0;
+	bool capped = true;
+	for (unsigned int i = 0; i < frames; i++)
+	{
+		bool stall = i == frames / 2;
+		double frameSeconds = stall ? stallSeconds : frameTimes(rng);
+		double droppedBefore = timestep.GetDroppedTime();
+		result.realSeconds += frameSeconds;
+
+		timestep.AddFrameTime(frameSeconds);
+		while (timestep.Step())
+			expectedTicks++;
+
+		if (stall)
+		{
+			result.stallSteps = timestep.GetFrameSteps();
+			result.stallDropped = timestep.GetDroppedTime() - droppedBefore;
+		}
+		else
+			result.maxFrameSteps = std::max(result.maxFrameSteps, timestep.GetFrameSteps());
+		capped = capped && timestep.GetFrameSteps() <= maxSteps;
+
+		float alpha = timestep.GetAlpha();
+		result.minAlpha = std::min(result.minAlpha, alpha);
+		result.maxAlpha = std::max(result.maxAlpha, alpha);
+
+		double accounted = timestep.GetSimulationTime() + alpha * step + timestep.GetDroppedTime();
+		result.maxDrift = std::max(result.maxDrift, fabs(result.realSeconds - accounted));
+	}
+	bool ticksMatch = timestep.GetTickCount() == expectedTicks &&
+		fabs(timestep.GetSimulationTime() - expectedTicks * step) < 1e-6;
+
+	// Frame times that are exactly one step, summed in floating point,
+	// mustn't round into an occasional skipped or doubled step
+	FixedTimestep even(step, maxSteps);
+	result.evenFramesStepOnce = true;
+	for (unsigned int i = 0; i < frames; i++)
+	{
+		even.AddFrameTime(step);
+		while (even.Step()) {}
+		result.evenFramesStepOnce = result.evenFramesStepOnce && even.GetFrameSteps() == 1;
+	}
+	result.evenFramesStepOnce = result.evenFramesStepOnce && even.GetTickCount() == frames;
+
+	// The stall's bank is whatever was left over plus two seconds,
+	// all but five steps of which are dropped
+	result.passed =
+		capped && ticksMatch &&
+		result.maxFrameSteps == 3 &&
+		result.stallSteps == maxSteps &&
+		result.stallDropped > stallSeconds - maxSteps * step &&
+		result.stallDropped <= stallSeconds + step - maxSteps * step &&
+		result.minAlpha >= 0.0f && result.maxAlpha < 1.0f &&
+		result.maxDrift < 1e-6 &&
+		result.evenFramesStepOnce;
+	return result;
+}
+
+// --------------------------------------------------------
+// Adds random draws of 16 meshes, 12 materials and 3 LODs
+// (576 groups, so a few thousand draws leave each a handful)
+// whose values are their places in the queue, then checks
+// every batch against the draws that should have gone in it
+// --------------------------------------------------------
+Benchmarks::BatcherCheckResult Benchmarks::CheckInstanceBatcher(unsigned int drawCount)
+{
+	BatcherCheckResult result = {};
+	result.drawCount = drawCount;
+
+	std::vector<char> meshes(16), materials(12);
+	InstanceBatcher batcher;
+	std::mt19937 rng(97531);
+
+	for (int round = 0; round < 2; round++)
+	{
+		// Each draw's group, and the groups in order of first appearance
+		std::vector<unsigned int> drawGroups(drawCount);
+		std::vector<unsigned int> groupOrder;
+		std::vector<int> groupSlots(meshes.size() * materials.size() * 3, -1);
+		batcher.Clear();
+		for (unsigned int i = 0; i < drawCount; i++)
+		{
+			unsigned int mesh = rng() % meshes.size();
+			unsigned int material = rng() % materials.size();
+			int lod = (int)(rng() % 3);
+			unsigned int group = (mesh * (unsigned int)materials.size() + material) * 3 + lod;
+			if (groupSlots[group] < 0)
+			{
+				groupSlots[group] = (int)groupOrder.size();
+				groupOrder.push_back(group);
+			}
+			drawGroups[i] = group;
+			batcher.Add(&meshes[mesh], &materials[material], lod, i);
+		}
+		batcher.Build();
+
+		const std::vector<unsigned int>& values = batcher.GetInstanceValues();
+		bool partitioned = batcher.GetBatchCount() == groupOrder.size();
+		bool ordered = true;
+		bool covered = values.size() == drawCount;
+		std::vector<unsigned char> seen(drawCount, 0);
+		unsigned int nextInstance = 0;
+		for (unsigned int b = 0; b < batcher.GetBatchCount() && covered; b++)
+		{
+			const InstanceBatcher::Batch& batch = batcher.GetBatch(b);
+			covered = batch.firstInstance == nextInstance && batch.instanceCount > 0 &&
+				batch.firstInstance + batch.instanceCount <= values.size();
+			nextInstance = batch.firstInstance + batch.instanceCount;
+
+			for (unsigned int i = batch.firstInstance; i < nextInstance && covered; i++)
+			{
+				unsigned int draw = values[i];
+				covered = draw < drawCount && !seen[draw];
+				if (!covered)
+					break;
+				seen[draw] = 1;
+
+				// Batches come in the order their groups first appeared
+				partitioned = partitioned && drawGroups[draw] == groupOrder[b];
+				ordered = ordered && (i == batch.firstInstance || values[i - 1] < draw);
+			}
+		}
+		covered = covered && nextInstance == drawCount;
+
+		if (round == 0)
+		{
+			result.batchCount = batcher.GetBatchCount();
+			result.groupCount = (unsigned int)groupOrder.size();
+			result.partitioned = partitioned;
+			result.orderPreserved = ordered;
+			result.coveredOnce = covered;
+		}
+		else
+			result.reusable = partitioned && ordered && covered;
+	}
+
+	result.passed =
+		result.partitioned &&
+		result.orderPreserved &&
+		result.coveredOnce &&
+		result.reusable;
+	return result;
+}
+
+
+// --------------------------------------------------------
+// Result lines, shared by the UI and "-bench" so the two
+// always report the same way
+// --------------------------------------------------------
+void Benchmarks::Print(const ObjLoadResult& r)
+{
+	printf("OBJ loading (%.1f MB, %u threads): legacy %.3f ms, mapped %.3f ms, identical: %s\n",
+		r.megabytes, r.threadCount, r.legacyMilliseconds, r.fastMilliseconds, YesNo(r.identical));
+}
+
+void Benchmarks::Print(const TangentResult& r)
+{
+	printf("Tangents: reference %.3f ms, fast %.3f ms, max difference %g, deterministic: %s\n",
+		r.referenceMilliseconds, r.fastMilliseconds, r.maxDifference, YesNo(r.deterministic));
+}
+
+void Benchmarks::Print(const RayResult& r, const char* modelName)
+{
+	printf("Rays (%s): %.2f million rays/sec, %u mismatches\n", modelName,
+		r.raysPerSecond / 1000000.0, r.mismatches);
+}
+
+void Benchmarks::Print(const TransformResult& r)
+{
+	printf("Transforms (%u): per-object %.3f ms, batch %.3f ms, threaded %.3f ms\n",
+		r.transformCount, r.perObjectMilliseconds, r.batchMilliseconds, r.threadedMilliseconds);
+}
+
+void Benchmarks::Print(const HierarchyResult& r)
+{
+	printf("Hierarchy (%u nodes, %u levels): full %.3f ms, subtree %.3f ms\n",
+		r.nodeCount, r.depthCount, r.fullMilliseconds, r.subtreeMilliseconds);
+}
+
+void Benchmarks::Print(const InverseTransposeResult& r)
+{
+	printf("Inverse-transpose: generic %.3f ms, fast %.3f ms, max error %g\n",
+		r.genericMilliseconds, r.fastMilliseconds, r.maxError);
+}
+
+void Benchmarks::Print(const EntityResult& r)
+{
+	printf("Entities (%u): shared_ptr update %.3f ms, draw list %.3f ms; store update %.3f ms, draw list %.3f ms\n",
+		r.entityCount,
+		r.legacyUpdateMilliseconds, r.legacyDrawListMilliseconds,
+		r.storeUpdateMilliseconds, r.storeDrawListMilliseconds);
+}
+
+void Benchmarks::Print(const CullingResult& r)
+{
+	printf("Culling (%u objects): reference %.3f ms, SIMD %.3f ms, %u visible, identical: %s\n",
+		r.objectCount, r.referenceMilliseconds, r.simdMilliseconds, r.visibleCount, YesNo(r.identical));
+	printf("Shadow casters: reference %.3f ms, SIMD %.3f ms, %u casters (%u off screen), identical: %s\n",
+		r.shadowReferenceMilliseconds, r.shadowSimdMilliseconds,
+		r.casterCount, r.offscreenCasters, YesNo(r.shadowIdentical));
+}
+
+void Benchmarks::Print(const RenderQueueResult& r)
+{
+	printf("Draw sorting (%u draws): std::stable_sort %.3f ms, radix %.3f ms, state changes %u -> %u, identical: %s\n",
+		r.drawCount, r.referenceMilliseconds, r.radixMilliseconds,
+		r.unsortedChanges, r.sortedChanges, YesNo(r.identical));
+}
+
+void Benchmarks::Print(const SceneLoadResult& r)
+{
+	printf("Scene loading (%u entities): open %.3f ms, create %.3f ms, text parse %.3f ms, round trip: %s\n",
+		r.entityCount, r.openMilliseconds, r.createMilliseconds, r.parseMilliseconds, YesNo(r.roundTrip));
+}
+
+void Benchmarks::Print(const SpatialIndexResult& r)
+{
+	printf("Spatial index (%u boxes, %u moving): update %.3f ms, frustum %.3f vs %.3f ms, sphere %.3f vs %.3f ms, ray %.3f vs %.3f ms, identical: %s\n",
+		r.objectCount, r.movingCount, r.updateMilliseconds,
+		r.frustumMilliseconds, r.linearFrustumMilliseconds,
+		r.sphereMilliseconds, r.linearSphereMilliseconds,
+		r.rayMilliseconds, r.linearRayMilliseconds,
+		YesNo(r.identical));
+}
+
+void Benchmarks::Print(const EntityQueryResult& r)
+{
+	printf("Entity queries (%u entities, %u moving): bounds %.3f ms for %u rows (checking every row %.3f ms), frustum %.3f ms, sphere %.3f ms, ray %.3f ms, identical: %s\n",
+		r.entityCount, r.movingCount, r.boundsMilliseconds, r.boundsUpdated, r.rescanMilliseconds,
+		r.frustumMilliseconds, r.sphereMilliseconds, r.rayMilliseconds,
+		YesNo(r.identical));
+}
+
+void Benchmarks::Print(const OcclusionResult& r)
+{
+	printf("Occlusion (%ux%u, %u threads, %u triangles): %u of %u boxes hidden (%u by rays, %u false), setup %.3f ms, raster %.3f ms (1 thread %.3f ms), pyramid %.3f ms, tests %.3f ms, identical: %s\n",
+		r.width, r.height, r.threadCount, r.triangleCount,
+		r.occludedCount, r.boxCount, r.hiddenCount, r.falseOcclusions,
+		r.setupMilliseconds, r.rasterMilliseconds, r.singleThreadRasterMilliseconds,
+		r.pyramidMilliseconds, r.testMilliseconds,
+		YesNo(r.identical));
+}
+
+void Benchmarks::Print(const CommandResult& r)
+{
+	printf("Command recording (%u draws in %u passes): %u commands, %.1f KB, serial %.3f ms, parallel %.3f ms, stitch %.3f ms, replay %.3f ms, identical: %s\n",
+		r.drawCount, r.passCount, r.commandCount, r.kilobytes,
+		r.serialMilliseconds, r.parallelMilliseconds, r.stitchMilliseconds, r.replayMilliseconds,
+		YesNo(r.identical));
+}
+
+void Benchmarks::Print(const MeshletCheckResult& r)
+{
+	printf("Meshlets (%u): at most %u vertices and %u triangles (%u with loose vertices), triangles preserved: %s, sphere overshoot %g, %u cone rejects (%u false), grid facing: %s, passed: %s\n",
+		r.meshletCount, r.maxVertices, r.maxTriangles, r.maxLooseTriangles,
+		YesNo(r.trianglesPreserved), r.sphereOvershoot,
+		r.coneRejects, r.falseRejects, YesNo(r.gridFacingCorrect),
+		YesNo(r.passed));
+}
+
+void Benchmarks::Print(const TimestepCheckResult& r)
+{
+	printf("Fixed timestep (%u frames, %.0f s): at most %u steps a frame, stall took %u and dropped %.3f s, alpha in [%.6f, %.6f], drift %g s, even frames step once: %s, passed: %s\n",
+		r.frameCount, r.realSeconds, r.maxFrameSteps, r.stallSteps, r.stallDropped,
+		r.minAlpha, r.maxAlpha, r.maxDrift, YesNo(r.evenFramesStepOnce),
+		YesNo(r.passed));
+}
+
+void Benchmarks::Print(const BatcherCheckResult& r)
+{
+	printf("Instance batching (%u draws): %u batches for %u groups, partitioned: %s, order preserved: %s, covered once: %s, reusable: %s, passed: %s\n",
+		r.drawCount, r.batchCount, r.groupCount,
+		YesNo(r.partitioned), YesNo(r.orderPreserved), YesNo(r.coveredOnce), YesNo(r.reusable),
+		YesNo(r.passed));
+}
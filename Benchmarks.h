@@ -0,0 +1,314 @@
+#pragma once
+
+#include <memory>
+
+class Mesh;
+
+// --------------------------------------------------------
+// CPU-side timing harnesses and correctness checks
+//
+// None of these need a graphics device, so they can be run
+// from the UI or from a console without a window.  The one
+// exception is MeasureEntityQueries, which is handed a mesh
+// that's already loaded.
+// --------------------------------------------------------
+namespace Benchmarks
+{
+	// Legacy vs. memory mapped OBJ loading
+	struct ObjLoadResult
+	{
+		double legacyMilliseconds;	// Average time for ObjParser::LoadLegacy()
+		double fastMilliseconds;	// Average time for ObjParser::Load()
+		double megabytes;			// Size of the file
+		unsigned int vertexCount;	// Vertices produced per load
+		unsigned int threadCount;	// Cores ObjParser::Load() had to spread across
+		bool identical;				// Did both loaders produce the same data?
+	};
+
+	ObjLoadResult CompareObjLoaders(const char* filename, int iterations);
+
+	// The same on a generated scan: a gridSize x gridSize height field
+	// written with six decimal places, as a scanner would
+	ObjLoadResult CompareObjLoadersOnScan(unsigned int gridSize, int iterations);
+
+	// Reference vs. SIMD/threaded tangent generation
+	struct TangentResult
+	{
+		double referenceMilliseconds;	// Average time for MeshProcessing::CalculateTangentsReference()
+		double fastMilliseconds;		// Average time for MeshProcessing::CalculateTangents()
+		double angleMilliseconds;		// Average time for the angle weighted (MikkTSpace style) mode
+		unsigned int vertexCount;		// Welded vertices in the mesh
+		float maxDifference;			// Largest component difference from the reference
+		float maxAngleDegrees;			// Largest angle between angle weighted and reference tangents
+		bool deterministic;				// Same bits with one thread and with many?
+	};
+
+	TangentResult CompareTangents(const char* filename, int iterations);
+
+	// Ray queries against a mesh's BVH
+	struct RayResult
+	{
+		double buildMilliseconds;	// Time to build the BVH
+		unsigned int nodeCount;		// Nodes in the finished hierarchy
+		unsigned int triangleCount;	// Triangles it holds
+		unsigned int rayCount;		// Rays traced
+		double raysPerSecond;		// Throughput of MeshBVH::Intersect()
+		float hitRate;				// Fraction of rays that hit something
+		unsigned int mismatches;	// Sampled rays that disagree with a brute force test
+	};
+
+	RayResult MeasureRayThroughput(const char* filename, unsigned int rayCount);
+
+	// Per-object vs. batched world matrix updates
+	struct TransformResult
+	{
+		unsigned int transformCount;	// Transforms rebuilt per iteration
+		double perObjectMilliseconds;	// Average time reading each dirty matrix one at a time
+		double batchMilliseconds;		// Average time for TransformSystem::UpdateMatrices() on one thread
+		double threadedMilliseconds;	// Average time for TransformSystem::UpdateMatrices() on every core
+		unsigned int threadCount;		// Threads used for the threaded run
+	};
+
+	TransformResult MeasureTransformUpdates(unsigned int transformCount, int iterations);
+
+	// World matrix propagation through a transform hierarchy
+	struct HierarchyResult
+	{
+		unsigned int nodeCount;			// Transforms in the tree
+		unsigned int depthCount;		// Levels from the root down
+		double fullMilliseconds;		// Average time to update everything after moving the root
+		double subtreeMilliseconds;		// Average time after moving one of the root's children
+		unsigned int subtreeUpdated;	// World matrices rebuilt for that subtree
+		double idleMilliseconds;		// Average time when nothing moved
+	};
+
+	HierarchyResult MeasureHierarchyUpdates(unsigned int nodeCount, unsigned int childrenPerNode, int iterations);
+
+	// General inverse vs. TransformSystem::InverseTranspose() for normal matrices
+	struct InverseTransposeResult
+	{
+		unsigned int matrixCount;		// Matrices per timed pass
+		double genericMilliseconds;		// XMMatrixInverse(XMMatrixTranspose(world)), non-uniform scales
+		double fastMilliseconds;		// Built from the rotation and reciprocal scale, non-uniform scales
+		double uniformMilliseconds;		// Fast path with uniform scales
+		double unscaledMilliseconds;	// Fast path with no scale at all
+		float maxError;					// Largest difference from the generic result (relative)
+	};
+
+	InverseTransposeResult CompareInverseTranspose(unsigned int matrixCount, int iterations);
+
+	// vector<shared_ptr<Entity>> style iteration vs. the packed EntityStore
+	struct EntityResult
+	{
+		unsigned int entityCount;			// Entities walked per pass
+		double legacyUpdateMilliseconds;	// Moving every entity, copying shared_ptrs as the old loops did
+		double legacyDrawListMilliseconds;	// Gathering each entity's mesh, material and transform the same way
+		double storeUpdateMilliseconds;		// Moving every entity by row
+		double storeDrawListMilliseconds;	// Gathering the draw list by row
+	};
+
+	EntityResult CompareEntityIteration(unsigned int entityCount, int iterations);
+
+	// Scalar vs. SIMD frustum culling of a random scene
+	struct CullingResult
+	{
+		unsigned int objectCount;		// Spheres and boxes in the scene
+		unsigned int visibleCount;		// Inside the frustum
+		unsigned int smallCulled;		// Of those, how many a 1% screen-size cutoff removes
+		double referenceMilliseconds;	// Average time for FrustumCulling::CullReference()
+		double simdMilliseconds;		// Average time for FrustumCulling::Cull()
+		bool identical;					// Did both produce the same visible list?
+
+		// Shadow casters for a directional light over the same scene
+		unsigned int casterCount;			// Casting onto the visible objects
+		unsigned int offscreenCasters;		// Of those, how many are outside the frustum
+		double shadowReferenceMilliseconds;	// Average time for FrustumCulling::CullShadowCastersReference()
+		double shadowSimdMilliseconds;		// Average time for FrustumCulling::CullShadowCasters()
+		bool shadowIdentical;				// The same casters both ways, for visible and off-screen receivers and spheres alone?
+	};
+
+	CullingResult CompareCulling(unsigned int objectCount, int iterations);
+
+	// std::stable_sort vs. radix sorting a frame's render keys
+	struct RenderQueueResult
+	{
+		unsigned int drawCount;			// Draws queued
+		double referenceMilliseconds;	// Average time for RenderQueue::SortReference()
+		double radixMilliseconds;		// Average time for RenderQueue::Sort()
+		unsigned int skippedPasses;		// Byte passes the radix sort found nothing to do for
+		unsigned int unsortedChanges;	// Shader, material and mesh changes in the order draws were queued
+		unsigned int sortedChanges;		// The same after sorting
+		bool identical;					// Did both sorts produce the same order?
+	};
+
+	RenderQueueResult CompareRenderQueueSort(unsigned int drawCount, int iterations);
+
+	// Loading a generated scene from its binary and text forms
+	struct SceneLoadResult
+	{
+		unsigned int entityCount;		// Entities in the scene (a quarter of them parented)
+		unsigned int binaryBytes;		// Size of the binary file
+		unsigned int textBytes;			// Size of its text form
+		double openMilliseconds;		// Average time for SceneFile::Open(): mapping and validating
+		double createMilliseconds;		// Average time for EntityStore::CreateFromScene() into an empty store
+		double parseMilliseconds;		// Average time for SceneFile::ParseText()
+		double formatMilliseconds;		// Average time for SceneFile::FormatText()
+		bool roundTrip;					// Did text -> binary -> text give back the same scene?
+	};
+
+	SceneLoadResult MeasureSceneLoad(unsigned int entityCount, int iterations);
+
+	// Loose octree updates and queries over moving boxes, against testing every box
+	struct SpatialIndexResult
+	{
+		unsigned int objectCount;			// Boxes in the index
+		unsigned int movingCount;			// Of those, how many move every frame
+		unsigned int nodeCount;				// Octree nodes in use at the end
+		double buildMilliseconds;			// Time to insert every box into an empty tree
+		double updateMilliseconds;			// Average time per frame to re-file the moving boxes
+		float relinkRate;					// Fraction of those updates that moved a box to another node
+		double frustumMilliseconds;			// Average time per frame for LooseOctree::QueryFrustum()
+		double linearFrustumMilliseconds;	// The same test on every box
+		double sphereMilliseconds;			// Average time per frame for 64 LooseOctree::QuerySphere() calls
+		double linearSphereMilliseconds;	// The same tests on every box
+		double rayMilliseconds;				// Average time per frame for 64 LooseOctree::QueryRay() calls
+		double linearRayMilliseconds;		// The same tests on every box
+		bool identical;						// Did every query find the same boxes both ways?
+	};
+
+	SpatialIndexResult MeasureSpatialIndex(unsigned int objectCount, float movingFraction, int frames);
+
+	// The same scene as entities: EntityStore's per-frame bounds refresh
+	// and its queries, the way Game uses them
+	struct EntityQueryResult
+	{
+		unsigned int entityCount;			// Entities in the store
+		unsigned int movingCount;			// Of those, how many move every frame
+		unsigned int boundsUpdated;			// Average per frame whose bounds were rebuilt
+		double boundsMilliseconds;			// Average time per frame for EntityStore::UpdateBounds()
+		double rescanMilliseconds;			// Average time per frame to check every row's bounds, as every query used to
+		double frustumMilliseconds;			// Average time per frame for EntityStore::QueryFrustum()
+		double sphereMilliseconds;			// Average time per frame for 64 EntityStore::QuerySphere() calls
+		double rayMilliseconds;				// Average time per frame for 64 EntityStore::QueryRay() calls
+		bool identical;						// Did every query find the same rows as testing every world box?
+	};
+
+	// Every entity uses "mesh", scaled to the scene's box sizes, so
+	// this needs a device to have loaded it
+	EntityQueryResult MeasureEntityQueries(std::shared_ptr<Mesh> mesh, unsigned int entityCount, float movingFraction, int frames);
+
+	// Software occlusion culling of boxes behind hilly ground and walls,
+	// checked against rays cast to points across each box
+	struct OcclusionResult
+	{
+		unsigned int width;					// Of the occlusion buffer
+		unsigned int height;
+		unsigned int threadCount;			// Workers filling tiles
+		unsigned int triangleCount;			// Occluder triangles set up per frame (after culling and clipping)
+		unsigned int boxCount;				// Boxes in view, tested each frame
+		unsigned int occludedCount;			// Average per frame the buffer hid
+		unsigned int hiddenCount;			// Average per frame no ray reached
+		unsigned int falseOcclusions;		// Boxes hidden by the buffer that a ray did reach, over every frame
+		double setupMilliseconds;			// Average per frame: transforming, clipping and binning
+		double rasterMilliseconds;			// Average per frame: filling the tiles
+		double singleThreadRasterMilliseconds;	// The same on one thread
+		double pyramidMilliseconds;			// Average per frame: building the min/max levels
+		double testMilliseconds;			// Average per frame: OcclusionBuffer::IsOccluded() on every box
+		bool identical;						// Did one thread and many give the same depth?
+	};
+
+	OcclusionResult MeasureOcclusion(unsigned int boxCount, int frames);
+
+	// Recording passes of draws into command streams on one thread and on
+	// one thread per pass, then stitching and replaying them
+	struct CommandResult
+	{
+		unsigned int passCount;
+		unsigned int drawCount;				// Over every pass
+		unsigned int commandCount;			// In the stitched stream
+		double kilobytes;					// Size of the stitched stream
+		double serialMilliseconds;			// Average time to record every pass on one thread
+		double parallelMilliseconds;		// The same with a thread per pass
+		double stitchMilliseconds;			// Average time to append the passes in order
+		double replayMilliseconds;			// Average time for a RecordingBackend to walk the result
+		bool identical;						// Same bytes both ways, and every draw replayed?
+	};
+
+	CommandResult MeasureCommandRecording(unsigned int drawCount, unsigned int passCount, int iterations);
+
+	// --- Correctness checks ---
+
+	// Meshlets built from a generated sphere, and cone culling
+	struct MeshletCheckResult
+	{
+		unsigned int meshletCount;
+		unsigned int maxVertices;		// Most unique vertices in a meshlet (limit 64)
+		unsigned int maxTriangles;		// Most triangles in a meshlet (limit 124)
+		unsigned int maxLooseTriangles;	// The same with a vertex limit too loose to bind first
+		bool trianglesPreserved;		// Every source triangle in exactly one meshlet, winding kept
+		float sphereOvershoot;			// Furthest any vertex lies outside its meshlet's sphere
+		unsigned int coneRejects;		// Meshlets the cone test rejected from a few viewpoints
+		unsigned int falseRejects;		// Of those, how many had a triangle facing the viewer
+		bool gridFacingCorrect;			// Flat grid kept from in front, rejected from behind?
+		bool passed;
+	};
+
+	MeshletCheckResult CheckMeshlets(unsigned int segments);
+
+	// FixedTimestep driven by uneven frame times with a stall
+	// part way through, at 60 steps a second and five at most
+	// per frame
+	struct TimestepCheckResult
+	{
+		unsigned int frameCount;
+		double realSeconds;				// What the frame times add up to
+		unsigned int maxFrameSteps;		// Most steps any frame took, besides the stall's
+		unsigned int stallSteps;		// Steps taken for a two second frame
+		double stallDropped;			// Time the cap dropped for it
+		float minAlpha;					// Range of the leftover fraction after stepping
+		float maxAlpha;
+		double maxDrift;				// Furthest simulation time plus alpha strayed from real time less dropped time
+		bool evenFramesStepOnce;		// Did frames exactly a step long take exactly one step each?
+		bool passed;
+	};
+
+	TimestepCheckResult CheckFixedTimestep(unsigned int frames);
+
+	// InstanceBatcher grouping random draws, as a sorted render
+	// queue would hand them over
+	struct BatcherCheckResult
+	{
+		unsigned int drawCount;
+		unsigned int batchCount;
+		unsigned int groupCount;		// Distinct (mesh, material, LOD) among the draws
+		bool partitioned;				// Each batch holds one whole group
+		bool orderPreserved;			// Queue order within batches, and batches by their first draw
+		bool coveredOnce;				// Batches tile the instances, with every draw in exactly one
+		bool reusable;					// All of the above again after Clear(), with other draws
+		bool passed;
+	};
+
+	BatcherCheckResult CheckInstanceBatcher(unsigned int drawCount);
+
+	// --- Reporting ---
+
+	// Prints a result on one line (culling takes two), as both the
+	// UI's buttons and the headless "-bench" option report it
+	void Print(const ObjLoadResult& result);
+	void Print(const TangentResult& result);
+	void Print(const RayResult& result, const char* modelName);
+	void Print(const TransformResult& result);
+	void Print(const HierarchyResult& result);
+	void Print(const InverseTransposeResult& result);
+	void Print(const EntityResult& result);
+	void Print(const CullingResult& result);
+	void Print(const RenderQueueResult& result);
+	void Print(const SceneLoadResult& result);
+	void Print(const SpatialIndexResult& result);
+	void Print(const EntityQueryResult& result);
+	void Print(const OcclusionResult& result);
+	void Print(const CommandResult& result);
+	void Print(const MeshletCheckResult& result);
+	void Print(const TimestepCheckResult& result);
+	void Print(const BatcherCheckResult& result);
+}
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "Camera.h"
+#include "MeshProcessing.h"
 #include <algorithm>
+#include <cmath>
 
 using namespace DirectX;
 
@@ -41,6 +43,47 @@ float Camera::GetFOV(){	return fov; }
 float Camera::GetNearClip(){ return nClip; }
 float Camera::GetFarClip(){	return fClip; }
 
+// Perspective size on screen, using the distance to the camera
+// and the vertical field of view (1 fills the whole height)
+float Camera::GetProjectedSize(XMFLOAT3 position, float worldSize)
+{
+	XMFLOAT3 cameraPosition = transform->GetPosition();
+	float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&position) - XMLoadFloat3(&cameraPosition)));
+
+	// Inside (or nearly touching) the object covers everything
+	float visibleHeight = 2.0f * distance * tanf(fov * 0.5f);
+	if (visibleHeight <= worldSize)
+		return 1.0f;
+
+	return worldSize / visibleHeight;
+}
+
+// Planes come straight out of the combined view-projection
+// matrix, so they're in world space
+void Camera::GetFrustumPlanes(XMFLOAT4 planes[6])
+{
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(XMLoadFloat4x4(&viewMatrix), XMLoadFloat4x4(&projMatrix)));
+	MeshProcessing::ExtractFrustumPlanes(viewProjection, planes);
+}
+
+// Unprojects the pixel onto the near and far planes and
+// returns the ray between them
+void Camera::GetPickingRay(float screenX, float screenY, float screenWidth, float screenHeight,
+	XMFLOAT3& origin, XMFLOAT3& direction)
+{
+	float ndcX = screenX / screenWidth * 2.0f - 1.0f;
+	float ndcY = 1.0f - screenY / screenHeight * 2.0f;
+
+	XMMATRIX inverseViewProj = XMMatrixInverse(0,
+		XMMatrixMultiply(XMLoadFloat4x4(&viewMatrix), XMLoadFloat4x4(&projMatrix)));
+	XMVECTOR nearPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 0.0f, 1.0f), inverseViewProj);
+	XMVECTOR farPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 1.0f, 1.0f), inverseViewProj);
+
+	XMStoreFloat3(&origin, nearPoint);
+	XMStoreFloat3(&direction, XMVector3Normalize(farPoint - nearPoint));
+}
+
 // Update the view matrix
 // Called once per frame
 void Camera::UpdateViewMatrix()
@@ -41,6 +41,19 @@ public:
 	float GetNearClip();
 	float GetFarClip();
 
+	// Fraction of the screen's height covered by something
+	// "worldSize" units across at a world-space position
+	float GetProjectedSize(DirectX::XMFLOAT3 position, float worldSize);
+
+	// Inward-facing, normalized world-space planes of the view
+	// frustum (left, right, bottom, top, near, far)
+	void GetFrustumPlanes(DirectX::XMFLOAT4 planes[6]);
+
+	// World-space ray through a pixel, starting on the near plane
+	// with a normalized direction (for picking)
+	void GetPickingRay(float screenX, float screenY, float screenWidth, float screenHeight,
+		DirectX::XMFLOAT3& origin, DirectX::XMFLOAT3& direction);
+
 	// Updaters
 	void UpdateViewMatrix();
 	void UpdateProjectionMatrix(float aspectRatio);
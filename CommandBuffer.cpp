@@ -0,0 +1,225 @@
+#include "CommandBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Anonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// Bytes rounded up to whole 8-byte units
+	size_t ToUnits(size_t bytes)
+	{
+		return (bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+	}
+}
+
+CommandBuffer::CommandBuffer() :
+	used(0),
+	commandCount(0)
+{
+}
+
+void CommandBuffer::Clear()
+{
+	used = 0;
+	commandCount = 0;
+}
+
+// --------------------------------------------------------
+// Streams hold nothing but their own commands, so appending
+// one is a straight copy
+// --------------------------------------------------------
+void CommandBuffer::Append(const CommandBuffer& other)
+{
+	if (other.used == 0)
+		return;
+
+	if (memory.size() < used + other.used)
+		memory.resize(std::max(used + other.used, memory.size() * 2));
+	memcpy(&memory[used], other.memory.data(), other.used * sizeof(uint64_t));
+	used += other.used;
+	commandCount += other.commandCount;
+}
+
+// --------------------------------------------------------
+// Makes room for a command and any data after it, growing
+// the stream as needed, and fills in its header
+// --------------------------------------------------------
+void* CommandBuffer::Push(Type type, size_t commandSize, size_t dataSize)
+{
+	size_t units = ToUnits(commandSize) + ToUnits(dataSize);
+	if (memory.size() < used + units)
+		memory.resize(std::max(used + units, memory.size() * 2));
+
+	Header* header = (Header*)&memory[used];
+	header->type = type;
+	header->size = (uint32_t)(units * sizeof(uint64_t));
+	used += units;
+	commandCount++;
+	return header;
+}
+
+template <typename Command>
+Command* CommandBuffer::Push(Type type, size_t dataSize)
+{
+	return (Command*)Push(type, sizeof(Command), dataSize);
+}
+
+void CommandBuffer::SetPipeline(void* vertexShader, void* inputLayout, void* pixelShader)
+{
+	SetPipelineCommand* command = Push<SetPipelineCommand>(TypeSetPipeline);
+	command->vertexShader = vertexShader;
+	command->inputLayout = inputLayout;
+	command->pixelShader = pixelShader;
+}
+
+void* CommandBuffer::SetConstants(Stage stage, unsigned int slot, void* buffer, const void* data, unsigned int size)
+{
+	SetConstantsCommand* command = Push<SetConstantsCommand>(TypeSetConstants, size);
+	command->stage = stage;
+	command->slot = slot;
+	command->buffer = buffer;
+	command->dataSize = size;
+	command->padding = 0;
+
+	void* copy = command + 1;
+	memcpy(copy, data, size);
+	return copy;
+}
+
+void CommandBuffer::SetResource(Stage stage, unsigned int slot, void* view)
+{
+	SetResourceCommand* command = Push<SetResourceCommand>(TypeSetResource);
+	command->stage = stage;
+	command->slot = slot;
+	command->view = view;
+}
+
+void CommandBuffer::SetSampler(Stage stage, unsigned int slot, void* sampler)
+{
+	SetSamplerCommand* command = Push<SetSamplerCommand>(TypeSetSampler);
+	command->stage = stage;
+	command->slot = slot;
+	command->sampler = sampler;
+}
+
+void CommandBuffer::ClearResources(Stage stage, unsigned int first, unsigned int count)
+{
+	ClearResourcesCommand* command = Push<ClearResourcesCommand>(TypeClearResources);
+	command->stage = stage;
+	command->first = first;
+	command->count = count;
+	command->padding = 0;
+}
+
+void CommandBuffer::SetVertexBuffer(unsigned int slot, void* buffer, unsigned int stride, unsigned int offset)
+{
+	SetVertexBufferCommand* command = Push<SetVertexBufferCommand>(TypeSetVertexBuffer);
+	command->slot = slot;
+	command->stride = stride;
+	command->buffer = buffer;
+	command->offset = offset;
+	command->padding = 0;
+}
+
+void CommandBuffer::SetIndexBuffer(void* buffer, unsigned int indexSize)
+{
+	SetIndexBufferCommand* command = Push<SetIndexBufferCommand>(TypeSetIndexBuffer);
+	command->buffer = buffer;
+	command->indexSize = indexSize;
+	command->padding = 0;
+}
+
+void* CommandBuffer::UpdateBuffer(void* buffer, const void* data, unsigned int size)
+{
+	UpdateBufferCommand* command = Push<UpdateBufferCommand>(TypeUpdateBuffer, size);
+	command->buffer = buffer;
+	command->dataSize = size;
+	command->padding = 0;
+
+	void* copy = command + 1;
+	memcpy(copy, data, size);
+	return copy;
+}
+
+void CommandBuffer::SetTargets(void* renderTarget, void* depthStencil)
+{
+	SetTargetsCommand* command = Push<SetTargetsCommand>(TypeSetTargets);
+	command->renderTarget = renderTarget;
+	command->depthStencil = depthStencil;
+}
+
+void CommandBuffer::ClearTarget(void* renderTarget, const float color[4])
+{
+	ClearTargetCommand* command = Push<ClearTargetCommand>(TypeClearTarget);
+	command->renderTarget = renderTarget;
+	memcpy(command->color, color, sizeof(command->color));
+}
+
+void CommandBuffer::ClearDepth(void* depthStencil, float depth)
+{
+	ClearDepthCommand* command = Push<ClearDepthCommand>(TypeClearDepth);
+	command->depthStencil = depthStencil;
+	command->depth = depth;
+	command->padding = 0;
+}
+
+void CommandBuffer::SetViewport(float width, float height)
+{
+	SetViewportCommand* command = Push<SetViewportCommand>(TypeSetViewport);
+	command->width = width;
+	command->height = height;
+}
+
+void CommandBuffer::SetRasterizerState(void* state)
+{
+	Push<SetStateCommand>(TypeSetRasterizerState)->state = state;
+}
+
+void CommandBuffer::SetDepthState(void* state)
+{
+	Push<SetStateCommand>(TypeSetDepthState)->state = state;
+}
+
+void CommandBuffer::Draw(unsigned int vertexCount, unsigned int startVertex)
+{
+	DrawCommand* command = Push<DrawCommand>(TypeDraw);
+	command->vertexCount = vertexCount;
+	command->startVertex = startVertex;
+}
+
+void CommandBuffer::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	DrawIndexedCommand* command = Push<DrawIndexedCommand>(TypeDrawIndexed);
+	command->indexCount = indexCount;
+	command->startIndex = startIndex;
+	command->baseVertex = baseVertex;
+	command->padding = 0;
+}
+
+void CommandBuffer::DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance)
+{
+	DrawIndexedInstancedCommand* command = Push<DrawIndexedInstancedCommand>(TypeDrawIndexedInstanced);
+	command->indexCount = indexCount;
+	command->instanceCount = instanceCount;
+	command->startIndex = startIndex;
+	command->baseVertex = baseVertex;
+	command->startInstance = startInstance;
+	command->padding = 0;
+}
+
+const CommandBuffer::Header* CommandBuffer::GetFirst() const
+{
+	return used > 0 ? (const Header*)memory.data() : 0;
+}
+
+const CommandBuffer::Header* CommandBuffer::GetNext(const Header* command) const
+{
+	const uint64_t* next = (const uint64_t*)command + command->size / sizeof(uint64_t);
+	return next < memory.data() + used ? (const Header*)next : 0;
+}
+
+// Getters
+unsigned int CommandBuffer::GetCommandCount() const { return commandCount; }
+size_t CommandBuffer::GetSize() const { return used * sizeof(uint64_t); }
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// A pass's worth of rendering commands, recorded into one
+// block of linear memory and replayed later by a backend.
+//
+// Every command is a small POD struct starting with a header
+// (its type and size), and some carry data right after them
+// (constant buffer contents, buffer uploads), so a stream is
+// just bytes that can be copied, appended to another stream
+// or walked from front to back.  Everything is padded to 8
+// bytes, which keeps the handles inside aligned.
+//
+// Resources (shaders, buffers, views, states) are opaque
+// handles that only the backend executing the stream knows
+// how to use, so nothing here needs a graphics device.  A
+// buffer is only ever touched by one thread, so several
+// threads can each record their own pass and the results be
+// stitched together in pass order with Append().
+// --------------------------------------------------------
+class CommandBuffer
+{
+public:
+
+	enum Type : uint32_t
+	{
+		TypeSetPipeline,
+		TypeSetConstants,
+		TypeSetResource,
+		TypeSetSampler,
+		TypeClearResources,
+		TypeSetVertexBuffer,
+		TypeSetIndexBuffer,
+		TypeUpdateBuffer,
+		TypeSetTargets,
+		TypeClearTarget,
+		TypeClearDepth,
+		TypeSetViewport,
+		TypeSetRasterizerState,
+		TypeSetDepthState,
+		TypeDraw,
+		TypeDrawIndexed,
+		TypeDrawIndexedInstanced,
+		TypeCount
+	};
+
+	// Shader stages constants and resources are bound to
+	enum Stage : uint32_t
+	{
+		StageVertex,
+		StagePixel
+	};
+
+	struct Header
+	{
+		Type type;
+		uint32_t size;		// In bytes, including the header and any data after the command
+	};
+
+	// Shaders and the vertex layout (a null pixel shader draws depth only)
+	struct SetPipelineCommand
+	{
+		Header header;
+		void* vertexShader;
+		void* inputLayout;
+		void* pixelShader;
+	};
+
+	// Uploads the "dataSize" bytes after the command to a constant
+	// buffer and binds it to a stage's slot
+	struct SetConstantsCommand
+	{
+		Header header;
+		Stage stage;
+		uint32_t slot;
+		void* buffer;
+		uint32_t dataSize;
+		uint32_t padding;
+	};
+
+	struct SetResourceCommand
+	{
+		Header header;
+		Stage stage;
+		uint32_t slot;
+		void* view;
+	};
+
+	struct SetSamplerCommand
+	{
+		Header header;
+		Stage stage;
+		uint32_t slot;
+		void* sampler;
+	};
+
+	// Unbinds "count" resource slots from "first" on
+	struct ClearResourcesCommand
+	{
+		Header header;
+		Stage stage;
+		uint32_t first;
+		uint32_t count;
+		uint32_t padding;
+	};
+
+	struct SetVertexBufferCommand
+	{
+		Header header;
+		uint32_t slot;
+		uint32_t stride;
+		void* buffer;
+		uint32_t offset;
+		uint32_t padding;
+	};
+
+	struct SetIndexBufferCommand
+	{
+		Header header;
+		void* buffer;
+		uint32_t indexSize;	// 2 or 4 bytes
+		uint32_t padding;
+	};
+
+	// Replaces the whole contents of a dynamic buffer with the
+	// "dataSize" bytes after the command
+	struct UpdateBufferCommand
+	{
+		Header header;
+		void* buffer;
+		uint32_t dataSize;
+		uint32_t padding;
+	};
+
+	// One render target (or none) and a depth buffer (or none)
+	struct SetTargetsCommand
+	{
+		Header header;
+		void* renderTarget;
+		void* depthStencil;
+	};
+
+	struct ClearTargetCommand
+	{
+		Header header;
+		void* renderTarget;
+		float color[4];
+	};
+
+	struct ClearDepthCommand
+	{
+		Header header;
+		void* depthStencil;
+		float depth;
+		uint32_t padding;
+	};
+
+	// Covers the whole target, with depths from 0 to 1
+	struct SetViewportCommand
+	{
+		Header header;
+		float width;
+		float height;
+	};
+
+	// A null state restores the default
+	struct SetStateCommand
+	{
+		Header header;
+		void* state;
+	};
+
+	struct DrawCommand
+	{
+		Header header;
+		uint32_t vertexCount;
+		uint32_t startVertex;
+	};
+
+	struct DrawIndexedCommand
+	{
+		Header header;
+		uint32_t indexCount;
+		uint32_t startIndex;
+		int32_t baseVertex;
+		uint32_t padding;
+	};
+
+	struct DrawIndexedInstancedCommand
+	{
+		Header header;
+		uint32_t indexCount;
+		uint32_t instanceCount;
+		uint32_t startIndex;
+		int32_t baseVertex;
+		uint32_t startInstance;
+		uint32_t padding;
+	};
+
+private:
+
+	// The stream, in 8-byte units so every command stays aligned
+	std::vector<uint64_t> memory;
+	size_t used;
+	unsigned int commandCount;
+
+	// Helpers
+	void* Push(Type type, size_t commandSize, size_t dataSize);
+	template <typename Command> Command* Push(Type type, size_t dataSize = 0);
+
+public:
+
+	CommandBuffer();
+
+	// Empties the stream (keeping its memory)
+	void Clear();
+
+	// Copies another stream's commands onto the end of this one
+	void Append(const CommandBuffer& other);
+
+	// Recording.  SetConstants() and UpdateBuffer() copy their data
+	// into the stream and return where it now lives, which stays
+	// valid until the next command is recorded.
+	void SetPipeline(void* vertexShader, void* inputLayout, void* pixelShader);
+	void* SetConstants(Stage stage, unsigned int slot, void* buffer, const void* data, unsigned int size);
+	void SetResource(Stage stage, unsigned int slot, void* view);
+	void SetSampler(Stage stage, unsigned int slot, void* sampler);
+	void ClearResources(Stage stage, unsigned int first, unsigned int count);
+	void SetVertexBuffer(unsigned int slot, void* buffer, unsigned int stride, unsigned int offset = 0);
+	void SetIndexBuffer(void* buffer, unsigned int indexSize);
+	void* UpdateBuffer(void* buffer, const void* data, unsigned int size);
+	void SetTargets(void* renderTarget, void* depthStencil);
+	void ClearTarget(void* renderTarget, const float color[4]);
+	void ClearDepth(void* depthStencil, float depth = 1.0f);
+	void SetViewport(float width, float height);
+	void SetRasterizerState(void* state);
+	void SetDepthState(void* state);
+	void Draw(unsigned int vertexCount, unsigned int startVertex = 0);
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndex = 0, int baseVertex = 0);
+	void DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex = 0, int baseVertex = 0, unsigned int startInstance = 0);
+
+	// Walking the stream: the first command (or null when it's empty),
+	// and the one after "command" (or null after the last).  Any data
+	// a command carries starts right after its struct.
+	const Header* GetFirst() const;
+	const Header* GetNext(const Header* command) const;
+
+	// Getters
+	unsigned int GetCommandCount() const;
+	size_t GetSize() const;		// In bytes
+};
+
+// --------------------------------------------------------
+// Something that consumes command streams, in the order
+// they're handed to it
+// --------------------------------------------------------
+class CommandBackend
+{
+public:
+	virtual ~CommandBackend() = default;
+	virtual void Execute(const CommandBuffer& commands) = 0;
+};
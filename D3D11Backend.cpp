@@ -0,0 +1,168 @@
+#include "D3D11Backend.h"
+#include "Graphics.h"
+
+#include <cstring>
+
+// --------------------------------------------------------
+// Walks the stream from front to back, executing each
+// command as it comes
+// --------------------------------------------------------
+void D3D11Backend::Execute(const CommandBuffer& commands)
+{
+	ID3D11DeviceContext* context = Graphics::Context.Get();
+	for (const CommandBuffer::Header* command = commands.GetFirst(); command; command = commands.GetNext(command))
+	{
+		switch (command->type)
+		{
+		case CommandBuffer::TypeSetPipeline:
+		{
+			const CommandBuffer::SetPipelineCommand* c = (const CommandBuffer::SetPipelineCommand*)command;
+			context->IASetInputLayout((ID3D11InputLayout*)c->inputLayout);
+			context->VSSetShader((ID3D11VertexShader*)c->vertexShader, 0, 0);
+			context->PSSetShader((ID3D11PixelShader*)c->pixelShader, 0, 0);
+			break;
+		}
+
+		case CommandBuffer::TypeSetConstants:
+		{
+			const CommandBuffer::SetConstantsCommand* c = (const CommandBuffer::SetConstantsCommand*)command;
+			ID3D11Buffer* buffer = (ID3D11Buffer*)c->buffer;
+			context->UpdateSubresource(buffer, 0, 0, c + 1, 0, 0);
+			if (c->stage == CommandBuffer::StageVertex)
+				context->VSSetConstantBuffers(c->slot, 1, &buffer);
+			else
+				context->PSSetConstantBuffers(c->slot, 1, &buffer);
+			break;
+		}
+
+		case CommandBuffer::TypeSetResource:
+		{
+			const CommandBuffer::SetResourceCommand* c = (const CommandBuffer::SetResourceCommand*)command;
+			ID3D11ShaderResourceView* view = (ID3D11ShaderResourceView*)c->view;
+			if (c->stage == CommandBuffer::StageVertex)
+				context->VSSetShaderResources(c->slot, 1, &view);
+			else
+				context->PSSetShaderResources(c->slot, 1, &view);
+			break;
+		}
+
+		case CommandBuffer::TypeSetSampler:
+		{
+			const CommandBuffer::SetSamplerCommand* c = (const CommandBuffer::SetSamplerCommand*)command;
+			ID3D11SamplerState* sampler = (ID3D11SamplerState*)c->sampler;
+			if (c->stage == CommandBuffer::StageVertex)
+				context->VSSetSamplers(c->slot, 1, &sampler);
+			else
+				context->PSSetSamplers(c->slot, 1, &sampler);
+			break;
+		}
+
+		case CommandBuffer::TypeClearResources:
+		{
+			const CommandBuffer::ClearResourcesCommand* c = (const CommandBuffer::ClearResourcesCommand*)command;
+			ID3D11ShaderResourceView* nullSRVs[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT] = {};
+			unsigned int count = c->count < D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT ? c->count : D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT;
+			if (c->stage == CommandBuffer::StageVertex)
+				context->VSSetShaderResources(c->first, count, nullSRVs);
+			else
+				context->PSSetShaderResources(c->first, count, nullSRVs);
+			break;
+		}
+
+		case CommandBuffer::TypeSetVertexBuffer:
+		{
+			const CommandBuffer::SetVertexBufferCommand* c = (const CommandBuffer::SetVertexBufferCommand*)command;
+			ID3D11Buffer* buffer = (ID3D11Buffer*)c->buffer;
+			UINT stride = c->stride;
+			UINT offset = c->offset;
+			context->IASetVertexBuffers(c->slot, 1, &buffer, &stride, &offset);
+			break;
+		}
+
+		case CommandBuffer::TypeSetIndexBuffer:
+		{
+			const CommandBuffer::SetIndexBufferCommand* c = (const CommandBuffer::SetIndexBufferCommand*)command;
+			context->IASetIndexBuffer((ID3D11Buffer*)c->buffer, c->indexSize == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, 0);
+			break;
+		}
+
+		case CommandBuffer::TypeUpdateBuffer:
+		{
+			// The whole buffer is rewritten, so the old contents can go
+			const CommandBuffer::UpdateBufferCommand* c = (const CommandBuffer::UpdateBufferCommand*)command;
+			D3D11_MAPPED_SUBRESOURCE mapped = {};
+			if (SUCCEEDED(context->Map((ID3D11Buffer*)c->buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+			{
+				memcpy(mapped.pData, c + 1, c->dataSize);
+				context->Unmap((ID3D11Buffer*)c->buffer, 0);
+			}
+			break;
+		}
+
+		case CommandBuffer::TypeSetTargets:
+		{
+			const CommandBuffer::SetTargetsCommand* c = (const CommandBuffer::SetTargetsCommand*)command;
+			ID3D11RenderTargetView* target = (ID3D11RenderTargetView*)c->renderTarget;
+			context->OMSetRenderTargets(1, &target, (ID3D11DepthStencilView*)c->depthStencil);
+			break;
+		}
+
+		case CommandBuffer::TypeClearTarget:
+		{
+			const CommandBuffer::ClearTargetCommand* c = (const CommandBuffer::ClearTargetCommand*)command;
+			context->ClearRenderTargetView((ID3D11RenderTargetView*)c->renderTarget, c->color);
+			break;
+		}
+
+		case CommandBuffer::TypeClearDepth:
+		{
+			const CommandBuffer::ClearDepthCommand* c = (const CommandBuffer::ClearDepthCommand*)command;
+			context->ClearDepthStencilView((ID3D11DepthStencilView*)c->depthStencil, D3D11_CLEAR_DEPTH, c->depth, 0);
+			break;
+		}
+
+		case CommandBuffer::TypeSetViewport:
+		{
+			const CommandBuffer::SetViewportCommand* c = (const CommandBuffer::SetViewportCommand*)command;
+			D3D11_VIEWPORT viewport = {};
+			viewport.Width = c->width;
+			viewport.Height = c->height;
+			viewport.MaxDepth = 1.0f;
+			context->RSSetViewports(1, &viewport);
+			break;
+		}
+
+		case CommandBuffer::TypeSetRasterizerState:
+			context->RSSetState((ID3D11RasterizerState*)((const CommandBuffer::SetStateCommand*)command)->state);
+			break;
+
+		case CommandBuffer::TypeSetDepthState:
+			context->OMSetDepthStencilState((ID3D11DepthStencilState*)((const CommandBuffer::SetStateCommand*)command)->state, 0);
+			break;
+
+		case CommandBuffer::TypeDraw:
+		{
+			const CommandBuffer::DrawCommand* c = (const CommandBuffer::DrawCommand*)command;
+			context->Draw(c->vertexCount, c->startVertex);
+			break;
+		}
+
+		case CommandBuffer::TypeDrawIndexed:
+		{
+			const CommandBuffer::DrawIndexedCommand* c = (const CommandBuffer::DrawIndexedCommand*)command;
+			context->DrawIndexed(c->indexCount, c->startIndex, c->baseVertex);
+			break;
+		}
+
+		case CommandBuffer::TypeDrawIndexedInstanced:
+		{
+			const CommandBuffer::DrawIndexedInstancedCommand* c = (const CommandBuffer::DrawIndexedInstancedCommand*)command;
+			context->DrawIndexedInstanced(c->indexCount, c->instanceCount, c->startIndex, c->baseVertex, c->startInstance);
+			break;
+		}
+
+		default:
+			break;
+		}
+	}
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "CommandBuffer.h"
+
+// --------------------------------------------------------
+// Replays command streams on Graphics::Context, turning each
+// command back into the D3D11 call(s) it stands for.  The
+// stream's handles must be the raw D3D11 objects (shaders,
+// buffers, views and states) they name.
+// --------------------------------------------------------
+class D3D11Backend : public CommandBackend
+{
+public:
+	void Execute(const CommandBuffer& commands) override;
+};
@@ -0,0 +1,700 @@
+#include "EntityStore.h"
+#include "Graphics.h"
+#include "SimpleShader.h"
+#include "ShaderCommands.h"
+
+#include <algorithm>
+
+using namespace DirectX;
+
+EntityStore::EntityStore(TransformSystem& transformSystem) :
+	transformSystem(&transformSystem)
+{
+}
+
+// --------------------------------------------------------
+// Adds an entity as the last row, with a fresh transform.
+// Handle slots are reused once freed; their generation was
+// bumped on the way out, so old handles stay dead.
+// --------------------------------------------------------
+EntityStore::Handle EntityStore::Create(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material)
+{
+	Handle entity;
+	if (!freeHandles.empty())
+	{
+		entity.index = freeHandles.back();
+		freeHandles.pop_back();
+	}
+	else
+	{
+		entity.index = (unsigned int)handleRows.size();
+		handleRows.push_back(InvalidRow);
+		generations.push_back(0);
+	}
+	entity.generation = generations[entity.index];
+
+	unsigned int row = (unsigned int)rowHandles.size();
+	handleRows[entity.index] = row;
+	rowHandles.push_back(entity.index);
+
+	meshes.push_back(mesh);
+	materials.push_back(material);
+	transforms.emplace_back(*transformSystem);
+	lods.push_back(0);
+	occluders.push_back(0);
+	colorTints.push_back(XMFLOAT3(1, 1, 1));
+	uvScales.push_back(1.0f);
+	uvOffsets.push_back(0.0f);
+	sphereX.push_back(0.0f); sphereY.push_back(0.0f); sphereZ.push_back(0.0f); sphereRadius.push_back(0.0f);
+	boxX.push_back(0.0f); boxY.push_back(0.0f); boxZ.push_back(0.0f);
+	boxExtentX.push_back(0.0f); boxExtentY.push_back(0.0f); boxExtentZ.push_back(0.0f);
+	boundsVersions.push_back(0);
+	boundsValid.push_back(0);
+
+	// The new transform starts dirty, so its first rebuild marks it
+	// moved and UpdateBounds() picks the row up from there
+	unsigned int slot = transforms.back().GetSlot();
+	if (slot >= slotHandles.size())
+		slotHandles.resize(slot + 1, InvalidRow);
+	slotHandles[slot] = entity.index;
+
+	return entity;
+}
+
+// --------------------------------------------------------
+// Removes an entity by moving the last row into its place,
+// which keeps the rows packed.  The moved row's handle is
+// pointed at its new row.
+// --------------------------------------------------------
+void EntityStore::Destroy(Handle entity)
+{
+	unsigned int row = GetRow(entity);
+	if (row == InvalidRow)
+		return;
+
+	slotHandles[transforms[row].GetSlot()] = InvalidRow;
+
+	unsigned int last = (unsigned int)rowHandles.size() - 1;
+	if (row != last)
+	{
+		meshes[row] = std::move(meshes[last]);
+		materials[row] = std::move(materials[last]);
+		transforms[row] = std::move(transforms[last]);
+		lods[row] = lods[last];
+		occluders[row] = occluders[last];
+		colorTints[row] = colorTints[last];
+		uvScales[row] = uvScales[last];
+		uvOffsets[row] = uvOffsets[last];
+		sphereX[row] = sphereX[last]; sphereY[row] = sphereY[last]; sphereZ[row] = sphereZ[last]; sphereRadius[row] = sphereRadius[last];
+		boxX[row] = boxX[last]; boxY[row] = boxY[last]; boxZ[row] = boxZ[last];
+		boxExtentX[row] = boxExtentX[last]; boxExtentY[row] = boxExtentY[last]; boxExtentZ[row] = boxExtentZ[last];
+		boundsVersions[row] = boundsVersions[last];
+		boundsValid[row] = boundsValid[last];
+
+		rowHandles[row] = rowHandles[last];
+		handleRows[rowHandles[row]] = row;
+	}
+
+	meshes.pop_back();
+	materials.pop_back();
+	transforms.pop_back();
+	lods.pop_back();
+	occluders.pop_back();
+	colorTints.pop_back();
+	uvScales.pop_back();
+	uvOffsets.pop_back();
+	sphereX.pop_back(); sphereY.pop_back(); sphereZ.pop_back(); sphereRadius.pop_back();
+	boxX.pop_back(); boxY.pop_back(); boxZ.pop_back();
+	boxExtentX.pop_back(); boxExtentY.pop_back(); boxExtentZ.pop_back();
+	boundsVersions.pop_back();
+	boundsValid.pop_back();
+	rowHandles.pop_back();
+
+	spatialIndex.Remove(entity.index);
+	handleRows[entity.index] = InvalidRow;
+	generations[entity.index]++;
+	freeHandles.push_back(entity.index);
+}
+
+bool EntityStore::IsAlive(Handle entity)
+{
+	return GetRow(entity) != InvalidRow;
+}
+
+// Grows every component array (and the handle table) up front
+void EntityStore::Reserve(unsigned int count)
+{
+	size_t rows = rowHandles.size() + count;
+	meshes.reserve(rows);
+	materials.reserve(rows);
+	transforms.reserve(rows);
+	lods.reserve(rows);
+	occluders.reserve(rows);
+	colorTints.reserve(rows);
+	uvScales.reserve(rows);
+	uvOffsets.reserve(rows);
+	sphereX.reserve(rows); sphereY.reserve(rows); sphereZ.reserve(rows); sphereRadius.reserve(rows);
+	boxX.reserve(rows); boxY.reserve(rows); boxZ.reserve(rows);
+	boxExtentX.reserve(rows); boxExtentY.reserve(rows); boxExtentZ.reserve(rows);
+	boundsVersions.reserve(rows);
+	boundsValid.reserve(rows);
+	rowHandles.reserve(rows);
+
+	if (count > freeHandles.size())
+	{
+		size_t handles = handleRows.size() + (count - freeHandles.size());
+		handleRows.reserve(handles);
+		generations.reserve(handles);
+	}
+
+	transformSystem->Reserve(count);
+}
+
+// --------------------------------------------------------
+// Bulk creation from a block of scene records.  Everything
+// is reserved first, so the rows land in contiguous storage
+// without a single reallocation along the way.  Parents are
+// linked once every row exists, so the transform system
+// builds its hierarchy storage once rather than growing it
+// with each new row.
+// --------------------------------------------------------
+unsigned int EntityStore::CreateFromScene(
+	const SceneFile::EntityRecord* records,
+	unsigned int count,
+	const std::shared_ptr<Mesh>* sceneMeshes,
+	const std::shared_ptr<Material>* sceneMaterials)
+{
+	Reserve(count);
+
+	unsigned int firstRow = GetCount();
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const SceneFile::EntityRecord& record = records[i];
+		Create(sceneMeshes[record.Mesh], sceneMaterials[record.Material]);
+
+		unsigned int row = firstRow + i;
+		transforms[row].SetPosition(record.Position);
+		transforms[row].SetRotationQuaternion(record.Rotation);
+		transforms[row].SetScale(record.Scale);
+		colorTints[row] = record.ColorTint;
+		uvScales[row] = record.UVScale;
+		uvOffsets[row] = record.UVOffset;
+		occluders[row] = record.Occluder != 0;
+	}
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (records[i].Parent != SceneFile::None)
+			transforms[firstRow + i].SetParent(&transforms[firstRow + records[i].Parent]);
+	}
+
+	return firstRow;
+}
+
+// Handles and rows
+
+unsigned int EntityStore::GetRow(Handle entity)
+{
+	if (entity.index >= handleRows.size() || generations[entity.index] != entity.generation)
+		return InvalidRow;
+	return handleRows[entity.index];
+}
+
+EntityStore::Handle EntityStore::GetHandle(unsigned int row)
+{
+	Handle entity;
+	entity.index = rowHandles[row];
+	entity.generation = generations[entity.index];
+	return entity;
+}
+
+// Getters
+
+Mesh* EntityStore::GetMesh(unsigned int row) { return meshes[row].get(); }
+Material* EntityStore::GetMaterial(unsigned int row) { return materials[row].get(); }
+Transform& EntityStore::GetTransform(unsigned int row) { return transforms[row]; }
+int EntityStore::GetLod(unsigned int row) { return lods[row]; }
+XMFLOAT3 EntityStore::GetColorTint(unsigned int row) { return colorTints[row]; }
+float EntityStore::GetUVScale(unsigned int row) { return uvScales[row]; }
+float EntityStore::GetUVOffset(unsigned int row) { return uvOffsets[row]; }
+unsigned int EntityStore::GetCount() { return (unsigned int)rowHandles.size(); }
+
+// World-space bounds of the mesh
+BoundingBox EntityStore::GetWorldBoundingBox(unsigned int row)
+{
+	UpdateWorldBounds(row);
+	return BoundingBox(
+		XMFLOAT3(boxX[row], boxY[row], boxZ[row]),
+		XMFLOAT3(boxExtentX[row], boxExtentY[row], boxExtentZ[row]));
+}
+
+BoundingSphere EntityStore::GetWorldBoundingSphere(unsigned int row)
+{
+	UpdateWorldBounds(row);
+	return BoundingSphere(XMFLOAT3(sphereX[row], sphereY[row], sphereZ[row]), sphereRadius[row]);
+}
+
+bool EntityStore::IsOccluder(unsigned int row) { return occluders[row] != 0; }
+const XMFLOAT4X4& EntityStore::GetDrawWorldMatrix(unsigned int row) { return drawWorlds[row]; }
+
+// Setters
+
+void EntityStore::SetMesh(unsigned int row, std::shared_ptr<Mesh> mesh) { meshes[row] = mesh; boundsValid[row] = 0; staleHandles.push_back(rowHandles[row]); }
+void EntityStore::SetMaterial(unsigned int row, std::shared_ptr<Material> material) { materials[row] = material; }
+void EntityStore::SetColorTint(unsigned int row, XMFLOAT3 tint) { colorTints[row] = tint; }
+void EntityStore::SetUVScale(unsigned int row, float scale) { uvScales[row] = scale; }
+void EntityStore::SetUVOffset(unsigned int row, float offset) { uvOffsets[row] = offset; }
+void EntityStore::SetOccluder(unsigned int row, bool occluder) { occluders[row] = occluder; }
+
+// Functions
+
+// --------------------------------------------------------
+// Moves the mesh's object-space bounds into world space, only
+// when the transform has actually changed since the last time.
+// Static entities pay for this once.  Returns whether anything
+// was rebuilt.
+// --------------------------------------------------------
+bool EntityStore::UpdateWorldBounds(unsigned int row)
+{
+	unsigned int version = transforms[row].GetVersion();
+	if (boundsValid[row] && version == boundsVersions[row])
+		return false;
+
+	XMFLOAT4X4 world = transforms[row].GetWorldMatrix();
+	XMMATRIX worldMat = XMLoadFloat4x4(&world);
+	BoundingBox worldBox;
+	BoundingSphere worldSphere;
+	meshes[row]->GetBoundingBox().Transform(worldBox, worldMat);
+	meshes[row]->GetBoundingSphere().Transform(worldSphere, worldMat);
+
+	sphereX[row] = worldSphere.Center.x;
+	sphereY[row] = worldSphere.Center.y;
+	sphereZ[row] = worldSphere.Center.z;
+	sphereRadius[row] = worldSphere.Radius;
+	boxX[row] = worldBox.Center.x;
+	boxY[row] = worldBox.Center.y;
+	boxZ[row] = worldBox.Center.z;
+	boxExtentX[row] = worldBox.Extents.x;
+	boxExtentY[row] = worldBox.Extents.y;
+	boxExtentZ[row] = worldBox.Extents.z;
+
+	boundsVersions[row] = version;
+	boundsValid[row] = 1;
+
+	spatialIndex.Update(rowHandles[row], worldBox.Center, worldBox.Extents);
+	return true;
+}
+
+// --------------------------------------------------------
+// The transform system says which slots were rebuilt, so only
+// their rows (and rows with a new mesh) are visited.  Pending
+// transform changes are batched first, so none are missed.
+// --------------------------------------------------------
+unsigned int EntityStore::UpdateBounds()
+{
+	transformSystem->UpdateMatrices();
+	transformSystem->TakeMovedSlots(movedSlots);
+
+	unsigned int updated = 0;
+	for (unsigned int slot : movedSlots)
+	{
+		if (slot < slotHandles.size() && slotHandles[slot] != InvalidRow)
+			updated += UpdateWorldBounds(handleRows[slotHandles[slot]]);
+	}
+
+	for (unsigned int handle : staleHandles)
+	{
+		if (handleRows[handle] != InvalidRow)
+			updated += UpdateWorldBounds(handleRows[handle]);
+	}
+	staleHandles.clear();
+	return updated;
+}
+
+// Points at the bounds arrays for the culling kernels
+FrustumCulling::Bounds EntityStore::GetCurrentBounds()
+{
+	FrustumCulling::Bounds bounds = {
+		sphereX.data(), sphereY.data(), sphereZ.data(), sphereRadius.data(),
+		boxX.data(), boxY.data(), boxZ.data(), boxExtentX.data(), boxExtentY.data(), boxExtentZ.data() };
+	return bounds;
+}
+
+// The SIMD frustum test over all rows
+unsigned int EntityStore::Cull(const FrustumCulling::View& view, std::vector<unsigned int>& visibleRows)
+{
+	return FrustumCulling::Cull(GetCurrentBounds(), GetCount(), view, visibleRows);
+}
+
+// The light-space caster test over all rows
+unsigned int EntityStore::CullShadowCasters(
+	const XMFLOAT4X4& lightView,
+	const XMFLOAT4X4& lightProjection,
+	const std::vector<unsigned int>& receiverRows,
+	std::vector<unsigned int>& casterRows)
+{
+	return FrustumCulling::CullShadowCasters(GetCurrentBounds(), GetCount(), lightView, lightProjection, receiverRows, casterRows);
+}
+
+// Turns the handles a query gathered into sorted rows
+unsigned int EntityStore::QueryHandlesToRows(std::vector<unsigned int>& rows)
+{
+	rows.clear();
+	for (unsigned int handle : queryHandles)
+		rows.push_back(handleRows[handle]);
+	std::sort(rows.begin(), rows.end());
+	return (unsigned int)rows.size();
+}
+
+// --------------------------------------------------------
+// The octree only knows boxes, so the screen-size cutoff is
+// applied to what it finds, using the bounding spheres the
+// same way the linear cull does
+// --------------------------------------------------------
+unsigned int EntityStore::QueryFrustum(const FrustumCulling::View& view, std::vector<unsigned int>& rows)
+{
+	queryHandles.clear();
+	spatialIndex.QueryFrustum(view.planes, queryHandles);
+	QueryHandlesToRows(rows);
+
+	if (view.minScreenSize > 0.0f)
+	{
+		float minSize = view.minScreenSize * view.tanHalfFov;
+		size_t kept = 0;
+		for (unsigned int row : rows)
+		{
+			float dx = sphereX[row] - view.position.x, dy = sphereY[row] - view.position.y, dz = sphereZ[row] - view.position.z;
+			if (sphereRadius[row] * sphereRadius[row] >= minSize * minSize * (dx * dx + dy * dy + dz * dz))
+				rows[kept++] = row;
+		}
+		rows.resize(kept);
+	}
+	return (unsigned int)rows.size();
+}
+
+unsigned int EntityStore::QuerySphere(XMFLOAT3 center, float radius, std::vector<unsigned int>& rows)
+{
+	queryHandles.clear();
+	spatialIndex.QuerySphere(center, radius, queryHandles);
+	return QueryHandlesToRows(rows);
+}
+
+unsigned int EntityStore::QueryBox(const BoundingBox& box, std::vector<unsigned int>& rows)
+{
+	queryHandles.clear();
+	spatialIndex.QueryBox(box.Center, box.Extents, queryHandles);
+	return QueryHandlesToRows(rows);
+}
+
+unsigned int EntityStore::QueryRay(XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, std::vector<unsigned int>& rows)
+{
+	queryHandles.clear();
+	spatialIndex.QueryRay(origin, direction, maxDistance, queryHandles);
+	return QueryHandlesToRows(rows);
+}
+
+unsigned int EntityStore::GetSpatialNodeCount() { return spatialIndex.GetNodeCount(); }
+
+// --------------------------------------------------------
+// Occluders go in where this frame draws them, so moving and
+// parented ones line up with their pixels.  World matrices
+// are copied into the buffer, so it can draw while things
+// move on.  The geometry belongs to the meshes, which the
+// store keeps alive.
+// --------------------------------------------------------
+unsigned int EntityStore::AddOccluders(OcclusionBuffer& buffer, float alpha)
+{
+	occluderRows.clear();
+	for (unsigned int row = 0; row < GetCount(); row++)
+	{
+		if (occluders[row] && !meshes[row]->GetOccluderGeometry().corners.empty())
+			occluderRows.push_back(row);
+	}
+
+	InterpolateMatrices(occluderRows, alpha);
+	for (unsigned int row : occluderRows)
+		buffer.AddOccluder(drawWorlds[row], meshes[row]->GetOccluderGeometry());
+	return (unsigned int)occluderRows.size();
+}
+
+// Filters "rows" in place against each row's world box as of the last UpdateBounds()
+unsigned int EntityStore::CullOccluded(const OcclusionBuffer& buffer, std::vector<unsigned int>& rows)
+{
+	size_t kept = 0;
+	for (unsigned int row : rows)
+	{
+		if (occluders[row] || !buffer.IsOccluded(
+			XMFLOAT3(boxX[row], boxY[row], boxZ[row]),
+			XMFLOAT3(boxExtentX[row], boxExtentY[row], boxExtentZ[row])))
+			rows[kept++] = row;
+	}
+
+	unsigned int culled = (unsigned int)(rows.size() - kept);
+	rows.resize(kept);
+	return culled;
+}
+
+// --------------------------------------------------------
+// Depth is measured to the world bounding sphere's center,
+// which is close enough for ordering whole objects.  Rows in
+// a pass that ignores materials all share shader and material
+// id 0, so only the mesh separates them.
+// --------------------------------------------------------
+void EntityStore::Enqueue(
+	RenderQueue& queue,
+	unsigned int pass,
+	const std::vector<unsigned int>& rows,
+	XMFLOAT3 eye,
+	XMFLOAT3 forward,
+	float farZ,
+	bool useMaterials)
+{
+	for (unsigned int row : rows)
+	{
+		float depth =
+			(sphereX[row] - eye.x) * forward.x +
+			(sphereY[row] - eye.y) * forward.y +
+			(sphereZ[row] - eye.z) * forward.z;
+
+		unsigned int shader = 0;
+		unsigned int material = 0;
+		if (useMaterials)
+		{
+			shader = queue.GetShaderId(materials[row]->GetVertexShader(), materials[row]->GetPixelShader());
+			material = queue.GetMaterialId(materials[row].get());
+		}
+
+		queue.Add(
+			RenderQueue::MakeKey(pass, shader, material, queue.GetMeshId(meshes[row].get()), RenderQueue::QuantizeDepth(depth, farZ)),
+			row);
+	}
+}
+
+// --------------------------------------------------------
+// Picks the coarsest LOD whose simplification error stays
+// under "maxScreenError" (a fraction of the screen's height)
+// when projected from the mesh's center.  The error is
+// scaled by the largest axis of the world matrix.
+// --------------------------------------------------------
+void EntityStore::SelectLod(unsigned int row, Camera& camera, float maxScreenError)
+{
+	XMFLOAT4X4 world = transforms[row].GetWorldMatrix();
+	XMMATRIX worldMat = XMLoadFloat4x4(&world);
+	float scale = XMVectorGetX(XMVectorMax(
+		XMVector3Length(worldMat.r[0]),
+		XMVectorMax(XMVector3Length(worldMat.r[1]), XMVector3Length(worldMat.r[2]))));
+
+	XMFLOAT3 center = GetWorldBoundingSphere(row).Center;
+	Mesh* mesh = meshes[row].get();
+
+	lods[row] = 0;
+	for (int i = mesh->GetLodCount() - 1; i > 0; i--)
+	{
+		if (camera.GetProjectedSize(center, mesh->GetLod(i).error * scale) <= maxScreenError)
+		{
+			lods[row] = i;
+			break;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Casts a world-space ray (normalized direction) against the
+// mesh's triangles.  The world bounding sphere rejects most
+// misses before the ray is moved into object space.  The
+// direction isn't renormalized there, so hit distances stay
+// in world units.  "distance" is both the limit and the result.
+// --------------------------------------------------------
+bool EntityStore::Intersect(unsigned int row, XMFLOAT3 origin, XMFLOAT3 direction, float& distance)
+{
+	MeshBVH* bvh = meshes[row]->GetBVH().get();
+	if (!bvh)
+		return false;
+
+	XMVECTOR rayOrigin = XMLoadFloat3(&origin);
+	XMVECTOR rayDirection = XMLoadFloat3(&direction);
+	float sphereDistance;
+	if (!GetWorldBoundingSphere(row).Intersects(rayOrigin, rayDirection, sphereDistance))
+		return false;
+
+	XMFLOAT4X4 world = transforms[row].GetWorldMatrix();
+	XMMATRIX inverseWorld = XMMatrixInverse(0, XMLoadFloat4x4(&world));
+	XMFLOAT3 localOrigin, localDirection;
+	XMStoreFloat3(&localOrigin, XMVector3TransformCoord(rayOrigin, inverseWorld));
+	XMStoreFloat3(&localDirection, XMVector3TransformNormal(rayDirection, inverseWorld));
+
+	MeshBVH::RayHit hit;
+	if (!bvh->Intersect(localOrigin, localDirection, distance, hit))
+		return false;
+
+	distance = hit.distance;
+	return true;
+}
+
+// Material surface settings with the entity's overrides applied on top
+void EntityStore::GetSurface(unsigned int row, XMFLOAT3& colorTint, float& uvScale, float& uvOffset)
+{
+	Material* material = materials[row].get();
+	XMFLOAT3 materialTint = material->GetColorTint();
+	colorTint = XMFLOAT3(
+		materialTint.x * colorTints[row].x,
+		materialTint.y * colorTints[row].y,
+		materialTint.z * colorTints[row].z);
+
+	// (uv * materialScale + materialOffset) * scale + offset
+	uvScale = material->GetUVScale() * uvScales[row];
+	uvOffset = material->GetUVOffset() * uvScales[row] + uvOffsets[row];
+}
+
+// --------------------------------------------------------
+// Binds the material's textures and samplers, the shaders and
+// the mesh's buffers, skipping whatever "bound" says is
+// already set
+// --------------------------------------------------------
+void EntityStore::Bind(CommandBuffer& commands, DrawState& bound, Mesh* mesh, Material* material, SimpleVertexShader* vs, SimplePixelShader* ps)
+{
+	if (material != bound.material)
+	{
+		material->BindTexturesAndSamplers(commands);
+		bound.material = material;
+		bound.changes++;
+	}
+
+	// Activate the shaders for this mesh's materials before drawing
+	if (vs != bound.vertexShader || ps != bound.pixelShader)
+	{
+		ShaderCommands::SetShaders(commands, vs, ps);
+		bound.changes += (vs != bound.vertexShader) + (ps != bound.pixelShader);
+		bound.vertexShader = vs;
+		bound.pixelShader = ps;
+	}
+
+	// The mesh's buffers are set here rather than by its draw
+	// functions, since DrawVisible() skips setting them when
+	// every meshlet is culled
+	if (mesh != bound.mesh)
+	{
+		mesh->SetBuffers(commands);
+		bound.mesh = mesh;
+		bound.changes++;
+	}
+}
+
+// --------------------------------------------------------
+// Where each row is between the last two simulation steps.
+// The transforms share scratch space while blending, so this
+// happens once, up front, rather than in every draw.
+// --------------------------------------------------------
+void EntityStore::InterpolateMatrices(const std::vector<unsigned int>& rows, float alpha)
+{
+	if (drawWorlds.size() < rowHandles.size())
+	{
+		drawWorlds.resize(rowHandles.size());
+		drawWorldInvTransposes.resize(rowHandles.size());
+	}
+
+	for (unsigned int row : rows)
+		transforms[row].GetInterpolatedMatrices(alpha, drawWorlds[row], drawWorldInvTransposes[row]);
+}
+
+// Everything the instanced vertex shader needs per row
+void EntityStore::PackInstances(const std::vector<unsigned int>& rows, std::vector<InstanceBatcher::InstanceData>& instances)
+{
+	instances.resize(rows.size());
+	for (size_t i = 0; i < rows.size(); i++)
+	{
+		InstanceBatcher::InstanceData& instance = instances[i];
+		instance.world = drawWorlds[rows[i]];
+		instance.worldInvTranspose = drawWorldInvTransposes[rows[i]];
+		GetSurface(rows[i], instance.colorTint, instance.uvScale, instance.uvOffset);
+		instance.padding[0] = instance.padding[1] = instance.padding[2] = 0.0f;
+	}
+}
+
+// --------------------------------------------------------
+// Sets the entity's shader data and draws its mesh, with
+// only the meshlets inside the camera's view and facing it,
+// all recorded into "commands".  With a DrawState, the
+// material's textures, the shaders and the mesh buffers are
+// only bound when they differ from the last draw.
+// --------------------------------------------------------
+unsigned int EntityStore::Draw(CommandBuffer& commands, unsigned int row, Camera& camera, DrawState* state)
+{
+	Mesh* mesh = meshes[row].get();
+	Material* material = materials[row].get();
+
+	// Where the entity is between the last two simulation steps
+	const XMFLOAT4X4& world = drawWorlds[row];
+	const XMFLOAT4X4& worldInvTranspose = drawWorldInvTransposes[row];
+
+	XMFLOAT3 colorTint;
+	float uvScale, uvOffset;
+	GetSurface(row, colorTint, uvScale, uvOffset);
+
+	// Get shaders for this game entity
+	SimpleVertexShader* vs = material->GetVertexShader();
+	SimplePixelShader* ps = material->GetPixelShader();
+
+	// Record shader buffer data, on top of what the shaders hold
+	// Ensure names exactly match names in shader buffer
+	ShaderCommands::Constants vsData = ShaderCommands::SetConstants(commands, vs, CommandBuffer::StageVertex);
+	ShaderCommands::SetMatrix4x4(vsData, "world", world);
+	ShaderCommands::SetMatrix4x4(vsData, "view", camera.GetViewMatrix());
+	ShaderCommands::SetMatrix4x4(vsData, "projection", camera.GetProjectionMatrix());
+	ShaderCommands::SetMatrix4x4(vsData, "worldInvTranspose", worldInvTranspose);
+	ShaderCommands::SetFloat3(vsData, "positionScale", mesh->GetPositionScale());
+	ShaderCommands::SetFloat3(vsData, "positionOffset", mesh->GetPositionOffset());
+	ShaderCommands::SetFloat3(vsData, "colorTint", colorTint);
+
+	ShaderCommands::Constants psData = ShaderCommands::SetConstants(commands, ps, CommandBuffer::StagePixel);
+	ShaderCommands::SetFloat3(psData, "colorTint", colorTint);
+	ShaderCommands::SetFloat(psData, "uvScale", uvScale);
+	ShaderCommands::SetFloat(psData, "uvOffset", uvOffset);
+	ShaderCommands::SetFloat3(psData, "cameraPosition", camera.GetTransform()->GetPosition());
+
+	DrawState unknown;
+	DrawState& bound = state ? *state : unknown;
+	Bind(commands, bound, mesh, material, vs, ps);
+
+	// Only the meshlets inside the camera's view and facing it are submitted
+	return mesh->DrawVisible(
+		commands,
+		bound.ranges,
+		world,
+		camera.GetViewMatrix(),
+		camera.GetProjectionMatrix(),
+		true,
+		lods[row],
+		false);
+}
+
+// --------------------------------------------------------
+// Draws "instanceCount" instances, starting at "firstInstance"
+// in the buffer bound to input slot 1, with this row's mesh,
+// material and LOD.  Everything per entity comes from the
+// instance data, so the constants are set once per batch and
+// the pixel shader's tint and UV scale/offset are neutral.
+// --------------------------------------------------------
+void EntityStore::DrawInstanced(CommandBuffer& commands, unsigned int row, unsigned int firstInstance, unsigned int instanceCount, SimpleVertexShader* instancedVS, Camera& camera, DrawState* state)
+{
+	Mesh* mesh = meshes[row].get();
+	Material* material = materials[row].get();
+	SimplePixelShader* ps = material->GetPixelShader();
+
+	ShaderCommands::Constants vsData = ShaderCommands::SetConstants(commands, instancedVS, CommandBuffer::StageVertex);
+	ShaderCommands::SetMatrix4x4(vsData, "view", camera.GetViewMatrix());
+	ShaderCommands::SetMatrix4x4(vsData, "projection", camera.GetProjectionMatrix());
+	ShaderCommands::SetFloat3(vsData, "positionScale", mesh->GetPositionScale());
+	ShaderCommands::SetFloat3(vsData, "positionOffset", mesh->GetPositionOffset());
+
+	ShaderCommands::Constants psData = ShaderCommands::SetConstants(commands, ps, CommandBuffer::StagePixel);
+	ShaderCommands::SetFloat3(psData, "colorTint", XMFLOAT3(1, 1, 1));
+	ShaderCommands::SetFloat(psData, "uvScale", 1.0f);
+	ShaderCommands::SetFloat(psData, "uvOffset", 0.0f);
+	ShaderCommands::SetFloat3(psData, "cameraPosition", camera.GetTransform()->GetPosition());
+
+	DrawState unknown;
+	Bind(commands, state ? *state : unknown, mesh, material, instancedVS, ps);
+
+	mesh->DrawInstanced(commands, instanceCount, firstInstance, lods[row], false);
+}
@@ -0,0 +1,233 @@
+#pragma once
+
+#include "Mesh.h"
+#include "Transform.h"
+#include "Camera.h"
+#include "Material.h"
+#include "FrustumCulling.h"
+#include "RenderQueue.h"
+#include "InstanceBatcher.h"
+#include "LooseOctree.h"
+#include "OcclusionBuffer.h"
+#include "SceneFile.h"
+#include "CommandBuffer.h"
+#include <DirectXCollision.h>
+#include <memory>
+#include <vector>
+
+// --------------------------------------------------------
+// Every entity in a scene, as structure-of-arrays: one packed
+// array per component, with row i of each belonging to the
+// same entity.
+//
+// Rows have no gaps.  Destroying an entity moves the last row
+// into its place, so anything kept across frames should hold
+// a Handle instead: an index into a table that follows the
+// row around, plus a generation that goes stale once the
+// entity is destroyed (even if the index is reused).
+//
+// Loops go by row, from 0 to GetCount(), and the getters hand
+// out plain pointers and references, so walking the scene
+// never touches a reference count.
+// --------------------------------------------------------
+class EntityStore
+{
+public:
+
+	// Names one entity for as long as it lives (default is none)
+	struct Handle
+	{
+		unsigned int index = 0xFFFFFFFF;	// Slot in the handle table
+		unsigned int generation = 0;		// Must match the slot's for the entity to be alive
+	};
+
+	// Row of an entity that isn't alive
+	static constexpr unsigned int InvalidRow = 0xFFFFFFFF;
+
+	// What a run of Draw() calls has left bound in a command stream,
+	// so each can skip rebinding whatever matches the previous one.
+	// Start a fresh one whenever something else may have changed the
+	// pipeline, and use one per recording thread.
+	struct DrawState
+	{
+		Mesh* mesh = 0;
+		Material* material = 0;
+		SimpleVertexShader* vertexShader = 0;
+		SimplePixelShader* pixelShader = 0;
+		unsigned int changes = 0;	// Meshes, materials and shaders actually bound
+		std::vector<MeshProcessing::DrawRange> ranges;	// Scratch for meshlet culling
+	};
+
+private:
+
+	// Components, one row per live entity.  The store holds a
+	// reference to each mesh and material so they outlive it.
+	std::vector<std::shared_ptr<Mesh>> meshes;
+	std::vector<std::shared_ptr<Material>> materials;
+	std::vector<Transform> transforms;
+	std::vector<int> lods;				// Mesh level of detail picked by the last SelectLod
+	std::vector<unsigned char> occluders;	// Drawn into the occlusion buffer (see AddOccluders)
+
+	// Per-entity surface overrides, applied on top of the material's
+	// (tints multiply, UV transforms apply after the material's)
+	std::vector<DirectX::XMFLOAT3> colorTints;
+	std::vector<float> uvScales;
+	std::vector<float> uvOffsets;
+
+	// World-space bounds, one array per component so culling can
+	// test several entities at once.  UpdateBounds() rebuilds them
+	// for the rows whose transforms moved (or whose mesh changed).
+	std::vector<float> sphereX, sphereY, sphereZ, sphereRadius;
+	std::vector<float> boxX, boxY, boxZ, boxExtentX, boxExtentY, boxExtentZ;
+	std::vector<unsigned int> boundsVersions;
+	std::vector<unsigned char> boundsValid;
+
+	// World matrices to draw with, by row, blended by the last
+	// InterpolateMatrices() (only for the rows it was given)
+	std::vector<DirectX::XMFLOAT4X4> drawWorlds;
+	std::vector<DirectX::XMFLOAT4X4> drawWorldInvTransposes;
+	std::vector<unsigned int> occluderRows;
+
+	// The same world boxes in a loose octree, by handle index (which
+	// doesn't move with rows), re-filed whenever a row's bounds are
+	// rebuilt.  Queries gather handles here before turning them into rows.
+	LooseOctree spatialIndex;
+	std::vector<unsigned int> queryHandles;
+
+	// Handle table: which row each handle points at, and back
+	std::vector<unsigned int> handleRows;
+	std::vector<unsigned int> generations;
+	std::vector<unsigned int> freeHandles;
+	std::vector<unsigned int> rowHandles;
+
+	// The handle owning each transform slot (InvalidRow for slots that
+	// aren't the store's), so moved slots lead straight to their rows,
+	// and handles whose mesh changed since the last UpdateBounds()
+	std::vector<unsigned int> slotHandles;
+	std::vector<unsigned int> staleHandles;
+	std::vector<unsigned int> movedSlots;
+
+	// Where the entities' transforms live
+	TransformSystem* transformSystem;
+
+	// Helpers
+	bool UpdateWorldBounds(unsigned int row);
+	FrustumCulling::Bounds GetCurrentBounds();
+	unsigned int QueryHandlesToRows(std::vector<unsigned int>& rows);
+	void GetSurface(unsigned int row, DirectX::XMFLOAT3& colorTint, float& uvScale, float& uvOffset);
+	void Bind(CommandBuffer& commands, DrawState& bound, Mesh* mesh, Material* material, SimpleVertexShader* vs, SimplePixelShader* ps);
+
+public:
+
+	EntityStore(TransformSystem& transformSystem = TransformSystem::Default());
+
+	// Entity management (new entities are added as the last row)
+	Handle Create(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material);
+	void Destroy(Handle entity);
+	bool IsAlive(Handle entity);
+
+	// Makes room for this many more entities (and their transforms),
+	// so creating them never reallocates
+	void Reserve(unsigned int count);
+
+	// Creates one entity per scene record, in order, returning the first
+	// new row.  The records' mesh and material indices pick from the given
+	// arrays, and parents are earlier records of the same block.
+	unsigned int CreateFromScene(
+		const SceneFile::EntityRecord* records,
+		unsigned int count,
+		const std::shared_ptr<Mesh>* sceneMeshes,
+		const std::shared_ptr<Material>* sceneMaterials);
+
+	// Converting between handles and rows (InvalidRow for dead handles)
+	unsigned int GetRow(Handle entity);
+	Handle GetHandle(unsigned int row);
+
+	// Getters, by row
+	Mesh* GetMesh(unsigned int row);
+	Material* GetMaterial(unsigned int row);
+	Transform& GetTransform(unsigned int row);	// Moves when rows do
+	int GetLod(unsigned int row);
+	DirectX::XMFLOAT3 GetColorTint(unsigned int row);
+	float GetUVScale(unsigned int row);
+	float GetUVOffset(unsigned int row);
+	DirectX::BoundingBox GetWorldBoundingBox(unsigned int row);
+	DirectX::BoundingSphere GetWorldBoundingSphere(unsigned int row);
+	bool IsOccluder(unsigned int row);
+	const DirectX::XMFLOAT4X4& GetDrawWorldMatrix(unsigned int row);	// As of the last InterpolateMatrices()
+	unsigned int GetCount();
+
+	// Setters, by row
+	void SetMesh(unsigned int row, std::shared_ptr<Mesh> mesh);
+	void SetMaterial(unsigned int row, std::shared_ptr<Material> material);
+	void SetColorTint(unsigned int row, DirectX::XMFLOAT3 tint);
+	void SetUVScale(unsigned int row, float scale);
+	void SetUVOffset(unsigned int row, float offset);
+	void SetOccluder(unsigned int row, bool occluder);
+
+	// Rebuilds the world bounds of the rows whose transforms moved (or
+	// whose mesh changed) since the last call, re-filing them in the
+	// spatial index, and returns how many were rebuilt.  Call once a
+	// frame, before culling or querying: those read the bounds as they
+	// were left here, so they never visit rows that didn't move.
+	unsigned int UpdateBounds();
+
+	// Fills "visibleRows" with the rows inside the view, returning how
+	// many there are
+	unsigned int Cull(const FrustumCulling::View& view, std::vector<unsigned int>& visibleRows);
+
+	// Fills "casterRows" with the rows that can shadow any of the receiver
+	// rows through a directional light's orthographic projection
+	unsigned int CullShadowCasters(
+		const DirectX::XMFLOAT4X4& lightView,
+		const DirectX::XMFLOAT4X4& lightProjection,
+		const std::vector<unsigned int>& receiverRows,
+		std::vector<unsigned int>& casterRows);
+
+	// Queues every occluder row whose mesh has occluder geometry (meshes
+	// loaded with a BVH) into the buffer with its world matrix blended
+	// between the last two simulation steps, as InterpolateMatrices()
+	// would for drawing, and returns how many there are
+	unsigned int AddOccluders(OcclusionBuffer& buffer, float alpha);
+
+	// Drops the rows whose world box the buffer hides (occluders are always
+	// kept), leaving the rest in order, and returns how many were dropped
+	unsigned int CullOccluded(const OcclusionBuffer& buffer, std::vector<unsigned int>& rows);
+
+	// Spatial queries through the octree: each fills "rows" with the rows
+	// whose world box (as of the last UpdateBounds()) touches the shape,
+	// in row order, and returns how many there are
+	unsigned int QueryFrustum(const FrustumCulling::View& view, std::vector<unsigned int>& rows);	// Applies the view's screen-size cutoff too
+	unsigned int QuerySphere(DirectX::XMFLOAT3 center, float radius, std::vector<unsigned int>& rows);
+	unsigned int QueryBox(const DirectX::BoundingBox& box, std::vector<unsigned int>& rows);
+	unsigned int QueryRay(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, std::vector<unsigned int>& rows);
+	unsigned int GetSpatialNodeCount();
+
+	// Adds a draw for each of "rows" to "queue" in the given pass,
+	// keyed by shader, material (unless the pass ignores materials)
+	// and mesh, then by distance along "forward" from "eye"
+	void Enqueue(
+		RenderQueue& queue,
+		unsigned int pass,
+		const std::vector<unsigned int>& rows,
+		DirectX::XMFLOAT3 eye,
+		DirectX::XMFLOAT3 forward,
+		float farZ,
+		bool useMaterials = true);
+
+	// Blends the world matrices of "rows" "alpha" of the way from the
+	// last simulation step, ready for the draws that follow.  Drawing
+	// only reads these (never the transforms), so once they're set,
+	// several threads can record draws at once.
+	void InterpolateMatrices(const std::vector<unsigned int>& rows, float alpha);
+
+	// Fills "instances" with the instance data for each of "rows", in
+	// order, with their interpolated matrices
+	void PackInstances(const std::vector<unsigned int>& rows, std::vector<InstanceBatcher::InstanceData>& instances);
+
+	// Functions, by row
+	void SelectLod(unsigned int row, Camera& camera, float maxScreenError);
+	bool Intersect(unsigned int row, DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float& distance);	// Needs a mesh BVH
+	unsigned int Draw(CommandBuffer& commands, unsigned int row, Camera& camera, DrawState* state = 0);	// Returns the number of meshlets drawn, using the interpolated matrices
+	void DrawInstanced(CommandBuffer& commands, unsigned int row, unsigned int firstInstance, unsigned int instanceCount, SimpleVertexShader* instancedVS, Camera& camera, DrawState* state = 0);	// Draws a batch sharing this row's mesh, material and LOD
+};
@@ -0,0 +1,95 @@
+#include "FixedTimestep.h"
+
+#include <cmath>
+
+// Goes through the setters, so a step that isn't positive (which
+// would let Step() return true forever) keeps the 60 Hz default
+FixedTimestep::FixedTimestep(double step, unsigned int maxStepsPerFrame) :
+	step(1.0 / 60.0),
+	maxStepsPerFrame(1)
+{
+	Reset();
+	SetStep(step);
+	SetMaxStepsPerFrame(maxStepsPerFrame);
+}
+
+// --------------------------------------------------------
+// Adds a frame's worth of time to the bank.  Negative times
+// (a clock that went backwards) are ignored, and anything over
+// the per-frame cap is written off as dropped time.
+// --------------------------------------------------------
+void FixedTimestep::AddFrameTime(double frameSeconds)
+{
+	frameSteps = 0;
+	if (frameSeconds > 0.0)
+		accumulator += frameSeconds;
+
+	double limit = step * maxStepsPerFrame;
+	if (accumulator > limit)
+	{
+		droppedTime += accumulator - limit;
+		accumulator = limit;
+	}
+}
+
+// Takes one step out of the bank and moves simulation time along
+bool FixedTimestep::Step()
+{
+	// Frame times that add up to exactly a step (or a capped bank)
+	// can round to just under it, so allow for that
+	if (accumulator < step * (1.0 - 1e-9))
+		return false;
+
+	accumulator = accumulator > step ? accumulator - step : 0.0;
+	tickCount++;
+	simulationTime = baseTime + (tickCount - baseTick) * step;
+	frameSteps++;
+	return true;
+}
+
+void FixedTimestep::Reset()
+{
+	accumulator = 0.0;
+	simulationTime = 0.0;
+	droppedTime = 0.0;
+	tickCount = 0;
+	frameSteps = 0;
+	baseTime = 0.0;
+	baseTick = 0;
+}
+
+// Getters
+
+float FixedTimestep::GetAlpha()
+{
+	// The bank is always under one step after the Step() loop, but
+	// a bank just short of a step rounds to 1 as a float, and drawing
+	// may happen before the loop has run, so clamp to just under one
+	float alpha = (float)(accumulator / step);
+	return alpha < 1.0f ? alpha : std::nextafter(1.0f, 0.0f);
+}
+
+double FixedTimestep::GetStep() { return step; }
+unsigned int FixedTimestep::GetMaxStepsPerFrame() { return maxStepsPerFrame; }
+double FixedTimestep::GetSimulationTime() { return simulationTime; }
+double FixedTimestep::GetDroppedTime() { return droppedTime; }
+unsigned long long FixedTimestep::GetTickCount() { return tickCount; }
+unsigned int FixedTimestep::GetFrameSteps() { return frameSteps; }
+
+// Setters
+
+// Keeps the banked time, so changing rates mid-run only shifts alpha
+void FixedTimestep::SetStep(double step)
+{
+	if (step > 0.0)
+	{
+		baseTime = simulationTime;
+		baseTick = tickCount;
+		this->step = step;
+	}
+}
+
+void FixedTimestep::SetMaxStepsPerFrame(unsigned int maxStepsPerFrame)
+{
+	this->maxStepsPerFrame = maxStepsPerFrame > 0 ? maxStepsPerFrame : 1;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+// --------------------------------------------------------
+// Accumulator for running the simulation at a fixed rate
+// while frames are drawn as fast as they come.
+//
+// Each frame, AddFrameTime() banks the frame's duration and
+// Step() is called in a loop, returning true once for every
+// whole step the bank covers.  What's left over is GetAlpha(),
+// the fraction of a step that drawing should blend the last
+// two simulation states by.
+//
+// A slow frame can't queue more than a few steps: anything
+// past the cap is dropped, so the simulation falls behind
+// real time instead of spending ever longer catching up.
+//
+// Nothing here reads a clock, so it runs the same anywhere
+// and can be driven by made-up frame times.
+// --------------------------------------------------------
+class FixedTimestep
+{
+private:
+
+	double step;
+	unsigned int maxStepsPerFrame;
+
+	double accumulator;
+	double simulationTime;
+	double droppedTime;			// Total time thrown away by the cap
+	unsigned long long tickCount;
+
+	// Simulation time and tick count when the step last changed.
+	// Time is counted from here in whole steps rather than summed
+	// a step at a time, so rounding can't build up over a long run.
+	double baseTime;
+	unsigned long long baseTick;
+	unsigned int frameSteps;	// Steps taken since the last AddFrameTime()
+
+public:
+
+	FixedTimestep(double step = 1.0 / 60.0, unsigned int maxStepsPerFrame = 5);
+
+	// Banks a frame's duration (in seconds), capped at maxStepsPerFrame steps
+	void AddFrameTime(double frameSeconds);
+
+	// Consumes one step from the bank, if there's a whole one
+	bool Step();
+
+	// Starts over at time zero with nothing banked
+	void Reset();
+
+	// Getters
+	float GetAlpha();					// Leftover fraction of a step, in [0, 1)
+	double GetStep();
+	unsigned int GetMaxStepsPerFrame();
+	double GetSimulationTime();			// Time at the end of the latest step
+	double GetDroppedTime();
+	unsigned long long GetTickCount();
+	unsigned int GetFrameSteps();
+
+	// Setters
+	void SetStep(double step);
+	void SetMaxStepsPerFrame(unsigned int maxStepsPerFrame);
+};
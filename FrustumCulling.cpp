@@ -0,0 +1,351 @@
+#include "FrustumCulling.h"
+
+#include <cmath>
+
+using namespace DirectX;
+
+// Anonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// Each plane's components splatted across a register, plus the
+	// absolute normals for the box test
+	struct SplatPlanes
+	{
+		XMVECTOR x[6], y[6], z[6], w[6];
+		XMVECTOR absX[6], absY[6], absZ[6];
+		XMVECTOR viewX, viewY, viewZ;
+		XMVECTOR minSizeSquared;	// (minScreenSize * tanHalfFov)^2
+		bool sizeCutoff;
+	};
+
+	// --------------------------------------------------------
+	// Tests four objects starting at "first" and returns a lane
+	// mask (bit i set when object first + i is visible)
+	// --------------------------------------------------------
+	unsigned int TestGroup(const FrustumCulling::Bounds& b, size_t first, const SplatPlanes& p)
+	{
+		XMVECTOR cx = XMLoadFloat4((const XMFLOAT4*)&b.sphereX[first]);
+		XMVECTOR cy = XMLoadFloat4((const XMFLOAT4*)&b.sphereY[first]);
+		XMVECTOR cz = XMLoadFloat4((const XMFLOAT4*)&b.sphereZ[first]);
+		XMVECTOR r = XMLoadFloat4((const XMFLOAT4*)&b.sphereRadius[first]);
+
+		// Sphere: not entirely behind any plane
+		XMVECTOR inside = XMVectorTrueInt();
+		XMVECTOR negativeR = -r;
+		for (int i = 0; i < 6; i++)
+		{
+			XMVECTOR distance = cx * p.x[i] + cy * p.y[i] + cz * p.z[i] + p.w[i];
+			inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(distance, negativeR));
+		}
+
+		// Too small to see, judged by the sphere like Camera::GetProjectedSize
+		if (p.sizeCutoff)
+		{
+			XMVECTOR dx = cx - p.viewX, dy = cy - p.viewY, dz = cz - p.viewZ;
+			XMVECTOR distanceSquared = dx * dx + dy * dy + dz * dz;
+			inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(r * r, p.minSizeSquared * distanceSquared));
+		}
+
+		// Box: the corner furthest along each plane's normal must be in
+		// front of it.  Skipped when the spheres already ruled out the group.
+		if (b.boxX && !XMVector4EqualInt(inside, XMVectorZero()))
+		{
+			XMVECTOR bx = XMLoadFloat4((const XMFLOAT4*)&b.boxX[first]);
+			XMVECTOR by = XMLoadFloat4((const XMFLOAT4*)&b.boxY[first]);
+			XMVECTOR bz = XMLoadFloat4((const XMFLOAT4*)&b.boxZ[first]);
+			XMVECTOR ex = XMLoadFloat4((const XMFLOAT4*)&b.boxExtentX[first]);
+			XMVECTOR ey = XMLoadFloat4((const XMFLOAT4*)&b.boxExtentY[first]);
+			XMVECTOR ez = XMLoadFloat4((const XMFLOAT4*)&b.boxExtentZ[first]);
+			for (int i = 0; i < 6; i++)
+			{
+				XMVECTOR distance = bx * p.x[i] + by * p.y[i] + bz * p.z[i] + p.w[i];
+				XMVECTOR reach = ex * p.absX[i] + ey * p.absY[i] + ez * p.absZ[i];
+				inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(distance + reach, XMVectorZero()));
+			}
+		}
+
+		XMUINT4 lanes;
+		XMStoreUInt4(&lanes, inside);
+		return (lanes.x & 1) | (lanes.y & 2) | (lanes.z & 4) | (lanes.w & 8);
+	}
+
+	// --------------------------------------------------------
+	// Runs test(bounds, first) on whole groups of four straight
+	// from the arrays, then copies the last partial group into
+	// padded locals and masks off the lanes past the end.  Lanes
+	// left in each mask are appended to "passed".
+	// --------------------------------------------------------
+	template <typename Test>
+	void RunGroups(const FrustumCulling::Bounds& bounds, size_t count, Test test, std::vector<unsigned int>& passed)
+	{
+		size_t whole = count & ~(size_t)3;
+		for (size_t first = 0; first < whole; first += 4)
+		{
+			unsigned int mask = test(bounds, first);
+			for (unsigned int lane = 0; mask; lane++, mask >>= 1)
+			{
+				if (mask & 1)
+					passed.push_back((unsigned int)(first + lane));
+			}
+		}
+
+		if (whole < count)
+		{
+			float padded[10][4] = {};
+			const float* sources[10] = {
+				bounds.sphereX, bounds.sphereY, bounds.sphereZ, bounds.sphereRadius,
+				bounds.boxX, bounds.boxY, bounds.boxZ, bounds.boxExtentX, bounds.boxExtentY, bounds.boxExtentZ };
+			for (int c = 0; c < 10; c++)
+			{
+				for (size_t lane = 0; lane < 4; lane++)
+				{
+					if (!sources[c])
+						break;
+					padded[c][lane] = whole + lane < count ? sources[c][whole + lane] : 0.0f;
+				}
+			}
+
+			FrustumCulling::Bounds tail = {
+				padded[0], padded[1], padded[2], padded[3],
+				bounds.boxX ? padded[4] : 0, padded[5], padded[6], padded[7], padded[8], padded[9] };
+			unsigned int mask = test(tail, 0) & ((1u << (count - whole)) - 1);
+			for (unsigned int lane = 0; mask; lane++, mask >>= 1)
+			{
+				if (mask & 1)
+					passed.push_back((unsigned int)(whole + lane));
+			}
+		}
+	}
+
+	// Light-space box of one object (spheres stand in as cubes when
+	// there are no boxes).  The light's view matrix is rigid, so
+	// the new extents are the old ones through the absolute rotation.
+	void GetLightSpaceBox(const FrustumCulling::Bounds& b, size_t i, const XMFLOAT4X4& m, float center[3], float extent[3])
+	{
+		bool boxes = b.boxX != 0;
+		float x = boxes ? b.boxX[i] : b.sphereX[i];
+		float y = boxes ? b.boxY[i] : b.sphereY[i];
+		float z = boxes ? b.boxZ[i] : b.sphereZ[i];
+		float ex = boxes ? b.boxExtentX[i] : b.sphereRadius[i];
+		float ey = boxes ? b.boxExtentY[i] : b.sphereRadius[i];
+		float ez = boxes ? b.boxExtentZ[i] : b.sphereRadius[i];
+
+		center[0] = x * m._11 + y * m._21 + z * m._31 + m._41;
+		center[1] = x * m._12 + y * m._22 + z * m._32 + m._42;
+		center[2] = x * m._13 + y * m._23 + z * m._33 + m._43;
+		extent[0] = ex * fabsf(m._11) + ey * fabsf(m._21) + ez * fabsf(m._31);
+		extent[1] = ex * fabsf(m._12) + ey * fabsf(m._22) + ez * fabsf(m._32);
+		extent[2] = ex * fabsf(m._13) + ey * fabsf(m._23) + ez * fabsf(m._33);
+	}
+
+	// Light-space area the casters have to overlap, and how deep
+	struct ShadowRegion
+	{
+		float minX, maxX;
+		float minY, maxY;
+		float maxZ;			// Far side of the furthest receiver
+		bool empty;
+	};
+
+	// --------------------------------------------------------
+	// Combines the receivers' light-space boxes and clips them to
+	// the ortho box, whose limits come from the projection's scale
+	// and offset (x' = x * _11 + _41 covers -1 to 1, and so on)
+	// --------------------------------------------------------
+	ShadowRegion FindShadowRegion(const FrustumCulling::Bounds& bounds, const XMFLOAT4X4& lightView,
+		const XMFLOAT4X4& lightProjection, const std::vector<unsigned int>& receivers)
+	{
+		ShadowRegion region = { INFINITY, -INFINITY, INFINITY, -INFINITY, -INFINITY, true };
+		for (unsigned int i : receivers)
+		{
+			float center[3], extent[3];
+			GetLightSpaceBox(bounds, i, lightView, center, extent);
+			region.minX = fminf(region.minX, center[0] - extent[0]);
+			region.maxX = fmaxf(region.maxX, center[0] + extent[0]);
+			region.minY = fminf(region.minY, center[1] - extent[1]);
+			region.maxY = fmaxf(region.maxY, center[1] + extent[1]);
+			region.maxZ = fmaxf(region.maxZ, center[2] + extent[2]);
+		}
+
+		const XMFLOAT4X4& p = lightProjection;
+		region.minX = fmaxf(region.minX, (-1.0f - p._41) / p._11);
+		region.maxX = fminf(region.maxX, (1.0f - p._41) / p._11);
+		region.minY = fmaxf(region.minY, (-1.0f - p._42) / p._22);
+		region.maxY = fminf(region.maxY, (1.0f - p._42) / p._22);
+		region.maxZ = fminf(region.maxZ, (1.0f - p._43) / p._33);
+
+		float nearZ = -p._43 / p._33;
+		region.empty = receivers.empty() ||
+			region.minX > region.maxX ||
+			region.minY > region.maxY ||
+			region.maxZ < nearZ;
+		return region;
+	}
+}
+
+// Splats the view once, then tests every group of four
+unsigned int FrustumCulling::Cull(const Bounds& bounds, size_t count, const View& view, std::vector<unsigned int>& visible)
+{
+	visible.clear();
+
+	SplatPlanes p;
+	for (int i = 0; i < 6; i++)
+	{
+		p.x[i] = XMVectorReplicate(view.planes[i].x);
+		p.y[i] = XMVectorReplicate(view.planes[i].y);
+		p.z[i] = XMVectorReplicate(view.planes[i].z);
+		p.w[i] = XMVectorReplicate(view.planes[i].w);
+		p.absX[i] = XMVectorAbs(p.x[i]);
+		p.absY[i] = XMVectorAbs(p.y[i]);
+		p.absZ[i] = XMVectorAbs(p.z[i]);
+	}
+	p.viewX = XMVectorReplicate(view.position.x);
+	p.viewY = XMVectorReplicate(view.position.y);
+	p.viewZ = XMVectorReplicate(view.position.z);
+	float minSize = view.minScreenSize * view.tanHalfFov;
+	p.minSizeSquared = XMVectorReplicate(minSize * minSize);
+	p.sizeCutoff = view.minScreenSize > 0.0f;
+
+	RunGroups(bounds, count,
+		[&p](const Bounds& b, size_t first) { return TestGroup(b, first, p); },
+		visible);
+	return (unsigned int)visible.size();
+}
+
+// --------------------------------------------------------
+// Scalar version of the same tests, in the same order
+// --------------------------------------------------------
+unsigned int FrustumCulling::CullReference(const Bounds& bounds, size_t count, const View& view, std::vector<unsigned int>& visible)
+{
+	visible.clear();
+	float minSize = view.minScreenSize * view.tanHalfFov;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		float x = bounds.sphereX[i], y = bounds.sphereY[i], z = bounds.sphereZ[i];
+		float r = bounds.sphereRadius[i];
+
+		bool inside = true;
+		for (int j = 0; j < 6 && inside; j++)
+		{
+			const XMFLOAT4& plane = view.planes[j];
+			inside = x * plane.x + y * plane.y + z * plane.z + plane.w >= -r;
+		}
+
+		if (inside && view.minScreenSize > 0.0f)
+		{
+			float dx = x - view.position.x, dy = y - view.position.y, dz = z - view.position.z;
+			inside = r * r >= minSize * minSize * (dx * dx + dy * dy + dz * dz);
+		}
+
+		for (int j = 0; j < 6 && inside && bounds.boxX; j++)
+		{
+			const XMFLOAT4& plane = view.planes[j];
+			float distance = bounds.boxX[i] * plane.x + bounds.boxY[i] * plane.y + bounds.boxZ[i] * plane.z + plane.w;
+			float reach =
+				bounds.boxExtentX[i] * fabsf(plane.x) +
+				bounds.boxExtentY[i] * fabsf(plane.y) +
+				bounds.boxExtentZ[i] * fabsf(plane.z);
+			inside = distance + reach >= 0.0f;
+		}
+
+		if (inside)
+			visible.push_back((unsigned int)i);
+	}
+
+	return (unsigned int)visible.size();
+}
+
+// --------------------------------------------------------
+// Finds the receivers' region once, then moves four casters
+// at a time into light space and checks them against it
+// --------------------------------------------------------
+unsigned int FrustumCulling::CullShadowCasters(
+	const Bounds& bounds,
+	size_t count,
+	const XMFLOAT4X4& lightView,
+	const XMFLOAT4X4& lightProjection,
+	const std::vector<unsigned int>& receivers,
+	std::vector<unsigned int>& casters)
+{
+	casters.clear();
+	ShadowRegion region = FindShadowRegion(bounds, lightView, lightProjection, receivers);
+	if (region.empty)
+		return 0;
+
+	// The light's view matrix and its absolute rotation, splatted
+	XMVECTOR m[4][3], absM[3][3];
+	for (int row = 0; row < 4; row++)
+	{
+		for (int column = 0; column < 3; column++)
+		{
+			m[row][column] = XMVectorReplicate(lightView.m[row][column]);
+			if (row < 3)
+				absM[row][column] = XMVectorAbs(m[row][column]);
+		}
+	}
+	XMVECTOR minX = XMVectorReplicate(region.minX), maxX = XMVectorReplicate(region.maxX);
+	XMVECTOR minY = XMVectorReplicate(region.minY), maxY = XMVectorReplicate(region.maxY);
+	XMVECTOR maxZ = XMVectorReplicate(region.maxZ);
+	bool boxes = bounds.boxX != 0;
+
+	auto test = [&](const Bounds& b, size_t first)
+	{
+		XMVECTOR x = XMLoadFloat4((const XMFLOAT4*)(boxes ? &b.boxX[first] : &b.sphereX[first]));
+		XMVECTOR y = XMLoadFloat4((const XMFLOAT4*)(boxes ? &b.boxY[first] : &b.sphereY[first]));
+		XMVECTOR z = XMLoadFloat4((const XMFLOAT4*)(boxes ? &b.boxZ[first] : &b.sphereZ[first]));
+		XMVECTOR ex = XMLoadFloat4((const XMFLOAT4*)(boxes ? &b.boxExtentX[first] : &b.sphereRadius[first]));
+		XMVECTOR ey = boxes ? XMLoadFloat4((const XMFLOAT4*)&b.boxExtentY[first]) : ex;
+		XMVECTOR ez = boxes ? XMLoadFloat4((const XMFLOAT4*)&b.boxExtentZ[first]) : ex;
+
+		XMVECTOR center[3], extent[3];
+		for (int c = 0; c < 3; c++)
+		{
+			center[c] = x * m[0][c] + y * m[1][c] + z * m[2][c] + m[3][c];
+			extent[c] = ex * absM[0][c] + ey * absM[1][c] + ez * absM[2][c];
+		}
+
+		XMVECTOR keep = XMVectorLessOrEqual(center[0] - extent[0], maxX);
+		keep = XMVectorAndInt(keep, XMVectorGreaterOrEqual(center[0] + extent[0], minX));
+		keep = XMVectorAndInt(keep, XMVectorLessOrEqual(center[1] - extent[1], maxY));
+		keep = XMVectorAndInt(keep, XMVectorGreaterOrEqual(center[1] + extent[1], minY));
+		keep = XMVectorAndInt(keep, XMVectorLessOrEqual(center[2] - extent[2], maxZ));
+
+		XMUINT4 lanes;
+		XMStoreUInt4(&lanes, keep);
+		return (lanes.x & 1) | (lanes.y & 2) | (lanes.z & 4) | (lanes.w & 8);
+	};
+	RunGroups(bounds, count, test, casters);
+
+	return (unsigned int)casters.size();
+}
+
+// --------------------------------------------------------
+// Scalar version of the same test
+// --------------------------------------------------------
+unsigned int FrustumCulling::CullShadowCastersReference(
+	const Bounds& bounds,
+	size_t count,
+	const XMFLOAT4X4& lightView,
+	const XMFLOAT4X4& lightProjection,
+	const std::vector<unsigned int>& receivers,
+	std::vector<unsigned int>& casters)
+{
+	casters.clear();
+	ShadowRegion region = FindShadowRegion(bounds, lightView, lightProjection, receivers);
+	if (region.empty)
+		return 0;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		float center[3], extent[3];
+		GetLightSpaceBox(bounds, i, lightView, center, extent);
+		if (center[0] - extent[0] <= region.maxX && center[0] + extent[0] >= region.minX &&
+			center[1] - extent[1] <= region.maxY && center[1] + extent[1] >= region.minY &&
+			center[2] - extent[2] <= region.maxZ)
+			casters.push_back((unsigned int)i);
+	}
+
+	return (unsigned int)casters.size();
+}
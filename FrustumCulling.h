@@ -0,0 +1,77 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Visibility tests for whole scenes against a view frustum
+//
+// Bounds come in as structure-of-arrays and are tested four
+// objects at a time, one per SIMD lane: the bounding sphere
+// first, then (for groups with any lane still inside) the
+// axis-aligned box, which is tighter for long, flat objects.
+// Shadow casters get the same treatment against a light's
+// orthographic volume.  Nothing here needs a graphics device.
+// --------------------------------------------------------
+namespace FrustumCulling
+{
+	// World-space bounds, one array per component.  The box arrays
+	// may all be null to test spheres alone.
+	struct Bounds
+	{
+		const float* sphereX;
+		const float* sphereY;
+		const float* sphereZ;
+		const float* sphereRadius;
+
+		const float* boxX;		// Box centers
+		const float* boxY;
+		const float* boxZ;
+		const float* boxExtentX;	// Half sizes along each axis
+		const float* boxExtentY;
+		const float* boxExtentZ;
+	};
+
+	// What the objects are tested against
+	struct View
+	{
+		DirectX::XMFLOAT4 planes[6];	// Inward-facing, normalized (see MeshProcessing::ExtractFrustumPlanes)
+		DirectX::XMFLOAT3 position;		// Eye position, for the screen-size cutoff
+		float tanHalfFov;				// Tangent of half the vertical field of view
+		float minScreenSize;			// Spheres covering less of the screen's height are culled (0 keeps everything)
+	};
+
+	// Fills "visible" with the indices of objects inside the view, in
+	// order, and returns how many there are
+	unsigned int Cull(const Bounds& bounds, size_t count, const View& view, std::vector<unsigned int>& visible);
+
+	// The same tests one object at a time, for checking the kernel
+	unsigned int CullReference(const Bounds& bounds, size_t count, const View& view, std::vector<unsigned int>& visible);
+
+	// --------------------------------------------------------
+	// Shadow casters for a directional light with an orthographic
+	// projection.  Only the receivers passed in (normally whatever
+	// the camera can see) count: a caster is kept if, in light
+	// space, it overlaps their combined footprint across the light
+	// (clipped to the ortho box) and reaches the near side of the
+	// furthest one.  There's no limit toward the light, so casters
+	// in front of the box's near plane still shade what's inside.
+	// Without boxes, spheres stand in as cubes.
+	// --------------------------------------------------------
+	unsigned int CullShadowCasters(
+		const Bounds& bounds,
+		size_t count,
+		const DirectX::XMFLOAT4X4& lightView,
+		const DirectX::XMFLOAT4X4& lightProjection,
+		const std::vector<unsigned int>& receivers,
+		std::vector<unsigned int>& casters);
+
+	// The same test one object at a time, for checking the kernel
+	unsigned int CullShadowCastersReference(
+		const Bounds& bounds,
+		size_t count,
+		const DirectX::XMFLOAT4X4& lightView,
+		const DirectX::XMFLOAT4X4& lightProjection,
+		const std::vector<unsigned int>& receivers,
+		std::vector<unsigned int>& casters);
+}
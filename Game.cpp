@@ -4,8 +4,12 @@
 #include "Input.h"
 #include "PathHelpers.h"
 #include "Window.h"
+#include "SceneFile.h"
+#include "ShaderCommands.h"
 
 #include <DirectXMath.h>
+#include <cstring>
+#include <unordered_map>
 
 // This code assumes files are in "ImGui" subfolder!
 // Adjust as necessary for your own folder structure and project setup
@@ -23,14 +27,16 @@ using namespace std;
 
 // --------------------------------------------------------
 // Called once per program, after the window and graphics API
-// are initialized but before the game loop begins
+// are initialized but before the game loop begins.  Returns
+// false if the scene can't be loaded.
 // --------------------------------------------------------
-void Game::Initialize()
+bool Game::Initialize()
 {
 	// Helper methods for loading shaders, creating some basic
 	// geometry to draw and some simple camera matrices.
 	//  - You'll be expanding and/or replacing these later
-	LoadShadersAndCreateGeometry();
+	if (!LoadShadersAndCreateGeometry())
+		return false;
 
 	// Set initial graphics API state
 	//  - These settings persist until we change them
@@ -44,82 +50,22 @@ void Game::Initialize()
 	}
 
 	// Initialize ImGui itself & platform/renderer backends
-	IMGUI_CHECKVERSION();
-	ImGui::CreateContext();
-	ImGui_ImplWin32_Init(Window::Handle());
-	ImGui_ImplDX11_Init(Graphics::Device.Get(), Graphics::Context.Get());
-	// Pick a style (uncomment one of these 3)
-	//ImGui::StyleColorsDark();
-	//ImGui::StyleColorsLight();
-	ImGui::StyleColorsClassic();
-
-	// Create Camera(s)
-	std::shared_ptr<Camera> cam1 =
-		std::make_shared<Camera>(
-			(float)Window::Width() / Window::Height(),
-			XMFLOAT3(0, 2, -20.0f),
-			XMFLOAT3(),
-			XM_PIDIV4,
-			0.01f,
-			100.0f,
-			7.0f,
-			0.004f);
-	std::shared_ptr<Camera> cam2 =
-		std::make_shared<Camera>(
-			(float)Window::Width() / Window::Height(),
-			XMFLOAT3(2.5f, 1.5f, -2.5f),
-			XMFLOAT3(XM_PI / 8, -XM_PIDIV4, 0),
-			XM_PIDIV2,
-			0.01f,
-			100.0f,
-			5.0f,
-			0.004f);
-
-
-	cameras.push_back(cam1);
-	cameras.push_back(cam2);
-
-	// Initialize Lights
-	Light dirLight1 = {};
-	dirLight1.Type = LIGHT_TYPE_DIRECTIONAL;
-	dirLight1.Direction = XMFLOAT3(1, -1, 1);
-	dirLight1.Color = XMFLOAT3(0.8f, 0.8f, 0.8f);
-	dirLight1.Intensity = 1.0f;
-
-	Light dirLight2 = {};
-	dirLight2.Type = LIGHT_TYPE_DIRECTIONAL;
-	dirLight2.Direction = XMFLOAT3(1, 0, 0);
-	dirLight2.Color = XMFLOAT3(1.0f, 0.1f, 0.1f);
-	dirLight2.Intensity = 0.8f;
-
-	Light dirLight3 = {};
-	dirLight3.Type = LIGHT_TYPE_DIRECTIONAL;
-	dirLight3.Direction = XMFLOAT3(-1, 1, 0);
-	dirLight3.Color = XMFLOAT3(0.1f, 0.1f, 1.0f);
-	dirLight3.Intensity = 0.8f;
-
-	Light pointLight1 = {};
-	pointLight1.Type = LIGHT_TYPE_POINT;
-	pointLight1.Position = XMFLOAT3(-1.5f, 0, 0);
-	pointLight1.Color = XMFLOAT3(1, 1, 1);
-	pointLight1.Intensity = 0.5f;
-	pointLight1.Range = 8.0f;
-
-	Light pointLight2 = {};
-	pointLight2.Type = LIGHT_TYPE_POINT;
-	pointLight2.Position = XMFLOAT3(1.5f, 0, 0);
-	pointLight2.Color = XMFLOAT3(1, 1, 1);
-	pointLight2.Intensity = 0.3f;
-	pointLight2.Range = 12.0f;
-
-	lights.push_back(dirLight1);
-	lights.push_back(dirLight2);
-	lights.push_back(dirLight3);
-	lights.push_back(pointLight1);
-	lights.push_back(pointLight2);
+	// - Running headless there's no window to put the UI in
+	if (!Graphics::IsHeadless())
+	{
+		IMGUI_CHECKVERSION();
+		ImGui::CreateContext();
+		ImGui_ImplWin32_Init(Window::Handle());
+		ImGui_ImplDX11_Init(Graphics::Device.Get(), Graphics::Context.Get());
+		// Pick a style (uncomment one of these 3)
+		//ImGui::StyleColorsDark();
+		//ImGui::StyleColorsLight();
+		ImGui::StyleColorsClassic();
+	}
 
 	// Create Shadow Map Resources
 	CreateShadowMapResources();
+	return true;
 }
 
 
@@ -131,17 +77,24 @@ void Game::Initialize()
 // --------------------------------------------------------
 Game::~Game()
 {
+	// The occlusion buffer may still be reading the meshes
+	occlusionBuffer.Finish();
+
 	// ImGui clean up
-	ImGui_ImplDX11_Shutdown();
-	ImGui_ImplWin32_Shutdown();
-	ImGui::DestroyContext();
+	if (!Graphics::IsHeadless())
+	{
+		ImGui_ImplDX11_Shutdown();
+		ImGui_ImplWin32_Shutdown();
+		ImGui::DestroyContext();
+	}
 }
 
 
 // --------------------------------------------------------
-// Creates the geometry we're going to draw
+// Creates the geometry we're going to draw.  Returns false
+// if the scene can't be loaded.
 // --------------------------------------------------------
-void Game::LoadShadersAndCreateGeometry()
+bool Game::LoadShadersAndCreateGeometry()
 {
 	// Create vertex and pixel shaders
 	vertexShader = std::make_shared<SimpleVertexShader>(Graphics::Device,
@@ -160,6 +113,8 @@ void Game::LoadShadersAndCreateGeometry()
 		Graphics::Context, FixPath(L"SkyPixelShader.cso").c_str());
 	shadowVS = std::make_shared<SimpleVertexShader>(Graphics::Device, 
 		Graphics::Context, FixPath(L"ShadowVS.cso").c_str());
+	instancedVS = std::make_shared<SimpleVertexShader>(Graphics::Device,
+		Graphics::Context, FixPath(L"InstancedVS.cso").c_str());
 	ppVS = std::make_shared<SimpleVertexShader>(Graphics::Device,
 		Graphics::Context, FixPath(L"PostProcessVS.cso").c_str());
 	ppPS = std::make_shared<SimplePixelShader>(Graphics::Device,
@@ -167,16 +122,6 @@ void Game::LoadShadersAndCreateGeometry()
 	cappPS = std::make_shared<SimplePixelShader>(Graphics::Device,
 		Graphics::Context, FixPath(L"PostProcessChromaticAberationPS.cso").c_str());
 
-	// Load 3D Models
-	shared_ptr<Mesh> cubeMesh = make_shared<Mesh>("Cube", FixPath("../../Assets/Models/cube.obj").c_str());
-	shared_ptr<Mesh> cylinderMesh = make_shared<Mesh>("Cylinder", FixPath("../../Assets/Models/cylinder.obj").c_str());
-	shared_ptr<Mesh> helixMesh = make_shared<Mesh>("Helix", FixPath("../../Assets/Models/helix.obj").c_str());
-	shared_ptr<Mesh> sphereMesh = make_shared<Mesh>("Sphere", FixPath("../../Assets/Models/sphere.obj").c_str());
-	shared_ptr<Mesh> torusMesh = make_shared<Mesh>("Torus", FixPath("../../Assets/Models/torus.obj").c_str());
-	shared_ptr<Mesh> quadMesh = make_shared<Mesh>("Quad", FixPath("../../Assets/Models/quad.obj").c_str());
-	shared_ptr<Mesh> quadDoubleSideMesh = make_shared<Mesh>("Double-Sided Quad", FixPath("../../Assets/Models/quad_double_sided.obj").c_str());
-
-
 	// Load Sampler State
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler;
 	D3D11_SAMPLER_DESC samplerDesc = {};
@@ -188,9 +133,9 @@ void Game::LoadShadersAndCreateGeometry()
 	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
 	Graphics::Device.Get()->CreateSamplerState(&samplerDesc, sampler.GetAddressOf());
 
-	// Create Sky object
+	// Create Sky object (with a cube of its own, whatever the scene holds)
 	skybox = std::make_shared<Sky>(
-		cubeMesh,
+		std::make_shared<Mesh>("Sky Cube", FixPath("../../Assets/Models/cube.obj").c_str()),
 		sampler,
 		skyVS,
 		skyPS,
@@ -202,117 +147,12 @@ void Game::LoadShadersAndCreateGeometry()
 		FixPath(L"../../Assets/Skyboxes/Clouds Pink/back.png").c_str()
 		);
 
-	// Load textures
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> flatNormalsSRV;
-
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(),
-		FixPath(L"../../Assets/Textures/flat_normals.png").c_str(), 0, flatNormalsSRV.GetAddressOf());
-
-	// Rock
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> rockSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> rockNormalSRV;
-
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(),
-		FixPath(L"../../Assets/Textures/rock.png").c_str(), 0, rockSRV.GetAddressOf());
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(),
-		FixPath(L"../../Assets/Textures/rock_normals.png").c_str(), 0, rockNormalSRV.GetAddressOf());
-
-	// Scratched Surface
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchedSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchedNormalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchedRoughnessSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchedMetalnessSRV;
-
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(),
-		FixPath(L"../../Assets/Textures/scratched_albedo.png").c_str(), 0, scratchedSRV.GetAddressOf());
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(),
-		FixPath(L"../../Assets/Textures/scratched_normals.png").c_str(), 0, scratchedNormalSRV.GetAddressOf());
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(),
-		FixPath(L"../../Assets/Textures/scratched_roughness.png").c_str(), 0, scratchedRoughnessSRV.GetAddressOf());
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(),
-		FixPath(L"../../Assets/Textures/scratched_metal.png").c_str(), 0, scratchedMetalnessSRV.GetAddressOf());
-
-	// Wood Surface
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodNormalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodRoughnessSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodMetalnessSRV;
-
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(),
-		FixPath(L"../../Assets/Textures/wood_albedo.png").c_str(), 0, woodSRV.GetAddressOf());
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(),
-		FixPath(L"../../Assets/Textures/wood_normals.png").c_str(), 0, woodNormalSRV.GetAddressOf());
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(),
-		FixPath(L"../../Assets/Textures/wood_roughness.png").c_str(), 0, woodRoughnessSRV.GetAddressOf());
-	CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(),
-		FixPath(L"../../Assets/Textures/wood_metal.png").c_str(), 0, woodMetalnessSRV.GetAddressOf());
-
-	// Create materials before creating entities
-	shared_ptr<Material> matWhite = make_shared<Material>(vertexShader, pixelShader, XMFLOAT3(1, 1, 1), 0.5f, 1.0f, 0.0f);
-	//shared_ptr<Material> matPurple = make_shared<Material>(vertexShader, pixelShader, XMFLOAT3(0.8f, 0, 0.8f), 0.5f);
-	//shared_ptr<Material> matOrange = make_shared<Material>(vertexShader, pixelShader, XMFLOAT3(1.0f, 0.5f, 0), 0.5f);
-	shared_ptr<Material> matUV = make_shared<Material>(vertexShader, uvPS, XMFLOAT3(0, 0, 0), 0.5f, 1.0f, 0.0f);
-	shared_ptr<Material> matNormal = make_shared<Material>(vertexShader, normalPS, XMFLOAT3(0, 0, 0), 0.5f, 1.0f, 0.0f);
-	shared_ptr<Material> matCustom = make_shared<Material>(vertexShader, customPS, XMFLOAT3(1, 1, 1), 0.5f, 1.0f, 0.0f);
-	shared_ptr<Material> matRocks = make_shared<Material>(vertexShader, pixelShader, XMFLOAT3(1, 1, 1), 0.5f, 1.0f, 0.0f);
-	shared_ptr<Material> matScratched = make_shared<Material>(vertexShader, pixelShader, XMFLOAT3(1, 1, 1), 0.5f, 1.0f, 0.0f);
-	shared_ptr<Material> matWood = make_shared<Material>(vertexShader, pixelShader, XMFLOAT3(1, 1, 1), 0.5f, 1.0f, 0.0f);
-
-	// Add Textures/Samplers to Materials
-	matRocks->AddTextureSRV("Albedo", rockSRV);
-	matRocks->AddTextureSRV("NormalMap", rockNormalSRV);
-	matRocks->AddSampler("BasicSampler", sampler);
-
-	matScratched->AddTextureSRV("Albedo", scratchedSRV);
-	matScratched->AddTextureSRV("NormalMap", scratchedNormalSRV);
-	matScratched->AddTextureSRV("RoughnessMap", scratchedRoughnessSRV);
-	matScratched->AddTextureSRV("MetalnessMap", scratchedMetalnessSRV);
-	matScratched->AddSampler("BasicSampler", sampler);
-
-	matWood->AddTextureSRV("Albedo", woodSRV);
-	matWood->AddTextureSRV("NormalMap", woodNormalSRV);
-	matWood->AddTextureSRV("RoughnessMap", woodRoughnessSRV);
-	matWood->AddTextureSRV("MetalnessMap", woodMetalnessSRV);
-	matWood->AddSampler("BasicSampler", sampler);
-
-	// Add material objects to vector
-	materials.push_back(matWhite);
-	//materials.push_back(matPurple);
-	//materials.push_back(matOrange);
-	materials.push_back(matUV);
-	materials.push_back(matNormal);
-	materials.push_back(matRocks);
-	materials.push_back(matScratched);
-	materials.push_back(matWood);
-
-	// Make game entities
-	std::shared_ptr<Entity> entity1 = std::make_shared<Entity>(cubeMesh, matWood);
-	std::shared_ptr<Entity> entity2 = std::make_shared<Entity>(cubeMesh, matScratched);
-	std::shared_ptr<Entity> entity3 = std::make_shared<Entity>(helixMesh, matScratched);
-	std::shared_ptr<Entity> entity4 = std::make_shared<Entity>(sphereMesh, matScratched);
-	std::shared_ptr<Entity> entity5 = std::make_shared<Entity>(torusMesh, matWood);
-	std::shared_ptr<Entity> entity6 = std::make_shared<Entity>(quadMesh, matScratched);
-	std::shared_ptr<Entity> entity7 = std::make_shared<Entity>(quadDoubleSideMesh, matScratched);
-
-	// Spread out some of the entities so they aren't all on top of one another
-	entity1->GetTransform()->MoveAbsolute(0, -3, 0);
-	entity1->GetTransform()->SetScale(25, 1, 25);
-	entity2->GetTransform()->MoveAbsolute(-6, 0, 0);
-	entity3->GetTransform()->MoveAbsolute(-3, 0, 0);
-	entity4->GetTransform()->MoveAbsolute(0, 0, 0);
-	entity5->GetTransform()->MoveAbsolute(3, 0, 0);
-	entity6->GetTransform()->MoveAbsolute(6, 0, 0);
-	entity7->GetTransform()->MoveAbsolute(9, 0, 0);
-
-
-	// Add entity objects to the list
-	entities.push_back(entity1);
-	entities.push_back(entity2);
-	entities.push_back(entity3);
-	entities.push_back(entity4);
-	entities.push_back(entity5);
-	entities.push_back(entity6);
-	entities.push_back(entity7);
+	// Meshes, materials, entities, lights and cameras
+	if (!LoadScene("../../Assets/Scenes/default.scene", sampler))
+		return false;
+
+	// The first step blends from where everything starts, not the origin
+	TransformSystem::Default().SaveState();
 
 	// Post Process Setup
 	CreateResizePostProcess();
@@ -325,6 +165,150 @@ void Game::LoadShadersAndCreateGeometry()
 	ppSampDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
 	ppSampDesc.MaxLOD = D3D11_FLOAT32_MAX;
 	Graphics::Device->CreateSamplerState(&ppSampDesc, ppSampler.GetAddressOf());
+	return true;
+}
+
+// --------------------------------------------------------
+// Loads a scene from its binary form, which is rebuilt from
+// the text form beside it whenever that changes.  Everything
+// is created in the file's order: meshes and materials first,
+// so the entity records can index them, then every entity in
+// one bulk pass, then the lights and cameras.  A scene with
+// no lights or cameras gets the defaults for each, since the
+// game always needs one of both.
+// --------------------------------------------------------
+bool Game::LoadScene(const char* textPath, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler)
+{
+	std::string sourcePath = FixPath(textPath);
+	std::string binaryPath = sourcePath + ".bin";
+
+	MappedFile file;
+	const SceneFile::Header* header = SceneFile::Open(binaryPath.c_str(), sourcePath.c_str(), file);
+	if (!header)
+	{
+		SceneFile::Scene scene;
+		if (SceneFile::ReadText(sourcePath.c_str(), scene) && SceneFile::Write(binaryPath.c_str(), sourcePath.c_str(), scene))
+			header = SceneFile::Open(binaryPath.c_str(), sourcePath.c_str(), file);
+	}
+	if (!header)
+	{
+		printf("Scene '%s' couldn't be loaded\n", textPath);
+		return false;
+	}
+
+	// Meshes each keep a BVH of their triangles for picking
+	size_t firstMesh = meshes.size();
+	const SceneFile::MeshRecord* meshRecords = SceneFile::GetMeshes(header);
+	for (uint32_t i = 0; i < header->MeshCount; i++)
+	{
+		meshes.push_back(make_shared<Mesh>(
+			SceneFile::GetString(header, meshRecords[i].Name),
+			FixPath(SceneFile::GetString(header, meshRecords[i].Path)).c_str(),
+			true));
+	}
+
+	// Pixel shaders are named after their compiled files, and anything
+	// else gets the standard one.  Textures shared between materials
+	// are only loaded once.
+	const pair<const char*, shared_ptr<SimplePixelShader>> namedShaders[] =
+	{
+		{ "PixelShader", pixelShader },
+		{ "uvPS", uvPS },
+		{ "normalPS", normalPS },
+		{ "customPS", customPS }
+	};
+	unordered_map<string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> textures;
+
+	size_t firstMaterial = materials.size();
+	const SceneFile::MaterialRecord* materialRecords = SceneFile::GetMaterials(header);
+	for (uint32_t i = 0; i < header->MaterialCount; i++)
+	{
+		const SceneFile::MaterialRecord& record = materialRecords[i];
+		shared_ptr<SimplePixelShader> ps = pixelShader;
+		for (const auto& named : namedShaders)
+		{
+			if (strcmp(SceneFile::GetString(header, record.PixelShader), named.first) == 0)
+				ps = named.second;
+		}
+
+		shared_ptr<Material> material = make_shared<Material>(vertexShader, ps, record.ColorTint, record.Roughness, record.UVScale, record.UVOffset);
+		bool textured = false;
+		for (int t = 0; t < SceneFile::TextureSlotCount; t++)
+		{
+			const char* path = SceneFile::GetString(header, record.Textures[t]);
+			if (path[0] == '\0')
+				continue;
+
+			Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv = textures[path];
+			if (!srv)
+			{
+				Microsoft::WRL::ComPtr<ID3D11Resource> texture;
+				CreateWICTextureFromFile(Graphics::Device.Get(), Graphics::Context.Get(),
+					FixPath(NarrowToWide(path)).c_str(), texture.GetAddressOf(), srv.GetAddressOf());
+				Graphics::TrackResource(texture.Get());
+			}
+			material->AddTextureSRV(SceneFile::TextureNames[t], srv);
+			textured = true;
+		}
+		if (textured)
+			material->AddSampler("BasicSampler", sampler);
+
+		materials.push_back(material);
+	}
+
+	// Every entity at once, into reserved rows
+	unsigned int firstRow = entities.CreateFromScene(
+		SceneFile::GetEntities(header),
+		header->EntityCount,
+		meshes.data() + firstMesh,
+		materials.data() + firstMaterial);
+
+	// The scene marks the entity to animate (in the default scene,
+	// the small cube the helix and sphere ride along with)
+	const SceneFile::EntityRecord* entityRecords = SceneFile::GetEntities(header);
+	for (uint32_t i = 0; i < header->EntityCount; i++)
+	{
+		if (entityRecords[i].Animated)
+		{
+			animatedEntity = entities.GetHandle(firstRow + i);
+			break;
+		}
+	}
+
+	// Only as many lights as the shaders have room for
+	lights.insert(lights.end(), SceneFile::GetLights(header), SceneFile::GetLights(header) + header->LightCount);
+	if (lights.size() > MAX_LIGHTS)
+	{
+		printf("Scene '%s': %zu lights, only the first %d are used\n", textPath, lights.size(), MAX_LIGHTS);
+		lights.resize(MAX_LIGHTS);
+	}
+	if (lights.empty())
+	{
+		// Straight down, as a default directional light has no direction
+		Light light = SceneFile::DefaultLight();
+		light.Direction = XMFLOAT3(0, -1, 0);
+		lights.push_back(light);
+	}
+
+	const SceneFile::CameraRecord* cameraRecords = SceneFile::GetCameras(header);
+	const SceneFile::CameraRecord defaultCamera = SceneFile::DefaultCamera();
+	uint32_t cameraCount = header->CameraCount > 0 ? header->CameraCount : 1;
+	for (uint32_t i = 0; i < cameraCount; i++)
+	{
+		const SceneFile::CameraRecord& record = header->CameraCount > 0 ? cameraRecords[i] : defaultCamera;
+		cameras.push_back(make_shared<Camera>(
+			(float)Window::Width() / Window::Height(),
+			record.Position,
+			record.Orientation,
+			record.FieldOfView,
+			record.NearClip,
+			record.FarClip,
+			record.MoveSpeed,
+			record.LookSpeed));
+	}
+
+	printf("Scene '%s': %u entities, %u meshes, %u materials\n", textPath, header->EntityCount, header->MeshCount, header->MaterialCount);
+	return true;
 }
 
 // Create Post Process Resources 
@@ -353,7 +337,7 @@ void Game::CreateResizePostProcess()
 
 	// Create the resource (no need to track it after the views are created below)
 	Microsoft::WRL::ComPtr<ID3D11Texture2D> ppTexture;
-	Graphics::Device->CreateTexture2D(&textureDesc, 0, ppTexture.GetAddressOf());
+	Graphics::CreateTexture2D(&textureDesc, 0, ppTexture.GetAddressOf());
 
 	// Create the Render Target View
 	D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = {};
@@ -393,7 +377,7 @@ void Game::CreateResizePostProcess()
 
 	// Create the resource (no need to track it after the views are created below)
 	Microsoft::WRL::ComPtr<ID3D11Texture2D> cappTexture;
-	Graphics::Device->CreateTexture2D(&textureDescCA, 0, cappTexture.GetAddressOf());
+	Graphics::CreateTexture2D(&textureDescCA, 0, cappTexture.GetAddressOf());
 
 	// Create the Render Target View
 	D3D11_RENDER_TARGET_VIEW_DESC rtvDescCA = {};
@@ -432,7 +416,7 @@ void Game::CreateShadowMapResources()
 	shadowDesc.SampleDesc.Quality = 0;
 	shadowDesc.Usage = D3D11_USAGE_DEFAULT;
 	Microsoft::WRL::ComPtr<ID3D11Texture2D> shadowTexture;
-	Graphics::Device->CreateTexture2D(&shadowDesc, 0, shadowTexture.GetAddressOf());
+	Graphics::CreateTexture2D(&shadowDesc, 0, shadowTexture.GetAddressOf());
 
 	// Create the depth/stencil view
 	D3D11_DEPTH_STENCIL_VIEW_DESC shadowDSDesc = {};
@@ -478,7 +462,7 @@ void Game::CreateShadowMapResources()
 	D3D11_RASTERIZER_DESC shadowRastDesc = {};
 	shadowRastDesc.FillMode = D3D11_FILL_SOLID;
 	shadowRastDesc.CullMode = D3D11_CULL_BACK;
-	shadowRastDesc.DepthClipEnable = true;
+	shadowRastDesc.DepthClipEnable = false; // Casters in front of the near plane are flattened onto it, not clipped
 	shadowRastDesc.DepthBias = 1000; // Min. precision units, not world units!
 	shadowRastDesc.SlopeScaledDepthBias = 1.0f; // Bias more based on slope
 	Graphics::Device->CreateRasterizerState(&shadowRastDesc, &shadowRasterizer);
@@ -511,45 +495,71 @@ void Game::OnResize()
 		CreateResizePostProcess();
 }
 
+// Getters
+const RecordingBackend::Stats& Game::GetFrameStats() const { return frameStats.GetStats(); }
+
 
 // --------------------------------------------------------
 // Update your game here - user input, move objects, AI, etc.
 // --------------------------------------------------------
 void Game::Update(float deltaTime, float totalTime)
 {
-	// Update the ImGui
-	UIUpdate(deltaTime);
-
-	// Build the custom UI
-	BuildUI(deltaTime);
+	// Update the ImGui and build the custom UI, if there's
+	// anywhere to show it
+	if (!Graphics::IsHeadless())
+	{
+		UIUpdate(deltaTime);
+		BuildUI(deltaTime);
+	}
 
 	// Update the active cam only
 	cameras[activeCam]->Update(deltaTime);
 
+	// Right-click picks whichever entity is under the cursor
+	if (Input::MouseRightPress())
+		PickEntity(Input::GetMouseX(), Input::GetMouseY());
+
 	// Example input checking: Quit if the escape key is pressed
 	if (Input::KeyDown(VK_ESCAPE))
 		Window::Quit();
 
-	// Update Transformations
-	
-	for (std::shared_ptr<Entity> e : entities) {
-		//e->GetTransform()->Rotate(0, deltaTime, 0);
+	// Run as many whole simulation steps as this frame's time covers,
+	// saving each step's starting state for Draw to blend from
+	timestep.AddFrameTime(deltaTime);
+	while (timestep.Step())
+	{
+		TransformSystem::Default().SaveState();
+		FixedUpdate((float)timestep.GetStep(), (float)timestep.GetSimulationTime());
+	}
+
+	// Draw the occluders into the CPU depth buffer from this camera on
+	// worker threads, while Draw culls against the frustum
+	// - Occluders are placed the way this frame draws them, blended
+	//   between the last two steps, so animated and parented entities
+	//   can be occluders too
+	occluderCount = 0;
+	if (occlusionCulling)
+	{
+		float alpha = interpolateTransforms ? timestep.GetAlpha() : 1.0f;
+		occlusionBuffer.Begin(cameras[activeCam]->GetViewMatrix(), cameras[activeCam]->GetProjectionMatrix());
+		occluderCount = entities.AddOccluders(occlusionBuffer, alpha);
+		occlusionBuffer.Start();
 	}
+}
 
-	float move = sin(totalTime) * 2.0f;
+// --------------------------------------------------------
+// Advance the simulation by one fixed step.  Anything that
+// moves entities belongs here rather than in Update, so it
+// behaves the same at any frame rate.
+// --------------------------------------------------------
+void Game::FixedUpdate(float step, float simulationTime)
+{
+	float move = sin(simulationTime) * 2.0f;
 
-	entities[1]->GetTransform()->SetPosition(-4, move, 0);
-	entities[2]->GetTransform()->SetPosition(0, move, 0);
-	entities[3]->GetTransform()->SetPosition(4, move, 0);
-	
-	// entities[0]->GetTransform()->Rotate(deltaTime, 0, deltaTime);
-	//float scaleSize = (float)sin(totalTime * 2) * 0.2f + 0.8f;
-	//entities[0]->GetTransform()->SetScale(scaleSize, scaleSize, scaleSize);
-	//entities[0]->GetTransform()->Rotate(0, 0, deltaTime);
-
-	//float moveDistance = (float)cos(totalTime) * 0.5f;
-	//entities[3]->GetTransform()->SetPosition(moveDistance, 0.6f, 0);
-	//entities[4]->GetTransform()->SetPosition(-moveDistance, 0.6f, 0);
+	// The scene's animated entity, whose children follow it
+	unsigned int animatedRow = entities.GetRow(animatedEntity);
+	if (animatedRow != EntityStore::InvalidRow)
+		entities.GetTransform(animatedRow).SetPosition(-4, move, 0);
 }
 
 
@@ -558,91 +568,121 @@ void Game::Update(float deltaTime, float totalTime)
 // --------------------------------------------------------
 void Game::Draw(float deltaTime, float totalTime)
 {
-	// Frame START
-	// - These things should happen ONCE PER FRAME
-	// - At the beginning of Game::Draw() before drawing *anything*
+	// Rebuild every world matrix that changed this frame in one batch,
+	// rather than one at a time as each is first read
+	transformsUpdated = TransformSystem::Default().UpdateMatrices();
+
+	// Then feed the entities that moved into their world bounds and
+	// the spatial index, once for every cull and query that follows
+	boundsUpdated = entities.UpdateBounds();
+
+	// Find the entities inside the active camera's view, through the
+	// spatial index or by testing every entity's world bounds four
+	// at a time
+	Camera& camera = *cameras[activeCam];
+	if (frustumCulling)
 	{
-		// Clear the back buffer (erase what's on screen) and depth buffer
-		const float color[4] = { 0.4f, 0.6f, 0.75f, 0.0f };
-		Graphics::Context->ClearRenderTargetView(Graphics::BackBufferRTV.Get(),	backgroundColor);
-		Graphics::Context->ClearDepthStencilView(Graphics::DepthBufferDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+		FrustumCulling::View view = {};
+		camera.GetFrustumPlanes(view.planes);
+		view.position = camera.GetTransform()->GetPosition();
+		view.tanHalfFov = tanf(camera.GetFOV() * 0.5f);
+		view.minScreenSize = minScreenSize;
+		if (spatialIndex)
+			entities.QueryFrustum(view, visibleRows);
+		else
+			entities.Cull(view, visibleRows);
 	}
-
-	// Render shadow map first before drawing geometry
-	RenderShadowMap();
-
-	// Post Processing Pre Draw ===============
-	// Clear render targets
-	const float clearColor[4] = { 0, 0, 0, 1 };
-	Graphics::Context->ClearRenderTargetView(ppRTV.Get(), clearColor);
-
-	// Swap Active Render Target
-	Graphics::Context->OMSetRenderTargets(1, ppRTV.GetAddressOf(), Graphics::DepthBufferDSV.Get());
-
-	// DRAW geometry
-	// Loop through and draw every mesh
+	else
 	{
-		for (std::shared_ptr<Entity> e : entities) {
-			std::shared_ptr<SimpleVertexShader> vs = e->GetMaterial()->GetVertexShader();
-			vs->SetMatrix4x4("lightView", lightViewMatrix);
-			vs->SetMatrix4x4("lightProjection", lightProjectionMatrix);
-
-			// Set pixel shader data
-			std::shared_ptr<SimplePixelShader> ps = e->GetMaterial()->GetPixelShader();
-			ps->SetData("lights", &lights[0], sizeof(Light) * (int)lights.size());
-
-			ps->SetShaderResourceView("ShadowMap", shadowSRV);
-			ps->SetSamplerState("ShadowSampler", shadowSampler);
-
-			// Draw the entity
-			e->Draw(cameras[activeCam]);
-		}
+		visibleRows.clear();
+		for (unsigned int i = 0; i < entities.GetCount(); i++)
+			visibleRows.push_back(i);
 	}
 
-	// Draw skybox
-	skybox->Draw(cameras[activeCam]);
-
-	// Post Processing Post Draw ===========
-	// Restore Back Buffer
-	Graphics::Context->OMSetRenderTargets(1, cappRTV.GetAddressOf(), 0);
-
-	// Activate shaders and bind resources
-	ppVS->SetShader();
-	ppPS->SetShader();
-	ppPS->SetShaderResourceView("Pixels", ppSRV.Get());
-	ppPS->SetSamplerState("ClampSampler", ppSampler.Get());
-
-	// Also set any required cbuffer data
-	ppPS->SetFloat("pixelWidth", 1.0f / Window::Width());
-	ppPS->SetFloat("pixelHeight", 1.0f / Window::Height());
-	ppPS->SetInt("blurRadius", blurDistance);
-	ppPS->CopyAllBufferData();
-
-	Graphics::Context->Draw(3, 0); // Draw exactly 3 vertices (one triangle)
-
-	// Repeat for Chromatic Aberation
-	// Restore Back Buffer
-	Graphics::Context->OMSetRenderTargets(1, Graphics::BackBufferRTV.GetAddressOf(), 0);
-
-	// Activate shaders and bind resources
-	cappPS->SetShader();
-	cappPS->SetShaderResourceView("Pixels", cappSRV.Get());
-	cappPS->SetSamplerState("ClampSampler", ppSampler.Get());
+	// Then drop whatever the occluders hide, once Update's depth buffer
+	// is finished
+	occludedCount = 0;
+	if (occlusionCulling && occlusionBuffer.Finish())
+		occludedCount = entities.CullOccluded(occlusionBuffer, visibleRows);
+
+	// Pick each entity's level of detail for the active camera,
+	// which the shadow map then coarsens further
+	// - Culled entities still need one, since they may cast shadows
+	for (unsigned int i = 0; i < entities.GetCount(); i++)
+		entities.SelectLod(i, camera, lodScreenError);
+
+	// Only entities whose shadows can land on something the camera
+	// sees, including ones off screen or between the light and the
+	// shadow volume's near plane
+	if (shadowCasterCulling)
+	{
+		entities.CullShadowCasters(lightViewMatrix, lightProjectionMatrix, visibleRows, shadowCasterRows);
+	}
+	else
+	{
+		shadowCasterRows.clear();
+		for (unsigned int i = 0; i < entities.GetCount(); i++)
+			shadowCasterRows.push_back(i);
+	}
 
-	// Also set any required cbuffer data
-	cappPS->SetFloat("pixelWidth", 1.0f / Window::Width());
-	cappPS->SetFloat("pixelHeight", 1.0f / Window::Height());
-	cappPS->SetFloat("redOffset", redOffset);
-	cappPS->SetFloat("greenOffset", greenOffset);
-	cappPS->SetFloat("blueOffset", blueOffset);
-	cappPS->CopyAllBufferData();
+	// Queue both passes and sort them by render key
+	// - Shadow casters only need their meshes grouped, nearest the light first
+	// - The light's view is orthonormal, so its forward axis is the third
+	//   column and "_43" is minus the eye's distance along it
+	// - The far plane comes back out of the orthographic projection
+	{
+		renderQueue.Clear();
+		XMFLOAT3 lightForward(lightViewMatrix._13, lightViewMatrix._23, lightViewMatrix._33);
+		XMFLOAT3 lightEye(lightForward.x * -lightViewMatrix._43, lightForward.y * -lightViewMatrix._43, lightForward.z * -lightViewMatrix._43);
+		float lightFar = (1.0f - lightProjectionMatrix._43) / lightProjectionMatrix._33;
+		entities.Enqueue(renderQueue, RenderQueue::PassShadow, shadowCasterRows, lightEye, lightForward, lightFar, false);
+		entities.Enqueue(renderQueue, RenderQueue::PassOpaque, visibleRows,
+			camera.GetTransform()->GetPosition(), camera.GetTransform()->GetForward(), camera.GetFarClip());
+		if (sortDraws)
+			renderQueue.Sort();
+	}
 
-	Graphics::Context->Draw(3, 0); // Draw exactly 3 vertices (one triangle)
+	// How far between the last two simulation steps to draw everything,
+	// blended once here so recording the passes only reads the results
+	float alpha = interpolateTransforms ? timestep.GetAlpha() : 1.0f;
+	entities.InterpolateMatrices(shadowCasterRows, alpha);
+	entities.InterpolateMatrices(visibleRows, alpha);
+
+	// Record each pass into its own stream, the shadow map's alongside
+	// the others
+	// - The shadow pass only reads the entities, meshes and queue, and
+	//   the only shader it sets anything on is its own
+	if (parallelRecording)
+	{
+		shadowRecorder.Start([this](size_t) { RecordShadowPass(); });
+		RecordOpaquePass();
+		RecordPostProcessPass();
+		shadowRecorder.Wait();
+	}
+	else
+	{
+		RecordShadowPass();
+		RecordOpaquePass();
+		RecordPostProcessPass();
+	}
 
-	
-	// Unbind shadow map (and any other SRVs)
-	ID3D11ShaderResourceView* nullSRVs[128] = {};
-	Graphics::Context->PSSetShaderResources(0, 128, nullSRVs);
+	// Stitch them together in pass order (shadow map first, before
+	// drawing geometry) and replay them on the device
+	frameCommands.Clear();
+	frameCommands.Append(shadowCommands);
+	frameCommands.Append(opaqueCommands);
+	frameCommands.Append(postProcessCommands);
+	if (!Graphics::IsHeadless())
+		deviceBackend.Execute(frameCommands);
+
+	// Running headless, the recording backend is the only one that
+	// sees the streams
+	frameStats.Reset();
+	frameStats.Execute(shadowCommands);
+	frameStats.Execute(opaqueCommands);
+	frameStats.Execute(postProcessCommands);
+	if (Graphics::IsHeadless())
+		return;
 
 	// Frame END
 	// - These should happen exactly ONCE PER FRAME
@@ -666,53 +706,300 @@ void Game::Draw(float deltaTime, float totalTime)
 	}
 }
 
-// Render Shadow Map from light's perspective
-void Game::RenderShadowMap()
+// --------------------------------------------------------
+// Casts a ray from the active camera through the given pixel
+// and remembers the closest entity it hits (or none)
+// --------------------------------------------------------
+void Game::PickEntity(int mouseX, int mouseY)
+{
+	XMFLOAT3 origin, direction;
+	cameras[activeCam]->GetPickingRay((float)mouseX, (float)mouseY, (float)Window::Width(), (float)Window::Height(), origin, direction);
+
+	// Only entities whose boxes the ray touches need their triangles tested
+	// (anything moved since the last frame's Draw is re-filed first)
+	entities.UpdateBounds();
+	pickedEntity = EntityStore::Handle();
+	pickedDistance = cameras[activeCam]->GetFarClip();
+	queryRows.clear();
+	if (spatialIndex)
+		entities.QueryRay(origin, direction, pickedDistance, queryRows);
+	else
+	{
+		for (unsigned int i = 0; i < entities.GetCount(); i++)
+			queryRows.push_back(i);
+	}
+
+	for (unsigned int row : queryRows)
+	{
+		if (entities.Intersect(row, origin, direction, pickedDistance))
+			pickedEntity = entities.GetHandle(row);
+	}
+	openPickedEntity = entities.IsAlive(pickedEntity);
+}
+
+// --------------------------------------------------------
+// Sets the data every draw in the frame shares on any shader
+// that isn't already bound (and so already has it)
+// - Constants go into the shaders' own data, which each draw's
+//   recorded constants start from
+// --------------------------------------------------------
+void Game::SetFrameShaderData(CommandBuffer& commands, SimpleVertexShader* vs, SimplePixelShader* ps, EntityStore::DrawState& state)
+{
+	if (vs != state.vertexShader)
+	{
+		vs->SetMatrix4x4("lightView", lightViewMatrix);
+		vs->SetMatrix4x4("lightProjection", lightProjectionMatrix);
+	}
+
+	// Set pixel shader data
+	if (ps != state.pixelShader)
+	{
+		// The shader always reads every slot, so unused ones hold a
+		// light with no intensity (and a direction that normalizes)
+		Light shaderLights[MAX_LIGHTS];
+		for (int i = 0; i < MAX_LIGHTS; i++)
+		{
+			if (i < (int)lights.size())
+				shaderLights[i] = lights[i];
+			else
+			{
+				shaderLights[i] = SceneFile::DefaultLight();
+				shaderLights[i].Direction = XMFLOAT3(0, -1, 0);
+				shaderLights[i].Intensity = 0.0f;
+			}
+		}
+		ps->SetData("lights", shaderLights, sizeof(shaderLights));
+
+		ShaderCommands::SetShaderResourceView(commands, ps, CommandBuffer::StagePixel, "ShadowMap", shadowSRV.Get());
+		ShaderCommands::SetSamplerState(commands, ps, CommandBuffer::StagePixel, "ShadowSampler", shadowSampler.Get());
+	}
+}
+
+// --------------------------------------------------------
+// Packs the batched entities' instance data, growing the
+// instance buffer if needed, and records copying it there and
+// binding it to input slot 1 for the instanced draws to read
+// --------------------------------------------------------
+void Game::UploadInstances(CommandBuffer& commands)
 {
+	entities.PackInstances(instanceBatcher.GetInstanceValues(), instanceData);
+	if (instanceData.empty())
+		return;
+
+	if (instanceData.size() > instanceCapacity)
+	{
+		instanceCapacity = (unsigned int)instanceData.size() > instanceCapacity * 2 ? (unsigned int)instanceData.size() : instanceCapacity * 2;
+
+		D3D11_BUFFER_DESC desc = {};
+		desc.ByteWidth = sizeof(InstanceBatcher::InstanceData) * instanceCapacity;
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+		desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		instanceBuffer.Reset();
+		Graphics::CreateBuffer(&desc, 0, instanceBuffer.GetAddressOf());
+	}
+
+	// Rewritten whole every frame, so the old contents can go
+	commands.UpdateBuffer(instanceBuffer.Get(), instanceData.data(), sizeof(InstanceBatcher::InstanceData) * (unsigned int)instanceData.size());
+	commands.SetVertexBuffer(1, instanceBuffer.Get(), sizeof(InstanceBatcher::InstanceData));
+}
+
+// Record the shadow map from light's perspective
+void Game::RecordShadowPass()
+{
+	shadowCommands.Clear();
+
 	// Clear shadow map
-	Graphics::Context->ClearDepthStencilView(shadowDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+	shadowCommands.ClearDepth(shadowDSV.Get());
 
 	// Set shadow map as current depth buffer
-	ID3D11RenderTargetView* nullRTV{};
-	Graphics::Context->OMSetRenderTargets(1, &nullRTV, shadowDSV.Get());
+	shadowCommands.SetTargets(0, shadowDSV.Get());
 
 	// Activate Rasterizer state
-	Graphics::Context->RSSetState(shadowRasterizer.Get());
-
-	// Deactivate pixel shader (dont need to draw anything to screen)
-	Graphics::Context->PSSetShader(0, 0, 0);
+	shadowCommands.SetRasterizerState(shadowRasterizer.Get());
 
 	// Change viewport
-	D3D11_VIEWPORT viewport = {};
-	viewport.Width = (float)shadowMapResolution;
-	viewport.Height = (float)shadowMapResolution;
-	viewport.MaxDepth = 1.0f;
-	Graphics::Context->RSSetViewports(1, &viewport);
-
-	// Activate shadow vertex shader
-	shadowVS->SetShader();
+	shadowCommands.SetViewport((float)shadowMapResolution, (float)shadowMapResolution);
+
+	// Activate shadow vertex shader, with no pixel shader (dont need to draw anything to screen)
+	ShaderCommands::SetShaders(shadowCommands, shadowVS.get(), 0);
 	shadowVS->SetMatrix4x4("view", lightViewMatrix);
 	shadowVS->SetMatrix4x4("projection", lightProjectionMatrix);
 
-	// Loop and draw all entities
-	for (auto& e : entities)
+	// Loop and draw the casters queued for this pass, setting
+	// each mesh's buffers only when it changes
+	shadowMeshletsDrawn = 0;
+	shadowMeshChanges = 0;
+	Mesh* boundMesh = 0;
+	unsigned int first = 0;
+	unsigned int count = renderQueue.GetPassRange(RenderQueue::PassShadow, first);
+	for (unsigned int q = first; q < first + count; q++)
 	{
-		shadowVS->SetMatrix4x4("world", e->GetTransform()->GetWorldMatrix());
-		shadowVS->CopyAllBufferData();
+		unsigned int i = renderQueue.GetValue(q);
+		Mesh* mesh = entities.GetMesh(i);
+		if (mesh != boundMesh)
+		{
+			mesh->SetBuffers(shadowCommands);
+			boundMesh = mesh;
+			shadowMeshChanges++;
+		}
+
+		const XMFLOAT4X4& world = entities.GetDrawWorldMatrix(i);
+
+		ShaderCommands::Constants constants = ShaderCommands::SetConstants(shadowCommands, shadowVS.get(), CommandBuffer::StageVertex);
+		ShaderCommands::SetMatrix4x4(constants, "world", world);
+		ShaderCommands::SetFloat3(constants, "positionScale", mesh->GetPositionScale());
+		ShaderCommands::SetFloat3(constants, "positionOffset", mesh->GetPositionOffset());
 		// Draw the mesh directly to avoid the entity's material
+		// - Only frustum culling applies, since a directional light
+		//   has no single position to test the normal cones against
+		// - Shadows are blurry enough to use a coarser LOD
 		// Note: Your code may differ significantly here!
-		e->GetMesh()->Draw();
+		shadowMeshletsDrawn += mesh->DrawVisible(
+			shadowCommands,
+			shadowRanges,
+			world,
+			lightViewMatrix,
+			lightProjectionMatrix,
+			false,
+			entities.GetLod(i) + shadowLodOffset,
+			false);
 	}
 
 	// Reset pipeline back for regular Drawing
-	viewport.Width = (float)Window::Width();
-	viewport.Height = (float)Window::Height();
-	Graphics::Context->RSSetViewports(1, &viewport);
-	Graphics::Context->OMSetRenderTargets(
-		1,
-		Graphics::BackBufferRTV.GetAddressOf(),
-		Graphics::DepthBufferDSV.Get());
-	Graphics::Context->RSSetState(0);
+	shadowCommands.SetRasterizerState(0);
+}
+
+// --------------------------------------------------------
+// Records the scene (and sky) into the post process target
+// --------------------------------------------------------
+void Game::RecordOpaquePass()
+{
+	opaqueCommands.Clear();
+	Camera& camera = *cameras[activeCam];
+
+	// Clear the back buffer (erase what's on screen) and depth buffer
+	opaqueCommands.ClearTarget(Graphics::BackBufferRTV.Get(), backgroundColor);
+	opaqueCommands.ClearDepth(Graphics::DepthBufferDSV.Get());
+
+	// Post Processing Pre Draw ===============
+	// Clear render targets
+	const float clearColor[4] = { 0, 0, 0, 1 };
+	opaqueCommands.ClearTarget(ppRTV.Get(), clearColor);
+
+	// Swap Active Render Target, covering the whole window
+	opaqueCommands.SetTargets(ppRTV.Get(), Graphics::DepthBufferDSV.Get());
+	opaqueCommands.SetViewport((float)Window::Width(), (float)Window::Height());
+
+	// DRAW geometry
+	// Draw the queue in order, only binding what changes from one
+	// draw to the next
+	// - The queued draws are grouped by mesh, material and LOD, and with
+	//   instancing on, each group of two or more whose material uses the
+	//   standard vertex shader becomes one instanced draw
+	// - Everything else (including lone entities, which keep their
+	//   meshlet culling) is drawn one entity at a time
+	{
+		meshletsDrawn = 0;
+		drawCalls = 0;
+		instancedBatches = 0;
+		EntityStore::DrawState drawState;
+		unsigned int first = 0;
+		unsigned int count = renderQueue.GetPassRange(RenderQueue::PassOpaque, first);
+
+		instanceBatcher.Clear();
+		for (unsigned int q = first; q < first + count; q++)
+		{
+			unsigned int i = renderQueue.GetValue(q);
+			instanceBatcher.Add(entities.GetMesh(i), entities.GetMaterial(i), entities.GetLod(i), i);
+		}
+		instanceBatcher.Build();
+		const std::vector<unsigned int>& batchRows = instanceBatcher.GetInstanceValues();
+
+		// Per-instance data for everything, in batch order
+		bool instancedAvailable = instancing && instancedVS->GetPerInstanceCompatible();
+		if (instancedAvailable)
+			UploadInstances(opaqueCommands);
+
+		for (unsigned int b = 0; b < instanceBatcher.GetBatchCount(); b++)
+		{
+			const InstanceBatcher::Batch& batch = instanceBatcher.GetBatch(b);
+			unsigned int row = batchRows[batch.firstInstance];
+			Material* material = entities.GetMaterial(row);
+
+			if (instancedAvailable && batch.instanceCount > 1 && material->GetVertexShader() == vertexShader.get())
+			{
+				SetFrameShaderData(opaqueCommands, instancedVS.get(), material->GetPixelShader(), drawState);
+				entities.DrawInstanced(opaqueCommands, row, batch.firstInstance, batch.instanceCount, instancedVS.get(), camera, &drawState);
+				drawCalls++;
+				instancedBatches++;
+				continue;
+			}
+
+			for (unsigned int n = 0; n < batch.instanceCount; n++)
+			{
+				unsigned int i = batchRows[batch.firstInstance + n];
+				material = entities.GetMaterial(i);
+				SetFrameShaderData(opaqueCommands, material->GetVertexShader(), material->GetPixelShader(), drawState);
+
+				// Draw the entity
+				meshletsDrawn += entities.Draw(opaqueCommands, i, camera, &drawState);
+				drawCalls++;
+			}
+		}
+		stateChanges = drawState.changes;
+	}
+
+	// Draw skybox
+	skybox->Draw(opaqueCommands, cameras[activeCam]);
+}
+
+// --------------------------------------------------------
+// Records the blur and chromatic aberration passes, ending
+// on the back buffer
+// --------------------------------------------------------
+void Game::RecordPostProcessPass()
+{
+	postProcessCommands.Clear();
+
+	// Post Processing Post Draw ===========
+	// Restore Back Buffer
+	postProcessCommands.SetTargets(cappRTV.Get(), 0);
+
+	// Activate shaders and bind resources
+	ShaderCommands::SetShaders(postProcessCommands, ppVS.get(), ppPS.get());
+	ShaderCommands::SetShaderResourceView(postProcessCommands, ppPS.get(), CommandBuffer::StagePixel, "Pixels", ppSRV.Get());
+	ShaderCommands::SetSamplerState(postProcessCommands, ppPS.get(), CommandBuffer::StagePixel, "ClampSampler", ppSampler.Get());
+
+	// Also set any required cbuffer data
+	ShaderCommands::Constants blurData = ShaderCommands::SetConstants(postProcessCommands, ppPS.get(), CommandBuffer::StagePixel);
+	ShaderCommands::SetFloat(blurData, "pixelWidth", 1.0f / Window::Width());
+	ShaderCommands::SetFloat(blurData, "pixelHeight", 1.0f / Window::Height());
+	ShaderCommands::SetInt(blurData, "blurRadius", blurDistance);
+
+	postProcessCommands.Draw(3); // Draw exactly 3 vertices (one triangle)
+
+	// Repeat for Chromatic Aberation
+	// Restore Back Buffer
+	postProcessCommands.SetTargets(Graphics::BackBufferRTV.Get(), 0);
+
+	// Activate shaders and bind resources
+	ShaderCommands::SetShaders(postProcessCommands, ppVS.get(), cappPS.get());
+	ShaderCommands::SetShaderResourceView(postProcessCommands, cappPS.get(), CommandBuffer::StagePixel, "Pixels", cappSRV.Get());
+	ShaderCommands::SetSamplerState(postProcessCommands, cappPS.get(), CommandBuffer::StagePixel, "ClampSampler", ppSampler.Get());
+
+	// Also set any required cbuffer data
+	ShaderCommands::Constants aberrationData = ShaderCommands::SetConstants(postProcessCommands, cappPS.get(), CommandBuffer::StagePixel);
+	ShaderCommands::SetFloat(aberrationData, "pixelWidth", 1.0f / Window::Width());
+	ShaderCommands::SetFloat(aberrationData, "pixelHeight", 1.0f / Window::Height());
+	ShaderCommands::SetFloat(aberrationData, "redOffset", redOffset);
+	ShaderCommands::SetFloat(aberrationData, "greenOffset", greenOffset);
+	ShaderCommands::SetFloat(aberrationData, "blueOffset", blueOffset);
+
+	postProcessCommands.Draw(3); // Draw exactly 3 vertices (one triangle)
+
+	// Unbind shadow map (and any other SRVs)
+	postProcessCommands.ClearResources(CommandBuffer::StagePixel, 0, 128);
 }
 
 // --------------------------------------------------------
@@ -761,6 +1048,49 @@ void Game::BuildUI(float deltaTime)
 		// The "x" will be printed as-is between the numbers, like so: 800x600
 		ImGui::BulletText("Window Resolution: %dx%d", Window::Width(), Window::Height());
 
+		// Entities that made it through frustum culling last frame
+		unsigned int visibleCount = (unsigned int)visibleRows.size();
+		ImGui::BulletText("Entities visible: %u, culled: %u", visibleCount, entities.GetCount() - visibleCount);
+		ImGui::Checkbox("Frustum culling", &frustumCulling);
+		ImGui::SliderFloat("Min screen size", &minScreenSize, 0.0f, 0.1f, "%.3f");
+
+		// Culling and picking through the entities' loose octree
+		ImGui::BulletText("Spatial index nodes: %u", entities.GetSpatialNodeCount());
+		ImGui::Checkbox("Spatial index", &spatialIndex);
+
+		// Entities hidden behind the occluders' CPU depth buffer
+		ImGui::BulletText("Occluded: %u by %u occluders (%u triangles, %.3f ms)",
+			occludedCount, occluderCount, occlusionBuffer.GetTriangleCount(),
+			occlusionBuffer.GetSetupMilliseconds() + occlusionBuffer.GetRasterMilliseconds() + occlusionBuffer.GetPyramidMilliseconds());
+		ImGui::Checkbox("Occlusion culling", &occlusionCulling);
+
+		// Entities drawn into the shadow map last frame
+		unsigned int casterCount = (unsigned int)shadowCasterRows.size();
+		ImGui::BulletText("Shadow casters: %u, culled: %u", casterCount, entities.GetCount() - casterCount);
+		ImGui::Checkbox("Shadow caster culling", &shadowCasterCulling);
+
+		// Binds saved by drawing in render key order
+		ImGui::BulletText("State changes: %u for %u draws", stateChanges, visibleCount);
+		ImGui::BulletText("Shadow mesh changes: %u for %u draws", shadowMeshChanges, casterCount);
+		ImGui::Checkbox("Sort draws", &sortDraws);
+
+		// Draw calls after grouping entities into instanced batches
+		ImGui::BulletText("Draw calls: %u (%u instanced)", drawCalls, instancedBatches);
+		ImGui::Checkbox("Instancing", &instancing);
+
+		// Last frame's command streams, as the recording backend saw them
+		const RecordingBackend::Stats& commandStats = frameStats.GetStats();
+		ImGui::BulletText("Commands: %u in %u passes (%.1f KB, %.1f KB of constants)",
+			commandStats.commandCount, commandStats.streamCount, commandStats.streamBytes / 1024.0, commandStats.constantBytes / 1024.0);
+		ImGui::Checkbox("Record passes in parallel", &parallelRecording);
+
+		// Buffers, textures and shaders made through Graphics, still alive
+		Graphics::ResourceStats resourceStats = Graphics::GetResourceStats();
+		ImGui::BulletText("GPU memory: %u buffers (%.1f MB), %u textures (%.1f MB), %u shaders",
+			resourceStats.bufferCount, resourceStats.bufferBytes / (1024.0 * 1024.0),
+			resourceStats.textureCount, resourceStats.textureBytes / (1024.0 * 1024.0),
+			resourceStats.shaderCount);
+
 		ImGui::Spacing();
 
 		// Can create a 3 or 4-component color editors, too!
@@ -796,10 +1126,44 @@ void Game::BuildUI(float deltaTime)
 			if (ImGui::TreeNode("Mesh Node", "%s", meshes[i]->GetName())) {
 				ImGui::Spacing();
 
-				ImGui::Text("Triangles: %d", meshes[i]->GetIndexCount() / 3);
+				ImGui::Text("Triangles: %d", meshes[i]->GetLod(0).indexCount / 3);
 				ImGui::Text("Vertices: %d", meshes[i]->GetVertexCount());
 				ImGui::Text("Indicecs: %d", meshes[i]->GetIndexCount());
 
+				// Welding results from loading
+				MeshProcessing::WeldStats weld = meshes[i]->GetWeldStats();
+				ImGui::Text("Vertices before welding: %u", weld.verticesBefore);
+				ImGui::Text("Weld time: %.3f ms", weld.milliseconds);
+				ImGui::Text("Loaded from cache: %s", meshes[i]->WasLoadedFromCache() ? "Yes" : "No");
+
+				// Post-transform cache simulation (16 entry FIFO)
+				MeshProcessing::VertexCacheStats before = meshes[i]->GetCacheStatsBefore();
+				MeshProcessing::VertexCacheStats after = meshes[i]->GetCacheStatsAfter();
+				ImGui::Text("ACMR: %.3f -> %.3f", before.acmr, after.acmr);
+				ImGui::Text("ATVR: %.3f -> %.3f", before.atvr, after.atvr);
+
+				// Compressed vertex layout and its round trip accuracy
+				MeshProcessing::PackingError packing = meshes[i]->GetPackingError();
+				ImGui::Text("Vertex size: %d bytes (unpacked %d)", (int)sizeof(PackedVertex), (int)sizeof(Vertex));
+				ImGui::Text("Index size: %d bits", meshes[i]->GetIndexFormat() == DXGI_FORMAT_R16_UINT ? 16 : 32);
+				ImGui::Text("Meshlets: %d", meshes[i]->GetMeshletCount());
+
+				// Object-space bounding volumes
+				BoundingBox box = meshes[i]->GetBoundingBox();
+				BoundingSphere sphere = meshes[i]->GetBoundingSphere();
+				ImGui::Text("Box extents: %.3f, %.3f, %.3f", box.Extents.x, box.Extents.y, box.Extents.z);
+				ImGui::Text("Sphere: (%.3f, %.3f, %.3f) r %.3f", sphere.Center.x, sphere.Center.y, sphere.Center.z, sphere.Radius);
+				ImGui::Text("Max position error: %.6f", packing.position);
+				ImGui::Text("Max UV error: %.6f", packing.uv);
+				ImGui::Text("Max normal/tangent error: %.4f / %.4f deg", packing.normalDegrees, packing.tangentDegrees);
+
+				// Simplified levels of detail sharing the index buffer
+				for (int lod = 0; lod < meshes[i]->GetLodCount(); lod++)
+				{
+					MeshProcessing::LodLevel level = meshes[i]->GetLod(lod);
+					ImGui::Text("LOD %d: %u triangles, error %.4f", lod, level.indexCount / 3, level.error);
+				}
+
 				ImGui::Spacing();
 
 				ImGui::TreePop();
@@ -811,25 +1175,435 @@ void Game::BuildUI(float deltaTime)
 		ImGui::TreePop();
 	}
 
+	if (ImGui::TreeNode("Performance"))
+	{
+		// Meshlet culling results from the last frame
+		int meshletsTotal = 0;
+		for (unsigned int i = 0; i < entities.GetCount(); i++)
+			meshletsTotal += entities.GetMesh(i)->GetMeshletCount();
+		ImGui::Text("Meshlets drawn: %u / %d", meshletsDrawn, meshletsTotal);
+		ImGui::Text("Shadow meshlets drawn: %u / %d", shadowMeshletsDrawn, meshletsTotal);
+		ImGui::Text("Transforms rebuilt: %u / %u", transformsUpdated, TransformSystem::Default().GetCount());
+		ImGui::Text("Entity bounds rebuilt: %u / %u", boundsUpdated, entities.GetCount());
+		ImGui::Spacing();
+
+		// Fixed-step simulation
+		if (ImGui::SliderInt("Tick rate (Hz)", &tickRate, 5, 240))
+			timestep.SetStep(1.0 / tickRate);
+		ImGui::Checkbox("Interpolate transforms", &interpolateTransforms);
+		ImGui::Text("Steps this frame: %u (alpha %.2f)", timestep.GetFrameSteps(), timestep.GetAlpha());
+		ImGui::Text("Ticks: %llu, time dropped: %.2f s", timestep.GetTickCount(), timestep.GetDroppedTime());
+		ImGui::Spacing();
+
+		// Level of detail selection
+		ImGui::SliderFloat("LOD screen error", &lodScreenError, 0.0f, 0.02f, "%.4f");
+		ImGui::SliderInt("Shadow LOD offset", &shadowLodOffset, 0, (int)MeshProcessing::MaxLodLevels - 1);
+		ImGui::Spacing();
+
+		// OBJ loading: original getline/sscanf loader vs. memory mapped parser
+		if (ImGui::Button("Benchmark OBJ Loading (Helix)"))
+		{
+			objLoadBenchmark = Benchmarks::CompareObjLoaders(FixPath("../../Assets/Models/helix.obj").c_str(), 10);
+			Benchmarks::Print(objLoadBenchmark);
+		}
+
+		if (objLoadBenchmark.vertexCount > 0)
+		{
+			ImGui::Text("Legacy loader: %.3f ms", objLoadBenchmark.legacyMilliseconds);
+			ImGui::Text("Mapped loader: %.3f ms (%.1fx)", objLoadBenchmark.fastMilliseconds,
+				objLoadBenchmark.legacyMilliseconds / objLoadBenchmark.fastMilliseconds);
+			ImGui::Text("Identical output: %s", objLoadBenchmark.identical ? "yes" : "no");
+		}
+
+		// The same on a scan-sized file, generated and then deleted
+		if (ImGui::Button("Benchmark OBJ Loading (200 MB scan)"))
+		{
+			scanLoadBenchmark = Benchmarks::CompareObjLoadersOnScan(1000, 1);
+			Benchmarks::Print(scanLoadBenchmark);
+		}
+
+		if (scanLoadBenchmark.vertexCount > 0)
+		{
+			ImGui::Text("Scan: %.0f MB, %u vertices, %u threads", scanLoadBenchmark.megabytes,
+				scanLoadBenchmark.vertexCount, scanLoadBenchmark.threadCount);
+			ImGui::Text("Legacy loader: %.3f ms", scanLoadBenchmark.legacyMilliseconds);
+			ImGui::Text("Mapped loader: %.3f ms (%.1fx)", scanLoadBenchmark.fastMilliseconds,
+				scanLoadBenchmark.legacyMilliseconds / scanLoadBenchmark.fastMilliseconds);
+			ImGui::Text("Identical output: %s", scanLoadBenchmark.identical ? "yes" : "no");
+		}
+		ImGui::Spacing();
+
+		// Tangents: original scalar loop vs. SIMD/threaded version
+		if (ImGui::Button("Benchmark Tangents (Helix)"))
+		{
+			tangentBenchmark = Benchmarks::CompareTangents(FixPath("../../Assets/Models/helix.obj").c_str(), 10);
+			Benchmarks::Print(tangentBenchmark);
+		}
+
+		if (tangentBenchmark.vertexCount > 0)
+		{
+			ImGui::Text("Reference: %.3f ms", tangentBenchmark.referenceMilliseconds);
+			ImGui::Text("SIMD/threaded: %.3f ms (%.1fx)", tangentBenchmark.fastMilliseconds,
+				tangentBenchmark.referenceMilliseconds / tangentBenchmark.fastMilliseconds);
+			ImGui::Text("Angle weighted: %.3f ms", tangentBenchmark.angleMilliseconds);
+			ImGui::Text("Max difference: %g", tangentBenchmark.maxDifference);
+			ImGui::Text("Angle weighted vs. reference: %.2f deg", tangentBenchmark.maxAngleDegrees);
+			ImGui::Text("Deterministic across threads: %s", tangentBenchmark.deterministic ? "yes" : "no");
+		}
+		ImGui::Spacing();
+
+		// Ray throughput against each mesh's BVH
+		const char* rayModels[2] = { "Helix", "Torus" };
+		const char* rayFiles[2] = { "../../Assets/Models/helix.obj", "../../Assets/Models/torus.obj" };
+		for (int i = 0; i < 2; i++)
+		{
+			ImGui::PushID(i);
+			if (ImGui::Button("Benchmark Rays")) {
+				rayBenchmarks[i] = Benchmarks::MeasureRayThroughput(FixPath(rayFiles[i]).c_str(), 100000);
+				Benchmarks::Print(rayBenchmarks[i], rayModels[i]);
+			}
+			ImGui::SameLine();
+			ImGui::Text("%s", rayModels[i]);
+
+			if (rayBenchmarks[i].rayCount > 0)
+			{
+				ImGui::Text("BVH: %u nodes over %u triangles in %.2f ms", rayBenchmarks[i].nodeCount,
+					rayBenchmarks[i].triangleCount, rayBenchmarks[i].buildMilliseconds);
+				ImGui::Text("%.2f million rays/sec (%.0f%% hit)", rayBenchmarks[i].raysPerSecond / 1000000.0,
+					rayBenchmarks[i].hitRate * 100.0f);
+				ImGui::Text("Mismatches vs. brute force: %u", rayBenchmarks[i].mismatches);
+			}
+			ImGui::PopID();
+		}
+		ImGui::Spacing();
+
+		// Transforms: one matrix at a time vs. batched SIMD/threaded updates
+		if (ImGui::Button("Benchmark Transforms (10K/100K/1M)"))
+		{
+			unsigned int counts[3] = { 10000, 100000, 1000000 };
+			for (int i = 0; i < 3; i++)
+			{
+				transformBenchmarks[i] = Benchmarks::MeasureTransformUpdates(counts[i], i < 2 ? 10 : 3);
+				Benchmarks::Print(transformBenchmarks[i]);
+			}
+		}
+
+		for (int i = 0; i < 3; i++)
+		{
+			if (transformBenchmarks[i].transformCount == 0)
+				continue;
+
+			Benchmarks::TransformResult& r = transformBenchmarks[i];
+			ImGui::Text("%u transforms:", r.transformCount);
+			ImGui::Text("  Per-object: %.3f ms (%.1f ns each)", r.perObjectMilliseconds, r.perObjectMilliseconds * 1000000.0 / r.transformCount);
+			ImGui::Text("  Batch: %.3f ms (%.1f ns each)", r.batchMilliseconds, r.batchMilliseconds * 1000000.0 / r.transformCount);
+			ImGui::Text("  Batch, %u threads: %.3f ms (%.1f ns each)", r.threadCount, r.threadedMilliseconds, r.threadedMilliseconds * 1000000.0 / r.transformCount);
+		}
+		ImGui::Spacing();
+
+		// Hierarchy: a wide tree and a single deep chain
+		if (ImGui::Button("Benchmark Hierarchy (50K wide, 20K deep)"))
+		{
+			hierarchyBenchmarks[0] = Benchmarks::MeasureHierarchyUpdates(50000, 4, 10);
+			hierarchyBenchmarks[1] = Benchmarks::MeasureHierarchyUpdates(20000, 1, 10);
+			for (int i = 0; i < 2; i++)
+				Benchmarks::Print(hierarchyBenchmarks[i]);
+		}
+
+		for (int i = 0; i < 2; i++)
+		{
+			if (hierarchyBenchmarks[i].nodeCount == 0)
+				continue;
+
+			Benchmarks::HierarchyResult& r = hierarchyBenchmarks[i];
+			ImGui::Text("%u nodes, %u levels:", r.nodeCount, r.depthCount);
+			ImGui::Text("  Root moved: %.3f ms", r.fullMilliseconds);
+			ImGui::Text("  Subtree moved: %.3f ms (%u rebuilt)", r.subtreeMilliseconds, r.subtreeUpdated);
+			ImGui::Text("  Nothing moved: %.4f ms", r.idleMilliseconds);
+		}
+		ImGui::Spacing();
+
+		// Normal matrices: general inverse vs. rotation and reciprocal scale
+		if (ImGui::Button("Benchmark Inverse-Transpose (100K)"))
+		{
+			inverseTransposeBenchmark = Benchmarks::CompareInverseTranspose(100000, 10);
+			Benchmarks::Print(inverseTransposeBenchmark);
+		}
+
+		if (inverseTransposeBenchmark.matrixCount > 0)
+		{
+			ImGui::Text("Generic inverse: %.3f ms", inverseTransposeBenchmark.genericMilliseconds);
+			ImGui::Text("Affine: %.3f ms (%.1fx)", inverseTransposeBenchmark.fastMilliseconds,
+				inverseTransposeBenchmark.genericMilliseconds / inverseTransposeBenchmark.fastMilliseconds);
+			ImGui::Text("Affine, uniform scale: %.3f ms", inverseTransposeBenchmark.uniformMilliseconds);
+			ImGui::Text("Affine, unscaled: %.3f ms", inverseTransposeBenchmark.unscaledMilliseconds);
+			ImGui::Text("Max relative error: %g", inverseTransposeBenchmark.maxError);
+		}
+		ImGui::Spacing();
+
+		// Entity iteration: shared_ptr per entity vs. packed rows
+		if (ImGui::Button("Benchmark Entities (1M)"))
+		{
+			entityBenchmark = Benchmarks::CompareEntityIteration(1000000, 5);
+			Benchmarks::Print(entityBenchmark);
+		}
+
+		if (entityBenchmark.entityCount > 0)
+		{
+			ImGui::Text("shared_ptr entities: update %.3f ms, draw list %.3f ms",
+				entityBenchmark.legacyUpdateMilliseconds, entityBenchmark.legacyDrawListMilliseconds);
+			ImGui::Text("Entity store: update %.3f ms, draw list %.3f ms",
+				entityBenchmark.storeUpdateMilliseconds, entityBenchmark.storeDrawListMilliseconds);
+		}
+		ImGui::Spacing();
+
+		// Whole-object frustum culling: one at a time vs. four per register
+		if (ImGui::Button("Benchmark Culling (250K)"))
+		{
+			cullingBenchmark = Benchmarks::CompareCulling(250000, 10);
+			Benchmarks::Print(cullingBenchmark);
+		}
+
+		if (cullingBenchmark.objectCount > 0)
+		{
+			ImGui::Text("Scalar: %.3f ms", cullingBenchmark.referenceMilliseconds);
+			ImGui::Text("SIMD: %.3f ms (%.1fx)", cullingBenchmark.simdMilliseconds,
+				cullingBenchmark.referenceMilliseconds / cullingBenchmark.simdMilliseconds);
+			ImGui::Text("Visible: %u / %u (%u more under 1%% of the screen)",
+				cullingBenchmark.visibleCount, cullingBenchmark.objectCount, cullingBenchmark.smallCulled);
+			ImGui::Text("Identical output: %s", cullingBenchmark.identical ? "yes" : "no");
+			ImGui::Text("Shadow casters: %.3f ms scalar, %.3f ms SIMD",
+				cullingBenchmark.shadowReferenceMilliseconds, cullingBenchmark.shadowSimdMilliseconds);
+			ImGui::Text("Casters: %u (%u off screen), identical: %s",
+				cullingBenchmark.casterCount, cullingBenchmark.offscreenCasters, cullingBenchmark.shadowIdentical ? "yes" : "no");
+		}
+
+		// Render key sorting: std::stable_sort vs. radix
+		if (ImGui::Button("Benchmark Draw Sorting (100K)"))
+		{
+			renderQueueBenchmark = Benchmarks::CompareRenderQueueSort(100000, 20);
+			Benchmarks::Print(renderQueueBenchmark);
+		}
+
+		if (renderQueueBenchmark.drawCount > 0)
+		{
+			ImGui::Text("std::stable_sort: %.3f ms", renderQueueBenchmark.referenceMilliseconds);
+			ImGui::Text("Radix: %.3f ms (%.1fx, %u of 8 passes skipped)", renderQueueBenchmark.radixMilliseconds,
+				renderQueueBenchmark.referenceMilliseconds / renderQueueBenchmark.radixMilliseconds,
+				renderQueueBenchmark.skippedPasses);
+			ImGui::Text("State changes: %u unsorted, %u sorted",
+				renderQueueBenchmark.unsortedChanges, renderQueueBenchmark.sortedChanges);
+			ImGui::Text("Identical output: %s", renderQueueBenchmark.identical ? "yes" : "no");
+		}
+
+		// Scene loading: binary open and bulk creation vs. parsing the text form
+		if (ImGui::Button("Benchmark Scene Loading (100K)"))
+		{
+			sceneLoadBenchmark = Benchmarks::MeasureSceneLoad(100000, 5);
+			Benchmarks::Print(sceneLoadBenchmark);
+		}
+
+		if (sceneLoadBenchmark.entityCount > 0)
+		{
+			ImGui::Text("Binary (%.1f MB): open %.3f ms, create %.3f ms",
+				sceneLoadBenchmark.binaryBytes / (1024.0 * 1024.0),
+				sceneLoadBenchmark.openMilliseconds, sceneLoadBenchmark.createMilliseconds);
+			ImGui::Text("Text (%.1f MB): parse %.3f ms, format %.3f ms",
+				sceneLoadBenchmark.textBytes / (1024.0 * 1024.0),
+				sceneLoadBenchmark.parseMilliseconds, sceneLoadBenchmark.formatMilliseconds);
+			ImGui::Text("Round trip: %s", sceneLoadBenchmark.roundTrip ? "yes" : "no");
+		}
+
+		// Spatial index: octree updates and queries vs. testing every box
+		if (ImGui::Button("Benchmark Spatial Index (100K)"))
+		{
+			spatialIndexBenchmark = Benchmarks::MeasureSpatialIndex(100000, 0.1f, 20);
+			Benchmarks::Print(spatialIndexBenchmark);
+		}
+
+		if (spatialIndexBenchmark.objectCount > 0)
+		{
+			ImGui::Text("Nodes: %u, build %.3f ms", spatialIndexBenchmark.nodeCount, spatialIndexBenchmark.buildMilliseconds);
+			ImGui::Text("Update (%u moving): %.3f ms, %.1f%% relinked",
+				spatialIndexBenchmark.movingCount, spatialIndexBenchmark.updateMilliseconds,
+				spatialIndexBenchmark.relinkRate * 100.0f);
+			ImGui::Text("Frustum: %.3f ms (linear %.3f ms)",
+				spatialIndexBenchmark.frustumMilliseconds, spatialIndexBenchmark.linearFrustumMilliseconds);
+			ImGui::Text("64 spheres: %.3f ms (linear %.3f ms)",
+				spatialIndexBenchmark.sphereMilliseconds, spatialIndexBenchmark.linearSphereMilliseconds);
+			ImGui::Text("64 rays: %.3f ms (linear %.3f ms)",
+				spatialIndexBenchmark.rayMilliseconds, spatialIndexBenchmark.linearRayMilliseconds);
+			ImGui::Text("Identical results: %s", spatialIndexBenchmark.identical ? "yes" : "no");
+		}
+
+		// The same scene as entities, through the store's bounds refresh and queries
+		if (!meshes.empty() && ImGui::Button("Benchmark Entity Queries (100K)"))
+		{
+			entityQueryBenchmark = Benchmarks::MeasureEntityQueries(meshes[0], 100000, 0.1f, 20);
+			Benchmarks::Print(entityQueryBenchmark);
+		}
+
+		if (entityQueryBenchmark.entityCount > 0)
+		{
+			ImGui::Text("Bounds (%u moving): %.3f ms for %u rows (every row %.3f ms)",
+				entityQueryBenchmark.movingCount, entityQueryBenchmark.boundsMilliseconds,
+				entityQueryBenchmark.boundsUpdated, entityQueryBenchmark.rescanMilliseconds);
+			ImGui::Text("Frustum: %.3f ms, 64 spheres: %.3f ms, 64 rays: %.3f ms",
+				entityQueryBenchmark.frustumMilliseconds, entityQueryBenchmark.sphereMilliseconds,
+				entityQueryBenchmark.rayMilliseconds);
+			ImGui::Text("Identical results: %s", entityQueryBenchmark.identical ? "yes" : "no");
+		}
+
+		// Occlusion culling: software depth buffer vs. rays against the occluders
+		if (ImGui::Button("Benchmark Occlusion Culling (10K)"))
+		{
+			occlusionBenchmark = Benchmarks::MeasureOcclusion(10000, 5);
+			Benchmarks::Print(occlusionBenchmark);
+		}
+
+		if (occlusionBenchmark.boxCount > 0)
+		{
+			ImGui::Text("Buffer: %ux%u, %u threads, %u triangles",
+				occlusionBenchmark.width, occlusionBenchmark.height,
+				occlusionBenchmark.threadCount, occlusionBenchmark.triangleCount);
+			ImGui::Text("Hidden: %u of %u boxes (rays: %u)",
+				occlusionBenchmark.occludedCount, occlusionBenchmark.boxCount, occlusionBenchmark.hiddenCount);
+			ImGui::Text("False occlusions: %u", occlusionBenchmark.falseOcclusions);
+			ImGui::Text("Setup: %.3f ms, raster: %.3f ms (1 thread %.3f ms)",
+				occlusionBenchmark.setupMilliseconds,
+				occlusionBenchmark.rasterMilliseconds, occlusionBenchmark.singleThreadRasterMilliseconds);
+			ImGui::Text("Pyramid: %.3f ms, tests: %.3f ms",
+				occlusionBenchmark.pyramidMilliseconds, occlusionBenchmark.testMilliseconds);
+			ImGui::Text("Identical results: %s", occlusionBenchmark.identical ? "yes" : "no");
+		}
+
+		// Command streams: recording passes on one thread vs. a thread per pass
+		if (ImGui::Button("Benchmark Command Recording (20K draws)"))
+		{
+			commandBenchmark = Benchmarks::MeasureCommandRecording(20000, 4, 10);
+			Benchmarks::Print(commandBenchmark);
+		}
+
+		if (commandBenchmark.drawCount > 0)
+		{
+			ImGui::Text("Draws: %u in %u passes (%u commands, %.1f KB)",
+				commandBenchmark.drawCount, commandBenchmark.passCount,
+				commandBenchmark.commandCount, commandBenchmark.kilobytes);
+			ImGui::Text("Recording: %.3f ms serial, %.3f ms parallel",
+				commandBenchmark.serialMilliseconds, commandBenchmark.parallelMilliseconds);
+			ImGui::Text("Stitch: %.3f ms, replay: %.3f ms",
+				commandBenchmark.stitchMilliseconds, commandBenchmark.replayMilliseconds);
+			ImGui::Text("Identical results: %s", commandBenchmark.identical ? "yes" : "no");
+		}
+		ImGui::Spacing();
+
+		// Correctness checks on generated data
+		if (ImGui::Button("Check Meshlets"))
+		{
+			meshletCheck = Benchmarks::CheckMeshlets(96);
+			Benchmarks::Print(meshletCheck);
+		}
+
+		if (meshletCheck.meshletCount > 0)
+		{
+			ImGui::Text("Meshlets: %u, at most %u vertices, %u triangles (%u loose)",
+				meshletCheck.meshletCount, meshletCheck.maxVertices, meshletCheck.maxTriangles, meshletCheck.maxLooseTriangles);
+			ImGui::Text("Triangles preserved: %s, sphere overshoot: %g",
+				meshletCheck.trianglesPreserved ? "yes" : "no", meshletCheck.sphereOvershoot);
+			ImGui::Text("Cone rejects: %u (%u false), grid facing: %s",
+				meshletCheck.coneRejects, meshletCheck.falseRejects, meshletCheck.gridFacingCorrect ? "yes" : "no");
+			ImGui::Text("Passed: %s", meshletCheck.passed ? "yes" : "no");
+		}
+		ImGui::Spacing();
+
+		if (ImGui::Button("Check Fixed Timestep"))
+		{
+			timestepCheck = Benchmarks::CheckFixedTimestep(216000);
+			Benchmarks::Print(timestepCheck);
+		}
+
+		if (timestepCheck.frameCount > 0)
+		{
+			ImGui::Text("Frames: %u (%.0f s), at most %u steps each",
+				timestepCheck.frameCount, timestepCheck.realSeconds, timestepCheck.maxFrameSteps);
+			ImGui::Text("Stall: %u steps, %.3f s dropped", timestepCheck.stallSteps, timestepCheck.stallDropped);
+			ImGui::Text("Alpha: %.6f to %.6f, drift: %g s",
+				timestepCheck.minAlpha, timestepCheck.maxAlpha, timestepCheck.maxDrift);
+			ImGui::Text("Even frames step once: %s", timestepCheck.evenFramesStepOnce ? "yes" : "no");
+			ImGui::Text("Passed: %s", timestepCheck.passed ? "yes" : "no");
+		}
+		ImGui::Spacing();
+
+		if (ImGui::Button("Check Instance Batching"))
+		{
+			batcherCheck = Benchmarks::CheckInstanceBatcher(5000);
+			Benchmarks::Print(batcherCheck);
+		}
+
+		if (batcherCheck.drawCount > 0)
+		{
+			ImGui::Text("Draws: %u, batches: %u (%u groups)",
+				batcherCheck.drawCount, batcherCheck.batchCount, batcherCheck.groupCount);
+			ImGui::Text("Partitioned: %s, order preserved: %s",
+				batcherCheck.partitioned ? "yes" : "no", batcherCheck.orderPreserved ? "yes" : "no");
+			ImGui::Text("Covered once: %s, reusable: %s",
+				batcherCheck.coveredOnce ? "yes" : "no", batcherCheck.reusable ? "yes" : "no");
+			ImGui::Text("Passed: %s", batcherCheck.passed ? "yes" : "no");
+		}
+
+		ImGui::TreePop();
+	}
+
 	if (ImGui::TreeNode("Game Entities"))
 	{
-		for (int i = 0; i < entities.size(); i++) {
-			ImGui::PushID(entities[i].get());
+		// Mouse picking against each mesh's BVH
+		ImGui::Text("Right-click the scene to pick an entity");
+		unsigned int pickedRow = entities.GetRow(pickedEntity);
+		if (pickedRow != EntityStore::InvalidRow)
+			ImGui::Text("Picked: Entity %u (%.2f units away)", pickedRow, pickedDistance);
+		else
+			ImGui::Text("Picked: None");
+		ImGui::Spacing();
+
+		for (unsigned int i = 0; i < entities.GetCount(); i++) {
+			// IDs follow the handle, so open nodes stay open if rows move
+			ImGui::PushID((int)entities.GetHandle(i).index);
 
-			if (ImGui::TreeNode("Entity", "Entity %d", i)) {
+			// Open the picked entity's details
+			if (i == pickedRow && openPickedEntity)
+			{
+				ImGui::SetNextItemOpen(true);
+				openPickedEntity = false;
+			}
+
+			if (ImGui::TreeNode("Entity", i == pickedRow ? "Entity %u (picked)" : "Entity %u", i)) {
 				ImGui::Spacing();
 
 				// Mesh name
-				ImGui::Text("Mesh: %s", entities[i]->GetMesh()->GetName());
+				ImGui::Text("Mesh: %s", entities.GetMesh(i)->GetName());
+				ImGui::Text("LOD: %d / %d", entities.GetLod(i), entities.GetMesh(i)->GetLodCount() - 1);
+
+				// World-space bounds (cached until the transform changes)
+				BoundingSphere worldSphere = entities.GetWorldBoundingSphere(i);
+				BoundingBox worldBox = entities.GetWorldBoundingBox(i);
+				ImGui::Text("World sphere: (%.2f, %.2f, %.2f) r %.2f", worldSphere.Center.x, worldSphere.Center.y, worldSphere.Center.z, worldSphere.Radius);
+				ImGui::Text("World box extents: %.2f, %.2f, %.2f", worldBox.Extents.x, worldBox.Extents.y, worldBox.Extents.z);
+
+				// Whether it's drawn into the occlusion buffer
+				bool occluder = entities.IsOccluder(i);
+				if (ImGui::Checkbox("Occluder", &occluder))
+					entities.SetOccluder(i, occluder);
 
 				ImGui::Spacing();
 
 				// Transform variables
-				std::shared_ptr<Transform> transform = entities[i]->GetTransform();
+				Transform* transform = &entities.GetTransform(i);
 
 				XMFLOAT3 position = transform->GetPosition();
 				XMFLOAT3 rotation = transform->GetPitchYawRoll();
 				XMFLOAT3 scale = transform->GetScale();
+				if (transform->HasParent())
+					ImGui::Text("Relative to its parent's transform");
 
 				// Drag sliders for transform values
 				// Position
@@ -844,6 +1618,19 @@ void Game::BuildUI(float deltaTime)
 
 				ImGui::Spacing();
 
+				// Surface overrides on top of the material's
+				XMFLOAT3 tint = entities.GetColorTint(i);
+				float uvScale = entities.GetUVScale(i);
+				float uvOffset = entities.GetUVOffset(i);
+				if (ImGui::ColorEdit3("Tint", &tint.x))
+					entities.SetColorTint(i, tint);
+				if (ImGui::DragFloat("UV scale", &uvScale, 0.01f))
+					entities.SetUVScale(i, uvScale);
+				if (ImGui::DragFloat("UV offset", &uvOffset, 0.01f))
+					entities.SetUVOffset(i, uvOffset);
+
+				ImGui::Spacing();
+
 				ImGui::TreePop();
 			}
 
@@ -870,8 +1657,11 @@ void Game::BuildUI(float deltaTime)
 		ImGui::Text("Far: %f", cameras[activeCam]->GetFarClip());
 
 		// Buttons to toggle through cameras
-		if (ImGui::Button("Cam 0")) { activeCam = 0; } ImGui::SameLine();
-		if (ImGui::Button("Cam 1")) { activeCam = 1; }
+		for (int i = 0; i < (int)cameras.size(); i++)
+		{
+			if (i > 0) ImGui::SameLine();
+			if (ImGui::Button(("Cam " + to_string(i)).c_str())) { activeCam = i; }
+		}
 
 		ImGui::TreePop();
 	}
@@ -908,6 +1698,10 @@ void Game::BuildUI(float deltaTime)
 					XMFLOAT3 position = lights[i].Position;
 					ImGui::DragFloat3("Position", &lights[i].Position.x, 0.01f);
 
+					// Entities the light can reach
+					unsigned int inRange = entities.QuerySphere(lights[i].Position, lights[i].Range, queryRows);
+					ImGui::Text("Entities in range: %u", inRange);
+
 					ImGui::Spacing();
 				}
 
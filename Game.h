@@ -6,13 +6,21 @@
 #include <memory>
 
 #include "Mesh.h"
-#include "Entity.h"
+#include "EntityStore.h"
 #include "Camera.h"
 #include "SimpleShader.h"
 #include "Material.h"
 #include "Lights.h"
 #include "WICTextureLoader.h"
 #include "Sky.h"
+#include "Benchmarks.h"
+#include "FixedTimestep.h"
+#include "RenderQueue.h"
+#include "OcclusionBuffer.h"
+#include "Parallel.h"
+#include "CommandBuffer.h"
+#include "D3D11Backend.h"
+#include "RecordingBackend.h"
 
 class Game
 {
@@ -24,21 +32,36 @@ public:
 	Game& operator=(const Game&) = delete; // Remove copy-assignment operator
 
 	// Primary functions
-	void Initialize();
+	bool Initialize();
 	void Update(float deltaTime, float totalTime);
 	void Draw(float deltaTime, float totalTime);
 	void OnResize();
 
+	// What the last frame's command streams held
+	const RecordingBackend::Stats& GetFrameStats() const;
+
 private:
 
 	// Initialization helper methods - feel free to customize, combine, remove, etc.
-	void LoadShadersAndCreateGeometry();
+	bool LoadShadersAndCreateGeometry();
+	bool LoadScene(const char* textPath, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler);
 
 	void CreateShadowMapResources();
-	void RenderShadowMap();
+	void SetFrameShaderData(CommandBuffer& commands, SimpleVertexShader* vs, SimplePixelShader* ps, EntityStore::DrawState& state);
+	void UploadInstances(CommandBuffer& commands);
+
+	// Each records one pass of the frame into its own command stream
+	void RecordShadowPass();
+	void RecordOpaquePass();
+	void RecordPostProcessPass();
 
 	void CreateResizePostProcess();
 
+	void PickEntity(int mouseX, int mouseY);
+
+	// One step of the simulation, always the same length
+	void FixedUpdate(float step, float simulationTime);
+
 	void UIUpdate(float deltaTime);
 	void BuildUI(float deltaTime);
 
@@ -46,13 +69,124 @@ private:
 	bool showDemoUI;
 	float backgroundColor[4] = { 0.4f, 0.6f, 0.75f, 0.0f };
 
+	// Results of benchmarks run from the UI
+	Benchmarks::ObjLoadResult objLoadBenchmark = {};
+	Benchmarks::ObjLoadResult scanLoadBenchmark = {};
+	Benchmarks::TangentResult tangentBenchmark = {};
+	Benchmarks::RayResult rayBenchmarks[2] = {};
+	Benchmarks::TransformResult transformBenchmarks[3] = {};
+	Benchmarks::HierarchyResult hierarchyBenchmarks[2] = {};
+	Benchmarks::InverseTransposeResult inverseTransposeBenchmark = {};
+	Benchmarks::EntityResult entityBenchmark = {};
+	Benchmarks::CullingResult cullingBenchmark = {};
+	Benchmarks::RenderQueueResult renderQueueBenchmark = {};
+	Benchmarks::SceneLoadResult sceneLoadBenchmark = {};
+	Benchmarks::SpatialIndexResult spatialIndexBenchmark = {};
+	Benchmarks::EntityQueryResult entityQueryBenchmark = {};
+	Benchmarks::OcclusionResult occlusionBenchmark = {};
+	Benchmarks::CommandResult commandBenchmark = {};
+
+	// Results of correctness checks run from the UI
+	Benchmarks::MeshletCheckResult meshletCheck = {};
+	Benchmarks::TimestepCheckResult timestepCheck = {};
+	Benchmarks::BatcherCheckResult batcherCheck = {};
+
+	// Entity under the cursor at the last right-click (none by default)
+	EntityStore::Handle pickedEntity;
+	float pickedDistance = 0.0f;
+	bool openPickedEntity = false;
+
+	// The simulation runs at a fixed tick rate, and drawing blends the
+	// last two steps (unless interpolation is switched off)
+	FixedTimestep timestep;
+	int tickRate = 60;
+	bool interpolateTransforms = true;
+
+	// World matrices rebuilt by last frame's batch update, and the
+	// entity bounds rebuilt from them
+	unsigned int transformsUpdated = 0;
+	unsigned int boundsUpdated = 0;
+
+	// Frustum culling of whole entities, with an optional cutoff for
+	// anything covering less than a fraction of the screen's height
+	bool frustumCulling = true;
+	float minScreenSize = 0.0f;
+	std::vector<unsigned int> visibleRows;
+
+	// Culling and picking go through the entities' spatial index rather
+	// than testing every entity (unless switched off), as do the light
+	// panel's range counts
+	bool spatialIndex = true;
+	std::vector<unsigned int> queryRows;
+
+	// Entities flagged as occluders are drawn into a small CPU depth
+	// buffer while the frame is culled, and whatever they hide is
+	// dropped from the visible rows (unless switched off)
+	bool occlusionCulling = true;
+	OcclusionBuffer occlusionBuffer;
+	unsigned int occluderCount = 0;
+	unsigned int occludedCount = 0;
+
+	// Entities drawn into the shadow map: only those that can shade
+	// something the camera sees (or every one, when switched off)
+	bool shadowCasterCulling = true;
+	std::vector<unsigned int> shadowCasterRows;
+
+	// Both passes' draws, sorted by render key so neighbouring draws
+	// share shaders, materials and meshes (unless sorting is off), and
+	// how many of those were actually bound last frame
+	RenderQueue renderQueue;
+	bool sortDraws = true;
+	unsigned int stateChanges = 0;
+	unsigned int shadowMeshChanges = 0;
+
+	// Visible entities sharing a mesh, material and LOD are drawn as
+	// one instanced batch, if their material uses the standard vertex
+	// shader (which instancedVS stands in for)
+	bool instancing = true;
+	InstanceBatcher instanceBatcher;
+	std::vector<InstanceBatcher::InstanceData> instanceData;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> instanceBuffer;
+	unsigned int instanceCapacity = 0;
+	unsigned int drawCalls = 0;
+	unsigned int instancedBatches = 0;
+
+	// Meshlets that survived culling last frame
+	unsigned int meshletsDrawn = 0;
+	unsigned int shadowMeshletsDrawn = 0;
+
+	// Every pass records into its own command stream (the shadow pass
+	// on a second thread, unless switched off), and the streams are
+	// stitched together in pass order before the device replays them.
+	// The recording backend only counts what went by.
+	bool parallelRecording = true;
+	CommandBuffer shadowCommands;
+	CommandBuffer opaqueCommands;
+	CommandBuffer postProcessCommands;
+	CommandBuffer frameCommands;
+	std::vector<MeshProcessing::DrawRange> shadowRanges;
+	D3D11Backend deviceBackend;
+	RecordingBackend frameStats;
+
+	// The thread the shadow pass records on, kept for the game's
+	// lifetime so a frame doesn't pay for creating one
+	WorkerPool shadowRecorder{ 1 };
+
+	// LOD selection: largest simplification error allowed on screen (as a
+	// fraction of its height), and how many levels coarser shadows may be
+	float lodScreenError = 0.002f;
+	int shadowLodOffset = 1;
+
 	// Vectors to store data for objects in the scene
 	std::vector<std::shared_ptr<Mesh>> meshes;
 	std::vector<std::shared_ptr<Material>> materials;
-	std::vector<std::shared_ptr<Entity>> entities;
+	EntityStore entities;
 	std::vector<std::shared_ptr<Camera>> cameras;
 	std::vector<Light> lights;
 
+	// The entity the simulation moves up and down (its children follow)
+	EntityStore::Handle animatedEntity;
+
 	// Int for keeping track of which camera is active
 	int activeCam = 0;
 
@@ -73,6 +207,7 @@ private:
 	std::shared_ptr<SimpleVertexShader> skyVS;
 	std::shared_ptr<SimplePixelShader> skyPS;
 	std::shared_ptr<SimpleVertexShader> shadowVS;
+	std::shared_ptr<SimpleVertexShader> instancedVS;
 
 	// Shadow Map resources
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> shadowDSV;
@@ -1,5 +1,6 @@
 #include "Graphics.h"
 #include <dxgi1_6.h>
+#include <atomic>
 
 // Tell the drivers to use high-performance GPU in multi-GPU systems (like laptops)
 extern "C"
@@ -15,6 +16,7 @@ namespace Graphics
 	namespace
 	{
 		bool apiInitialized = false;
+		bool headless = false;
 		bool supportsTearing = false;
 		bool vsyncDesired = false;
 		BOOL isFullscreen = false;
@@ -22,11 +24,208 @@ namespace Graphics
 		D3D_FEATURE_LEVEL featureLevel;
 
 		Microsoft::WRL::ComPtr<ID3D11InfoQueue> InfoQueue;
+
+		// Tracked resources, which may be made (and released) on any thread
+		std::atomic<unsigned int> bufferCount = 0;
+		std::atomic<unsigned int> textureCount = 0;
+		std::atomic<unsigned int> shaderCount = 0;
+		std::atomic<unsigned long long> bufferBytes = 0;
+		std::atomic<unsigned long long> textureBytes = 0;
+		std::atomic<unsigned int> buffersCreated = 0;
+		std::atomic<unsigned int> texturesCreated = 0;
+		std::atomic<unsigned int> shadersCreated = 0;
+
+		// What a tracker is counting
+		enum class TrackedKind { Buffer, Texture, Shader };
+
+		// Identifies the tracker attached to each tracked resource
+		const GUID TrackerGuid = { 0x5b1e7a3c, 0x9d42, 0x4f6e, { 0x8a, 0x17, 0x3c, 0x65, 0xd0, 0x2b, 0x94, 0xe1 } };
+
+		// --------------------------------------------------------
+		// Attached to a resource (or shader) as private data,
+		// which it releases when it's destroyed - so whoever owns
+		// it, it comes off the tally exactly then
+		// --------------------------------------------------------
+		class ResourceTracker : public IUnknown
+		{
+		private:
+			std::atomic<ULONG> refCount;
+			TrackedKind kind;
+			unsigned long long bytes;
+
+		public:
+			ResourceTracker(TrackedKind kind, unsigned long long bytes) : refCount(1), kind(kind), bytes(bytes)
+			{
+				switch (kind)
+				{
+				case TrackedKind::Buffer: bufferCount++; bufferBytes += bytes; buffersCreated++; break;
+				case TrackedKind::Texture: textureCount++; textureBytes += bytes; texturesCreated++; break;
+				case TrackedKind::Shader: shaderCount++; shadersCreated++; break;
+				}
+			}
+
+			HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+			{
+				if (riid != __uuidof(IUnknown))
+				{
+					*object = 0;
+					return E_NOINTERFACE;
+				}
+				*object = this;
+				AddRef();
+				return S_OK;
+			}
+
+			ULONG STDMETHODCALLTYPE AddRef() override { return ++refCount; }
+
+			ULONG STDMETHODCALLTYPE Release() override
+			{
+				ULONG count = --refCount;
+				if (count == 0)
+				{
+					switch (kind)
+					{
+					case TrackedKind::Buffer: bufferCount--; bufferBytes -= bytes; break;
+					case TrackedKind::Texture: textureCount--; textureBytes -= bytes; break;
+					case TrackedKind::Shader: shaderCount--; break;
+					}
+					delete this;
+				}
+				return count;
+			}
+		};
+
+		// Attaches a tracker, which the object then owns, unless it
+		// has one already
+		void Track(ID3D11DeviceChild* object, TrackedKind kind, unsigned long long bytes)
+		{
+			UINT size = 0;
+			if (SUCCEEDED(object->GetPrivateData(TrackerGuid, &size, 0)))
+				return;
+
+			ResourceTracker* tracker = new ResourceTracker(kind, bytes);
+			object->SetPrivateDataInterface(TrackerGuid, tracker);
+			tracker->Release();
+		}
+
+		// Bits per texel (or per texel of a compressed block) for the
+		// formats likely to turn up, assuming 32 for anything else
+		unsigned int BitsPerPixel(DXGI_FORMAT format)
+		{
+			switch (format)
+			{
+			case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+			case DXGI_FORMAT_R32G32B32A32_FLOAT:
+			case DXGI_FORMAT_R32G32B32A32_UINT:
+			case DXGI_FORMAT_R32G32B32A32_SINT:
+				return 128;
+
+			case DXGI_FORMAT_R32G32B32_TYPELESS:
+			case DXGI_FORMAT_R32G32B32_FLOAT:
+			case DXGI_FORMAT_R32G32B32_UINT:
+			case DXGI_FORMAT_R32G32B32_SINT:
+				return 96;
+
+			case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+			case DXGI_FORMAT_R16G16B16A16_FLOAT:
+			case DXGI_FORMAT_R16G16B16A16_UNORM:
+			case DXGI_FORMAT_R16G16B16A16_UINT:
+			case DXGI_FORMAT_R16G16B16A16_SNORM:
+			case DXGI_FORMAT_R16G16B16A16_SINT:
+			case DXGI_FORMAT_R32G32_TYPELESS:
+			case DXGI_FORMAT_R32G32_FLOAT:
+			case DXGI_FORMAT_R32G32_UINT:
+			case DXGI_FORMAT_R32G32_SINT:
+			case DXGI_FORMAT_R32G8X24_TYPELESS:
+			case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+				return 64;
+
+			case DXGI_FORMAT_R8G8_TYPELESS:
+			case DXGI_FORMAT_R8G8_UNORM:
+			case DXGI_FORMAT_R16_TYPELESS:
+			case DXGI_FORMAT_R16_FLOAT:
+			case DXGI_FORMAT_R16_UNORM:
+			case DXGI_FORMAT_D16_UNORM:
+			case DXGI_FORMAT_B5G6R5_UNORM:
+				return 16;
+
+			case DXGI_FORMAT_R8_TYPELESS:
+			case DXGI_FORMAT_R8_UNORM:
+			case DXGI_FORMAT_A8_UNORM:
+			case DXGI_FORMAT_BC2_TYPELESS:
+			case DXGI_FORMAT_BC2_UNORM:
+			case DXGI_FORMAT_BC2_UNORM_SRGB:
+			case DXGI_FORMAT_BC3_TYPELESS:
+			case DXGI_FORMAT_BC3_UNORM:
+			case DXGI_FORMAT_BC3_UNORM_SRGB:
+			case DXGI_FORMAT_BC5_TYPELESS:
+			case DXGI_FORMAT_BC5_UNORM:
+			case DXGI_FORMAT_BC5_SNORM:
+			case DXGI_FORMAT_BC6H_TYPELESS:
+			case DXGI_FORMAT_BC6H_UF16:
+			case DXGI_FORMAT_BC6H_SF16:
+			case DXGI_FORMAT_BC7_TYPELESS:
+			case DXGI_FORMAT_BC7_UNORM:
+			case DXGI_FORMAT_BC7_UNORM_SRGB:
+				return 8;
+
+			case DXGI_FORMAT_BC1_TYPELESS:
+			case DXGI_FORMAT_BC1_UNORM:
+			case DXGI_FORMAT_BC1_UNORM_SRGB:
+			case DXGI_FORMAT_BC4_TYPELESS:
+			case DXGI_FORMAT_BC4_UNORM:
+			case DXGI_FORMAT_BC4_SNORM:
+				return 4;
+
+			default:
+				return 32;
+			}
+		}
+
+		// Every mip of every array slice (zero mips means a full chain)
+		unsigned long long TextureBytes(DXGI_FORMAT format, unsigned int width, unsigned int height, unsigned int depth, unsigned int mipLevels, unsigned int arraySize)
+		{
+			unsigned long long bytes = 0;
+			for (unsigned int mip = 0; mipLevels == 0 || mip < mipLevels; mip++)
+			{
+				bytes += (unsigned long long)width * height * depth * BitsPerPixel(format) / 8;
+				if (width == 1 && height == 1 && depth == 1)
+					break;
+				width = width > 1 ? width / 2 : 1;
+				height = height > 1 ? height / 2 : 1;
+				depth = depth > 1 ? depth / 2 : 1;
+			}
+			return bytes * arraySize;
+		}
+
+		// Sets up the info queue in debug mode, for printing debug messages
+		void CreateInfoQueue()
+		{
+#if defined(DEBUG) || defined(_DEBUG)
+			Microsoft::WRL::ComPtr<ID3D11Debug> debug;
+			Device->QueryInterface(IID_PPV_ARGS(debug.GetAddressOf()));
+			debug->QueryInterface(IID_PPV_ARGS(InfoQueue.GetAddressOf()));
+#endif
+		}
 	}
 }
 
 // Getters
 bool Graphics::VsyncState() { return vsyncDesired || !supportsTearing || isFullscreen; }
+bool Graphics::IsHeadless() { return headless; }
+Graphics::ResourceStats Graphics::GetResourceStats()
+{
+	ResourceStats stats = {};
+	stats.bufferCount = bufferCount;
+	stats.textureCount = textureCount;
+	stats.shaderCount = shaderCount;
+	stats.bufferBytes = bufferBytes;
+	stats.textureBytes = textureBytes;
+	stats.buffersCreated = buffersCreated;
+	stats.texturesCreated = texturesCreated;
+	stats.shadersCreated = shadersCreated;
+	return stats;
+}
 std::wstring Graphics::APIName() 
 { 
 	switch (featureLevel)
@@ -131,14 +330,70 @@ HRESULT Graphics::Initialize(unsigned int windowWidth, unsigned int windowHeight
 	// will also set the appropriate viewport.
 	ResizeBuffers(windowWidth, windowHeight);
 
-#if defined(DEBUG) || defined(_DEBUG)
 	// If we're in debug mode, set up the info queue to
 	// get debug messages we can print to our console
-	Microsoft::WRL::ComPtr<ID3D11Debug> debug;
-	Device->QueryInterface(IID_PPV_ARGS(debug.GetAddressOf()));
-	debug->QueryInterface(IID_PPV_ARGS(InfoQueue.GetAddressOf()));
+	CreateInfoQueue();
+
+	return S_OK;
+}
+
+// --------------------------------------------------------
+// Initializes the Graphics API with no window, no swap chain
+// and no GPU work, for running the game's CPU side alone
+// (benchmarking it, say, on a machine without a GPU).
+//
+// The device is Direct3D's null driver: creating buffers,
+// textures and shaders works as usual, but nothing it's asked
+// to do ever renders.  The null driver comes with the SDK
+// layers, so where it's missing this falls back to WARP,
+// Direct3D's software rasterizer, which does render (on the
+// CPU, so frame times include it).  Which one it got is
+// printed.  The back buffer is an ordinary texture.
+// 
+// width  - Width of the back buffer (and our viewport)
+// height - Height of the back buffer (and our viewport)
+// --------------------------------------------------------
+HRESULT Graphics::InitializeHeadless(unsigned int width, unsigned int height)
+{
+	// Only initialize once
+	if (apiInitialized)
+		return E_FAIL;
+
+	unsigned int deviceFlags = 0;
+#if defined(DEBUG) || defined(_DEBUG)
+	deviceFlags |= D3D11_CREATE_DEVICE_DEBUG;
 #endif
 
+	// Null accepts everything and renders nothing; WARP renders
+	// in software.  Neither uses an adapter.
+	D3D_DRIVER_TYPE driverTypes[] = { D3D_DRIVER_TYPE_NULL, D3D_DRIVER_TYPE_WARP };
+	const char* driverNames[] = { "null", "WARP" };
+	HRESULT hr = E_FAIL;
+	for (int i = 0; i < 2 && FAILED(hr); i++)
+	{
+		hr = D3D11CreateDevice(
+			0,
+			driverTypes[i],
+			0,
+			deviceFlags,
+			0,
+			0,
+			D3D11_SDK_VERSION,
+			Device.GetAddressOf(),
+			&featureLevel,
+			Context.GetAddressOf());
+		if (SUCCEEDED(hr))
+			printf("Headless device: %s driver\n", driverNames[i]);
+	}
+	if (FAILED(hr)) return hr;
+
+	apiInitialized = true;
+	headless = true;
+
+	// Sets up the back and depth buffers, as with a window
+	ResizeBuffers(width, height);
+	CreateInfoQueue();
+
 	return S_OK;
 }
 
@@ -175,20 +430,38 @@ void Graphics::ResizeBuffers(unsigned int width, unsigned int height)
 	BackBufferRTV.Reset();
 	DepthBufferDSV.Reset();
 
-	// Resize the swap chain buffers
-	SwapChain->ResizeBuffers(
-		2, 
-		width, 
-		height, 
-		DXGI_FORMAT_R8G8B8A8_UNORM, 
-		supportsTearing ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0);
-
-	// Grab the references to the first buffer
 	Microsoft::WRL::ComPtr<ID3D11Texture2D> backBufferTexture;
-	SwapChain->GetBuffer(
-		0,
-		__uuidof(ID3D11Texture2D),
-		(void**)backBufferTexture.GetAddressOf());
+	if (headless)
+	{
+		// With no swap chain, the back buffer is just a texture
+		// nobody ever sees
+		D3D11_TEXTURE2D_DESC backBufferDesc = {};
+		backBufferDesc.Width = width;
+		backBufferDesc.Height = height;
+		backBufferDesc.MipLevels = 1;
+		backBufferDesc.ArraySize = 1;
+		backBufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		backBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+		backBufferDesc.BindFlags = D3D11_BIND_RENDER_TARGET;
+		backBufferDesc.SampleDesc.Count = 1;
+		CreateTexture2D(&backBufferDesc, 0, backBufferTexture.GetAddressOf());
+	}
+	else
+	{
+		// Resize the swap chain buffers
+		SwapChain->ResizeBuffers(
+			2, 
+			width, 
+			height, 
+			DXGI_FORMAT_R8G8B8A8_UNORM, 
+			supportsTearing ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0);
+
+		// Grab the references to the first buffer
+		SwapChain->GetBuffer(
+			0,
+			__uuidof(ID3D11Texture2D),
+			(void**)backBufferTexture.GetAddressOf());
+	}
 
 	// Now that we have the texture, create a render target view
 	// for the back buffer so we can render into it.
@@ -214,7 +487,7 @@ void Graphics::ResizeBuffers(unsigned int width, unsigned int height)
 	// Create the depth buffer and its view, then 
 	// release our reference to the texture
 	Microsoft::WRL::ComPtr<ID3D11Texture2D> depthBufferTexture;
-	Device->CreateTexture2D(&depthStencilDesc, 0, &depthBufferTexture);
+	CreateTexture2D(&depthStencilDesc, 0, depthBufferTexture.GetAddressOf());
 	Device->CreateDepthStencilView(
 		depthBufferTexture.Get(),
 		0,
@@ -239,7 +512,93 @@ void Graphics::ResizeBuffers(unsigned int width, unsigned int height)
 	Context->RSSetViewports(1, &viewport);
 
 	// Are we in a fullscreen state?
-	SwapChain->GetFullscreenState(&isFullscreen, 0);
+	if (SwapChain)
+		SwapChain->GetFullscreenState(&isFullscreen, 0);
+}
+
+
+// --------------------------------------------------------
+// Creates a buffer on the device exactly as the device would,
+// then tracks its size until the buffer is released
+// --------------------------------------------------------
+HRESULT Graphics::CreateBuffer(const D3D11_BUFFER_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer)
+{
+	HRESULT hr = Device->CreateBuffer(desc, initialData, buffer);
+	if (SUCCEEDED(hr) && buffer)
+		TrackResource(*buffer);
+	return hr;
+}
+
+// --------------------------------------------------------
+// Creates a 2D texture on the device exactly as the device
+// would, then tracks its (estimated) size until the texture
+// is released
+// --------------------------------------------------------
+HRESULT Graphics::CreateTexture2D(const D3D11_TEXTURE2D_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Texture2D** texture)
+{
+	HRESULT hr = Device->CreateTexture2D(desc, initialData, texture);
+	if (SUCCEEDED(hr) && texture)
+		TrackResource(*texture);
+	return hr;
+}
+
+// --------------------------------------------------------
+// Sizes the resource from its own description, which has
+// the real mip count even if it was created with a full
+// chain (zero), and starts tracking it
+// --------------------------------------------------------
+void Graphics::TrackResource(ID3D11Resource* resource)
+{
+	if (!resource)
+		return;
+
+	D3D11_RESOURCE_DIMENSION dimension = D3D11_RESOURCE_DIMENSION_UNKNOWN;
+	resource->GetType(&dimension);
+	switch (dimension)
+	{
+	case D3D11_RESOURCE_DIMENSION_BUFFER:
+	{
+		D3D11_BUFFER_DESC desc = {};
+		static_cast<ID3D11Buffer*>(resource)->GetDesc(&desc);
+		Track(resource, TrackedKind::Buffer, desc.ByteWidth);
+		break;
+	}
+
+	case D3D11_RESOURCE_DIMENSION_TEXTURE1D:
+	{
+		D3D11_TEXTURE1D_DESC desc = {};
+		static_cast<ID3D11Texture1D*>(resource)->GetDesc(&desc);
+		Track(resource, TrackedKind::Texture, TextureBytes(desc.Format, desc.Width, 1, 1, desc.MipLevels, desc.ArraySize));
+		break;
+	}
+
+	case D3D11_RESOURCE_DIMENSION_TEXTURE2D:
+	{
+		D3D11_TEXTURE2D_DESC desc = {};
+		static_cast<ID3D11Texture2D*>(resource)->GetDesc(&desc);
+		unsigned int samples = desc.SampleDesc.Count ? desc.SampleDesc.Count : 1;
+		Track(resource, TrackedKind::Texture, TextureBytes(desc.Format, desc.Width, desc.Height, 1, desc.MipLevels, desc.ArraySize) * samples);
+		break;
+	}
+
+	case D3D11_RESOURCE_DIMENSION_TEXTURE3D:
+	{
+		D3D11_TEXTURE3D_DESC desc = {};
+		static_cast<ID3D11Texture3D*>(resource)->GetDesc(&desc);
+		Track(resource, TrackedKind::Texture, TextureBytes(desc.Format, desc.Width, desc.Height, desc.Depth, desc.MipLevels, 1));
+		break;
+	}
+
+	default:
+		break;
+	}
+}
+
+// Shaders are only counted, since the device doesn't say their size
+void Graphics::TrackShader(ID3D11DeviceChild* shader)
+{
+	if (shader)
+		Track(shader, TrackedKind::Shader, 0);
 }
 
 
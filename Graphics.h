@@ -21,17 +21,44 @@ namespace Graphics
 	inline Microsoft::WRL::ComPtr<ID3D11RenderTargetView> BackBufferRTV;
 	inline Microsoft::WRL::ComPtr<ID3D11DepthStencilView> DepthBufferDSV;
 
+	// Buffers, textures and shaders made through the functions
+	// below (or handed to the Track functions), tallied until
+	// they're released
+	struct ResourceStats
+	{
+		unsigned int bufferCount;
+		unsigned int textureCount;
+		unsigned int shaderCount;
+		unsigned long long bufferBytes;
+		unsigned long long textureBytes;	// Estimated from format, size and mips
+		unsigned int buffersCreated;		// Every creation so far, released or not
+		unsigned int texturesCreated;
+		unsigned int shadersCreated;
+	};
+
 	// --- FUNCTIONS ---
 
 	// Getters
 	bool VsyncState();
+	bool IsHeadless();
 	std::wstring APIName();
+	ResourceStats GetResourceStats();
 
 	// General functions
 	HRESULT Initialize(unsigned int windowWidth, unsigned int windowHeight, HWND windowHandle, bool vsyncIfPossible);
+	HRESULT InitializeHeadless(unsigned int width, unsigned int height);
 	void ShutDown();
 	void ResizeBuffers(unsigned int width, unsigned int height);
 
+	// Resource creation that's tracked in the resource stats
+	HRESULT CreateBuffer(const D3D11_BUFFER_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer);
+	HRESULT CreateTexture2D(const D3D11_TEXTURE2D_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Texture2D** texture);
+
+	// Tracks a buffer, texture or shader made some other way (by a
+	// texture loader, say).  Anything already tracked is skipped.
+	void TrackResource(ID3D11Resource* resource);
+	void TrackShader(ID3D11DeviceChild* shader);
+
 	// Debug Layer
 	void PrintDebugMessages();
 }
\ No newline at end of file
@@ -0,0 +1,364 @@
+#include "HeadlessMain.h"
+
+#include "Window.h"
+#include "Graphics.h"
+#include "Game.h"
+#include "Input.h"
+#include "Benchmarks.h"
+#include "Mesh.h"
+#include "PathHelpers.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Anonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	double NowMilliseconds()
+	{
+		return std::chrono::duration<double, std::milli>(
+			std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+	}
+
+	// Running time, fastest and slowest of a set of samples
+	struct Timing
+	{
+		double total = 0;
+		double fastest = 0;
+		double slowest = 0;
+
+		void Add(double milliseconds, bool first)
+		{
+			total += milliseconds;
+			if (first || milliseconds < fastest) fastest = milliseconds;
+			if (first || milliseconds > slowest) slowest = milliseconds;
+		}
+	};
+
+	// The value following the named option, if there is one
+	unsigned int ReadOption(int argc, char* argv[], const char* name, unsigned int defaultValue)
+	{
+		for (int i = 1; i + 1 < argc; i++)
+		{
+			if (strcmp(argv[i], name) == 0)
+			{
+				int value = atoi(argv[i + 1]);
+				return value > 0 ? (unsigned int)value : defaultValue;
+			}
+		}
+		return defaultValue;
+	}
+
+	// The text following the named option, or null
+	const char* ReadTextOption(int argc, char* argv[], const char* name)
+	{
+		for (int i = 1; i + 1 < argc; i++)
+		{
+			if (strcmp(argv[i], name) == 0)
+				return argv[i + 1];
+		}
+		return 0;
+	}
+
+	// Each of these runs one of the Benchmarks at the size the UI
+	// uses, prints the same line its button does, and returns false
+	// if the results don't hold up (different output, mismatches
+	// or a failed check) so a script can tell
+	bool RunObjLoaders()
+	{
+		Benchmarks::ObjLoadResult r = Benchmarks::CompareObjLoaders(FixPath("../../Assets/Models/helix.obj").c_str(), 10);
+		Benchmarks::Print(r);
+		return r.identical;
+	}
+
+	bool RunObjLoadersOnScan()
+	{
+		Benchmarks::ObjLoadResult r = Benchmarks::CompareObjLoadersOnScan(1000, 1);
+		Benchmarks::Print(r);
+		return r.identical;
+	}
+
+	bool RunTangents()
+	{
+		Benchmarks::TangentResult r = Benchmarks::CompareTangents(FixPath("../../Assets/Models/helix.obj").c_str(), 10);
+		Benchmarks::Print(r);
+		return r.deterministic;
+	}
+
+	bool RunRayThroughput()
+	{
+		const char* models[2] = { "Helix", "Torus" };
+		const char* files[2] = { "../../Assets/Models/helix.obj", "../../Assets/Models/torus.obj" };
+		bool passed = true;
+		for (int i = 0; i < 2; i++)
+		{
+			Benchmarks::RayResult r = Benchmarks::MeasureRayThroughput(FixPath(files[i]).c_str(), 100000);
+			Benchmarks::Print(r, models[i]);
+			passed = passed && r.rayCount > 0 && r.mismatches == 0;
+		}
+		return passed;
+	}
+
+	bool RunTransformUpdates()
+	{
+		unsigned int counts[3] = { 10000, 100000, 1000000 };
+		for (int i = 0; i < 3; i++)
+			Benchmarks::Print(Benchmarks::MeasureTransformUpdates(counts[i], i < 2 ? 10 : 3));
+		return true;
+	}
+
+	bool RunHierarchyUpdates()
+	{
+		Benchmarks::Print(Benchmarks::MeasureHierarchyUpdates(50000, 4, 10));
+		Benchmarks::Print(Benchmarks::MeasureHierarchyUpdates(20000, 1, 10));
+		return true;
+	}
+
+	bool RunInverseTranspose()
+	{
+		Benchmarks::Print(Benchmarks::CompareInverseTranspose(100000, 10));
+		return true;
+	}
+
+	bool RunEntityIteration()
+	{
+		Benchmarks::Print(Benchmarks::CompareEntityIteration(1000000, 5));
+		return true;
+	}
+
+	bool RunCulling()
+	{
+		Benchmarks::CullingResult r = Benchmarks::CompareCulling(250000, 10);
+		Benchmarks::Print(r);
+		return r.identical && r.shadowIdentical;
+	}
+
+	bool RunRenderQueueSort()
+	{
+		Benchmarks::RenderQueueResult r = Benchmarks::CompareRenderQueueSort(100000, 20);
+		Benchmarks::Print(r);
+		return r.identical;
+	}
+
+	bool RunSceneLoad()
+	{
+		Benchmarks::SceneLoadResult r = Benchmarks::MeasureSceneLoad(100000, 5);
+		Benchmarks::Print(r);
+		return r.roundTrip;
+	}
+
+	bool RunSpatialIndex()
+	{
+		Benchmarks::SpatialIndexResult r = Benchmarks::MeasureSpatialIndex(100000, 0.1f, 20);
+		Benchmarks::Print(r);
+		return r.identical;
+	}
+
+	// The entities need a real mesh, so this is the one benchmark that
+	// creates a (null driver) device, the same way the headless game does
+	bool RunEntityQueries()
+	{
+		if (!Graphics::Device && (FAILED(Window::CreateHeadless(64, 64)) || FAILED(Graphics::InitializeHeadless(64, 64))))
+		{
+			printf("Entity queries: no headless device\n");
+			return false;
+		}
+
+		std::shared_ptr<Mesh> cube = std::make_shared<Mesh>("Cube", FixPath("../../Assets/Models/cube.obj").c_str());
+		Benchmarks::EntityQueryResult r = Benchmarks::MeasureEntityQueries(cube, 100000, 0.1f, 20);
+		Benchmarks::Print(r);
+		return r.identical;
+	}
+
+	bool RunOcclusion()
+	{
+		Benchmarks::OcclusionResult r = Benchmarks::MeasureOcclusion(10000, 5);
+		Benchmarks::Print(r);
+		return r.identical && r.falseOcclusions == 0;
+	}
+
+	bool RunCommandRecording()
+	{
+		Benchmarks::CommandResult r = Benchmarks::MeasureCommandRecording(20000, 4, 10);
+		Benchmarks::Print(r);
+		return r.identical;
+	}
+
+	bool RunMeshletCheck()
+	{
+		Benchmarks::MeshletCheckResult r = Benchmarks::CheckMeshlets(96);
+		Benchmarks::Print(r);
+		return r.passed;
+	}
+
+	bool RunTimestepCheck()
+	{
+		Benchmarks::TimestepCheckResult r = Benchmarks::CheckFixedTimestep(216000);
+		Benchmarks::Print(r);
+		return r.passed;
+	}
+
+	bool RunBatcherCheck()
+	{
+		Benchmarks::BatcherCheckResult r = Benchmarks::CheckInstanceBatcher(5000);
+		Benchmarks::Print(r);
+		return r.passed;
+	}
+
+	// Everything "-bench" can run, by the name of the Benchmarks
+	// function behind it
+	struct NamedBenchmark
+	{
+		const char* name;
+		bool (*run)();
+	};
+
+	const NamedBenchmark namedBenchmarks[] =
+	{
+		{ "CompareObjLoaders", RunObjLoaders },
+		{ "CompareObjLoadersOnScan", RunObjLoadersOnScan },
+		{ "CompareTangents", RunTangents },
+		{ "MeasureRayThroughput", RunRayThroughput },
+		{ "MeasureTransformUpdates", RunTransformUpdates },
+		{ "MeasureHierarchyUpdates", RunHierarchyUpdates },
+		{ "CompareInverseTranspose", RunInverseTranspose },
+		{ "CompareEntityIteration", RunEntityIteration },
+		{ "CompareCulling", RunCulling },
+		{ "CompareRenderQueueSort", RunRenderQueueSort },
+		{ "MeasureSceneLoad", RunSceneLoad },
+		{ "MeasureSpatialIndex", RunSpatialIndex },
+		{ "MeasureEntityQueries", RunEntityQueries },
+		{ "MeasureOcclusion", RunOcclusion },
+		{ "MeasureCommandRecording", RunCommandRecording },
+		{ "CheckMeshlets", RunMeshletCheck },
+		{ "CheckFixedTimestep", RunTimestepCheck },
+		{ "CheckInstanceBatcher", RunBatcherCheck },
+	};
+
+	// Runs the named benchmark, or every one given "all"; returns
+	// 0 if everything run held up, 1 otherwise
+	int RunBenchmarks(const char* name)
+	{
+		bool all = strcmp(name, "all") == 0;
+		bool found = false;
+		bool passed = true;
+		for (const NamedBenchmark& benchmark : namedBenchmarks)
+		{
+			if (!all && strcmp(name, benchmark.name) != 0)
+				continue;
+
+			found = true;
+			if (!benchmark.run())
+			{
+				printf("  %s: FAILED\n", benchmark.name);
+				passed = false;
+			}
+		}
+
+		if (!found)
+		{
+			printf("Unknown benchmark \"%s\"; choose \"all\" or one of:\n", name);
+			for (const NamedBenchmark& benchmark : namedBenchmarks)
+				printf("  %s\n", benchmark.name);
+			return 1;
+		}
+		return passed ? 0 : 1;
+	}
+}
+
+int HeadlessMain(int argc, char* argv[])
+{
+	// Benchmarks need no window, and only MeasureEntityQueries a device
+	const char* benchmark = ReadTextOption(argc, argv, "-bench");
+	if (benchmark)
+		return RunBenchmarks(benchmark);
+
+	unsigned int frameCount = ReadOption(argc, argv, "-frames", 1000);
+	unsigned int width = ReadOption(argc, argv, "-width", 960);
+	unsigned int height = ReadOption(argc, argv, "-height", 540);
+
+	// A steady 60 FPS, so every run steps the simulation identically
+	const float deltaTime = 1.0f / 60.0f;
+
+	// Only the size of a window, and a device that renders nothing
+	// (the null driver, or WARP where that isn't installed)
+	HRESULT windowResult = Window::CreateHeadless(width, height);
+	if (FAILED(windowResult))
+		return windowResult;
+
+	HRESULT graphicsResult = Graphics::InitializeHeadless(width, height);
+	if (FAILED(graphicsResult))
+	{
+		printf("Headless graphics failed to initialize (0x%08lX)\n", (unsigned long)graphicsResult);
+		return graphicsResult;
+	}
+
+	// Input is never updated, so it reads as nothing held down
+	Input::Initialize(0);
+
+	Game* game = new Game();
+	double loadStart = NowMilliseconds();
+	if (!game->Initialize())
+	{
+		printf("Headless: the game failed to initialize\n");
+		delete game;
+		Input::ShutDown();
+		Graphics::ShutDown();
+		return E_FAIL;
+	}
+	double loadMilliseconds = NowMilliseconds() - loadStart;
+
+	Timing update;
+	Timing draw;
+	Timing frame;
+	float totalTime = 0.0f;
+	for (unsigned int i = 0; i < frameCount; i++)
+	{
+		totalTime += deltaTime;
+
+		double start = NowMilliseconds();
+		game->Update(deltaTime, totalTime);
+		double updated = NowMilliseconds();
+		game->Draw(deltaTime, totalTime);
+		double drawn = NowMilliseconds();
+
+		update.Add(updated - start, i == 0);
+		draw.Add(drawn - updated, i == 0);
+		frame.Add(drawn - start, i == 0);
+
+#if defined(DEBUG) || defined(_DEBUG)
+		// Print any graphics debug messages that occurred this frame
+		Graphics::PrintDebugMessages();
+#endif
+	}
+
+	// Timings
+	printf("Headless: %u frames at %ux%u, %.1f ms to load\n", frameCount, width, height, loadMilliseconds);
+	printf("  Update: %.3f ms average (%.3f - %.3f)\n", update.total / frameCount, update.fastest, update.slowest);
+	printf("  Draw:   %.3f ms average (%.3f - %.3f)\n", draw.total / frameCount, draw.fastest, draw.slowest);
+	printf("  Frame:  %.3f ms average (%.0f FPS on the CPU alone)\n", frame.total / frameCount, frame.total > 0 ? 1000.0 * frameCount / frame.total : 0.0);
+
+	// What the last frame asked of the graphics API
+	const RecordingBackend::Stats& stats = game->GetFrameStats();
+	printf("  Last frame: %u commands in %u passes, %u draws, %llu vertices, %llu instances\n",
+		stats.commandCount, stats.streamCount, stats.drawCount, stats.vertexCount, stats.instanceCount);
+	printf("  Last frame: %.1f KB of commands, %.1f KB of constants, %.1f KB of other uploads\n",
+		stats.streamBytes / 1024.0, stats.constantBytes / 1024.0, stats.uploadBytes / 1024.0);
+
+	// And what it's holding on to
+	Graphics::ResourceStats resources = Graphics::GetResourceStats();
+	printf("  Resources: %u buffers (%.1f MB), %u textures (%.1f MB), %u shaders; %u, %u and %u created in all\n",
+		resources.bufferCount, resources.bufferBytes / (1024.0 * 1024.0),
+		resources.textureCount, resources.textureBytes / (1024.0 * 1024.0),
+		resources.shaderCount,
+		resources.buffersCreated, resources.texturesCreated, resources.shadersCreated);
+
+	// Clean up
+	delete game;
+	Input::ShutDown();
+	Graphics::ShutDown();
+	return 0;
+}
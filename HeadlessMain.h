@@ -0,0 +1,18 @@
+#pragma once
+
+// --------------------------------------------------------
+// Runs the game with no window, no swap chain and no GPU
+// work - just its CPU side, frame after frame at a fixed
+// time step - then prints what each Update() and Draw()
+// cost and what they handed the graphics API.  The device
+// is the null driver, or WARP if that isn't installed.
+//
+// Options (anything else is ignored):
+//   -frames <count>   Frames to time (default 1000)
+//   -width <pixels>   Back buffer width (default 960)
+//   -height <pixels>  Back buffer height (default 540)
+//   -bench <name>     Instead, run one of the Benchmarks by
+//                     function name (or "all") and print its
+//                     results; returns 1 if any didn't hold up
+// --------------------------------------------------------
+int HeadlessMain(int argc, char* argv[]);
@@ -0,0 +1,60 @@
+#include "InstanceBatcher.h"
+
+#include <cstddef>
+
+// The instanced vertex shader reads these as float4s in this order,
+// with the UV offset as a lone float right after the tint and scale
+static_assert(offsetof(InstanceBatcher::InstanceData, colorTint) == 128, "Instance layout must match InstancedVS.hlsl");
+static_assert(offsetof(InstanceBatcher::InstanceData, uvOffset) == 144, "Instance layout must match InstancedVS.hlsl");
+static_assert(sizeof(InstanceBatcher::InstanceData) % 16 == 0, "Instance stride should stay 16-byte aligned");
+
+void InstanceBatcher::Clear()
+{
+	batchIndices.clear();
+	drawBatches.clear();
+	drawValues.clear();
+	batches.clear();
+	instanceValues.clear();
+}
+
+// Finds (or starts) the draw's batch and counts it there
+void InstanceBatcher::Add(const void* mesh, const void* material, int lod, unsigned int value)
+{
+	GroupKey key = { mesh, material, lod };
+	auto found = batchIndices.emplace(key, (unsigned int)batches.size());
+	if (found.second)
+		batches.push_back({ 0, 0 });
+
+	unsigned int batch = found.first->second;
+	batches[batch].instanceCount++;
+	drawBatches.push_back(batch);
+	drawValues.push_back(value);
+}
+
+// --------------------------------------------------------
+// A counting sort: the counts from Add() become each batch's
+// first instance, then every draw's value is dropped into the
+// next free slot of its batch
+// --------------------------------------------------------
+void InstanceBatcher::Build()
+{
+	unsigned int offset = 0;
+	for (Batch& batch : batches)
+	{
+		batch.firstInstance = offset;
+		offset += batch.instanceCount;
+	}
+
+	instanceValues.resize(drawValues.size());
+	batchCursors.resize(batches.size());
+	for (size_t b = 0; b < batches.size(); b++)
+		batchCursors[b] = batches[b].firstInstance;
+	for (size_t i = 0; i < drawValues.size(); i++)
+		instanceValues[batchCursors[drawBatches[i]]++] = drawValues[i];
+}
+
+// Getters
+
+unsigned int InstanceBatcher::GetBatchCount() { return (unsigned int)batches.size(); }
+const InstanceBatcher::Batch& InstanceBatcher::GetBatch(unsigned int index) { return batches[index]; }
+const std::vector<unsigned int>& InstanceBatcher::GetInstanceValues() { return instanceValues; }
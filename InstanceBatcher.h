@@ -0,0 +1,97 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// --------------------------------------------------------
+// Gathers a frame's draws into instanced batches: every draw
+// of the same mesh, material and level of detail becomes one
+// instance of a single DrawIndexedInstanced call.
+//
+// Draws are added in submission order (normally the sorted
+// render queue's), and Build() lays their values out batch by
+// batch.  Batches come out in the order their first draw was
+// added, and each keeps its draws' order, so anything sorted
+// front-to-back stays that way within a batch.
+//
+// Meshes and materials are only compared by address, so none
+// of this needs a graphics device.
+// --------------------------------------------------------
+class InstanceBatcher
+{
+public:
+
+	// Everything the instanced vertex shader reads per instance,
+	// laid out to match the "_PER_INSTANCE" inputs in InstancedVS.hlsl
+	struct InstanceData
+	{
+		DirectX::XMFLOAT4X4 world;
+		DirectX::XMFLOAT4X4 worldInvTranspose;
+		DirectX::XMFLOAT3 colorTint;	// Material tint times the entity's
+		float uvScale;
+		float uvOffset;
+		float padding[3];				// Keeps the stride a multiple of 16 bytes
+	};
+
+	// A run of instances drawn together
+	struct Batch
+	{
+		unsigned int firstInstance;
+		unsigned int instanceCount;
+	};
+
+private:
+
+	// What draws must share to be batched
+	struct GroupKey
+	{
+		const void* mesh;
+		const void* material;
+		int lod;
+
+		bool operator==(const GroupKey& other) const
+		{
+			return mesh == other.mesh && material == other.material && lod == other.lod;
+		}
+	};
+
+	struct GroupKeyHash
+	{
+		size_t operator()(const GroupKey& key) const
+		{
+			size_t h = std::hash<const void*>()(key.mesh);
+			h ^= std::hash<const void*>()(key.material) + 0x9E3779B9 + (h << 6) + (h >> 2);
+			h ^= std::hash<int>()(key.lod) + 0x9E3779B9 + (h << 6) + (h >> 2);
+			return h;
+		}
+	};
+
+	// Draws as added: which batch each belongs to, and its value
+	std::unordered_map<GroupKey, unsigned int, GroupKeyHash> batchIndices;
+	std::vector<unsigned int> drawBatches;
+	std::vector<unsigned int> drawValues;
+
+	// Results of Build()
+	std::vector<Batch> batches;
+	std::vector<unsigned int> instanceValues;
+	std::vector<unsigned int> batchCursors;	// Next free slot in each batch, while building
+
+public:
+
+	// Empties the batcher (keeping its memory)
+	void Clear();
+
+	// Adds one draw, whose value (normally an entity row) is handed
+	// back in instance order
+	void Add(const void* mesh, const void* material, int lod, unsigned int value);
+
+	// Groups everything added since Clear()
+	void Build();
+
+	// Getters, valid after Build()
+	unsigned int GetBatchCount();
+	const Batch& GetBatch(unsigned int index);
+	const std::vector<unsigned int>& GetInstanceValues();	// Every batch's values, back to back
+};
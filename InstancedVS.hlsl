@@ -0,0 +1,49 @@
+#include "ShaderIncludes.hlsli"
+
+// Constant buffer for data shared by every instance in a batch
+cbuffer ExternalData : register(b0)
+{
+    matrix view;
+    matrix projection;
+    matrix lightView;
+    matrix lightProjection;
+    float3 positionScale;
+    float3 positionOffset;
+}
+
+// --------------------------------------------------------
+// VertexShader.hlsl for instanced batches
+//
+// - World matrices, tint and UV scale/offset come from the
+//   instance buffer instead of the constant buffer
+// - The rows are packed the same way the C++ side stores its
+//   matrices, so rebuilding the matrix takes a transpose to
+//   match constant buffer matrices
+// - The UV scale/offset is applied here, so the pixel shader's
+//   own should be left at 1 and 0
+// --------------------------------------------------------
+VertexToPixel main(VertexShaderInput_Instanced input)
+{
+    VertexToPixel output;
+
+    matrix world = transpose(float4x4(input.world0, input.world1, input.world2, input.world3));
+    matrix worldInvTranspose = transpose(float4x4(
+        input.worldInvTranspose0, input.worldInvTranspose1, input.worldInvTranspose2, input.worldInvTranspose3));
+
+    float3 localPosition = DecodePosition(input.packedPosition, positionScale, positionOffset);
+    matrix wvp = mul(projection, mul(view, world));
+    output.screenPosition = mul(wvp, float4(localPosition, 1.0f));
+
+    // Calculate WVP for shadow map
+    matrix shadowWVP = mul(lightProjection, mul(lightView, world));
+    output.shadowMapPos = mul(shadowWVP, float4(localPosition, 1.0f));
+
+    // Send other vertex data through the pipeline
+    output.uv = DecodeUV(input.packedUV) * input.tintAndUVScale.w + input.uvOffset;
+    output.normal = mul((float3x3) worldInvTranspose, DecodeOctahedral(input.packedNormal));
+    output.tangent = mul((float3x3) world, DecodeOctahedral(input.packedTangent));
+    output.worldPosition = mul(world, float4(localPosition, 1)).xyz;
+    output.colorTint = input.tintAndUVScale.rgb;
+
+    return output;
+}
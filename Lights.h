@@ -6,6 +6,9 @@
 #define LIGHT_TYPE_POINT		1
 #define LIGHT_TYPE_SPOT			2
 
+// The size of the lights array in PixelShader.hlsl and SkyPixelShader.hlsl
+#define MAX_LIGHTS				5
+
 struct Light {
 	int Type;						// Which kind of light? 0, 1 or 2 (see above)
 	DirectX::XMFLOAT3 Direction;	// Directional and Spot lights need a direction
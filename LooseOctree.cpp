@@ -0,0 +1,459 @@
+#include "LooseOctree.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+// Anonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// How a node's bounds relate to a query shape
+	enum Overlap
+	{
+		Outside,
+		Partial,
+		Inside		// Everything below the node matches without testing
+	};
+
+	// --------------------------------------------------------
+	// Query shapes.  Each tests a box both ways: as a node's
+	// bounds (where containing it lets a whole subtree through)
+	// and as an object (where overlapping is all that matters).
+	// --------------------------------------------------------
+	struct FrustumShape
+	{
+		XMFLOAT4 planes[6];
+
+		Overlap Test(XMFLOAT3 c, XMFLOAT3 e) const
+		{
+			Overlap result = Inside;
+			for (int i = 0; i < 6; i++)
+			{
+				const XMFLOAT4& p = planes[i];
+				float distance = c.x * p.x + c.y * p.y + c.z * p.z + p.w;
+				float reach = e.x * fabsf(p.x) + e.y * fabsf(p.y) + e.z * fabsf(p.z);
+				if (distance < -reach)
+					return Outside;
+				if (distance < reach)
+					result = Partial;
+			}
+			return result;
+		}
+	};
+
+	struct SphereShape
+	{
+		XMFLOAT3 center;
+		float radius;
+
+		Overlap Test(XMFLOAT3 c, XMFLOAT3 e) const
+		{
+			// Squared distances to the box's nearest and furthest points
+			float dx = fabsf(center.x - c.x), dy = fabsf(center.y - c.y), dz = fabsf(center.z - c.z);
+			float nx = std::max(dx - e.x, 0.0f), ny = std::max(dy - e.y, 0.0f), nz = std::max(dz - e.z, 0.0f);
+			float fx = dx + e.x, fy = dy + e.y, fz = dz + e.z;
+			float r2 = radius * radius;
+
+			if (nx * nx + ny * ny + nz * nz > r2)
+				return Outside;
+			return fx * fx + fy * fy + fz * fz <= r2 ? Inside : Partial;
+		}
+	};
+
+	struct BoxShape
+	{
+		XMFLOAT3 center;
+		XMFLOAT3 extents;
+
+		Overlap Test(XMFLOAT3 c, XMFLOAT3 e) const
+		{
+			float dx = fabsf(center.x - c.x), dy = fabsf(center.y - c.y), dz = fabsf(center.z - c.z);
+			if (dx > extents.x + e.x || dy > extents.y + e.y || dz > extents.z + e.z)
+				return Outside;
+			return dx + e.x <= extents.x && dy + e.y <= extents.y && dz + e.z <= extents.z ? Inside : Partial;
+		}
+	};
+
+	// Slab test; a ray never contains anything
+	struct RayShape
+	{
+		XMFLOAT3 origin;
+		XMFLOAT3 inverseDirection;
+		float maxDistance;
+
+		Overlap Test(XMFLOAT3 c, XMFLOAT3 e) const
+		{
+			float t1 = (c.x - e.x - origin.x) * inverseDirection.x, t2 = (c.x + e.x - origin.x) * inverseDirection.x;
+			float tMin = std::min(t1, t2), tMax = std::max(t1, t2);
+			t1 = (c.y - e.y - origin.y) * inverseDirection.y; t2 = (c.y + e.y - origin.y) * inverseDirection.y;
+			tMin = std::max(tMin, std::min(t1, t2)); tMax = std::min(tMax, std::max(t1, t2));
+			t1 = (c.z - e.z - origin.z) * inverseDirection.z; t2 = (c.z + e.z - origin.z) * inverseDirection.z;
+			tMin = std::max(tMin, std::min(t1, t2)); tMax = std::min(tMax, std::max(t1, t2));
+
+			return tMax >= std::max(tMin, 0.0f) && tMin <= maxDistance ? Partial : Outside;
+		}
+	};
+
+	float MaxComponent(XMFLOAT3 v)
+	{
+		return std::max(v.x, std::max(v.y, v.z));
+	}
+}
+
+LooseOctree::LooseOctree(XMFLOAT3 center, float halfSize, unsigned int maxDepth) :
+	maxDepth(maxDepth),
+	outsideFirst(None),
+	objectCount(0),
+	relinkCount(0)
+{
+	Node root = {};
+	root.center = center;
+	root.halfSize = halfSize;
+	root.parent = None;
+	std::fill(std::begin(root.children), std::end(root.children), None);
+	root.firstObject = None;
+	nodes.push_back(root);
+}
+
+// --------------------------------------------------------
+// The deepest existing node whose cell holds the box's center
+// and is at least as big as the box, so its loose bounds
+// (twice the cell) hold the whole box
+// --------------------------------------------------------
+unsigned int LooseOctree::FindNode(XMFLOAT3 center, XMFLOAT3 extents)
+{
+	if (!Fits(0, center, extents))
+		return OutsideNode;
+
+	unsigned int node = 0;
+	for (unsigned int child = GetChild(0, center, extents, false); child != None; child = GetChild(node, center, extents, false))
+		node = child;
+	return node;
+}
+
+// --------------------------------------------------------
+// The child of a node the box would go in, or None if it's
+// too big for one (or the node is as deep as they go).  A
+// missing child is created if asked for, or None otherwise.
+// --------------------------------------------------------
+unsigned int LooseOctree::GetChild(unsigned int node, XMFLOAT3 center, XMFLOAT3 extents, bool create)
+{
+	float childHalf = nodes[node].halfSize * 0.5f;
+	if (nodes[node].depth >= maxDepth || MaxComponent(extents) > childHalf)
+		return None;
+
+	XMFLOAT3 nodeCenter = nodes[node].center;
+	unsigned int octant =
+		(center.x >= nodeCenter.x ? 1 : 0) |
+		(center.y >= nodeCenter.y ? 2 : 0) |
+		(center.z >= nodeCenter.z ? 4 : 0);
+
+	unsigned int child = nodes[node].children[octant];
+	if (child != None || !create)
+		return child;
+
+	Node created = {};
+	created.center = XMFLOAT3(
+		nodeCenter.x + (octant & 1 ? childHalf : -childHalf),
+		nodeCenter.y + (octant & 2 ? childHalf : -childHalf),
+		nodeCenter.z + (octant & 4 ? childHalf : -childHalf));
+	created.halfSize = childHalf;
+	created.parent = node;
+	std::fill(std::begin(created.children), std::end(created.children), None);
+	created.firstObject = None;
+	created.depth = nodes[node].depth + 1;
+
+	if (!freeNodes.empty())
+	{
+		child = freeNodes.back();
+		freeNodes.pop_back();
+		nodes[child] = created;
+	}
+	else
+	{
+		child = (unsigned int)nodes.size();
+		nodes.push_back(created);
+	}
+	nodes[node].children[octant] = child;
+	return child;
+}
+
+// --------------------------------------------------------
+// Pushes every object small enough for a child down into it,
+// creating children as needed, then splits any child that's
+// ended up over the threshold itself
+// --------------------------------------------------------
+void LooseOctree::Split(unsigned int node)
+{
+	unsigned int id = nodes[node].firstObject;
+	while (id != None)
+	{
+		unsigned int next = nextObjects[id];
+		unsigned int child = GetChild(node, boxCenters[id], boxExtents[id], true);
+		if (child != None)
+		{
+			Unlink(id);
+			Link(id, child);
+		}
+		id = next;
+	}
+
+	for (int i = 0; i < 8; i++)
+	{
+		unsigned int child = nodes[node].children[i];
+		if (child != None && ShouldSplit(child))
+			Split(child);
+	}
+}
+
+// Is the node over the threshold, with room for children below it?
+bool LooseOctree::ShouldSplit(unsigned int node)
+{
+	return nodes[node].objectCount > SplitThreshold && nodes[node].depth < maxDepth;
+}
+
+// Is the box's center in the node's cell, and the box no bigger than it?
+bool LooseOctree::Fits(unsigned int node, XMFLOAT3 center, XMFLOAT3 extents)
+{
+	const Node& n = nodes[node];
+	return
+		fabsf(center.x - n.center.x) <= n.halfSize &&
+		fabsf(center.y - n.center.y) <= n.halfSize &&
+		fabsf(center.z - n.center.z) <= n.halfSize &&
+		MaxComponent(extents) <= n.halfSize;
+}
+
+// Adds an object to the front of a node's list and counts it up the tree
+void LooseOctree::Link(unsigned int id, unsigned int node)
+{
+	unsigned int& first = node == OutsideNode ? outsideFirst : nodes[node].firstObject;
+	nextObjects[id] = first;
+	previousObjects[id] = None;
+	if (first != None)
+		previousObjects[first] = id;
+	first = id;
+	objectNodes[id] = node;
+
+	if (node == OutsideNode)
+		return;
+
+	nodes[node].objectCount++;
+	for (unsigned int n = node; n != None; n = nodes[n].parent)
+		nodes[n].subtreeCount++;
+}
+
+// --------------------------------------------------------
+// Takes an object out of its node's list.  Any node left with
+// nothing in or below it is unlinked from its parent and kept
+// for reuse, working up the tree, so empty branches never
+// slow down queries.
+// --------------------------------------------------------
+void LooseOctree::Unlink(unsigned int id)
+{
+	unsigned int node = objectNodes[id];
+	unsigned int next = nextObjects[id];
+	unsigned int previous = previousObjects[id];
+	if (next != None)
+		previousObjects[next] = previous;
+	if (previous != None)
+		nextObjects[previous] = next;
+	else if (node == OutsideNode)
+		outsideFirst = next;
+	else
+		nodes[node].firstObject = next;
+	objectNodes[id] = None;
+
+	if (node == OutsideNode)
+		return;
+
+	nodes[node].objectCount--;
+	for (unsigned int n = node; n != None; n = nodes[n].parent)
+		nodes[n].subtreeCount--;
+
+	while (node != 0 && nodes[node].subtreeCount == 0)
+	{
+		unsigned int parent = nodes[node].parent;
+		std::replace(std::begin(nodes[parent].children), std::end(nodes[parent].children), node, None);
+		freeNodes.push_back(node);
+		node = parent;
+	}
+}
+
+// --------------------------------------------------------
+// Most moves stay inside the object's node: its center is
+// still in the cell, and there's still no child it would go
+// in.  Those only overwrite the bounds.  A node over the
+// threshold splits again whenever an object is filed in it,
+// and an object there that now fits a child is re-filed, so
+// a node that couldn't push anything down when it first went
+// over (its objects too big for its children) still splits
+// once they can go.
+// --------------------------------------------------------
+void LooseOctree::Update(unsigned int id, XMFLOAT3 center, XMFLOAT3 extents)
+{
+	if (id >= objectNodes.size())
+	{
+		boxCenters.resize(id + 1);
+		boxExtents.resize(id + 1);
+		objectNodes.resize(id + 1, None);
+		nextObjects.resize(id + 1, None);
+		previousObjects.resize(id + 1, None);
+	}
+
+	boxCenters[id] = center;
+	boxExtents[id] = extents;
+
+	unsigned int node = objectNodes[id];
+	if (node == OutsideNode && !Fits(0, center, extents))
+		return;
+	if (node != None && node != OutsideNode && Fits(node, center, extents) &&
+		GetChild(node, center, extents, ShouldSplit(node)) == None)
+		return;
+
+	if (node != None)
+	{
+		Unlink(id);
+		relinkCount++;
+	}
+	else
+	{
+		objectCount++;
+	}
+	node = FindNode(center, extents);
+	Link(id, node);
+	if (node != OutsideNode && ShouldSplit(node))
+		Split(node);
+}
+
+void LooseOctree::Remove(unsigned int id)
+{
+	if (!Contains(id))
+		return;
+
+	Unlink(id);
+	objectCount--;
+}
+
+bool LooseOctree::Contains(unsigned int id)
+{
+	return id < objectNodes.size() && objectNodes[id] != None;
+}
+
+// Empties the tree down to its root (keeping its memory)
+void LooseOctree::Clear()
+{
+	nodes.resize(1);
+	std::fill(std::begin(nodes[0].children), std::end(nodes[0].children), None);
+	nodes[0].firstObject = None;
+	nodes[0].objectCount = 0;
+	nodes[0].subtreeCount = 0;
+	freeNodes.clear();
+
+	std::fill(objectNodes.begin(), objectNodes.end(), None);
+	outsideFirst = None;
+	objectCount = 0;
+}
+
+// Every object in and below a node, untested
+void LooseOctree::AddSubtree(unsigned int node, std::vector<unsigned int>& ids)
+{
+	size_t base = stack.size();
+	stack.push_back(node);
+	while (stack.size() > base)
+	{
+		const Node& n = nodes[stack.back()];
+		stack.pop_back();
+
+		for (unsigned int id = n.firstObject; id != None; id = nextObjects[id])
+			ids.push_back(id);
+		for (unsigned int child : n.children)
+		{
+			if (child != None)
+				stack.push_back(child);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Walks down from the root through every node whose loose
+// bounds touch the shape, testing each object in them, and
+// takes whole subtrees at once where the shape contains a
+// node.  The outside list is always tested object by object.
+// --------------------------------------------------------
+template <typename Shape>
+unsigned int LooseOctree::Query(const Shape& shape, std::vector<unsigned int>& ids)
+{
+	size_t start = ids.size();
+
+	for (unsigned int id = outsideFirst; id != None; id = nextObjects[id])
+	{
+		if (shape.Test(boxCenters[id], boxExtents[id]) != Outside)
+			ids.push_back(id);
+	}
+
+	stack.clear();
+	if (nodes[0].subtreeCount > 0)
+		stack.push_back(0);
+
+	while (!stack.empty())
+	{
+		unsigned int node = stack.back();
+		stack.pop_back();
+
+		const Node& n = nodes[node];
+		float looseSize = n.halfSize * 2.0f;
+		Overlap overlap = shape.Test(n.center, XMFLOAT3(looseSize, looseSize, looseSize));
+		if (overlap == Outside)
+			continue;
+		if (overlap == Inside)
+		{
+			AddSubtree(node, ids);
+			continue;
+		}
+
+		for (unsigned int id = n.firstObject; id != None; id = nextObjects[id])
+		{
+			if (shape.Test(boxCenters[id], boxExtents[id]) != Outside)
+				ids.push_back(id);
+		}
+		for (unsigned int child : n.children)
+		{
+			if (child != None)
+				stack.push_back(child);
+		}
+	}
+
+	return (unsigned int)(ids.size() - start);
+}
+
+unsigned int LooseOctree::QueryFrustum(const XMFLOAT4 planes[6], std::vector<unsigned int>& ids)
+{
+	FrustumShape shape;
+	std::copy(planes, planes + 6, shape.planes);
+	return Query(shape, ids);
+}
+
+unsigned int LooseOctree::QuerySphere(XMFLOAT3 center, float radius, std::vector<unsigned int>& ids)
+{
+	return Query(SphereShape{ center, radius }, ids);
+}
+
+unsigned int LooseOctree::QueryBox(XMFLOAT3 center, XMFLOAT3 extents, std::vector<unsigned int>& ids)
+{
+	return Query(BoxShape{ center, extents }, ids);
+}
+
+// Zero direction components divide out to infinities, which the slab test handles
+unsigned int LooseOctree::QueryRay(XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, std::vector<unsigned int>& ids)
+{
+	RayShape shape = { origin, XMFLOAT3(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z), maxDistance };
+	return Query(shape, ids);
+}
+
+// Getters
+
+unsigned int LooseOctree::GetCount() { return objectCount; }
+unsigned int LooseOctree::GetNodeCount() { return (unsigned int)(nodes.size() - freeNodes.size()); }
+unsigned int LooseOctree::GetRelinkCount() { return relinkCount; }
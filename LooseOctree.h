@@ -0,0 +1,111 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Dynamic spatial index over axis-aligned boxes
+//
+// A loose octree: every node's bounds are twice the size of
+// its cell, so an object only has to have its center in a
+// cell (and be no bigger than it) to fit.  Each object lives
+// in the deepest existing node it fits, which makes updates
+// cheap: a box that moves within its cell just has its
+// bounds overwritten, and one that leaves is relinked along
+// a single path.  Nodes are only split once they hold more
+// than a handful of objects, and are recycled once empty, so
+// sparse regions stay shallow.
+//
+// Objects are named by small integer ids (normally entity
+// handle indices), and per-object data lives in flat arrays
+// indexed by id, with each node's objects chained through
+// them, so nothing allocates once the arrays have grown.
+// Objects outside the root cell (or bigger than it) are kept
+// on a separate list that every query tests directly.
+//
+// Queries append the ids of every object whose box overlaps
+// the query shape.  Nothing here needs a graphics device.
+// --------------------------------------------------------
+class LooseOctree
+{
+public:
+
+	// Marks an id that isn't in the tree, or a missing node
+	static constexpr unsigned int None = 0xFFFFFFFF;
+
+private:
+
+	struct Node
+	{
+		DirectX::XMFLOAT3 center;
+		float halfSize;				// Of the cell; the loose bounds are twice this
+		unsigned int parent;
+		unsigned int children[8];	// By octant: +X is bit 0, +Y bit 1, +Z bit 2
+		unsigned int firstObject;
+		unsigned int objectCount;	// Objects in this node
+		unsigned int subtreeCount;	// Objects in this node and everything below it
+		unsigned int depth;
+	};
+
+	// Objects not in any node's bounds live here
+	static constexpr unsigned int OutsideNode = 0xFFFFFFFE;
+
+	// Objects a node holds before the ones small enough for its
+	// children are pushed down into them
+	static constexpr unsigned int SplitThreshold = 16;
+
+	// Nodes, with the root at index 0.  Emptied nodes are unlinked
+	// and recycled rather than erased.
+	std::vector<Node> nodes;
+	std::vector<unsigned int> freeNodes;
+	unsigned int maxDepth;
+
+	// Per-object data, by id
+	std::vector<DirectX::XMFLOAT3> boxCenters;
+	std::vector<DirectX::XMFLOAT3> boxExtents;
+	std::vector<unsigned int> objectNodes;	// None when the id isn't in the tree
+	std::vector<unsigned int> nextObjects;
+	std::vector<unsigned int> previousObjects;
+
+	unsigned int outsideFirst;
+	unsigned int objectCount;
+	unsigned int relinkCount;
+
+	// Scratch stack for walking the tree
+	std::vector<unsigned int> stack;
+
+	// Helpers
+	unsigned int FindNode(DirectX::XMFLOAT3 center, DirectX::XMFLOAT3 extents);
+	bool Fits(unsigned int node, DirectX::XMFLOAT3 center, DirectX::XMFLOAT3 extents);
+	unsigned int GetChild(unsigned int node, DirectX::XMFLOAT3 center, DirectX::XMFLOAT3 extents, bool create);
+	bool ShouldSplit(unsigned int node);
+	void Split(unsigned int node);
+	void Link(unsigned int id, unsigned int node);
+	void Unlink(unsigned int id);
+	void AddSubtree(unsigned int node, std::vector<unsigned int>& ids);
+	template <typename Shape> unsigned int Query(const Shape& shape, std::vector<unsigned int>& ids);
+
+public:
+
+	// The root cell is a cube of "halfSize" around "center", split at
+	// most "maxDepth" times
+	LooseOctree(DirectX::XMFLOAT3 center = DirectX::XMFLOAT3(0, 0, 0), float halfSize = 1024.0f, unsigned int maxDepth = 10);
+
+	// Adds the object, or moves it if it's already in the tree
+	void Update(unsigned int id, DirectX::XMFLOAT3 center, DirectX::XMFLOAT3 extents);
+	void Remove(unsigned int id);
+	bool Contains(unsigned int id);
+	void Clear();
+
+	// Queries, each appending the ids of overlapping objects to "ids"
+	// (in no particular order) and returning how many were added
+	unsigned int QueryFrustum(const DirectX::XMFLOAT4 planes[6], std::vector<unsigned int>& ids);	// Inward-facing, normalized
+	unsigned int QuerySphere(DirectX::XMFLOAT3 center, float radius, std::vector<unsigned int>& ids);
+	unsigned int QueryBox(DirectX::XMFLOAT3 center, DirectX::XMFLOAT3 extents, std::vector<unsigned int>& ids);
+	unsigned int QueryRay(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, std::vector<unsigned int>& ids);
+
+	// Getters
+	unsigned int GetCount();			// Objects in the tree
+	unsigned int GetNodeCount();		// Nodes in use, including the root
+	unsigned int GetRelinkCount();		// Updates so far that moved an object to another node
+};
@@ -1,11 +1,14 @@
 
 #include <Windows.h>
 #include <crtdbg.h>
+#include <cstdio>
+#include <cstring>
 
 #include "Window.h"
 #include "Graphics.h"
 #include "Game.h"
 #include "Input.h"
+#include "HeadlessMain.h"
 
 // Annonymous namespace to hold variables
 // only accessible in this file
@@ -44,7 +47,32 @@ int WINAPI WinMain(
 	// Enable memory leak detection as a quick and dirty
 	// way of determining if we forgot to clean something up
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif
+
+	// "-headless" skips the window and the GPU entirely, timing
+	// the game's CPU side and printing the results instead, and
+	// "-bench <name>" runs one of the benchmarks on its own
+	// - Results go to the console we were started from, so they
+	//   outlive us (from cmd, "start /wait" keeps the prompt
+	//   from printing over them)
+	// - Otherwise a console of our own, which closes with us, so
+	//   it waits for Enter first
+	if (strstr(lpCmdLine, "-headless") || strstr(lpCmdLine, "-bench"))
+	{
+		bool ownConsole = !Window::AttachParentConsole();
+		if (ownConsole)
+			Window::CreateConsoleWindow(500, 120, 32, 120);
+
+		int result = HeadlessMain(__argc, __argv);
+		if (ownConsole)
+		{
+			printf("Press Enter to close\n");
+			getchar();
+		}
+		return result;
+	}
 
+#if defined(DEBUG) | defined(_DEBUG)
 	// Do we also want a console window?  Probably only in debug mode
 	Window::CreateConsoleWindow(500, 120, 32, 120);
 	printf("Console window created successfully.  Feel free to printf() here.\n");
@@ -84,7 +112,13 @@ int WINAPI WinMain(
 	Input::Initialize(Window::Handle());
 
 	// Now the game itself can be initialzied
-	game->Initialize();
+	if (!game->Initialize())
+	{
+		delete game;
+		Input::ShutDown();
+		Graphics::ShutDown();
+		return E_FAIL;
+	}
 
 	// Time tracking
 	LARGE_INTEGER perfFreq{};
@@ -0,0 +1,131 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Start with nothing mapped
+MappedFile::MappedFile() :
+	data(0),
+	size(0),
+#ifdef _WIN32
+	fileHandle(INVALID_HANDLE_VALUE),
+	mappingHandle(0)
+#else
+	fileDescriptor(-1)
+#endif
+{
+}
+
+// Release the mapping and file handles
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+// --------------------------------------------------------
+// Maps the entire file into memory as read-only.
+//
+// Returns false if the file could not be opened or mapped.
+// Empty files open successfully but have no data.
+// --------------------------------------------------------
+bool MappedFile::Open(const char* filename)
+{
+	// Only one mapping at a time
+	Close();
+
+#ifdef _WIN32
+	fileHandle = CreateFileA(
+		filename,
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		0,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+		0);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(fileHandle, &fileSize))
+	{
+		Close();
+		return false;
+	}
+
+	size = (size_t)fileSize.QuadPart;
+	if (size == 0)
+		return true;
+
+	mappingHandle = CreateFileMappingA(fileHandle, 0, PAGE_READONLY, 0, 0, 0);
+	if (!mappingHandle)
+	{
+		Close();
+		return false;
+	}
+
+	data = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+	fileDescriptor = open(filename, O_RDONLY);
+	if (fileDescriptor < 0)
+		return false;
+
+	struct stat fileInfo = {};
+	if (fstat(fileDescriptor, &fileInfo) != 0)
+	{
+		Close();
+		return false;
+	}
+
+	size = (size_t)fileInfo.st_size;
+	if (size == 0)
+		return true;
+
+	void* view = mmap(0, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	data = (view == MAP_FAILED) ? 0 : (const char*)view;
+#endif
+
+	if (!data)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+// Unmap the view and close the handles (safe to call more than once)
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mappingHandle) CloseHandle(mappingHandle);
+	if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+	mappingHandle = 0;
+	fileHandle = INVALID_HANDLE_VALUE;
+#else
+	if (data) munmap((void*)data, size);
+	if (fileDescriptor >= 0) close(fileDescriptor);
+	fileDescriptor = -1;
+#endif
+
+	data = 0;
+	size = 0;
+}
+
+// Getters
+bool MappedFile::IsOpen()
+{
+#ifdef _WIN32
+	return fileHandle != INVALID_HANDLE_VALUE;
+#else
+	return fileDescriptor >= 0;
+#endif
+}
+const char* MappedFile::GetData() { return data; }
+size_t MappedFile::GetSize() { return size; }
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+
+// --------------------------------------------------------
+// A read-only memory mapped file
+//
+// The OS pages the contents in on demand, so reading through
+// Data() avoids copying the whole file into our own buffers
+// --------------------------------------------------------
+class MappedFile
+{
+private:
+
+	// Mapped view of the file
+	const char* data;
+	size_t size;
+
+	// OS handles for the file and its mapping
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+
+public:
+
+	// Con/destructor
+	MappedFile();
+	~MappedFile();
+
+	// Mappings own OS handles, so they can't be copied
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Open/close the mapping
+	bool Open(const char* filename);
+	void Close();
+
+	// Getters
+	bool IsOpen();
+	const char* GetData();
+	size_t GetSize();
+};
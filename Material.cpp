@@ -1,4 +1,5 @@
 #include "Material.h"
+#include "ShaderCommands.h"
 
 using namespace DirectX;
 
@@ -20,8 +21,8 @@ XMFLOAT3 Material::GetColorTint() {	return colorTint; }
 float Material::GetRoughness() { return roughness; }
 float Material::GetUVScale() { return uvScale; }
 float Material::GetUVOffset() { return uvOffset; }
-std::shared_ptr<SimpleVertexShader> Material::GetVertexShader() { return vs; }
-std::shared_ptr<SimplePixelShader> Material::GetPixelShader() {	return ps; }
+SimpleVertexShader* Material::GetVertexShader() { return vs.get(); }
+SimplePixelShader* Material::GetPixelShader() {	return ps.get(); }
 
 // Setters
 void Material::SetColorTint(XMFLOAT3 tint) { colorTint = tint; }
@@ -41,8 +42,8 @@ void Material::AddSampler(std::string name, Microsoft::WRL::ComPtr<ID3D11Sampler
 	samplers.insert({ name, sampler });
 }
 
-void Material::BindTexturesAndSamplers()
+void Material::BindTexturesAndSamplers(CommandBuffer& commands)
 {
-	for (auto& t : textureSRVs) { ps->SetShaderResourceView(t.first.c_str(), t.second); }
-	for (auto& s : samplers) { ps->SetSamplerState(s.first.c_str(), s.second); }
+	for (auto& t : textureSRVs) { ShaderCommands::SetShaderResourceView(commands, ps.get(), CommandBuffer::StagePixel, t.first.c_str(), t.second.Get()); }
+	for (auto& s : samplers) { ShaderCommands::SetSamplerState(commands, ps.get(), CommandBuffer::StagePixel, s.first.c_str(), s.second.Get()); }
 }
@@ -5,6 +5,7 @@
 #include <unordered_map>
 
 #include "SimpleShader.h"
+#include "CommandBuffer.h"
 
 class Material
 {
@@ -36,8 +37,8 @@ public:
 	float GetRoughness();
 	float GetUVScale();
 	float GetUVOffset();
-	std::shared_ptr<SimpleVertexShader> GetVertexShader();
-	std::shared_ptr<SimplePixelShader> GetPixelShader();
+	SimpleVertexShader* GetVertexShader();
+	SimplePixelShader* GetPixelShader();
 
 	// Setters
 	void SetColorTint(DirectX::XMFLOAT3 tint);
@@ -51,6 +52,6 @@ public:
 	void AddTextureSRV(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
 	void AddSampler(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler);
 
-	void BindTexturesAndSamplers();
+	void BindTexturesAndSamplers(CommandBuffer& commands);
 };
 
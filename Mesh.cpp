@@ -1,9 +1,13 @@
 #include "Mesh.h"
 #include "Graphics.h"
 #include "Vertex.h"
+#include "MeshCache.h"
+#include "MeshProcessing.h"
+#include "ObjParser.h"
 
 #include <DirectXMath.h>
-#include <fstream>
+#include <stdio.h>
+#include <string>
 #include <vector>
 
 using namespace DirectX;
@@ -11,219 +15,89 @@ using namespace DirectX;
 Mesh::Mesh(const char* name, Vertex* vertArray, size_t numVertices, unsigned int* indexArray, size_t numIndices)
 {
 	// Calculate Tangent values before creating buffers
-	CalculateTangents(&vertArray[0], (int)numVertices, &indexArray[0], (int)numIndices);
-
-	// Create vertex and index buffers
-	CreateBuffers(vertArray, numVertices, indexArray, numIndices);	
+	MeshProcessing::CalculateTangents(vertArray, numVertices, indexArray, numIndices);
 
 	// Save the sizes of the arrays to local variables
 	this->numVertices = (unsigned int)numVertices;
 	this->numIndices = (unsigned int)numIndices;
 
 	this->name = name;
-}
 
-Mesh::Mesh(const char* name, const char* filename) :
-	name(name),
-	numVertices(0),
-	numIndices(0)
-{
-	// Load object using filename
+	// Data handed to us is already indexed, so nothing gets welded
+	weldStats = { (unsigned int)numVertices, (unsigned int)numVertices, 0.0 };
+	loadedFromCache = false;
 
-	// Author: Chris Cascioli
-	// Purpose: Basic .OBJ 3D model loading, supporting positions, uvs and normals
+	// Hand-built meshes are drawn in the order given
+	cacheStatsBefore = MeshProcessing::AnalyzeVertexCache(indexArray, numIndices, numVertices);
+	cacheStatsAfter = cacheStatsBefore;
 
-	// File input object
-	std::ifstream obj(filename);
+	// Only the full detail level
+	lods.push_back({ 0, (unsigned int)numIndices, 0.0f });
 
-	// Check for successful open
-	if (!obj.is_open())
-		return;
+	// Compress and create vertex and index buffers
+	std::vector<PackedVertex> packed;
+	std::vector<unsigned short> shortIndices;
+	PackForGPU(vertArray, indexArray, packed, shortIndices);
+	CreateBuffers(packed.data(), numVertices, GetIndexData(indexArray, shortIndices), numIndices);
+}
 
-	// Variables used while reading the file
-	std::vector<XMFLOAT3> positions;	// Positions from the file
-	std::vector<XMFLOAT3> normals;		// Normals from the file
-	std::vector<XMFLOAT2> uvs;		// UVs from the file
-	std::vector<Vertex> verts;		// Verts we're assembling
-	std::vector<UINT> indices;		// Indices of these verts
-	int vertCounter = 0;			// Count of vertices
-	int indexCounter = 0;			// Count of indices
-	char chars[100];			// String for line reading
+Mesh::Mesh(const char* name, const char* filename, bool buildBVH) :
+	name(name),
+	numVertices(0),
+	numIndices(0),
+	indexFormat(DXGI_FORMAT_R32_UINT),
+	weldStats(),
+	loadedFromCache(false),
+	cacheStatsBefore(),
+	cacheStatsAfter(),
+	packingError(),
+	boundsMin(0, 0, 0),
+	boundsMax(0, 0, 0),
+	lods(1, MeshProcessing::LodLevel{ 0, 0, 0.0f }),
+	positionScale(0, 0, 0),
+	positionOffset(0, 0, 0)
+{
+	// Processed data is cached next to the source file
+	std::string cachePath = std::string(filename) + ".meshcache";
 
-	// Still have data left?
-	while (obj.good())
+	// Use the cache if it's still current, handing the mapped
+	// blocks straight to the GPU without any copies
 	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
-
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 norm;
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-
-			// Add to the list of normals
-			normals.push_back(norm);
-		}
-		else if (chars[0] == 'v' && chars[1] == 't')
-		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			XMFLOAT2 uv;
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-
-			// Add to the list of uv's
-			uvs.push_back(uv);
-		}
-		else if (chars[0] == 'v')
+		MappedFile cacheFile;
+		const MeshCache::Header* header = MeshCache::Open(cachePath.c_str(), filename, cacheFile);
+		if (header)
 		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 pos;
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-
-			// Add to the positions
-			positions.push_back(pos);
-		}
-		else if (chars[0] == 'f')
-		{
-			// Read the face indices into an array
-			// NOTE: This assumes the given obj file contains
-			//  vertex positions, uv coordinates AND normals.
-			unsigned int i[12];
-			int numbersRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-
-			// If we only got the first number, chances are the OBJ
-			// file has no UV coordinates.  This isn't great, but we
-			// still want to load the model without crashing, so we
-			// need to re-read a different pattern (in which we assume
-			// there are no UVs denoted for any of the vertices)
-			if (numbersRead == 1)
-			{
-				// Re-read with a different pattern
-				numbersRead = sscanf_s(
-					chars,
-					"f %d//%d %d//%d %d//%d %d//%d",
-					&i[0], &i[2],
-					&i[3], &i[5],
-					&i[6], &i[8],
-					&i[9], &i[11]);
-
-				// The following indices are where the UVs should 
-				// have been, so give them a valid value
-				i[1] = 1;
-				i[4] = 1;
-				i[7] = 1;
-				i[10] = 1;
-
-				// If we have no UVs, create a single UV coordinate
-				// that will be used for all vertices
-				if (uvs.size() == 0)
-					uvs.push_back(XMFLOAT2(0, 0));
-			}
-
-			// - Create the verts by looking up
-			//    corresponding data from vectors
-			// - OBJ File indices are 1-based, so
-			//    they need to be adusted
-			Vertex v1;
-			v1.Position = positions[i[0] - 1];
-			v1.UV = uvs[i[1] - 1];
-			v1.Normal = normals[i[2] - 1];
-
-			Vertex v2;
-			v2.Position = positions[i[3] - 1];
-			v2.UV = uvs[i[4] - 1];
-			v2.Normal = normals[i[5] - 1];
-
-			Vertex v3;
-			v3.Position = positions[i[6] - 1];
-			v3.UV = uvs[i[7] - 1];
-			v3.Normal = normals[i[8] - 1];
-
-			// The model is most likely in a right-handed space,
-			// especially if it came from Maya.  We want to convert
-			// to a left-handed space for DirectX.  This means we 
-			// need to:
-			//  - Invert the Z position
-			//  - Invert the normal's Z
-			//  - Flip the winding order
-			// We also need to flip the UV coordinate since DirectX
-			// defines (0,0) as the top left of the texture, and many
-			// 3D modeling packages use the bottom left as (0,0)
-
-			// Flip the UV's since they're probably "upside down"
-			v1.UV.y = 1.0f - v1.UV.y;
-			v2.UV.y = 1.0f - v2.UV.y;
-			v3.UV.y = 1.0f - v3.UV.y;
-
-			// Flip Z (LH vs. RH)
-			v1.Position.z *= -1.0f;
-			v2.Position.z *= -1.0f;
-			v3.Position.z *= -1.0f;
-
-			// Flip normal's Z
-			v1.Normal.z *= -1.0f;
-			v2.Normal.z *= -1.0f;
-			v3.Normal.z *= -1.0f;
-
-			// Add the verts to the vector (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v3);
-			verts.push_back(v2);
-			vertCounter += 3;
-
-			// Add three more indices
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-
-			// Was there a 4th face?
-			// - 12 numbers read means 4 faces WITH uv's
-			// - 8 numbers read means 4 faces WITHOUT uv's
-			if (numbersRead == 12 || numbersRead == 8)
-			{
-				// Make the last vertex
-				Vertex v4;
-				v4.Position = positions[i[9] - 1];
-				v4.UV = uvs[i[10] - 1];
-				v4.Normal = normals[i[11] - 1];
-
-				// Flip the UV, Z pos and normal's Z
-				v4.UV.y = 1.0f - v4.UV.y;
-				v4.Position.z *= -1.0f;
-				v4.Normal.z *= -1.0f;
-
-				// Add a whole triangle (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v4);
-				verts.push_back(v3);
-				vertCounter += 3;
-
-				// Add three more indices
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-			}
+			numVertices = header->VertexCount;
+			numIndices = header->IndexCount;
+			indexFormat = header->IndexStride == sizeof(unsigned short) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+			weldStats = { header->VerticesBeforeWeld, header->VertexCount, 0.0 };
+			boundsMin = header->BoundsMin;
+			boundsMax = header->BoundsMax;
+			BoundingBox::CreateFromPoints(boundingBox, XMLoadFloat3(&boundsMin), XMLoadFloat3(&boundsMax));
+			boundingSphere = BoundingSphere(header->SphereCenter, header->SphereRadius);
+			MeshProcessing::GetPositionDecode(boundsMin, boundsMax, positionScale, positionOffset);
+			cacheStatsBefore = header->CacheStatsBefore;
+			cacheStatsAfter = header->CacheStatsAfter;
+			packingError = header->PackingError;
+			meshlets.assign(MeshCache::GetMeshlets(header), MeshCache::GetMeshlets(header) + header->MeshletCount);
+			lods.assign(MeshCache::GetLods(header), MeshCache::GetLods(header) + header->LodCount);
+			loadedFromCache = true;
+
+			CreateBuffers(MeshCache::GetVertices(header), numVertices, MeshCache::GetIndices(header), numIndices);
+			if (buildBVH)
+				BuildBVH(MeshCache::GetVertices(header), MeshCache::GetIndices(header));
+			printf("Mesh '%s': loaded %u vertices from cache\n", name, numVertices);
+			return;
 		}
 	}
 
-	// Close the file and create the actual buffers
-	obj.close();
+	// Load object using filename
+	std::vector<Vertex> verts;		// Verts we're assembling
+	std::vector<unsigned int> indices;	// Indices of these verts
+
+	// Check for successful load
+	if (!ObjParser::Load(filename, verts, indices) || verts.empty())
+		return;
 
 	// - At this point, "verts" is a vector of Vertex structs, and can be used
 	//    directly to create a vertex buffer:  &verts[0] is the address of the first vert
@@ -231,24 +105,70 @@ Mesh::Mesh(const char* name, const char* filename) :
 	// - The vector "indices" is similar. It's a vector of unsigned ints and
 	//    can be used directly for the index buffer: &indices[0] is the address of the first int
 	//
-	// - "vertCounter" is the number of vertices
-	// - "indexCounter" is the number of indices
-	// - Yes, these are effectively the same since OBJs do not index entire vertices!  This means
-	//    an index buffer isn't doing much for us.  We could try to optimize the mesh ourselves
-	//    and detect duplicate vertices, but at that point it would be better to use a more
-	//    sophisticated model loading library like TinyOBJLoader or The Open Asset Importer Library
+	// - OBJs do not index entire vertices, so every face corner is its own vertex
+	//    at this point.  Weld identical corners together so the index buffer
+	//    actually shares vertices between neighboring triangles
+	weldStats = MeshProcessing::WeldVertices(verts, indices);
+	printf("Mesh '%s': welded %u vertices down to %u (%.3f ms)\n",
+		name,
+		weldStats.verticesBefore,
+		weldStats.verticesAfter,
+		weldStats.milliseconds);
+
+	// Reorder for the GPU: triangles for post-transform cache hits, then
+	// group them into meshlets (which are also ordered for less overdraw),
+	// then append the simplified LODs, then vertices for linear fetches
+	cacheStatsBefore = MeshProcessing::AnalyzeVertexCache(indices.data(), indices.size(), verts.size());
+	MeshProcessing::OptimizeVertexCache(indices, verts.size());
+	meshlets = MeshProcessing::BuildMeshlets(indices, verts);
+	lods = MeshProcessing::BuildLods(verts, indices);
+	MeshProcessing::OptimizeVertexFetch(verts, indices);
+	cacheStatsAfter = MeshProcessing::AnalyzeVertexCache(indices.data(), lods[0].indexCount, verts.size());
+	printf("Mesh '%s': ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %zu meshlets, %zu LODs\n",
+		name,
+		cacheStatsBefore.acmr,
+		cacheStatsAfter.acmr,
+		cacheStatsBefore.atvr,
+		cacheStatsAfter.atvr,
+		meshlets.size(),
+		lods.size());
 
 	// Store values
-	numVertices = vertCounter;
-	numIndices = indexCounter;
-
-	this->name = name;
+	numVertices = (unsigned int)verts.size();
+	numIndices = (unsigned int)indices.size();
 
 	// Calculate Tangent values before creating buffers
-	CalculateTangents(&verts[0], numVertices, &indices[0], numIndices);
+	// - Only from the full detail triangles, since the LODs reuse them
+	MeshProcessing::CalculateTangents(verts.data(), numVertices, indices.data(), lods[0].indexCount);
+
+	// Compress into the GPU formats
+	std::vector<PackedVertex> packed;
+	std::vector<unsigned short> shortIndices;
+	PackForGPU(verts.data(), indices.data(), packed, shortIndices);
+	const void* indexData = GetIndexData(indices.data(), shortIndices);
+
+	// Save the finished data so the next run can skip all of the above
+	MeshCache::Header header = {};
+	header.VerticesBeforeWeld = weldStats.verticesBefore;
+	header.BoundsMin = boundsMin;
+	header.BoundsMax = boundsMax;
+	header.SphereCenter = boundingSphere.Center;
+	header.SphereRadius = boundingSphere.Radius;
+	header.CacheStatsBefore = cacheStatsBefore;
+	header.CacheStatsAfter = cacheStatsAfter;
+	header.PackingError = packingError;
+	header.VertexCount = numVertices;
+	header.IndexCount = numIndices;
+	header.MeshletCount = (unsigned int)meshlets.size();
+	header.LodCount = (unsigned int)lods.size();
+	header.IndexStride = indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(unsigned short) : sizeof(unsigned int);
+	if (!MeshCache::Write(cachePath.c_str(), filename, header, packed.data(), indexData, meshlets.data(), lods.data()))
+		printf("Mesh '%s': unable to write cache file\n", name);
 
 	// Create vertex and index buffers using new object data
-	CreateBuffers(&verts[0], numVertices, &indices[0], numIndices);
+	CreateBuffers(packed.data(), numVertices, indexData, numIndices);
+	if (buildBVH)
+		BuildBVH(packed.data(), indexData);
 }
 
 // Nothing to delete yet since everything is using ComPtr and SmartPtr
@@ -257,7 +177,54 @@ Mesh::~Mesh()
 
 }
 
-void Mesh::CreateBuffers(Vertex* vertArray, size_t numVertices, unsigned int* indexArray, size_t numIndices)
+// --------------------------------------------------------
+// Compresses processed vertices and picks the index format.
+// - Positions are quantized to the mesh bounds, so those are
+//   calculated here along with the shader's decode values and
+//   the bounding box and sphere (Ritter's algorithm)
+// - Meshes under 65,536 vertices get 16-bit indices, written
+//   to "shortIndices" (see GetIndexData)
+// - The packed data is decoded again on the CPU to report
+//   the worst-case error of the compression
+// --------------------------------------------------------
+void Mesh::PackForGPU(const Vertex* verts, const unsigned int* indices, std::vector<PackedVertex>& packed, std::vector<unsigned short>& shortIndices)
+{
+	MeshProcessing::CalculateBounds(verts, numVertices, boundsMin, boundsMax);
+	BoundingBox::CreateFromPoints(boundingBox, XMLoadFloat3(&boundsMin), XMLoadFloat3(&boundsMax));
+	BoundingSphere::CreateFromPoints(boundingSphere, numVertices, &verts[0].Position, sizeof(Vertex));
+	MeshProcessing::GetPositionDecode(boundsMin, boundsMax, positionScale, positionOffset);
+	MeshProcessing::PackVertices(verts, numVertices, boundsMin, boundsMax, packed);
+
+	// Round trip accuracy check
+	packingError = MeshProcessing::MeasurePackingError(verts, packed.data(), numVertices, positionScale, positionOffset);
+	printf("Mesh '%s': packed vertex error - position %.6f, uv %.6f, normal %.4f deg, tangent %.4f deg\n",
+		name,
+		packingError.position,
+		packingError.uv,
+		packingError.normalDegrees,
+		packingError.tangentDegrees);
+
+	// Narrow the indices when every vertex fits in 16 bits
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	shortIndices.clear();
+	if (numVertices < 65536)
+	{
+		indexFormat = DXGI_FORMAT_R16_UINT;
+		shortIndices.resize(numIndices);
+		for (unsigned int i = 0; i < numIndices; i++)
+			shortIndices[i] = (unsigned short)indices[i];
+	}
+}
+
+// The index data matching indexFormat after PackForGPU
+const void* Mesh::GetIndexData(const unsigned int* indices, const std::vector<unsigned short>& shortIndices)
+{
+	if (indexFormat == DXGI_FORMAT_R16_UINT)
+		return shortIndices.data();
+	return indices;
+}
+
+void Mesh::CreateBuffers(const PackedVertex* vertArray, size_t numVertices, const void* indexArray, size_t numIndices)
 {
 	// Create a VERTEX BUFFER
 	// - This holds the vertex data of triangles for a single object
@@ -269,7 +236,7 @@ void Mesh::CreateBuffers(Vertex* vertArray, size_t numVertices, unsigned int* in
 		//  - After the buffer is created, this description variable is unnecessary
 		D3D11_BUFFER_DESC vbd = {};
 		vbd.Usage = D3D11_USAGE_IMMUTABLE;	// Will NEVER change
-		vbd.ByteWidth = sizeof(Vertex) * (UINT)numVertices;       // Multiply by dynamic number of veritces
+		vbd.ByteWidth = sizeof(PackedVertex) * (UINT)numVertices;       // Multiply by dynamic number of veritces
 		vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER; // Tells Direct3D this is a vertex buffer
 		vbd.CPUAccessFlags = 0;	// Note: We cannot access the data from C++ (this is good)
 		vbd.MiscFlags = 0;
@@ -283,7 +250,7 @@ void Mesh::CreateBuffers(Vertex* vertArray, size_t numVertices, unsigned int* in
 
 		// Actually create the buffer on the GPU with the initial data
 		// - Once we do this, we'll NEVER CHANGE DATA IN THE BUFFER AGAIN
-		Graphics::Device->CreateBuffer(&vbd, &initialVertexData, vertexBuffer.GetAddressOf());
+		Graphics::CreateBuffer(&vbd, &initialVertexData, vertexBuffer.GetAddressOf());
 	}
 
 	// Create an INDEX BUFFER
@@ -293,11 +260,12 @@ void Mesh::CreateBuffers(Vertex* vertArray, size_t numVertices, unsigned int* in
 	//    be if we want the GPU to act on it (as in: draw it to the screen)
 	{
 		// Describe the buffer, as we did above, with two major differences
-		//  - Byte Width (3 unsigned integers vs. 3 whole vertices)
+		//  - Byte Width (3 16 or 32-bit integers vs. 3 whole vertices)
 		//  - Bind Flag (used as an index buffer instead of a vertex buffer) 
 		D3D11_BUFFER_DESC ibd = {};
 		ibd.Usage = D3D11_USAGE_IMMUTABLE;	// Will NEVER change
-		ibd.ByteWidth = sizeof(unsigned int) * (UINT)numIndices;	// Multiply by dynamic number of indices
+		UINT indexSize = indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(unsigned short) : sizeof(unsigned int);
+		ibd.ByteWidth = indexSize * (UINT)numIndices;	// Multiply by dynamic number of indices
 		ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;	// Tells Direct3D this is an index buffer
 		ibd.CPUAccessFlags = 0;	// Note: We cannot access the data from C++ (this is good)
 		ibd.MiscFlags = 0;
@@ -309,98 +277,33 @@ void Mesh::CreateBuffers(Vertex* vertArray, size_t numVertices, unsigned int* in
 
 		// Actually create the buffer with the initial data
 		// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
-		Graphics::Device->CreateBuffer(&ibd, &initialIndexData, indexBuffer.GetAddressOf());
+		Graphics::CreateBuffer(&ibd, &initialIndexData, indexBuffer.GetAddressOf());
 	}
 }
 
 // --------------------------------------------------------
-// Author: Chris Cascioli
-// Purpose: Calculates the tangents of the vertices in a mesh
-// 
-// - You are allowed to directly copy/paste this into your code base
-//   for assignments, given that you clearly cite that this is not
-//   code of your own design.
-//
-// - Code originally adapted from: http://www.terathon.com/code/tangent.html
-//   - Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
-//   - See listing 7.4 in section 7.5 (page 9 of the PDF)
-//
-// - Note: For this code to work, your Vertex format must
-//         contain an XMFLOAT3 called Tangent
-//
-// - Be sure to call this BEFORE creating your D3D vertex/index buffers
+// Keeps a CPU copy of the full detail triangles in a BVH, and
+// another as occluder geometry.  Positions are decoded from the
+// packed vertices, so rays hit (and occluders hide) exactly what
+// the GPU draws, and both load paths share this.
 // --------------------------------------------------------
-void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
+void Mesh::BuildBVH(const PackedVertex* vertArray, const void* indexArray)
 {
-	// Reset tangents
-	for (int i = 0; i < numVerts; i++)
-	{
-		verts[i].Tangent = XMFLOAT3(0, 0, 0);
-	}
+	std::vector<XMFLOAT3> positions(numVertices);
+	for (unsigned int i = 0; i < numVertices; i++)
+		positions[i] = MeshProcessing::UnpackVertex(vertArray[i], positionScale, positionOffset).Position;
 
-	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numIndices;)
+	std::vector<unsigned int> indices(lods[0].indexCount);
+	for (unsigned int i = 0; i < lods[0].indexCount; i++)
 	{
-		// Grab indices and vertices of first triangle
-		unsigned int i1 = indices[i++];
-		unsigned int i2 = indices[i++];
-		unsigned int i3 = indices[i++];
-		Vertex* v1 = &verts[i1];
-		Vertex* v2 = &verts[i2];
-		Vertex* v3 = &verts[i3];
-
-		// Calculate vectors relative to triangle positions
-		float x1 = v2->Position.x - v1->Position.x;
-		float y1 = v2->Position.y - v1->Position.y;
-		float z1 = v2->Position.z - v1->Position.z;
-
-		float x2 = v3->Position.x - v1->Position.x;
-		float y2 = v3->Position.y - v1->Position.y;
-		float z2 = v3->Position.z - v1->Position.z;
-
-		// Do the same for vectors relative to triangle uv's
-		float s1 = v2->UV.x - v1->UV.x;
-		float t1 = v2->UV.y - v1->UV.y;
-
-		float s2 = v3->UV.x - v1->UV.x;
-		float t2 = v3->UV.y - v1->UV.y;
-
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
-
-		float tx = (t2 * x1 - t1 * x2) * r;
-		float ty = (t2 * y1 - t1 * y2) * r;
-		float tz = (t2 * z1 - t1 * z2) * r;
-
-		// Adjust tangents of each vert of the triangle
-		v1->Tangent.x += tx;
-		v1->Tangent.y += ty;
-		v1->Tangent.z += tz;
-
-		v2->Tangent.x += tx;
-		v2->Tangent.y += ty;
-		v2->Tangent.z += tz;
-
-		v3->Tangent.x += tx;
-		v3->Tangent.y += ty;
-		v3->Tangent.z += tz;
+		indices[i] = indexFormat == DXGI_FORMAT_R16_UINT ?
+			((const unsigned short*)indexArray)[i] :
+			((const unsigned int*)indexArray)[i];
 	}
 
-	// Ensure all of the tangents are orthogonal to the normals
-	for (int i = 0; i < numVerts; i++)
-	{
-		// Grab the two vectors
-		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
-		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
-
-		// Use Gram-Schmidt orthonormalize to ensure
-		// the normal and tangent are exactly 90 degrees apart
-		tangent = XMVector3Normalize(
-			tangent - normal * XMVector3Dot(normal, tangent));
-
-		// Store the tangent
-		XMStoreFloat3(&verts[i].Tangent, tangent);
-	}
+	bvh = std::make_shared<MeshBVH>(positions.data(), indices.data(), indices.size());
+	occluderGeometry = MeshProcessing::BuildOccluderGeometry(positions.data(), indices.data(), indices.size());
+	printf("Mesh '%s': built BVH with %u nodes (%.3f ms)\n", name, bvh->GetNodeCount(), bvh->GetBuildMilliseconds());
 }
 
 // Buffer Accessors
@@ -430,18 +333,112 @@ const char* Mesh::GetName()
 	return name;
 }
 
-// Set the buffers and draw their data to the screen
-void Mesh::Draw()
+// Welding results from loading
+MeshProcessing::WeldStats Mesh::GetWeldStats()
+{
+	return weldStats;
+}
+
+bool Mesh::WasLoadedFromCache()
+{
+	return loadedFromCache;
+}
+
+// Vertex cache simulation results
+MeshProcessing::VertexCacheStats Mesh::GetCacheStatsBefore()
+{
+	return cacheStatsBefore;
+}
+
+MeshProcessing::VertexCacheStats Mesh::GetCacheStatsAfter()
+{
+	return cacheStatsAfter;
+}
+
+// Packed vertex accuracy from the round trip check
+MeshProcessing::PackingError Mesh::GetPackingError()
 {
-	// Set buffers in the input assembler (IA) stage
-		//  - Do this ONCE PER OBJECT, since each object may have different geometry
-		//  - For this demo, this step *could* simply be done once during Init()
-		//  - However, this needs to be done between EACH DrawIndexed() call
-		//     when drawing different geometry, so it's here as an example
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
-	Graphics::Context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
-	Graphics::Context->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	return packingError;
+}
+
+DXGI_FORMAT Mesh::GetIndexFormat()
+{
+	return indexFormat;
+}
+
+int Mesh::GetMeshletCount()
+{
+	return (int)meshlets.size();
+}
+
+// Levels of detail (always at least the full mesh)
+int Mesh::GetLodCount()
+{
+	return (int)lods.size();
+}
+
+MeshProcessing::LodLevel Mesh::GetLod(int lod)
+{
+	return lods[lod];
+}
+
+std::shared_ptr<MeshBVH> Mesh::GetBVH()
+{
+	return bvh;
+}
+
+const MeshProcessing::OccluderGeometry& Mesh::GetOccluderGeometry()
+{
+	return occluderGeometry;
+}
+
+// Shader values for decoding 16-bit positions
+DirectX::XMFLOAT3 Mesh::GetPositionScale()
+{
+	return positionScale;
+}
+
+DirectX::XMFLOAT3 Mesh::GetPositionOffset()
+{
+	return positionOffset;
+}
+
+// Object-space bounds
+DirectX::XMFLOAT3 Mesh::GetBoundsMin()
+{
+	return boundsMin;
+}
+
+DirectX::XMFLOAT3 Mesh::GetBoundsMax()
+{
+	return boundsMax;
+}
+
+DirectX::BoundingBox Mesh::GetBoundingBox()
+{
+	return boundingBox;
+}
+
+DirectX::BoundingSphere Mesh::GetBoundingSphere()
+{
+	return boundingSphere;
+}
+
+// Set buffers in the input assembler (IA) stage
+//  - Do this ONCE PER OBJECT, since each object may have different geometry
+//  - For this demo, this step *could* simply be done once during Init()
+//  - However, this needs to be done between EACH DrawIndexed() call
+//     when drawing different geometry, so it's here as an example
+void Mesh::SetBuffers(CommandBuffer& commands)
+{
+	commands.SetVertexBuffer(0, vertexBuffer.Get(), sizeof(PackedVertex));
+	commands.SetIndexBuffer(indexBuffer.Get(), indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(unsigned short) : sizeof(unsigned int));
+}
+
+// Set the buffers and draw the full detail level to the screen
+void Mesh::Draw(CommandBuffer& commands)
+{
+	SetBuffers(commands);
 
 	// Tell Direct3D to draw
 	//  - Begins the rendering pipeline on the GPU
@@ -449,8 +446,83 @@ void Mesh::Draw()
 	//  - This will use all currently set Direct3D resources (shaders, buffers, etc)
 	//  - DrawIndexed() uses the currently set INDEX BUFFER to look up corresponding
 	//     vertices in the currently set VERTEX BUFFER
-	Graphics::Context->DrawIndexed(
-		numIndices,		// The number of indices to use (we could draw a subset if we wanted)
+	commands.DrawIndexed(
+		lods[0].indexCount,		// The number of indices to use (the LODs after it are a subset of the buffer)
 		0,		// Offset to the first index we want to use
 		0);		// Offset to add to each index when looking up vertices
 }
+
+// --------------------------------------------------------
+// Culls meshlets on the CPU and only draws the survivors
+//
+// - The frustum planes come from world * view * projection,
+//   so the tests happen in object space with no per-meshlet
+//   transforms
+// - Backface (normal cone) culling needs the camera position
+//   in object space and is skipped for mirrored transforms,
+//   since those flip the winding order
+// - Meshlets only cover the full detail level, so coarser
+//   LODs are small enough to simply be drawn whole
+// - Pass false for setBuffers when this mesh's buffers are
+//   already bound (by SetBuffers() or the previous draw)
+// - "ranges" is scratch space for the surviving meshlets
+// - Returns how many meshlets were drawn
+// --------------------------------------------------------
+unsigned int Mesh::DrawVisible(CommandBuffer& commands, std::vector<MeshProcessing::DrawRange>& ranges, XMFLOAT4X4 world, XMFLOAT4X4 view, XMFLOAT4X4 projection, bool backfaceCulling, int lod, bool setBuffers)
+{
+	// Clamp to the levels this mesh actually has, drawing
+	// meshes without meshlets whole
+	lod = lod < 0 ? 0 : lod >= (int)lods.size() ? (int)lods.size() - 1 : lod;
+	if (lod > 0 || meshlets.empty())
+	{
+		if (setBuffers)
+			SetBuffers(commands);
+		commands.DrawIndexed(lods[lod].indexCount, lods[lod].indexStart);
+		return 0;
+	}
+
+	XMMATRIX worldMat = XMLoadFloat4x4(&world);
+	XMMATRIX worldView = XMMatrixMultiply(worldMat, XMLoadFloat4x4(&view));
+
+	XMFLOAT4X4 worldViewProjection;
+	XMStoreFloat4x4(&worldViewProjection, XMMatrixMultiply(worldView, XMLoadFloat4x4(&projection)));
+	XMFLOAT4 planes[6];
+	MeshProcessing::ExtractFrustumPlanes(worldViewProjection, planes);
+
+	// The camera sits at the view space origin
+	XMFLOAT3 localCamera(0, 0, 0);
+	bool coneCulling = backfaceCulling && XMVectorGetX(XMMatrixDeterminant(worldMat)) > 0.0f;
+	if (coneCulling)
+		XMStoreFloat3(&localCamera, XMVector3Transform(XMVectorZero(), XMMatrixInverse(0, worldView)));
+
+	unsigned int visible = MeshProcessing::CullMeshlets(
+		meshlets.data(),
+		meshlets.size(),
+		planes,
+		coneCulling ? &localCamera : 0,
+		ranges);
+	if (ranges.empty())
+		return 0;
+
+	if (setBuffers)
+		SetBuffers(commands);
+	for (const MeshProcessing::DrawRange& range : ranges)
+		commands.DrawIndexed(range.indexCount, range.indexStart);
+
+	return visible;
+}
+
+// --------------------------------------------------------
+// Draws one level of detail once per instance, reading
+// instances "firstInstance" onwards from whatever buffer is
+// bound to input slot 1.  There's no meshlet culling here,
+// since the meshlets would need testing against every
+// instance's transform.
+// --------------------------------------------------------
+void Mesh::DrawInstanced(CommandBuffer& commands, unsigned int instanceCount, unsigned int firstInstance, int lod, bool setBuffers)
+{
+	lod = lod < 0 ? 0 : lod >= (int)lods.size() ? (int)lods.size() - 1 : lod;
+	if (setBuffers)
+		SetBuffers(commands);
+	commands.DrawIndexedInstanced(lods[lod].indexCount, instanceCount, lods[lod].indexStart, 0, firstInstance);
+}
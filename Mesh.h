@@ -1,9 +1,16 @@
 #pragma once
 
 #include <d3d11.h>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <memory>
+#include <vector>
 #include <wrl/client.h>
 
 #include "Vertex.h"
+#include "CommandBuffer.h"
+#include "MeshBVH.h"
+#include "MeshProcessing.h"
 
 class Mesh 
 {
@@ -16,19 +23,50 @@ private:
 	// Buffer relevant fields
 	unsigned int numVertices;		// How many vertices are in the mesh's vertex buffer
 	unsigned int numIndices;			// How many indices are in the mesh's index buffer	
+	DXGI_FORMAT indexFormat;			// 16-bit for meshes under 65,536 vertices, otherwise 32-bit
 
 	// UI related fields
 	const char* name;
+	MeshProcessing::WeldStats weldStats;	// Vertex counts before/after welding
+	bool loadedFromCache;					// Whether the binary mesh cache was used
+	MeshProcessing::VertexCacheStats cacheStatsBefore;	// Index order as loaded
+	MeshProcessing::VertexCacheStats cacheStatsAfter;	// Index order after optimization
+	MeshProcessing::PackingError packingError;			// Worst round trip error of the packed vertices
+
+	// Object-space bounds of the vertex positions
+	DirectX::XMFLOAT3 boundsMin;
+	DirectX::XMFLOAT3 boundsMax;
+	DirectX::BoundingBox boundingBox;
+	DirectX::BoundingSphere boundingSphere;
+
+	// Clusters of the index buffer for culling
+	std::vector<MeshProcessing::Meshlet> meshlets;
+
+	// Levels of detail as ranges of the index buffer.  Level 0 is
+	// the full mesh (split into the meshlets above), followed by
+	// progressively simplified copies sharing the same vertices.
+	std::vector<MeshProcessing::LodLevel> lods;
+
+	// Optional CPU-side copy of the full detail triangles for ray queries,
+	// and the same triangles for drawing into the occlusion buffer
+	std::shared_ptr<MeshBVH> bvh;
+	MeshProcessing::OccluderGeometry occluderGeometry;
+
+	// Turns the 16-bit packed positions back into object space
+	DirectX::XMFLOAT3 positionScale;
+	DirectX::XMFLOAT3 positionOffset;
 
 	// Helper functions
-	void CreateBuffers(Vertex* vertArray, size_t numVertices, unsigned int* indexArray, size_t numIndices);
-	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+	void PackForGPU(const Vertex* verts, const unsigned int* indices, std::vector<PackedVertex>& packed, std::vector<unsigned short>& shortIndices);
+	const void* GetIndexData(const unsigned int* indices, const std::vector<unsigned short>& shortIndices);
+	void CreateBuffers(const PackedVertex* vertArray, size_t numVertices, const void* indexArray, size_t numIndices);
+	void BuildBVH(const PackedVertex* vertArray, const void* indexArray);
 
 public:
 
 	// Con/destructor
 	Mesh(const char* name, Vertex* vertArray, size_t numVertices, unsigned int* indexArray, size_t numIndices);
-	Mesh(const char* name, const char* filename);
+	Mesh(const char* name, const char* filename, bool buildBVH = false);
 	~Mesh();
 
 	// Access ComPtrs
@@ -38,12 +76,36 @@ public:
 	// Access Buffer Fields
 	int GetVertexCount();
 	int GetIndexCount();
+	DirectX::XMFLOAT3 GetBoundsMin();
+	DirectX::XMFLOAT3 GetBoundsMax();
+	DirectX::BoundingBox GetBoundingBox();
+	DirectX::BoundingSphere GetBoundingSphere();
+	DXGI_FORMAT GetIndexFormat();
+	int GetMeshletCount();
+	int GetLodCount();
+	MeshProcessing::LodLevel GetLod(int lod);
+	std::shared_ptr<MeshBVH> GetBVH();	// Null unless requested when loading
+	const MeshProcessing::OccluderGeometry& GetOccluderGeometry();	// Empty unless a BVH was requested
+
+	// Access shader decode values
+	DirectX::XMFLOAT3 GetPositionScale();
+	DirectX::XMFLOAT3 GetPositionOffset();
 
-	// Access UI Field
+	// Access UI Fields
 	const char* GetName();
+	MeshProcessing::WeldStats GetWeldStats();
+	bool WasLoadedFromCache();
+	MeshProcessing::VertexCacheStats GetCacheStatsBefore();
+	MeshProcessing::VertexCacheStats GetCacheStatsAfter();
+	MeshProcessing::PackingError GetPackingError();
 
-	// Draw
-	void Draw();
+	// Draw, recording into a command stream.  DrawVisible() keeps the
+	// meshlets that survive culling in "ranges", so each recording
+	// thread needs its own.
+	void SetBuffers(CommandBuffer& commands);
+	void Draw(CommandBuffer& commands);
+	unsigned int DrawVisible(CommandBuffer& commands, std::vector<MeshProcessing::DrawRange>& ranges, DirectX::XMFLOAT4X4 world, DirectX::XMFLOAT4X4 view, DirectX::XMFLOAT4X4 projection, bool backfaceCulling, int lod = 0, bool setBuffers = true);
+	void DrawInstanced(CommandBuffer& commands, unsigned int instanceCount, unsigned int firstInstance, int lod = 0, bool setBuffers = true);	// Instance data goes in input slot 1
 
 
 };
\ No newline at end of file
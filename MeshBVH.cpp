@@ -0,0 +1,410 @@
+#include "MeshBVH.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace DirectX;
+
+// Anonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// Centroids are sorted into this many buckets per axis when
+	// searching for the cheapest split
+	const int SahBins = 16;
+
+	// Past this depth nodes are split at their median instead, which
+	// bounds the tree's depth even when the SAH keeps peeling off a
+	// few triangles at a time
+	const unsigned int MaxSahDepth = 48;
+
+	// Enough stack for MaxSahDepth plus a median split tree of 2^32 triangles
+	const int MaxTraversalDepth = 96;
+
+	struct Bounds
+	{
+		XMFLOAT3 min;
+		XMFLOAT3 max;
+
+		void Reset()
+		{
+			min = XMFLOAT3(INFINITY, INFINITY, INFINITY);
+			max = XMFLOAT3(-INFINITY, -INFINITY, -INFINITY);
+		}
+
+		void Grow(const XMFLOAT3& p)
+		{
+			min = XMFLOAT3(fminf(min.x, p.x), fminf(min.y, p.y), fminf(min.z, p.z));
+			max = XMFLOAT3(fmaxf(max.x, p.x), fmaxf(max.y, p.y), fmaxf(max.z, p.z));
+		}
+
+		void Grow(const Bounds& b)
+		{
+			min = XMFLOAT3(fminf(min.x, b.min.x), fminf(min.y, b.min.y), fminf(min.z, b.min.z));
+			max = XMFLOAT3(fmaxf(max.x, b.max.x), fmaxf(max.y, b.max.y), fmaxf(max.z, b.max.z));
+		}
+
+		// Half the surface area, which is all the heuristic needs
+		float HalfArea() const
+		{
+			float dx = max.x - min.x, dy = max.y - min.y, dz = max.z - min.z;
+			if (dx < 0.0f || dy < 0.0f || dz < 0.0f)
+				return 0.0f;
+			return dx * dy + dy * dz + dz * dx;
+		}
+	};
+
+	float Axis(const XMFLOAT3& v, int axis)
+	{
+		return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+	}
+
+	// Largest and smallest of a vector's xyz components
+	float MaxComponent3(FXMVECTOR v)
+	{
+		return XMVectorGetX(XMVectorMax(XMVectorMax(v, XMVectorSplatY(v)), XMVectorSplatZ(v)));
+	}
+
+	float MinComponent3(FXMVECTOR v)
+	{
+		return XMVectorGetX(XMVectorMin(XMVectorMin(v, XMVectorSplatY(v)), XMVectorSplatZ(v)));
+	}
+}
+
+// --------------------------------------------------------
+// Builds the tree right away, timing the build for the UI
+// --------------------------------------------------------
+MeshBVH::MeshBVH(const XMFLOAT3* positions, const unsigned int* indices, size_t indexCount) :
+	triangleCount((unsigned int)(indexCount / 3)),
+	buildMilliseconds(0.0)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	Build(positions, indices, indexCount);
+	buildMilliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// --------------------------------------------------------
+// Top-down binned SAH build.
+//
+// - Each node's triangles are bucketed by centroid along every
+//   axis, and the split between buckets with the lowest
+//   area-weighted cost wins
+// - Nodes with MaxLeafTriangles or fewer become leaves; larger
+//   nodes whose centroids all coincide are split down the middle
+// - Very deep nodes fall back to median splits (see MaxSahDepth)
+// - Leaf triangles are copied into packets in tree order, so
+//   the original index list isn't needed afterwards
+// --------------------------------------------------------
+void MeshBVH::Build(const XMFLOAT3* positions, const unsigned int* indices, size_t indexCount)
+{
+	nodes.clear();
+	packets.clear();
+	if (triangleCount == 0)
+		return;
+
+	// Per-triangle bounds and centroids
+	std::vector<Bounds> triangleBounds(triangleCount);
+	std::vector<XMFLOAT3> centroids(triangleCount);
+	std::vector<unsigned int> order(triangleCount);
+	for (unsigned int t = 0; t < triangleCount; t++)
+	{
+		triangleBounds[t].Reset();
+		for (int c = 0; c < 3; c++)
+			triangleBounds[t].Grow(positions[indices[t * 3 + c]]);
+
+		const Bounds& b = triangleBounds[t];
+		centroids[t] = XMFLOAT3((b.min.x + b.max.x) * 0.5f, (b.min.y + b.max.y) * 0.5f, (b.min.z + b.max.z) * 0.5f);
+		order[t] = t;
+	}
+
+	// A binary tree with single-triangle leaves has 2n - 1 nodes
+	nodes.reserve(triangleCount * 2);
+	nodes.push_back(Node{});
+
+	// Ranges of "order" still waiting to be split, with the node they belong to
+	struct Task { unsigned int node, start, end, depth; };
+	std::vector<Task> tasks;
+	tasks.push_back({ 0, 0, triangleCount, 0 });
+
+	while (!tasks.empty())
+	{
+		Task task = tasks.back();
+		tasks.pop_back();
+
+		Bounds bounds, centroidBounds;
+		bounds.Reset();
+		centroidBounds.Reset();
+		for (unsigned int i = task.start; i < task.end; i++)
+		{
+			bounds.Grow(triangleBounds[order[i]]);
+			centroidBounds.Grow(centroids[order[i]]);
+		}
+		nodes[task.node].boundsMin = bounds.min;
+		nodes[task.node].boundsMax = bounds.max;
+
+		unsigned int count = task.end - task.start;
+		if (count <= MaxLeafTriangles)
+		{
+			// Copy the triangles into a packet, leaving unused lanes degenerate
+			TrianglePacket packet = {};
+			for (unsigned int lane = 0; lane < MaxLeafTriangles; lane++)
+			{
+				packet.triangle[lane] = InvalidTriangle;
+				if (lane >= count)
+					continue;
+
+				unsigned int t = order[task.start + lane];
+				const XMFLOAT3& a = positions[indices[t * 3 + 0]];
+				const XMFLOAT3& b = positions[indices[t * 3 + 1]];
+				const XMFLOAT3& c = positions[indices[t * 3 + 2]];
+				packet.v0[0][lane] = a.x;
+				packet.v0[1][lane] = a.y;
+				packet.v0[2][lane] = a.z;
+				packet.e1[0][lane] = b.x - a.x;
+				packet.e1[1][lane] = b.y - a.y;
+				packet.e1[2][lane] = b.z - a.z;
+				packet.e2[0][lane] = c.x - a.x;
+				packet.e2[1][lane] = c.y - a.y;
+				packet.e2[2][lane] = c.z - a.z;
+				packet.triangle[lane] = t;
+			}
+
+			nodes[task.node].first = (unsigned int)packets.size();
+			nodes[task.node].count = count;
+			packets.push_back(packet);
+			continue;
+		}
+
+		// Find the cheapest bucket boundary over all three axes
+		int bestAxis = -1;
+		int bestSplit = 0;
+		float bestCost = INFINITY;
+		for (int axis = 0; axis < 3 && task.depth < MaxSahDepth; axis++)
+		{
+			float axisMin = Axis(centroidBounds.min, axis);
+			float extent = Axis(centroidBounds.max, axis) - axisMin;
+			if (extent <= 0.0f)
+				continue;
+
+			Bounds binBounds[SahBins];
+			unsigned int binCounts[SahBins] = {};
+			for (int b = 0; b < SahBins; b++)
+				binBounds[b].Reset();
+
+			float scale = SahBins / extent;
+			for (unsigned int i = task.start; i < task.end; i++)
+			{
+				int bin = std::min(SahBins - 1, (int)((Axis(centroids[order[i]], axis) - axisMin) * scale));
+				binBounds[bin].Grow(triangleBounds[order[i]]);
+				binCounts[bin]++;
+			}
+
+			// Sweep from the right to get the area and count of every right side
+			float rightArea[SahBins];
+			unsigned int rightCount[SahBins];
+			Bounds right;
+			right.Reset();
+			unsigned int rightTotal = 0;
+			for (int b = SahBins - 1; b > 0; b--)
+			{
+				right.Grow(binBounds[b]);
+				rightTotal += binCounts[b];
+				rightArea[b] = right.HalfArea();
+				rightCount[b] = rightTotal;
+			}
+
+			// Then from the left, costing each split by packets touched
+			Bounds left;
+			left.Reset();
+			unsigned int leftTotal = 0;
+			for (int b = 1; b < SahBins; b++)
+			{
+				left.Grow(binBounds[b - 1]);
+				leftTotal += binCounts[b - 1];
+				if (leftTotal == 0 || rightCount[b] == 0)
+					continue;
+
+				float leftPackets = (float)((leftTotal + MaxLeafTriangles - 1) / MaxLeafTriangles);
+				float rightPackets = (float)((rightCount[b] + MaxLeafTriangles - 1) / MaxLeafTriangles);
+				float cost = left.HalfArea() * leftPackets + rightArea[b] * rightPackets;
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = b;
+				}
+			}
+		}
+
+		// Partition around the chosen boundary, or at the median of the
+		// widest axis if the SAH was skipped or the centroids coincide
+		unsigned int middle = task.start + count / 2;
+		if (bestAxis < 0)
+		{
+			XMFLOAT3 extent(
+				centroidBounds.max.x - centroidBounds.min.x,
+				centroidBounds.max.y - centroidBounds.min.y,
+				centroidBounds.max.z - centroidBounds.min.z);
+			int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+			std::nth_element(&order[0] + task.start, &order[0] + middle, &order[0] + task.end, [&](unsigned int a, unsigned int b) {
+				return Axis(centroids[a], axis) < Axis(centroids[b], axis);
+			});
+		}
+		else
+		{
+			float axisMin = Axis(centroidBounds.min, bestAxis);
+			float scale = SahBins / (Axis(centroidBounds.max, bestAxis) - axisMin);
+			unsigned int* split = std::partition(&order[task.start], &order[0] + task.end, [&](unsigned int t) {
+				return std::min(SahBins - 1, (int)((Axis(centroids[t], bestAxis) - axisMin) * scale)) < bestSplit;
+			});
+			middle = (unsigned int)(split - &order[0]);
+		}
+
+		unsigned int left = (unsigned int)nodes.size();
+		nodes[task.node].first = left;
+		nodes[task.node].count = 0;
+		nodes.push_back(Node{});
+		nodes.push_back(Node{});
+		tasks.push_back({ left, task.start, middle, task.depth + 1 });
+		tasks.push_back({ left + 1, middle, task.end, task.depth + 1 });
+	}
+}
+
+// --------------------------------------------------------
+// Closest-hit traversal.
+//
+// - Boxes use the slab test with xyz in one SIMD register
+// - The nearer child is visited first and boxes further than
+//   the closest hit so far are skipped
+// - Leaves test all four packet lanes at once (Moller-Trumbore)
+// --------------------------------------------------------
+bool MeshBVH::Intersect(XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, RayHit& hit) const
+{
+	if (nodes.empty())
+		return false;
+
+	XMVECTOR rayOrigin = XMLoadFloat3(&origin);
+	XMVECTOR inverseDirection = XMVectorReciprocal(XMLoadFloat3(&direction));
+
+	// The ray splatted across lanes for the triangle tests
+	XMVECTOR ox = XMVectorReplicate(origin.x), oy = XMVectorReplicate(origin.y), oz = XMVectorReplicate(origin.z);
+	XMVECTOR dx = XMVectorReplicate(direction.x), dy = XMVectorReplicate(direction.y), dz = XMVectorReplicate(direction.z);
+	XMVECTOR zero = XMVectorZero();
+	XMVECTOR one = XMVectorSplatOne();
+	XMVECTOR epsilon = XMVectorReplicate(1e-12f);
+
+	float closest = maxDistance;
+	bool found = false;
+
+	// Entry distance of a node's box, or INFINITY if the ray misses it
+	auto enterBox = [&](const Node& node) {
+		XMVECTOR t0 = (XMLoadFloat3(&node.boundsMin) - rayOrigin) * inverseDirection;
+		XMVECTOR t1 = (XMLoadFloat3(&node.boundsMax) - rayOrigin) * inverseDirection;
+		float enter = MaxComponent3(XMVectorMin(t0, t1));
+		float exit = MinComponent3(XMVectorMax(t0, t1));
+		if (enter > exit || exit < 0.0f || enter >= closest)
+			return INFINITY;
+		return enter;
+	};
+
+	unsigned int stack[MaxTraversalDepth];
+	int stackSize = 0;
+	if (enterBox(nodes[0]) == INFINITY)
+		return false;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const Node& node = nodes[stack[--stackSize]];
+
+		if (node.count == 0)
+		{
+			// Push the further child first so the nearer one is popped next
+			float nearDistance = enterBox(nodes[node.first]);
+			float farDistance = enterBox(nodes[node.first + 1]);
+			unsigned int nearChild = node.first;
+			unsigned int farChild = node.first + 1;
+			if (farDistance < nearDistance)
+			{
+				std::swap(nearDistance, farDistance);
+				std::swap(nearChild, farChild);
+			}
+
+			if (farDistance != INFINITY)
+				stack[stackSize++] = farChild;
+			if (nearDistance != INFINITY)
+				stack[stackSize++] = nearChild;
+			continue;
+		}
+
+		// Boxes pushed earlier may be further than a hit found since
+		if (enterBox(node) == INFINITY)
+			continue;
+
+		const TrianglePacket& packet = packets[node.first];
+		XMVECTOR e1x = XMLoadFloat4((const XMFLOAT4*)packet.e1[0]);
+		XMVECTOR e1y = XMLoadFloat4((const XMFLOAT4*)packet.e1[1]);
+		XMVECTOR e1z = XMLoadFloat4((const XMFLOAT4*)packet.e1[2]);
+		XMVECTOR e2x = XMLoadFloat4((const XMFLOAT4*)packet.e2[0]);
+		XMVECTOR e2y = XMLoadFloat4((const XMFLOAT4*)packet.e2[1]);
+		XMVECTOR e2z = XMLoadFloat4((const XMFLOAT4*)packet.e2[2]);
+
+		// p = d x e2, det = e1 . p
+		XMVECTOR px = dy * e2z - dz * e2y;
+		XMVECTOR py = dz * e2x - dx * e2z;
+		XMVECTOR pz = dx * e2y - dy * e2x;
+		XMVECTOR det = e1x * px + e1y * py + e1z * pz;
+		XMVECTOR inverseDet = XMVectorReciprocal(det);
+
+		// s = o - v0, u = (s . p) / det
+		XMVECTOR sx = ox - XMLoadFloat4((const XMFLOAT4*)packet.v0[0]);
+		XMVECTOR sy = oy - XMLoadFloat4((const XMFLOAT4*)packet.v0[1]);
+		XMVECTOR sz = oz - XMLoadFloat4((const XMFLOAT4*)packet.v0[2]);
+		XMVECTOR u = (sx * px + sy * py + sz * pz) * inverseDet;
+
+		// q = s x e1, v = (d . q) / det, t = (e2 . q) / det
+		XMVECTOR qx = sy * e1z - sz * e1y;
+		XMVECTOR qy = sz * e1x - sx * e1z;
+		XMVECTOR qz = sx * e1y - sy * e1x;
+		XMVECTOR v = (dx * qx + dy * qy + dz * qz) * inverseDet;
+		XMVECTOR t = (e2x * qx + e2y * qy + e2z * qz) * inverseDet;
+
+		XMVECTOR valid = XMVectorGreater(XMVectorAbs(det), epsilon);
+		valid = XMVectorAndInt(valid, XMVectorGreaterOrEqual(u, zero));
+		valid = XMVectorAndInt(valid, XMVectorGreaterOrEqual(v, zero));
+		valid = XMVectorAndInt(valid, XMVectorLessOrEqual(u + v, one));
+		valid = XMVectorAndInt(valid, XMVectorGreater(t, zero));
+		valid = XMVectorAndInt(valid, XMVectorLess(t, XMVectorReplicate(closest)));
+
+		// Pick the nearest lane that passed
+		XMFLOAT4A ts, us, vs;
+		XMUINT4 mask;
+		XMStoreFloat4A(&ts, t);
+		XMStoreFloat4A(&us, u);
+		XMStoreFloat4A(&vs, v);
+		XMStoreUInt4(&mask, valid);
+		const float* tLanes = &ts.x;
+		const unsigned int* maskLanes = &mask.x;
+		for (unsigned int lane = 0; lane < node.count; lane++)
+		{
+			if (maskLanes[lane] && tLanes[lane] < closest)
+			{
+				closest = tLanes[lane];
+				hit.distance = closest;
+				hit.triangle = packet.triangle[lane];
+				hit.u = (&us.x)[lane];
+				hit.v = (&vs.x)[lane];
+				found = true;
+			}
+		}
+	}
+
+	return found;
+}
+
+// Getters
+unsigned int MeshBVH::GetNodeCount() const { return (unsigned int)nodes.size(); }
+unsigned int MeshBVH::GetTriangleCount() const { return triangleCount; }
+double MeshBVH::GetBuildMilliseconds() const { return buildMilliseconds; }
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Bounding volume hierarchy over a mesh's triangles, for
+// ray queries on the CPU (picking, baking, occlusion)
+//
+// Built with the surface area heuristic.  Each leaf holds up
+// to four triangles stored as one SIMD packet, so a leaf is
+// tested against a ray in a single pass.
+// --------------------------------------------------------
+class MeshBVH
+{
+public:
+
+	// Closest intersection found by a ray query
+	struct RayHit
+	{
+		float distance;			// Along the ray, in units of the direction's length
+		unsigned int triangle;	// Index of the triangle in the original index list
+		float u;				// Barycentric weights of the second and third corners
+		float v;
+	};
+
+	// Most triangles stored in one leaf (one per SIMD lane)
+	static const unsigned int MaxLeafTriangles = 4;
+
+private:
+
+	// 32-byte node: interior nodes point at two adjacent children,
+	// leaves point at their triangle packet
+	struct Node
+	{
+		DirectX::XMFLOAT3 boundsMin;
+		unsigned int first;			// Left child (right is first + 1), or packet index
+		DirectX::XMFLOAT3 boundsMax;
+		unsigned int count;			// Triangles in the leaf, 0 for interior nodes
+	};
+
+	// Four triangles in structure-of-arrays form, pre-arranged for
+	// Moller-Trumbore: a corner and the two edges leaving it
+	struct TrianglePacket
+	{
+		float v0[3][4];
+		float e1[3][4];
+		float e2[3][4];
+		unsigned int triangle[4];	// Original triangle index, InvalidTriangle for unused lanes
+	};
+
+	std::vector<Node> nodes;
+	std::vector<TrianglePacket> packets;
+	unsigned int triangleCount;
+	double buildMilliseconds;
+
+	// Helpers
+	void Build(const DirectX::XMFLOAT3* positions, const unsigned int* indices, size_t indexCount);
+
+public:
+
+	static const unsigned int InvalidTriangle = 0xFFFFFFFF;
+
+	// Builds the hierarchy over a triangle list (copied into the packets)
+	MeshBVH(const DirectX::XMFLOAT3* positions, const unsigned int* indices, size_t indexCount);
+
+	// Finds the closest triangle the ray hits before maxDistance (both sides
+	// of each triangle count).  The direction doesn't need to be normalized.
+	bool Intersect(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, RayHit& hit) const;
+
+	// Getters
+	unsigned int GetNodeCount() const;
+	unsigned int GetTriangleCount() const;
+	double GetBuildMilliseconds() const;
+};
@@ -0,0 +1,271 @@
+#include "MeshCache.h"
+
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+// Anonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// Blocks start on 16-byte boundaries
+	const uint64_t BlockAlignment = 16;
+
+	uint64_t AlignUp(uint64_t value)
+	{
+		return (value + BlockAlignment - 1) & ~(BlockAlignment - 1);
+	}
+
+	// Is the block of "count" records of "stride" bytes inside the file?
+	bool IsBlockInside(uint64_t offset, uint64_t count, uint64_t stride, uint64_t fileSize)
+	{
+		return offset <= fileSize && count * stride <= fileSize - offset;
+	}
+
+	// Does every index name one of the vertices?  Takes the largest
+	// first, which is a simple loop the compiler can vectorize.
+	template<typename T>
+	bool AreIndicesInRange(const T* indices, uint32_t indexCount, uint32_t vertexCount)
+	{
+		T largest = 0;
+		for (uint32_t i = 0; i < indexCount; i++)
+			largest = indices[i] > largest ? indices[i] : largest;
+		return indexCount == 0 || largest < vertexCount;
+	}
+
+	// Size and last write time of a file, or false if it doesn't exist
+	bool GetFileDetails(const char* path, uint64_t& size, uint64_t& timestamp)
+	{
+		std::error_code error;
+		std::filesystem::path p(path);
+
+		size = (uint64_t)std::filesystem::file_size(p, error);
+		if (error) return false;
+
+		timestamp = (uint64_t)std::filesystem::last_write_time(p, error).time_since_epoch().count();
+		return !error;
+	}
+
+	// 64-bit FNV-1a hash of a file's contents
+	uint64_t HashFile(const char* path)
+	{
+		uint64_t hash = 14695981039346656037ull;
+
+		MappedFile file;
+		if (!file.Open(path))
+			return hash;
+
+		const unsigned char* bytes = (const unsigned char*)file.GetData();
+		for (size_t i = 0; i < file.GetSize(); i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// --------------------------------------------------------
+	// Is the cache still a valid build of the source file?
+	//
+	// - Matching size and timestamp is trusted without reading the source
+	// - A changed timestamp (like a fresh checkout) with the same size
+	//   falls back to hashing the source contents, and if they match,
+	//   "staleTimestamp" is set to the source's current timestamp
+	// - A missing source leaves the cache as the only copy, so it's kept
+	// --------------------------------------------------------
+	bool IsCurrent(const MeshCache::Header* header, const char* sourcePath, uint64_t& staleTimestamp)
+	{
+		staleTimestamp = 0;
+
+		uint64_t size, timestamp;
+		if (!GetFileDetails(sourcePath, size, timestamp))
+			return true;
+
+		if (size != header->SourceSize)
+			return false;
+
+		if (timestamp == header->SourceTimestamp)
+			return true;
+
+		if (HashFile(sourcePath) != header->SourceHash)
+			return false;
+
+		staleTimestamp = timestamp;
+		return true;
+	}
+
+	// Overwrites just the source timestamp in a cache's header
+	bool WriteTimestamp(const char* cachePath, uint64_t timestamp)
+	{
+		std::fstream out(cachePath, std::ios::binary | std::ios::in | std::ios::out);
+		if (!out.is_open())
+			return false;
+
+		out.seekp(offsetof(MeshCache::Header, SourceTimestamp));
+		out.write((const char*)&timestamp, sizeof(timestamp));
+		return out.good();
+	}
+}
+
+// --------------------------------------------------------
+// Maps a cache file and validates its header, block ranges
+// and source details.  The returned header (and the blocks
+// behind it) live as long as the mapping stays open.
+// --------------------------------------------------------
+const MeshCache::Header* MeshCache::Open(const char* cachePath, const char* sourcePath, MappedFile& file)
+{
+	if (!file.Open(cachePath))
+		return 0;
+
+	// Check the header itself
+	size_t size = file.GetSize();
+	const Header* header = (const Header*)file.GetData();
+	bool valid =
+		size >= sizeof(Header) &&
+		memcmp(header->Magic, "MSHC", 4) == 0 &&
+		header->Version == Version &&
+		header->VertexStride == sizeof(PackedVertex) &&
+		(header->IndexStride == sizeof(unsigned short) || header->IndexStride == sizeof(unsigned int));
+
+	// Make sure the blocks are inside the file
+	valid = valid &&
+		IsBlockInside(header->VertexOffset, header->VertexCount, sizeof(PackedVertex), size) &&
+		IsBlockInside(header->IndexOffset, header->IndexCount, header->IndexStride, size) &&
+		IsBlockInside(header->MeshletOffset, header->MeshletCount, sizeof(MeshProcessing::Meshlet), size) &&
+		IsBlockInside(header->LodOffset, header->LodCount, sizeof(MeshProcessing::LodLevel), size) &&
+		header->LodCount >= 1 && header->LodCount <= MeshProcessing::MaxLodLevels;
+
+	// Every LOD must be a range of the index block
+	for (uint32_t i = 0; valid && i < header->LodCount; i++)
+	{
+		const MeshProcessing::LodLevel& lod = GetLods(header)[i];
+		valid = (uint64_t)lod.indexStart + lod.indexCount <= header->IndexCount;
+	}
+
+	// Every meshlet must be a range of the full detail LOD, since
+	// Mesh::DrawVisible() hands them straight to DrawIndexed()
+	for (uint32_t i = 0; valid && i < header->MeshletCount; i++)
+	{
+		const MeshProcessing::Meshlet& meshlet = GetMeshlets(header)[i];
+		const MeshProcessing::LodLevel& full = GetLods(header)[0];
+		valid =
+			meshlet.indexStart >= full.indexStart &&
+			(uint64_t)meshlet.indexStart + meshlet.indexCount <= (uint64_t)full.indexStart + full.indexCount;
+	}
+
+	// Every index must name a vertex, since the BVH and occluder
+	// geometry read positions through them on the CPU.  One pass
+	// over the block is cheap next to everything it saves.
+	if (valid)
+	{
+		valid = header->IndexStride == sizeof(unsigned short) ?
+			AreIndicesInRange((const unsigned short*)GetIndices(header), header->IndexCount, header->VertexCount) :
+			AreIndicesInRange((const unsigned int*)GetIndices(header), header->IndexCount, header->VertexCount);
+	}
+
+	uint64_t staleTimestamp = 0;
+	if (!valid || !IsCurrent(header, sourcePath, staleTimestamp))
+	{
+		file.Close();
+		return 0;
+	}
+
+	// The contents matched under a new timestamp, so store that one
+	// for the next run to trust without hashing.  The mapping can't
+	// be written through, so it's closed for the write and reopened.
+	if (staleTimestamp != 0)
+	{
+		file.Close();
+		WriteTimestamp(cachePath, staleTimestamp);
+		if (!file.Open(cachePath) || file.GetSize() != size)
+		{
+			file.Close();
+			return 0;
+		}
+		header = (const Header*)file.GetData();
+	}
+
+	return header;
+}
+
+// Block accessors
+const PackedVertex* MeshCache::GetVertices(const Header* header)
+{
+	return (const PackedVertex*)((const char*)header + header->VertexOffset);
+}
+
+const void* MeshCache::GetIndices(const Header* header)
+{
+	return (const char*)header + header->IndexOffset;
+}
+
+const MeshProcessing::Meshlet* MeshCache::GetMeshlets(const Header* header)
+{
+	return (const MeshProcessing::Meshlet*)((const char*)header + header->MeshletOffset);
+}
+
+const MeshProcessing::LodLevel* MeshCache::GetLods(const Header* header)
+{
+	return (const MeshProcessing::LodLevel*)((const char*)header + header->LodOffset);
+}
+
+// --------------------------------------------------------
+// Writes the header and data blocks to a temporary file, then
+// renames it over the cache so a partial write is never read
+// --------------------------------------------------------
+bool MeshCache::Write(
+	const char* cachePath,
+	const char* sourcePath,
+	Header header,
+	const PackedVertex* verts,
+	const void* indices,
+	const MeshProcessing::Meshlet* meshlets,
+	const MeshProcessing::LodLevel* lods)
+{
+	memcpy(header.Magic, "MSHC", 4);
+	header.Version = Version;
+	header.VertexStride = sizeof(PackedVertex);
+	header.Padding = 0;
+
+	// Snapshot the source so later runs can tell if it changed
+	GetFileDetails(sourcePath, header.SourceSize, header.SourceTimestamp);
+	header.SourceHash = HashFile(sourcePath);
+
+	// Lay out the blocks after the header
+	uint64_t vertexBytes = (uint64_t)sizeof(PackedVertex) * header.VertexCount;
+	uint64_t indexBytes = (uint64_t)header.IndexStride * header.IndexCount;
+	uint64_t meshletBytes = (uint64_t)sizeof(MeshProcessing::Meshlet) * header.MeshletCount;
+	uint64_t lodBytes = (uint64_t)sizeof(MeshProcessing::LodLevel) * header.LodCount;
+	header.VertexOffset = AlignUp(sizeof(Header));
+	header.IndexOffset = AlignUp(header.VertexOffset + vertexBytes);
+	header.MeshletOffset = AlignUp(header.IndexOffset + indexBytes);
+	header.LodOffset = AlignUp(header.MeshletOffset + meshletBytes);
+
+	std::string tempPath = std::string(cachePath) + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+			return false;
+
+		const char padding[BlockAlignment] = {};
+		out.write((const char*)&header, sizeof(Header));
+		out.write(padding, header.VertexOffset - sizeof(Header));
+		out.write((const char*)verts, vertexBytes);
+		out.write(padding, header.IndexOffset - (header.VertexOffset + vertexBytes));
+		out.write((const char*)indices, indexBytes);
+		out.write(padding, header.MeshletOffset - (header.IndexOffset + indexBytes));
+		out.write((const char*)meshlets, meshletBytes);
+		out.write(padding, header.LodOffset - (header.MeshletOffset + meshletBytes));
+		out.write((const char*)lods, lodBytes);
+
+		if (!out.good())
+			return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, cachePath, error);
+	return !error;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <stdint.h>
+
+#include "MappedFile.h"
+#include "MeshProcessing.h"
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Binary cache of fully processed mesh data
+//
+// Written the first time an OBJ is loaded, then memory mapped
+// on later runs so the vertex and index blocks can be handed
+// straight to the GPU without parsing or tangent generation
+// --------------------------------------------------------
+namespace MeshCache
+{
+	// Bump this whenever the layout or the processing that
+	// produces the cached data changes
+	const uint32_t Version = 6;
+
+	// Fixed-size header at the start of every cache file
+	struct Header
+	{
+		char Magic[4];					// Always "MSHC"
+		uint32_t Version;				// Must match MeshCache::Version
+		uint32_t VertexStride;			// Must match sizeof(PackedVertex)
+		uint32_t IndexStride;			// 2 or 4 bytes, matching the GPU index format
+		uint32_t VerticesBeforeWeld;	// Face corners in the source file
+		uint32_t Padding;
+
+		// Details of the source file this was built from
+		uint64_t SourceSize;
+		uint64_t SourceTimestamp;
+		uint64_t SourceHash;
+
+		// Axis-aligned bounds and bounding sphere of the vertex positions
+		DirectX::XMFLOAT3 BoundsMin;
+		DirectX::XMFLOAT3 BoundsMax;
+		DirectX::XMFLOAT3 SphereCenter;
+		float SphereRadius;
+
+		// Vertex cache efficiency before and after index optimization
+		MeshProcessing::VertexCacheStats CacheStatsBefore;
+		MeshProcessing::VertexCacheStats CacheStatsAfter;
+
+		// Round trip error of the packed vertices
+		MeshProcessing::PackingError PackingError;
+
+		// Data blocks, as byte offsets from the start of the file
+		uint32_t VertexCount;
+		uint32_t IndexCount;
+		uint32_t MeshletCount;
+		uint32_t LodCount;
+		uint64_t VertexOffset;
+		uint64_t IndexOffset;
+		uint64_t MeshletOffset;
+		uint64_t LodOffset;
+	};
+
+	// Maps the cache and checks it is current for the source file.
+	// Returns the header (pointing into the mapping), or null if
+	// the cache is missing, stale or malformed.
+	const Header* Open(const char* cachePath, const char* sourcePath, MappedFile& file);
+
+	// Access the data blocks of an opened cache
+	const PackedVertex* GetVertices(const Header* header);
+	const void* GetIndices(const Header* header);
+	const MeshProcessing::Meshlet* GetMeshlets(const Header* header);
+	const MeshProcessing::LodLevel* GetLods(const Header* header);
+
+	// Saves GPU-ready mesh data alongside a snapshot of the source file's details.
+	// The caller fills in the header's mesh details (counts, index stride,
+	// bounds and statistics) and the rest is filled in here.
+	bool Write(
+		const char* cachePath,
+		const char* sourcePath,
+		Header header,
+		const PackedVertex* verts,
+		const void* indices,
+		const MeshProcessing::Meshlet* meshlets,
+		const MeshProcessing::LodLevel* lods);
+}
@@ -0,0 +1,1762 @@
+#include "MeshProcessing.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <DirectXPackedVector.h>
+
+// Anonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// Welding only compares the attributes that come from the file.
+	// Position, UV and Normal sit next to each other at the front of
+	// the Vertex struct, while Tangent is calculated afterwards
+	const size_t WeldKeySize = offsetof(Vertex, Tangent);
+
+	// Marks an unused slot in the hash table
+	const unsigned int EmptySlot = 0xFFFFFFFF;
+
+	// Hash the raw bytes of a vertex's welding key (FNV-1a over 32-bit words)
+	uint32_t HashVertex(const Vertex& v)
+	{
+		uint32_t words[WeldKeySize / sizeof(uint32_t)];
+		memcpy(words, &v, WeldKeySize);
+
+		uint32_t hash = 2166136261u;
+		for (uint32_t w : words)
+		{
+			hash ^= w;
+			hash *= 16777619u;
+		}
+
+		// Fold the high bits down since the table is masked by its size
+		return hash ^ (hash >> 15);
+	}
+
+	// Forsyth's scoring parameters, from "Linear-Speed Vertex Cache Optimisation"
+	const int ForsythCacheSize = 32;
+	const float CacheDecayPower = 1.5f;
+	const float LastTriangleScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+	const unsigned int MaxScoredValence = 32;
+
+	// Meshes smaller than this are not worth splitting across more threads
+	const size_t MinTrianglesPerThread = 16 * 1024;
+
+	// Octahedral encoding: project the unit vector onto an octahedron,
+	// fold the lower half over the upper and store the two remaining
+	// components as 16-bit snorms
+	unsigned int EncodeOctahedral(DirectX::XMFLOAT3 n)
+	{
+		float sum = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+		if (sum == 0.0f)
+			return 0;
+
+		float x = n.x / sum;
+		float y = n.y / sum;
+		if (n.z < 0.0f)
+		{
+			float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = foldedX;
+			y = foldedY;
+		}
+
+		short qx = (short)lroundf(std::clamp(x, -1.0f, 1.0f) * 32767.0f);
+		short qy = (short)lroundf(std::clamp(y, -1.0f, 1.0f) * 32767.0f);
+		return (unsigned int)(unsigned short)qx | ((unsigned int)(unsigned short)qy << 16);
+	}
+
+	// Inverse of EncodeOctahedral, matching DecodeOctahedral in ShaderIncludes.hlsli
+	DirectX::XMFLOAT3 DecodeOctahedral(unsigned int packed)
+	{
+		float x = std::max((short)(packed & 0xFFFF) / 32767.0f, -1.0f);
+		float y = std::max((short)(packed >> 16) / 32767.0f, -1.0f);
+		float z = 1.0f - fabsf(x) - fabsf(y);
+
+		// Unfold the lower hemisphere
+		float t = std::max(-z, 0.0f);
+		x += x >= 0.0f ? -t : t;
+		y += y >= 0.0f ? -t : t;
+
+		float length = sqrtf(x * x + y * y + z * z);
+		return DirectX::XMFLOAT3(x / length, y / length, z / length);
+	}
+
+	// Angle between two vectors in degrees (0 if either is zero length)
+	float AngleDegrees(DirectX::XMFLOAT3 a, DirectX::XMFLOAT3 b)
+	{
+		float lengths = sqrtf((a.x * a.x + a.y * a.y + a.z * a.z) * (b.x * b.x + b.y * b.y + b.z * b.z));
+		if (lengths == 0.0f)
+			return 0.0f;
+
+		float cosine = std::clamp((a.x * b.x + a.y * b.y + a.z * b.z) / lengths, -1.0f, 1.0f);
+		return acosf(cosine) * (180.0f / DirectX::XM_PI);
+	}
+
+	// Symmetric 4x4 quadric (upper triangle) plus the total area
+	// of the planes that went into it
+	struct Quadric
+	{
+		double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+		double weight;
+
+		void AddPlane(double a, double b, double c, double d, double w)
+		{
+			a2 += w * a * a; ab += w * a * b; ac += w * a * c; ad += w * a * d;
+			b2 += w * b * b; bc += w * b * c; bd += w * b * d;
+			c2 += w * c * c; cd += w * c * d;
+			d2 += w * d * d;
+			weight += w;
+		}
+
+		void Add(const Quadric& q)
+		{
+			a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+			b2 += q.b2; bc += q.bc; bd += q.bd;
+			c2 += q.c2; cd += q.cd;
+			d2 += q.d2;
+			weight += q.weight;
+		}
+
+		// Weighted sum of squared distances from p to the planes
+		double Evaluate(const DirectX::XMFLOAT3& p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			double result =
+				a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x +
+				b2 * y * y + 2 * bc * y * z + 2 * bd * y +
+				c2 * z * z + 2 * cd * z +
+				d2;
+			return result > 0.0 ? result : 0.0;
+		}
+	};
+
+	// Unnormalized face normal of a triangle, whose length is twice its area
+	DirectX::XMFLOAT3 FaceNormal(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b, const DirectX::XMFLOAT3& c)
+	{
+		float e1[3] = { b.x - a.x, b.y - a.y, b.z - a.z };
+		float e2[3] = { c.x - a.x, c.y - a.y, c.z - a.z };
+		return DirectX::XMFLOAT3(
+			e1[1] * e2[2] - e1[2] * e2[1],
+			e1[2] * e2[0] - e1[0] * e2[2],
+			e1[0] * e2[1] - e1[1] * e2[0]);
+	}
+
+	// Score of a vertex given its place in the simulated LRU cache
+	// (-1 if not cached) and how many unemitted triangles still use it
+	float ForsythVertexScore(int cachePosition, unsigned int remainingTriangles)
+	{
+		// Nothing left to gain from this vertex
+		if (remainingTriangles == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			// The most recent triangle's vertices get a fixed score so the next
+			// triangle doesn't just reuse the same edge, then the score decays
+			if (cachePosition < 3)
+				score = LastTriangleScore;
+			else
+				score = powf(1.0f - (cachePosition - 3) * (1.0f / (ForsythCacheSize - 3)), CacheDecayPower);
+		}
+
+		// Boost vertices with few triangles left so they get finished off
+		// rather than leaving lone triangles stranded until the end
+		unsigned int valence = std::min(remainingTriangles, MaxScoredValence);
+		score += ValenceBoostScale * powf((float)valence, -ValenceBoostPower);
+		return score;
+	}
+
+	// --------------------------------------------------------
+	// Orders contiguous triangle clusters so the ones facing most
+	// outward from the mesh's center are drawn first.
+	// "clusterStarts" holds each cluster's first triangle plus a
+	// final entry for the total triangle count.
+	// --------------------------------------------------------
+	std::vector<unsigned int> SortClustersForOverdraw(const std::vector<unsigned int>& indices, const std::vector<Vertex>& verts, const std::vector<unsigned int>& clusterStarts)
+	{
+		size_t clusterCount = clusterStarts.size() - 1;
+
+		// Area-weighted centroid and normal of each cluster and of the whole mesh
+		std::vector<float> clusterData(clusterCount * 6, 0.0f);
+		float meshCentroid[3] = { 0, 0, 0 };
+		float meshArea = 0.0f;
+		for (size_t cl = 0; cl < clusterCount; cl++)
+		{
+			float* centroid = &clusterData[cl * 6];
+			float* normal = &clusterData[cl * 6 + 3];
+			float clusterArea = 0.0f;
+
+			for (unsigned int t = clusterStarts[cl]; t < clusterStarts[cl + 1]; t++)
+			{
+				const DirectX::XMFLOAT3& a = verts[indices[t * 3 + 0]].Position;
+				const DirectX::XMFLOAT3& b = verts[indices[t * 3 + 1]].Position;
+				const DirectX::XMFLOAT3& c = verts[indices[t * 3 + 2]].Position;
+
+				float e1[3] = { b.x - a.x, b.y - a.y, b.z - a.z };
+				float e2[3] = { c.x - a.x, c.y - a.y, c.z - a.z };
+				float n[3] = {
+					e1[1] * e2[2] - e1[2] * e2[1],
+					e1[2] * e2[0] - e1[0] * e2[2],
+					e1[0] * e2[1] - e1[1] * e2[0] };
+				float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+				centroid[0] += (a.x + b.x + c.x) * area;
+				centroid[1] += (a.y + b.y + c.y) * area;
+				centroid[2] += (a.z + b.z + c.z) * area;
+				normal[0] += n[0];
+				normal[1] += n[1];
+				normal[2] += n[2];
+				clusterArea += area;
+			}
+
+			for (int i = 0; i < 3; i++)
+				meshCentroid[i] += centroid[i];
+			meshArea += clusterArea;
+
+			float scale = clusterArea > 0.0f ? 1.0f / (clusterArea * 3.0f) : 0.0f;
+			for (int i = 0; i < 3; i++)
+				centroid[i] *= scale;
+		}
+
+		float meshScale = meshArea > 0.0f ? 1.0f / (meshArea * 3.0f) : 0.0f;
+		for (int i = 0; i < 3; i++)
+			meshCentroid[i] *= meshScale;
+
+		// Clusters that sit far out along their own normal are likely to cover others
+		std::vector<float> sortKeys(clusterCount);
+		std::vector<unsigned int> order(clusterCount);
+		for (size_t cl = 0; cl < clusterCount; cl++)
+		{
+			const float* centroid = &clusterData[cl * 6];
+			const float* normal = &clusterData[cl * 6 + 3];
+			float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			float inverseLength = length > 0.0f ? 1.0f / length : 0.0f;
+
+			sortKeys[cl] =
+				((centroid[0] - meshCentroid[0]) * normal[0] +
+				(centroid[1] - meshCentroid[1]) * normal[1] +
+				(centroid[2] - meshCentroid[2]) * normal[2]) * inverseLength;
+			order[cl] = (unsigned int)cl;
+		}
+
+		std::stable_sort(order.begin(), order.end(),
+			[&](unsigned int a, unsigned int b) { return sortKeys[a] > sortKeys[b]; });
+
+		return order;
+	}
+}
+
+// --------------------------------------------------------
+// Merges duplicate vertices using an open addressing hash table.
+//
+// - Vertices are compared bit-for-bit on their position, uv and normal,
+//   so only corners that truly came from the same OBJ data are merged
+// - Surviving vertices keep their first-seen order, and "indices"
+//   is rewritten in place to point at them
+// --------------------------------------------------------
+MeshProcessing::WeldStats MeshProcessing::WeldVertices(std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	WeldStats stats = {};
+	stats.verticesBefore = (unsigned int)verts.size();
+
+	// Table size is the next power of two with room to
+	// spare so probe sequences stay short
+	size_t tableSize = 1;
+	while (tableSize < verts.size() * 2)
+		tableSize <<= 1;
+	std::vector<unsigned int> table(tableSize, EmptySlot);
+	size_t mask = tableSize - 1;
+
+	// Maps each original vertex to its welded index
+	std::vector<unsigned int> remap(verts.size());
+	unsigned int uniqueCount = 0;
+
+	for (size_t i = 0; i < verts.size(); i++)
+	{
+		size_t slot = HashVertex(verts[i]) & mask;
+
+		// Linear probe until we find a match or an empty slot
+		while (true)
+		{
+			unsigned int existing = table[slot];
+			if (existing == EmptySlot)
+			{
+				// New unique vertex, compact it towards the front
+				table[slot] = uniqueCount;
+				verts[uniqueCount] = verts[i];
+				remap[i] = uniqueCount;
+				uniqueCount++;
+				break;
+			}
+
+			if (memcmp(&verts[existing], &verts[i], WeldKeySize) == 0)
+			{
+				remap[i] = existing;
+				break;
+			}
+
+			slot = (slot + 1) & mask;
+		}
+	}
+
+	// Drop the duplicates and point the indices at the survivors
+	verts.resize(uniqueCount);
+	for (unsigned int& index : indices)
+		index = remap[index];
+
+	stats.verticesAfter = uniqueCount;
+	stats.milliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::high_resolution_clock::now() - start).count();
+	return stats;
+}
+
+// --------------------------------------------------------
+// Finds the axis-aligned bounds of a set of vertex positions
+// --------------------------------------------------------
+void MeshProcessing::CalculateBounds(const Vertex* verts, size_t vertexCount, DirectX::XMFLOAT3& boundsMin, DirectX::XMFLOAT3& boundsMax)
+{
+	if (vertexCount == 0)
+	{
+		boundsMin = boundsMax = DirectX::XMFLOAT3(0, 0, 0);
+		return;
+	}
+
+	boundsMin = boundsMax = verts[0].Position;
+	for (size_t i = 1; i < vertexCount; i++)
+	{
+		const DirectX::XMFLOAT3& p = verts[i].Position;
+		if (p.x < boundsMin.x) boundsMin.x = p.x;
+		if (p.y < boundsMin.y) boundsMin.y = p.y;
+		if (p.z < boundsMin.z) boundsMin.z = p.z;
+		if (p.x > boundsMax.x) boundsMax.x = p.x;
+		if (p.y > boundsMax.y) boundsMax.y = p.y;
+		if (p.z > boundsMax.z) boundsMax.z = p.z;
+	}
+}
+
+// --------------------------------------------------------
+// Author: Chris Cascioli
+// Purpose: Calculates the tangents of the vertices in a mesh
+// 
+// - You are allowed to directly copy/paste this into your code base
+//   for assignments, given that you clearly cite that this is not
+//   code of your own design.
+//
+// - Code originally adapted from: http://www.terathon.com/code/tangent.html
+//   - Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
+//   - See listing 7.4 in section 7.5 (page 9 of the PDF)
+//
+// - Note: For this code to work, your Vertex format must
+//         contain an XMFLOAT3 called Tangent
+//
+// - Moved here from Mesh unchanged (apart from its signature),
+//   as the reference CalculateTangents() is checked against
+// --------------------------------------------------------
+void MeshProcessing::CalculateTangentsReference(Vertex* verts, size_t vertexCount, const unsigned int* indices, size_t indexCount)
+{
+	using namespace DirectX;
+
+	// Reset tangents
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		verts[i].Tangent = XMFLOAT3(0, 0, 0);
+	}
+
+	// Calculate tangents one whole triangle at a time
+	for (size_t i = 0; i + 2 < indexCount;)
+	{
+		// Grab indices and vertices of first triangle
+		unsigned int i1 = indices[i++];
+		unsigned int i2 = indices[i++];
+		unsigned int i3 = indices[i++];
+		Vertex* v1 = &verts[i1];
+		Vertex* v2 = &verts[i2];
+		Vertex* v3 = &verts[i3];
+
+		// Calculate vectors relative to triangle positions
+		float x1 = v2->Position.x - v1->Position.x;
+		float y1 = v2->Position.y - v1->Position.y;
+		float z1 = v2->Position.z - v1->Position.z;
+
+		float x2 = v3->Position.x - v1->Position.x;
+		float y2 = v3->Position.y - v1->Position.y;
+		float z2 = v3->Position.z - v1->Position.z;
+
+		// Do the same for vectors relative to triangle uv's
+		float s1 = v2->UV.x - v1->UV.x;
+		float t1 = v2->UV.y - v1->UV.y;
+
+		float s2 = v3->UV.x - v1->UV.x;
+		float t2 = v3->UV.y - v1->UV.y;
+
+		// Create vectors for tangent calculation
+		float r = 1.0f / (s1 * t2 - s2 * t1);
+
+		float tx = (t2 * x1 - t1 * x2) * r;
+		float ty = (t2 * y1 - t1 * y2) * r;
+		float tz = (t2 * z1 - t1 * z2) * r;
+
+		// Adjust tangents of each vert of the triangle
+		v1->Tangent.x += tx;
+		v1->Tangent.y += ty;
+		v1->Tangent.z += tz;
+
+		v2->Tangent.x += tx;
+		v2->Tangent.y += ty;
+		v2->Tangent.z += tz;
+
+		v3->Tangent.x += tx;
+		v3->Tangent.y += ty;
+		v3->Tangent.z += tz;
+	}
+
+	// Ensure all of the tangents are orthogonal to the normals
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		// Grab the two vectors
+		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
+		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
+
+		// Use Gram-Schmidt orthonormalize to ensure
+		// the normal and tangent are exactly 90 degrees apart
+		tangent = XMVector3Normalize(
+			tangent - normal * XMVector3Dot(normal, tangent));
+
+		// Store the tangent
+		XMStoreFloat3(&verts[i].Tangent, tangent);
+	}
+}
+
+// --------------------------------------------------------
+// Same math as CalculateTangentsReference, restructured for SIMD
+// and threads:
+//
+// 1. Triangles are gathered four at a time into structure-of-arrays
+//    lanes and their tangents stored in separate x/y/z arrays
+// 2. A vertex -> corner table (built in index order) lets each vertex
+//    sum its own triangles' tangents, so threads never share an
+//    accumulator and the additions happen in the reference's order
+// 3. Gram-Schmidt and normalization run four vertices at a time
+//
+// Angle weighting follows MikkTSpace's weighting: each triangle's
+// tangent is projected into the corner's normal plane, normalized and
+// weighted by the corner's angle, so dense fans don't dominate.
+// Degenerate triangles are skipped in that mode.
+// --------------------------------------------------------
+void MeshProcessing::CalculateTangents(
+	Vertex* verts,
+	size_t vertexCount,
+	const unsigned int* indices,
+	size_t indexCount,
+	TangentWeighting weighting,
+	unsigned int threadCount)
+{
+	using namespace DirectX;
+
+	size_t triangleCount = indexCount / 3;
+	if (vertexCount == 0)
+		return;
+
+	if (threadCount == 0)
+	{
+		size_t bySize = triangleCount / MinTrianglesPerThread + 1;
+		size_t cores = std::thread::hardware_concurrency();
+		threadCount = (unsigned int)(bySize < cores ? bySize : (cores > 0 ? cores : 1));
+	}
+
+	// Work is split into blocks of four, one lane each
+	size_t triangleBlocks = (triangleCount + 3) / 4;
+	size_t vertexBlocks = (vertexCount + 3) / 4;
+	bool angleWeighted = weighting == TangentWeighting::Angle;
+
+	// Per-triangle tangents (and corner angles) as separate arrays,
+	// padded to whole blocks
+	std::vector<float> faceX(triangleBlocks * 4);
+	std::vector<float> faceY(triangleBlocks * 4);
+	std::vector<float> faceZ(triangleBlocks * 4);
+	std::vector<float> cornerAngles(angleWeighted ? triangleBlocks * 12 : 0);
+
+	RunParallel(threadCount, [&](size_t thread)
+	{
+		size_t blockEnd = triangleBlocks * (thread + 1) / threadCount;
+		for (size_t block = triangleBlocks * thread / threadCount; block < blockEnd; block++)
+		{
+			// Gather positions and UVs of four triangles, repeating the
+			// last triangle to fill the final block
+			float lanes[3][5][4];
+			for (size_t lane = 0; lane < 4; lane++)
+			{
+				size_t t = block * 4 + lane;
+				if (t >= triangleCount)
+					t = triangleCount - 1;
+
+				for (int c = 0; c < 3; c++)
+				{
+					const Vertex& v = verts[indices[t * 3 + c]];
+					lanes[c][0][lane] = v.Position.x;
+					lanes[c][1][lane] = v.Position.y;
+					lanes[c][2][lane] = v.Position.z;
+					lanes[c][3][lane] = v.UV.x;
+					lanes[c][4][lane] = v.UV.y;
+				}
+			}
+
+			XMVECTOR p[3][3];
+			XMVECTOR uv[3][2];
+			for (int c = 0; c < 3; c++)
+			{
+				for (int axis = 0; axis < 3; axis++)
+					p[c][axis] = XMLoadFloat4((const XMFLOAT4*)lanes[c][axis]);
+				uv[c][0] = XMLoadFloat4((const XMFLOAT4*)lanes[c][3]);
+				uv[c][1] = XMLoadFloat4((const XMFLOAT4*)lanes[c][4]);
+			}
+
+			// Edges relative to the first corner, in position and UV space
+			XMVECTOR x1 = p[1][0] - p[0][0];
+			XMVECTOR y1 = p[1][1] - p[0][1];
+			XMVECTOR z1 = p[1][2] - p[0][2];
+			XMVECTOR x2 = p[2][0] - p[0][0];
+			XMVECTOR y2 = p[2][1] - p[0][1];
+			XMVECTOR z2 = p[2][2] - p[0][2];
+			XMVECTOR s1 = uv[1][0] - uv[0][0];
+			XMVECTOR t1 = uv[1][1] - uv[0][1];
+			XMVECTOR s2 = uv[2][0] - uv[0][0];
+			XMVECTOR t2 = uv[2][1] - uv[0][1];
+
+			XMVECTOR r = XMVectorReciprocal(s1 * t2 - s2 * t1);
+			XMStoreFloat4((XMFLOAT4*)&faceX[block * 4], (t2 * x1 - t1 * x2) * r);
+			XMStoreFloat4((XMFLOAT4*)&faceY[block * 4], (t2 * y1 - t1 * y2) * r);
+			XMStoreFloat4((XMFLOAT4*)&faceZ[block * 4], (t2 * z1 - t1 * z2) * r);
+
+			if (!angleWeighted)
+				continue;
+
+			// Angle at each corner between its two edges
+			for (int c = 0; c < 3; c++)
+			{
+				const XMVECTOR* a = p[c];
+				const XMVECTOR* b = p[(c + 1) % 3];
+				const XMVECTOR* d = p[(c + 2) % 3];
+				XMVECTOR ex = b[0] - a[0], ey = b[1] - a[1], ez = b[2] - a[2];
+				XMVECTOR fx = d[0] - a[0], fy = d[1] - a[1], fz = d[2] - a[2];
+				XMVECTOR lengths = XMVectorSqrt((ex * ex + ey * ey + ez * ez) * (fx * fx + fy * fy + fz * fz));
+				XMVECTOR cosine = XMVectorDivide(ex * fx + ey * fy + ez * fz, lengths);
+				XMVECTOR angle = XMVectorACos(XMVectorClamp(cosine, XMVectorReplicate(-1.0f), XMVectorReplicate(1.0f)));
+				angle = XMVectorSelect(XMVectorZero(), angle, XMVectorGreater(lengths, XMVectorZero()));
+				XMStoreFloat4((XMFLOAT4*)&cornerAngles[(block * 3 + c) * 4], angle);
+			}
+		}
+	});
+
+	// Vertex -> corner table, with each vertex's corners in index order
+	std::vector<unsigned int> offsets(vertexCount + 1, 0);
+	std::vector<unsigned int> corners(triangleCount * 3);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		offsets[indices[i] + 1]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		offsets[v + 1] += offsets[v];
+	{
+		std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; i++)
+			corners[fill[indices[i]]++] = (unsigned int)i;
+	}
+
+	RunParallel(threadCount, [&](size_t thread)
+	{
+		size_t blockEnd = vertexBlocks * (thread + 1) / threadCount;
+		for (size_t block = vertexBlocks * thread / threadCount; block < blockEnd; block++)
+		{
+			// Sum each vertex's triangles, one vertex per lane
+			float lanes[6][4];
+			for (size_t lane = 0; lane < 4; lane++)
+			{
+				size_t v = block * 4 + lane;
+				if (v >= vertexCount)
+					v = vertexCount - 1;
+
+				const XMFLOAT3& n = verts[v].Normal;
+				float x = 0.0f, y = 0.0f, z = 0.0f;
+				for (unsigned int at = offsets[v]; at < offsets[v + 1]; at++)
+				{
+					unsigned int corner = corners[at];
+					unsigned int t = corner / 3;
+					if (!angleWeighted)
+					{
+						x += faceX[t];
+						y += faceY[t];
+						z += faceZ[t];
+						continue;
+					}
+
+					// Project into the corner's normal plane and weight by angle
+					float d = n.x * faceX[t] + n.y * faceY[t] + n.z * faceZ[t];
+					float px = faceX[t] - n.x * d;
+					float py = faceY[t] - n.y * d;
+					float pz = faceZ[t] - n.z * d;
+					float length = sqrtf(px * px + py * py + pz * pz);
+					if (!(length > 0.0f && length < INFINITY))
+						continue;
+
+					float weight = cornerAngles[(t / 4 * 3 + corner % 3) * 4 + t % 4] / length;
+					x += px * weight;
+					y += py * weight;
+					z += pz * weight;
+				}
+
+				lanes[0][lane] = n.x;
+				lanes[1][lane] = n.y;
+				lanes[2][lane] = n.z;
+				lanes[3][lane] = x;
+				lanes[4][lane] = y;
+				lanes[5][lane] = z;
+			}
+
+			XMVECTOR nx = XMLoadFloat4((const XMFLOAT4*)lanes[0]);
+			XMVECTOR ny = XMLoadFloat4((const XMFLOAT4*)lanes[1]);
+			XMVECTOR nz = XMLoadFloat4((const XMFLOAT4*)lanes[2]);
+			XMVECTOR tx = XMLoadFloat4((const XMFLOAT4*)lanes[3]);
+			XMVECTOR ty = XMLoadFloat4((const XMFLOAT4*)lanes[4]);
+			XMVECTOR tz = XMLoadFloat4((const XMFLOAT4*)lanes[5]);
+
+			// Gram-Schmidt, then normalize (zero stays zero, like XMVector3Normalize)
+			XMVECTOR d = nx * tx + ny * ty + nz * tz;
+			tx -= nx * d;
+			ty -= ny * d;
+			tz -= nz * d;
+			XMVECTOR length = XMVectorSqrt(tx * tx + ty * ty + tz * tz);
+			XMVECTOR nonZero = XMVectorNotEqual(length, XMVectorZero());
+			XMStoreFloat4((XMFLOAT4*)lanes[3], XMVectorSelect(XMVectorZero(), tx / length, nonZero));
+			XMStoreFloat4((XMFLOAT4*)lanes[4], XMVectorSelect(XMVectorZero(), ty / length, nonZero));
+			XMStoreFloat4((XMFLOAT4*)lanes[5], XMVectorSelect(XMVectorZero(), tz / length, nonZero));
+
+			for (size_t lane = 0; lane < 4 && block * 4 + lane < vertexCount; lane++)
+				verts[block * 4 + lane].Tangent = XMFLOAT3(lanes[3][lane], lanes[4][lane], lanes[5][lane]);
+		}
+	});
+}
+
+// --------------------------------------------------------
+// Greedy triangle reordering for the post-transform vertex cache.
+//
+// - Every vertex is scored by its position in a simulated LRU cache
+//   plus a boost for having few triangles left to draw
+// - Each step emits the highest scoring triangle that touches the
+//   cache, then rescores only the triangles around cached vertices,
+//   which keeps the whole pass linear in the number of triangles
+// --------------------------------------------------------
+void MeshProcessing::OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Build vertex -> triangle adjacency in one flat array
+	std::vector<unsigned int> remaining(vertexCount, 0);
+	for (unsigned int index : indices)
+		remaining[index]++;
+
+	std::vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		offsets[v + 1] = offsets[v] + remaining[v];
+
+	std::vector<unsigned int> adjacency(indices.size());
+	{
+		std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++)
+			adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	// Initial scores with an empty cache
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScore[v] = ForsythVertexScore(-1, remaining[v]);
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	unsigned int best = 0;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		triangleScore[t] =
+			vertexScore[indices[t * 3 + 0]] +
+			vertexScore[indices[t * 3 + 1]] +
+			vertexScore[indices[t * 3 + 2]];
+
+		if (triangleScore[t] > triangleScore[best])
+			best = (unsigned int)t;
+	}
+
+	// The cache, plus room for the three vertices being pushed in
+	unsigned int cache[ForsythCacheSize + 3];
+	unsigned int newCache[ForsythCacheSize + 3];
+	int cacheCount = 0;
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	size_t searchCursor = 0;
+	const unsigned int NoTriangle = 0xFFFFFFFF;
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+	{
+		// Nothing in the cache is useful, so start fresh
+		// from the next unemitted triangle in the input
+		if (best == NoTriangle)
+		{
+			while (emitted[searchCursor])
+				searchCursor++;
+			best = (unsigned int)searchCursor;
+		}
+
+		const unsigned int* tri = &indices[best * 3];
+		output.insert(output.end(), tri, tri + 3);
+		emitted[best] = true;
+
+		// Remove the triangle from its vertices' adjacency lists
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int v = tri[c];
+			unsigned int* list = &adjacency[offsets[v]];
+			for (unsigned int a = 0; a < remaining[v]; a++)
+			{
+				if (list[a] == best)
+				{
+					list[a] = list[remaining[v] - 1];
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		// Push the triangle's vertices to the front of the cache
+		int newCount = 0;
+		for (int c = 0; c < 3; c++)
+			newCache[newCount++] = tri[c];
+		for (int c = 0; c < cacheCount; c++)
+		{
+			unsigned int v = cache[c];
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				newCache[newCount++] = v;
+		}
+
+		// Rescore everything that was touched, including vertices that fell out
+		for (int c = 0; c < newCount; c++)
+		{
+			unsigned int v = newCache[c];
+			cachePosition[v] = c < ForsythCacheSize ? c : -1;
+			vertexScore[v] = ForsythVertexScore(cachePosition[v], remaining[v]);
+		}
+
+		// Rescore the triangles around those vertices and pick the next one
+		best = NoTriangle;
+		float bestScore = -1.0f;
+		for (int c = 0; c < newCount; c++)
+		{
+			unsigned int v = newCache[c];
+			const unsigned int* list = &adjacency[offsets[v]];
+			for (unsigned int a = 0; a < remaining[v]; a++)
+			{
+				unsigned int t = list[a];
+				const unsigned int* other = &indices[t * 3];
+				triangleScore[t] = vertexScore[other[0]] + vertexScore[other[1]] + vertexScore[other[2]];
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+		}
+
+		cacheCount = std::min(newCount, ForsythCacheSize);
+		memcpy(cache, newCache, sizeof(unsigned int) * cacheCount);
+	}
+
+	indices.swap(output);
+}
+
+// --------------------------------------------------------
+// Renumbers vertices in order of first use by the index
+// buffer so the input assembler reads them front to back
+// --------------------------------------------------------
+void MeshProcessing::OptimizeVertexFetch(std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	std::vector<unsigned int> remap(verts.size(), EmptySlot);
+	std::vector<Vertex> reordered;
+	reordered.reserve(verts.size());
+
+	for (unsigned int& index : indices)
+	{
+		if (remap[index] == EmptySlot)
+		{
+			remap[index] = (unsigned int)reordered.size();
+			reordered.push_back(verts[index]);
+		}
+		index = remap[index];
+	}
+
+	verts.swap(reordered);
+}
+
+// --------------------------------------------------------
+// Counts vertex shader invocations under a FIFO cache, the
+// model most post-transform caches are documented to follow
+// --------------------------------------------------------
+MeshProcessing::VertexCacheStats MeshProcessing::AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats = {};
+	if (indexCount < 3 || vertexCount == 0)
+		return stats;
+
+	// A vertex is cached if it missed within the last "cacheSize" misses
+	std::vector<unsigned int> cacheTime(vertexCount, 0);
+	unsigned int timestamp = cacheSize + 1;
+	unsigned int misses = 0;
+
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int v = indices[i];
+		if (timestamp - cacheTime[v] > cacheSize)
+		{
+			cacheTime[v] = timestamp++;
+			misses++;
+		}
+	}
+
+	stats.acmr = (float)misses / (indexCount / 3);
+	stats.atvr = (float)misses / vertexCount;
+	return stats;
+}
+
+// --------------------------------------------------------
+// Scale and offset for 16-bit positions: offset is the bounds'
+// minimum corner and each step of the quantized value covers
+// 1/65535th of the extent (flat axes decode to the offset)
+// --------------------------------------------------------
+void MeshProcessing::GetPositionDecode(DirectX::XMFLOAT3 boundsMin, DirectX::XMFLOAT3 boundsMax, DirectX::XMFLOAT3& positionScale, DirectX::XMFLOAT3& positionOffset)
+{
+	positionScale = DirectX::XMFLOAT3(
+		(boundsMax.x - boundsMin.x) / 65535.0f,
+		(boundsMax.y - boundsMin.y) / 65535.0f,
+		(boundsMax.z - boundsMin.z) / 65535.0f);
+	positionOffset = boundsMin;
+}
+
+// --------------------------------------------------------
+// Encodes vertices into the 20-byte GPU layout
+// --------------------------------------------------------
+void MeshProcessing::PackVertices(const Vertex* verts, size_t vertexCount, DirectX::XMFLOAT3 boundsMin, DirectX::XMFLOAT3 boundsMax, std::vector<PackedVertex>& packed)
+{
+	packed.resize(vertexCount);
+
+	// Multipliers that map the bounds onto 0-65535
+	float extent[3] = { boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z };
+	float minimum[3] = { boundsMin.x, boundsMin.y, boundsMin.z };
+	float quantize[3];
+	for (int a = 0; a < 3; a++)
+		quantize[a] = extent[a] > 0.0f ? 65535.0f / extent[a] : 0.0f;
+
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const Vertex& v = verts[i];
+		PackedVertex& p = packed[i];
+
+		float position[3] = { v.Position.x, v.Position.y, v.Position.z };
+		for (int a = 0; a < 3; a++)
+			p.Position[a] = (unsigned short)std::clamp(lroundf((position[a] - minimum[a]) * quantize[a]), 0l, 65535l);
+		p.Position[3] = 0;
+
+		p.UV =
+			(unsigned int)DirectX::PackedVector::XMConvertFloatToHalf(v.UV.x) |
+			((unsigned int)DirectX::PackedVector::XMConvertFloatToHalf(v.UV.y) << 16);
+		p.Normal = EncodeOctahedral(v.Normal);
+		p.Tangent = EncodeOctahedral(v.Tangent);
+	}
+}
+
+// --------------------------------------------------------
+// Decodes a packed vertex using the same math as the shader
+// --------------------------------------------------------
+Vertex MeshProcessing::UnpackVertex(const PackedVertex& packed, DirectX::XMFLOAT3 positionScale, DirectX::XMFLOAT3 positionOffset)
+{
+	Vertex v = {};
+	v.Position = DirectX::XMFLOAT3(
+		positionOffset.x + packed.Position[0] * positionScale.x,
+		positionOffset.y + packed.Position[1] * positionScale.y,
+		positionOffset.z + packed.Position[2] * positionScale.z);
+	v.UV = DirectX::XMFLOAT2(
+		DirectX::PackedVector::XMConvertHalfToFloat((DirectX::PackedVector::HALF)(packed.UV & 0xFFFF)),
+		DirectX::PackedVector::XMConvertHalfToFloat((DirectX::PackedVector::HALF)(packed.UV >> 16)));
+	v.Normal = DecodeOctahedral(packed.Normal);
+	v.Tangent = DecodeOctahedral(packed.Tangent);
+	return v;
+}
+
+// --------------------------------------------------------
+// CPU round trip check of the packed layout, reporting the
+// worst case of each attribute across the whole mesh
+// --------------------------------------------------------
+MeshProcessing::PackingError MeshProcessing::MeasurePackingError(const Vertex* verts, const PackedVertex* packed, size_t vertexCount, DirectX::XMFLOAT3 positionScale, DirectX::XMFLOAT3 positionOffset)
+{
+	PackingError error = {};
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const Vertex& original = verts[i];
+		Vertex decoded = UnpackVertex(packed[i], positionScale, positionOffset);
+
+		float dx = decoded.Position.x - original.Position.x;
+		float dy = decoded.Position.y - original.Position.y;
+		float dz = decoded.Position.z - original.Position.z;
+		error.position = std::max(error.position, sqrtf(dx * dx + dy * dy + dz * dz));
+
+		error.uv = std::max(error.uv, fabsf(decoded.UV.x - original.UV.x));
+		error.uv = std::max(error.uv, fabsf(decoded.UV.y - original.UV.y));
+
+		error.normalDegrees = std::max(error.normalDegrees, AngleDegrees(original.Normal, decoded.Normal));
+		error.tangentDegrees = std::max(error.tangentDegrees, AngleDegrees(original.Tangent, decoded.Tangent));
+	}
+	return error;
+}
+
+// --------------------------------------------------------
+// Splits the mesh into meshlets of limited size.
+//
+// - A meshlet starts from the first unused triangle in the
+//   current (cache optimized) order, then repeatedly adds the
+//   neighboring triangle that needs the fewest new vertices,
+//   breaking ties by distance to the meshlet's center
+// - Bounding spheres use the center of the meshlet's box
+// - Normal cones follow meshoptimizer's formulation: the axis
+//   is the average face normal and the cutoff is the sine of
+//   the widest angle between it and any face normal
+// --------------------------------------------------------
+std::vector<MeshProcessing::Meshlet> MeshProcessing::BuildMeshlets(
+	std::vector<unsigned int>& indices,
+	const std::vector<Vertex>& verts,
+	unsigned int maxVertices,
+	unsigned int maxTriangles)
+{
+	std::vector<Meshlet> meshlets;
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return meshlets;
+
+	// Vertex -> triangle adjacency
+	std::vector<unsigned int> offsets(verts.size() + 1, 0);
+	for (unsigned int index : indices)
+		offsets[index + 1]++;
+	for (size_t v = 0; v < verts.size(); v++)
+		offsets[v + 1] += offsets[v];
+
+	std::vector<unsigned int> adjacency(indices.size());
+	{
+		std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++)
+			adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	// Triangle centers for the distance tie breaker
+	std::vector<DirectX::XMFLOAT3> triangleCenters(triangleCount);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const DirectX::XMFLOAT3& a = verts[indices[t * 3 + 0]].Position;
+		const DirectX::XMFLOAT3& b = verts[indices[t * 3 + 1]].Position;
+		const DirectX::XMFLOAT3& c = verts[indices[t * 3 + 2]].Position;
+		triangleCenters[t] = DirectX::XMFLOAT3((a.x + b.x + c.x) / 3, (a.y + b.y + c.y) / 3, (a.z + b.z + c.z) / 3);
+	}
+
+	// Which meshlet each vertex was last added to (0 = none yet)
+	std::vector<unsigned int> vertexMeshlet(verts.size(), 0);
+	std::vector<bool> used(triangleCount, false);
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	size_t searchCursor = 0;
+
+	std::vector<unsigned int> meshletVerts;
+	std::vector<unsigned int> meshletTriangles;
+	while (output.size() < indices.size())
+	{
+		unsigned int stamp = (unsigned int)meshlets.size() + 1;
+		meshletVerts.clear();
+		meshletTriangles.clear();
+		float centerSum[3] = { 0, 0, 0 };
+
+		// Seed with the next unused triangle
+		while (used[searchCursor])
+			searchCursor++;
+		unsigned int next = (unsigned int)searchCursor;
+
+		while (true)
+		{
+			// Add the chosen triangle and any vertices it brings along
+			used[next] = true;
+			meshletTriangles.push_back(next);
+			centerSum[0] += triangleCenters[next].x;
+			centerSum[1] += triangleCenters[next].y;
+			centerSum[2] += triangleCenters[next].z;
+			for (int c = 0; c < 3; c++)
+			{
+				unsigned int v = indices[next * 3 + c];
+				if (vertexMeshlet[v] != stamp)
+				{
+					vertexMeshlet[v] = stamp;
+					meshletVerts.push_back(v);
+				}
+			}
+
+			if (meshletTriangles.size() >= maxTriangles)
+				break;
+
+			// Find the neighbor needing the fewest new vertices
+			float inverseCount = 1.0f / meshletTriangles.size();
+			DirectX::XMFLOAT3 center(centerSum[0] * inverseCount, centerSum[1] * inverseCount, centerSum[2] * inverseCount);
+			unsigned int best = 0xFFFFFFFF;
+			unsigned int bestNewVerts = 4;
+			float bestDistance = 0.0f;
+			for (unsigned int v : meshletVerts)
+			{
+				for (unsigned int a = offsets[v]; a < offsets[v + 1]; a++)
+				{
+					unsigned int t = adjacency[a];
+					if (used[t])
+						continue;
+
+					unsigned int newVerts =
+						(vertexMeshlet[indices[t * 3 + 0]] != stamp) +
+						(vertexMeshlet[indices[t * 3 + 1]] != stamp) +
+						(vertexMeshlet[indices[t * 3 + 2]] != stamp);
+					if (meshletVerts.size() + newVerts > maxVertices || newVerts > bestNewVerts)
+						continue;
+
+					float dx = triangleCenters[t].x - center.x;
+					float dy = triangleCenters[t].y - center.y;
+					float dz = triangleCenters[t].z - center.z;
+					float distance = dx * dx + dy * dy + dz * dz;
+					if (newVerts < bestNewVerts || distance < bestDistance)
+					{
+						best = t;
+						bestNewVerts = newVerts;
+						bestDistance = distance;
+					}
+				}
+			}
+
+			// Nothing connected fits, so this meshlet is done
+			if (best == 0xFFFFFFFF)
+				break;
+			next = best;
+		}
+
+		// Cache optimize the meshlet on its own, using local vertex numbers
+		std::vector<unsigned int> local(meshletTriangles.size() * 3);
+		for (size_t t = 0; t < meshletTriangles.size(); t++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				unsigned int v = indices[meshletTriangles[t] * 3 + c];
+				local[t * 3 + c] = (unsigned int)(std::find(meshletVerts.begin(), meshletVerts.end(), v) - meshletVerts.begin());
+			}
+		}
+		OptimizeVertexCache(local, meshletVerts.size());
+
+		Meshlet meshlet = {};
+		meshlet.indexStart = (unsigned int)output.size();
+		meshlet.indexCount = (unsigned int)local.size();
+		for (unsigned int l : local)
+			output.push_back(meshletVerts[l]);
+
+		// Bounding sphere around the center of the meshlet's box
+		DirectX::XMFLOAT3 boxMin = verts[meshletVerts[0]].Position;
+		DirectX::XMFLOAT3 boxMax = boxMin;
+		for (unsigned int v : meshletVerts)
+		{
+			const DirectX::XMFLOAT3& p = verts[v].Position;
+			boxMin = DirectX::XMFLOAT3(std::min(boxMin.x, p.x), std::min(boxMin.y, p.y), std::min(boxMin.z, p.z));
+			boxMax = DirectX::XMFLOAT3(std::max(boxMax.x, p.x), std::max(boxMax.y, p.y), std::max(boxMax.z, p.z));
+		}
+		meshlet.center = DirectX::XMFLOAT3((boxMin.x + boxMax.x) * 0.5f, (boxMin.y + boxMax.y) * 0.5f, (boxMin.z + boxMax.z) * 0.5f);
+		for (unsigned int v : meshletVerts)
+		{
+			const DirectX::XMFLOAT3& p = verts[v].Position;
+			float dx = p.x - meshlet.center.x;
+			float dy = p.y - meshlet.center.y;
+			float dz = p.z - meshlet.center.z;
+			meshlet.radius = std::max(meshlet.radius, sqrtf(dx * dx + dy * dy + dz * dz));
+		}
+
+		// Normal cone from the unit face normals
+		std::vector<DirectX::XMFLOAT3> normals;
+		float axis[3] = { 0, 0, 0 };
+		for (unsigned int t : meshletTriangles)
+		{
+			const DirectX::XMFLOAT3& a = verts[indices[t * 3 + 0]].Position;
+			const DirectX::XMFLOAT3& b = verts[indices[t * 3 + 1]].Position;
+			const DirectX::XMFLOAT3& c = verts[indices[t * 3 + 2]].Position;
+			float e1[3] = { b.x - a.x, b.y - a.y, b.z - a.z };
+			float e2[3] = { c.x - a.x, c.y - a.y, c.z - a.z };
+			DirectX::XMFLOAT3 n(
+				e1[1] * e2[2] - e1[2] * e2[1],
+				e1[2] * e2[0] - e1[0] * e2[2],
+				e1[0] * e2[1] - e1[1] * e2[0]);
+			float length = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+			if (length == 0.0f)
+				continue;
+
+			n = DirectX::XMFLOAT3(n.x / length, n.y / length, n.z / length);
+			normals.push_back(n);
+			axis[0] += n.x;
+			axis[1] += n.y;
+			axis[2] += n.z;
+		}
+
+		meshlet.coneCutoff = 1.0f;
+		float axisLength = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		if (axisLength > 0.0f)
+		{
+			meshlet.coneAxis = DirectX::XMFLOAT3(axis[0] / axisLength, axis[1] / axisLength, axis[2] / axisLength);
+
+			float minDot = 1.0f;
+			for (const DirectX::XMFLOAT3& n : normals)
+				minDot = std::min(minDot, n.x * meshlet.coneAxis.x + n.y * meshlet.coneAxis.y + n.z * meshlet.coneAxis.z);
+
+			// Cones wider than a hemisphere (plus a little slack) can't be rejected
+			if (minDot > 0.1f)
+				meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+		}
+
+		meshlets.push_back(meshlet);
+	}
+
+	// Draw the most outward facing meshlets first
+	std::vector<unsigned int> clusterStarts;
+	for (const Meshlet& meshlet : meshlets)
+		clusterStarts.push_back(meshlet.indexStart / 3);
+	clusterStarts.push_back((unsigned int)triangleCount);
+	std::vector<unsigned int> order = SortClustersForOverdraw(output, verts, clusterStarts);
+
+	std::vector<Meshlet> sorted;
+	sorted.reserve(meshlets.size());
+	indices.clear();
+	for (unsigned int m : order)
+	{
+		Meshlet meshlet = meshlets[m];
+		indices.insert(indices.end(), output.begin() + meshlet.indexStart, output.begin() + meshlet.indexStart + meshlet.indexCount);
+		meshlet.indexStart = (unsigned int)indices.size() - meshlet.indexCount;
+		sorted.push_back(meshlet);
+	}
+
+	return sorted;
+}
+
+// --------------------------------------------------------
+// Gribb/Hartmann plane extraction for DirectXMath's row-vector
+// convention and D3D's 0-1 clip space depth
+// --------------------------------------------------------
+void MeshProcessing::ExtractFrustumPlanes(const DirectX::XMFLOAT4X4& m, DirectX::XMFLOAT4 planes[6])
+{
+	planes[0] = DirectX::XMFLOAT4(m._14 + m._11, m._24 + m._21, m._34 + m._31, m._44 + m._41);	// Left
+	planes[1] = DirectX::XMFLOAT4(m._14 - m._11, m._24 - m._21, m._34 - m._31, m._44 - m._41);	// Right
+	planes[2] = DirectX::XMFLOAT4(m._14 + m._12, m._24 + m._22, m._34 + m._32, m._44 + m._42);	// Bottom
+	planes[3] = DirectX::XMFLOAT4(m._14 - m._12, m._24 - m._22, m._34 - m._32, m._44 - m._42);	// Top
+	planes[4] = DirectX::XMFLOAT4(m._13, m._23, m._33, m._43);									// Near
+	planes[5] = DirectX::XMFLOAT4(m._14 - m._13, m._24 - m._23, m._34 - m._33, m._44 - m._43);	// Far
+
+	// Normalize so plane distances are real distances
+	for (int i = 0; i < 6; i++)
+	{
+		DirectX::XMFLOAT4& p = planes[i];
+		float length = sqrtf(p.x * p.x + p.y * p.y + p.z * p.z);
+		if (length > 0.0f)
+			p = DirectX::XMFLOAT4(p.x / length, p.y / length, p.z / length, p.w / length);
+	}
+}
+
+// --------------------------------------------------------
+// Conservative cone test: the meshlet is backfacing if the
+// whole bounding sphere sits inside the "back" side of the cone
+// --------------------------------------------------------
+bool MeshProcessing::IsMeshletBackfacing(const Meshlet& meshlet, DirectX::XMFLOAT3 viewPosition)
+{
+	if (meshlet.coneCutoff >= 1.0f)
+		return false;
+
+	float toCenter[3] = {
+		meshlet.center.x - viewPosition.x,
+		meshlet.center.y - viewPosition.y,
+		meshlet.center.z - viewPosition.z };
+	float distance = sqrtf(toCenter[0] * toCenter[0] + toCenter[1] * toCenter[1] + toCenter[2] * toCenter[2]);
+	float alongAxis =
+		toCenter[0] * meshlet.coneAxis.x +
+		toCenter[1] * meshlet.coneAxis.y +
+		toCenter[2] * meshlet.coneAxis.z;
+
+	return alongAxis >= meshlet.coneCutoff * distance + meshlet.radius;
+}
+
+// --------------------------------------------------------
+// Culls meshlets and collects draw ranges for the survivors.
+// Planes and view position must share the meshlets' object space.
+// --------------------------------------------------------
+unsigned int MeshProcessing::CullMeshlets(
+	const Meshlet* meshlets,
+	size_t meshletCount,
+	const DirectX::XMFLOAT4 planes[6],
+	const DirectX::XMFLOAT3* viewPosition,
+	std::vector<DrawRange>& ranges)
+{
+	ranges.clear();
+	unsigned int visible = 0;
+
+	for (size_t m = 0; m < meshletCount; m++)
+	{
+		const Meshlet& meshlet = meshlets[m];
+
+		// Entirely behind any plane means outside the frustum
+		bool inside = true;
+		for (int i = 0; i < 6 && inside; i++)
+		{
+			float distance =
+				planes[i].x * meshlet.center.x +
+				planes[i].y * meshlet.center.y +
+				planes[i].z * meshlet.center.z +
+				planes[i].w;
+			inside = distance >= -meshlet.radius;
+		}
+
+		if (!inside || (viewPosition && IsMeshletBackfacing(meshlet, *viewPosition)))
+			continue;
+
+		// Extend the previous range when this meshlet follows it directly
+		visible++;
+		if (!ranges.empty() && ranges.back().indexStart + ranges.back().indexCount == meshlet.indexStart)
+			ranges.back().indexCount += meshlet.indexCount;
+		else
+			ranges.push_back({ meshlet.indexStart, meshlet.indexCount });
+	}
+
+	return visible;
+}
+
+// --------------------------------------------------------
+// Quadric error edge-collapse simplification (Garland and
+// Heckbert), collapsing each edge onto one of its existing
+// endpoints so every LOD can share the same vertex buffer.
+//
+// Vertices are classified each pass, similar to meshoptimizer:
+// - Manifold: unique position, closed fan; may collapse anywhere
+// - Border: unique position on an open edge; only slides along
+//   the border onto another border vertex
+// - Seam: one of exactly two vertices sharing a position (a UV or
+//   normal seam); collapses along the seam together with its twin
+//   so both sides land on the same position and the seam stays closed
+// - Locked: everything else (corners, poles, non-manifold), never moves
+//
+// Open edges also add a perpendicular plane to the quadrics so
+// borders and seams keep their shape.  Each pass sorts candidate
+// collapses by cost and applies as many as it can, skipping any
+// whose neighborhood already changed this pass and any that would
+// flip a face or exceed maxError.
+// --------------------------------------------------------
+std::vector<unsigned int> MeshProcessing::SimplifyMesh(const std::vector<Vertex>& verts, const std::vector<unsigned int>& indices, size_t targetIndexCount, float maxError, float& error)
+{
+	error = 0.0f;
+	std::vector<unsigned int> result = indices;
+	size_t vertexCount = verts.size();
+	if (result.size() <= targetIndexCount)
+		return result;
+
+	const unsigned int None = 0xFFFFFFFF;
+	const unsigned int Multiple = 0xFFFFFFFE;
+	enum Kind { Manifold, Border, Seam, Locked };
+
+	// Drop exact duplicate triangles up front (some exporters emit every
+	// face twice); they add nothing on screen and would make every edge
+	// look non-manifold, locking the whole mesh
+	{
+		struct Key { unsigned int a, b, c; size_t triangle; };
+		std::vector<Key> keys(result.size() / 3);
+		for (size_t t = 0; t < keys.size(); t++)
+		{
+			// Rotate so the smallest index comes first, keeping the winding
+			unsigned int a = result[t * 3 + 0], b = result[t * 3 + 1], c = result[t * 3 + 2];
+			if (b < a && b < c) keys[t] = { b, c, a, t };
+			else if (c < a && c < b) keys[t] = { c, a, b, t };
+			else keys[t] = { a, b, c, t };
+		}
+		std::sort(keys.begin(), keys.end(), [](const Key& x, const Key& y) {
+			if (x.a != y.a) return x.a < y.a;
+			if (x.b != y.b) return x.b < y.b;
+			if (x.c != y.c) return x.c < y.c;
+			return x.triangle < y.triangle;
+		});
+
+		std::vector<bool> duplicate(keys.size());
+		for (size_t k = 1; k < keys.size(); k++)
+			duplicate[keys[k].triangle] = keys[k].a == keys[k - 1].a && keys[k].b == keys[k - 1].b && keys[k].c == keys[k - 1].c;
+
+		size_t write = 0;
+		for (size_t t = 0; t < keys.size(); t++)
+		{
+			if (duplicate[t])
+				continue;
+			result[write++] = result[t * 3 + 0];
+			result[write++] = result[t * 3 + 1];
+			result[write++] = result[t * 3 + 2];
+		}
+		result.resize(write);
+		if (result.size() <= targetIndexCount)
+			return result;
+	}
+
+	// Link vertices sharing a position into rings ("wedges")
+	std::vector<unsigned int> wedge(vertexCount);
+	{
+		std::vector<unsigned int> sorted(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++)
+			sorted[v] = wedge[v] = (unsigned int)v;
+
+		auto positionLess = [&](unsigned int a, unsigned int b) {
+			const DirectX::XMFLOAT3& pa = verts[a].Position;
+			const DirectX::XMFLOAT3& pb = verts[b].Position;
+			if (pa.x != pb.x) return pa.x < pb.x;
+			if (pa.y != pb.y) return pa.y < pb.y;
+			return pa.z < pb.z;
+		};
+		std::sort(sorted.begin(), sorted.end(), positionLess);
+
+		for (size_t start = 0; start < vertexCount;)
+		{
+			size_t end = start + 1;
+			while (end < vertexCount && !positionLess(sorted[start], sorted[end]))
+				end++;
+			for (size_t i = start; i < end; i++)
+				wedge[sorted[i]] = sorted[i + 1 < end ? i + 1 : start];
+			start = end;
+		}
+	}
+
+	// Plane quadrics from every triangle, weighted by area
+	std::vector<Quadric> quadrics(vertexCount, Quadric{});
+	for (size_t i = 0; i + 2 < result.size(); i += 3)
+	{
+		const DirectX::XMFLOAT3& a = verts[result[i]].Position;
+		DirectX::XMFLOAT3 n = FaceNormal(a, verts[result[i + 1]].Position, verts[result[i + 2]].Position);
+		double length = sqrt((double)n.x * n.x + (double)n.y * n.y + (double)n.z * n.z);
+		if (length == 0.0)
+			continue;
+
+		double nx = n.x / length, ny = n.y / length, nz = n.z / length;
+		double d = -(nx * a.x + ny * a.y + nz * a.z);
+		for (int c = 0; c < 3; c++)
+			quadrics[result[i + c]].AddPlane(nx, ny, nz, d, length * 0.5);
+	}
+
+	std::vector<unsigned int> offsets(vertexCount + 1);
+	std::vector<unsigned int> adjacency;
+	std::vector<unsigned long long> halfEdges;
+	std::vector<unsigned int> openOut(vertexCount);
+	std::vector<unsigned int> openIn(vertexCount);
+	std::vector<unsigned char> kinds(vertexCount);
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+	bool addedEdgeQuadrics = false;
+	double worstError = 0.0;
+
+	// A candidate collapse of "from" onto "to", plus the matching
+	// collapse on the other side of a seam (or None)
+	struct Collapse
+	{
+		unsigned int from;
+		unsigned int to;
+		unsigned int twinFrom;
+		unsigned int twinTo;
+		double cost;
+		double weight;
+	};
+	std::vector<Collapse> collapses;
+
+	// The other vertex at v's position when exactly two share it (or None)
+	auto findTwin = [&](unsigned int v) { return wedge[v] != v && wedge[wedge[v]] == v ? wedge[v] : None; };
+
+	while (result.size() > targetIndexCount)
+	{
+		size_t triangleCount = result.size() / 3;
+
+		// Vertex -> triangle adjacency for the current triangles
+		std::fill(offsets.begin(), offsets.end(), 0);
+		for (unsigned int index : result)
+			offsets[index + 1]++;
+		for (size_t v = 0; v < vertexCount; v++)
+			offsets[v + 1] += offsets[v];
+		adjacency.resize(result.size());
+		{
+			std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < result.size(); i++)
+				adjacency[fill[result[i]]++] = (unsigned int)(i / 3);
+		}
+
+		// Directed edges, so open edges can be found by their missing opposite
+		halfEdges.clear();
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				unsigned long long a = result[t * 3 + c];
+				unsigned long long b = result[t * 3 + (c + 1) % 3];
+				halfEdges.push_back((a << 32) | b);
+			}
+		}
+		std::sort(halfEdges.begin(), halfEdges.end());
+		auto hasEdge = [&](unsigned long long a, unsigned long long b) {
+			return std::binary_search(halfEdges.begin(), halfEdges.end(), (a << 32) | b);
+		};
+
+		std::fill(openOut.begin(), openOut.end(), None);
+		std::fill(openIn.begin(), openIn.end(), None);
+		for (unsigned long long edge : halfEdges)
+		{
+			unsigned int a = (unsigned int)(edge >> 32);
+			unsigned int b = (unsigned int)(edge & 0xFFFFFFFF);
+			if (hasEdge(b, a))
+				continue;
+
+			openOut[a] = openOut[a] == None ? b : Multiple;
+			openIn[b] = openIn[b] == None ? a : Multiple;
+
+			// Planes through the open edges keep borders and seams in place
+			if (!addedEdgeQuadrics)
+			{
+				for (unsigned int at = offsets[a]; at < offsets[a + 1]; at++)
+				{
+					const unsigned int* tri = &result[adjacency[at] * 3];
+					if (tri[0] != b && tri[1] != b && tri[2] != b)
+						continue;
+
+					const DirectX::XMFLOAT3& pa = verts[a].Position;
+					const DirectX::XMFLOAT3& pb = verts[b].Position;
+					DirectX::XMFLOAT3 n = FaceNormal(verts[tri[0]].Position, verts[tri[1]].Position, verts[tri[2]].Position);
+					double e[3] = { (double)pb.x - pa.x, (double)pb.y - pa.y, (double)pb.z - pa.z };
+					double p[3] = { e[1] * n.z - e[2] * n.y, e[2] * n.x - e[0] * n.z, e[0] * n.y - e[1] * n.x };
+					double length = sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+					double edgeLengthSq = e[0] * e[0] + e[1] * e[1] + e[2] * e[2];
+					if (length > 0.0)
+					{
+						p[0] /= length; p[1] /= length; p[2] /= length;
+						double d = -(p[0] * pa.x + p[1] * pa.y + p[2] * pa.z);
+						quadrics[a].AddPlane(p[0], p[1], p[2], d, edgeLengthSq * 10.0);
+						quadrics[b].AddPlane(p[0], p[1], p[2], d, edgeLengthSq * 10.0);
+					}
+					break;
+				}
+			}
+		}
+		addedEdgeQuadrics = true;
+
+		// Classify every vertex
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			bool closed = openOut[v] == None && openIn[v] == None;
+			bool singleOpen = openOut[v] < Multiple && openIn[v] < Multiple;
+			unsigned int twin = findTwin((unsigned int)v);
+
+			if (wedge[v] == v)
+				kinds[v] = closed ? Manifold : singleOpen ? Border : Locked;
+			else if (twin != None && singleOpen && openOut[twin] < Multiple && openIn[twin] < Multiple &&
+				memcmp(&verts[openOut[v]].Position, &verts[openIn[twin]].Position, sizeof(DirectX::XMFLOAT3)) == 0 &&
+				memcmp(&verts[openIn[v]].Position, &verts[openOut[twin]].Position, sizeof(DirectX::XMFLOAT3)) == 0)
+				kinds[v] = Seam;
+			else
+				kinds[v] = Locked;
+		}
+
+		// Gather every legal collapse along the current edges
+		collapses.clear();
+		for (unsigned long long edge : halfEdges)
+		{
+			for (int direction = 0; direction < 2; direction++)
+			{
+				unsigned int from = (unsigned int)(direction == 0 ? edge >> 32 : edge & 0xFFFFFFFF);
+				unsigned int to = (unsigned int)(direction == 0 ? edge & 0xFFFFFFFF : edge >> 32);
+
+				Collapse collapse = { from, to, None, None, 0.0, 0.0 };
+				switch (kinds[from])
+				{
+				case Manifold:
+					break;
+
+				case Border:
+					if (kinds[to] != Border || (openOut[from] != to && openIn[from] != to))
+						continue;
+					break;
+
+				case Seam:
+				{
+					if (kinds[to] != Seam || (openOut[from] != to && openIn[from] != to))
+						continue;
+
+					// The twin slides along the other side of the seam
+					unsigned int twinFrom = findTwin(from);
+					unsigned int twinTo = openOut[from] == to ? openIn[twinFrom] : openOut[twinFrom];
+					if (twinTo >= Multiple || kinds[twinTo] != Seam ||
+						memcmp(&verts[twinTo].Position, &verts[to].Position, sizeof(DirectX::XMFLOAT3)) != 0)
+						continue;
+
+					collapse.twinFrom = twinFrom;
+					collapse.twinTo = twinTo;
+					break;
+				}
+
+				default:
+					continue;
+				}
+
+				collapse.cost = quadrics[from].Evaluate(verts[to].Position);
+				collapse.weight = quadrics[from].weight;
+				if (collapse.twinFrom != None)
+				{
+					collapse.cost += quadrics[collapse.twinFrom].Evaluate(verts[to].Position);
+					collapse.weight += quadrics[collapse.twinFrom].weight;
+				}
+				collapses.push_back(collapse);
+			}
+		}
+
+		if (collapses.empty())
+			break;
+
+		std::sort(collapses.begin(), collapses.end(),
+			[](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+		// Apply the cheapest collapses with independent neighborhoods
+		for (size_t v = 0; v < vertexCount; v++)
+			remap[v] = (unsigned int)v;
+		std::fill(touched.begin(), touched.end(), false);
+
+		// Moving "from" onto "to" must not flip or flatten any surviving
+		// triangle.  Returns the number of triangles removed, or -1.
+		auto checkCollapse = [&](unsigned int from, unsigned int to) {
+			const DirectX::XMFLOAT3& target = verts[to].Position;
+			int removed = 0;
+			for (unsigned int at = offsets[from]; at < offsets[from + 1]; at++)
+			{
+				const unsigned int* tri = &result[adjacency[at] * 3];
+				if (tri[0] == to || tri[1] == to || tri[2] == to)
+				{
+					removed++;
+					continue;
+				}
+
+				DirectX::XMFLOAT3 before[3];
+				DirectX::XMFLOAT3 after[3];
+				for (int c = 0; c < 3; c++)
+				{
+					before[c] = verts[tri[c]].Position;
+					after[c] = tri[c] == from ? target : before[c];
+				}
+
+				DirectX::XMFLOAT3 n0 = FaceNormal(before[0], before[1], before[2]);
+				DirectX::XMFLOAT3 n1 = FaceNormal(after[0], after[1], after[2]);
+				float dot = n0.x * n1.x + n0.y * n1.y + n0.z * n1.z;
+				float lengths = sqrtf((n0.x * n0.x + n0.y * n0.y + n0.z * n0.z) * (n1.x * n1.x + n1.y * n1.y + n1.z * n1.z));
+				if (lengths == 0.0f || dot <= 0.25f * lengths)
+					return -1;
+			}
+			return removed;
+		};
+
+		auto freezeOneRing = [&](unsigned int v) {
+			for (unsigned int at = offsets[v]; at < offsets[v + 1]; at++)
+			{
+				const unsigned int* tri = &result[adjacency[at] * 3];
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = true;
+			}
+		};
+
+		size_t remainingTriangles = triangleCount;
+		size_t targetTriangles = targetIndexCount / 3;
+		double maxErrorSq = (double)maxError * maxError;
+		for (const Collapse& collapse : collapses)
+		{
+			if (remainingTriangles <= targetTriangles)
+				break;
+
+			bool hasTwin = collapse.twinFrom != None;
+			if (touched[collapse.from] || touched[collapse.to] ||
+				(hasTwin && (touched[collapse.twinFrom] || touched[collapse.twinTo])))
+				continue;
+
+			double collapseErrorSq = collapse.weight > 0.0 ? collapse.cost / collapse.weight : 0.0;
+			if (collapseErrorSq > maxErrorSq)
+				continue;
+
+			int removed = checkCollapse(collapse.from, collapse.to);
+			int twinRemoved = hasTwin ? checkCollapse(collapse.twinFrom, collapse.twinTo) : 0;
+			if (removed < 0 || twinRemoved < 0)
+				continue;
+
+			// Commit, and freeze the neighborhoods for the rest of this pass
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to].Add(quadrics[collapse.from]);
+			freezeOneRing(collapse.from);
+			if (hasTwin)
+			{
+				remap[collapse.twinFrom] = collapse.twinTo;
+				quadrics[collapse.twinTo].Add(quadrics[collapse.twinFrom]);
+				freezeOneRing(collapse.twinFrom);
+			}
+
+			worstError = std::max(worstError, collapseErrorSq);
+			remainingTriangles -= removed + twinRemoved;
+		}
+
+		// Rebuild the triangle list without the collapsed triangles
+		size_t write = 0;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			unsigned int a = remap[result[t * 3 + 0]];
+			unsigned int b = remap[result[t * 3 + 1]];
+			unsigned int c = remap[result[t * 3 + 2]];
+			if (a == b || b == c || c == a)
+				continue;
+
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+
+		// Stop once a pass can't make progress
+		if (write == result.size())
+			break;
+		result.resize(write);
+	}
+
+	error = (float)sqrt(worstError);
+	return result;
+}
+
+// --------------------------------------------------------
+// Builds the LOD chain at the end of the index buffer.
+//
+// Every level simplifies the full mesh rather than the previous
+// level, so each reported error is relative to what's actually
+// being replaced on screen.  A level must remove at least a
+// fifth of the previous level's triangles to be worth keeping,
+// though a later level with a looser error limit may still fit.
+// --------------------------------------------------------
+std::vector<MeshProcessing::LodLevel> MeshProcessing::BuildLods(const std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	std::vector<LodLevel> lods;
+	lods.push_back({ 0, (unsigned int)indices.size(), 0.0f });
+
+	// Error limits are a fraction of the bounds' diagonal
+	DirectX::XMFLOAT3 boundsMin, boundsMax;
+	CalculateBounds(verts.data(), verts.size(), boundsMin, boundsMax);
+	float dx = boundsMax.x - boundsMin.x;
+	float dy = boundsMax.y - boundsMin.y;
+	float dz = boundsMax.z - boundsMin.z;
+	float diagonal = sqrtf(dx * dx + dy * dy + dz * dz);
+
+	std::vector<unsigned int> source(indices);
+	float errorFraction = 0.01f;
+	for (unsigned int level = 1; level < MaxLodLevels; level++, errorFraction *= 2.0f)
+	{
+		size_t target = (source.size() >> level) / 3 * 3;
+		float error = 0.0f;
+		std::vector<unsigned int> simplified = SimplifyMesh(verts, source, target, diagonal * errorFraction, error);
+
+		const LodLevel& previous = lods.back();
+		if (simplified.empty() || simplified.size() * 5 > (size_t)previous.indexCount * 4)
+			continue;
+
+		OptimizeVertexCache(simplified, verts.size());
+		lods.push_back({ (unsigned int)indices.size(), (unsigned int)simplified.size(), error });
+		indices.insert(indices.end(), simplified.begin(), simplified.end());
+	}
+
+	return lods;
+}
+
+// --------------------------------------------------------
+// Corners are matched by position through a sort, which gives
+// every distinct position an id.  Each directed edge (a to b)
+// is then keyed by its ids, and its neighbor is whichever
+// triangle has the opposite edge (b to a), when exactly one
+// does and nothing else runs a to b.
+// --------------------------------------------------------
+MeshProcessing::OccluderGeometry MeshProcessing::BuildOccluderGeometry(const DirectX::XMFLOAT3* positions, const unsigned int* indices, size_t indexCount)
+{
+	OccluderGeometry geometry;
+	size_t triangleCount = indexCount / 3;
+	geometry.corners.resize(triangleCount * 3);
+	geometry.neighbors.assign(triangleCount * 3, NoNeighbor);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		geometry.corners[i] = positions[indices[i]];
+
+	// Position ids, by corner
+	std::vector<unsigned int> order(geometry.corners.size());
+	for (unsigned int i = 0; i < order.size(); i++)
+		order[i] = i;
+	auto lessPosition = [&](unsigned int a, unsigned int b)
+	{
+		const DirectX::XMFLOAT3& pa = geometry.corners[a];
+		const DirectX::XMFLOAT3& pb = geometry.corners[b];
+		if (pa.x != pb.x) return pa.x < pb.x;
+		if (pa.y != pb.y) return pa.y < pb.y;
+		return pa.z < pb.z;
+	};
+	std::sort(order.begin(), order.end(), lessPosition);
+
+	std::vector<uint32_t> ids(geometry.corners.size());
+	uint32_t id = 0;
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		if (i > 0 && lessPosition(order[i - 1], order[i]))
+			id++;
+		ids[order[i]] = id;
+	}
+
+	// Directed edges, sorted by key
+	std::vector<std::pair<uint64_t, unsigned int>> edges;
+	edges.reserve(geometry.corners.size());
+	for (unsigned int t = 0; t < triangleCount; t++)
+	{
+		for (unsigned int e = 0; e < 3; e++)
+		{
+			uint32_t a = ids[t * 3 + e];
+			uint32_t b = ids[t * 3 + (e + 1) % 3];
+			if (a != b)
+				edges.push_back({ ((uint64_t)a << 32) | b, t * 3 + e });
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+
+	// How many edges have a key, found by binary search
+	auto findEdges = [&](uint64_t key, size_t& first)
+	{
+		auto range = std::equal_range(edges.begin(), edges.end(), std::make_pair(key, 0u),
+			[](const std::pair<uint64_t, unsigned int>& x, const std::pair<uint64_t, unsigned int>& y) { return x.first < y.first; });
+		first = range.first - edges.begin();
+		return (size_t)(range.second - range.first);
+	};
+
+	for (size_t i = 0; i < edges.size(); i++)
+	{
+		uint64_t key = edges[i].first;
+		uint64_t opposite = (key << 32) | (key >> 32);
+		size_t first = 0, oppositeFirst = 0;
+		if (findEdges(key, first) == 1 && findEdges(opposite, oppositeFirst) == 1)
+			geometry.neighbors[edges[i].second] = edges[oppositeFirst].second / 3;
+	}
+
+	return geometry;
+}
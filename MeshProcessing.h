@@ -0,0 +1,185 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// CPU-side mesh processing helpers
+//
+// These only touch plain vertex/index arrays (no D3D objects),
+// so they can run and be timed without a graphics device
+// --------------------------------------------------------
+namespace MeshProcessing
+{
+	// Results of a vertex welding pass
+	struct WeldStats
+	{
+		unsigned int verticesBefore;	// Vertex count coming into the pass
+		unsigned int verticesAfter;		// Unique vertices left after welding
+		double milliseconds;			// Time spent deduplicating
+	};
+
+	// Post-transform vertex cache efficiency of an index buffer
+	struct VertexCacheStats
+	{
+		float acmr;		// Average cache misses per triangle (0.5 is ideal for big grids, 3 is worst)
+		float atvr;		// Average transforms per vertex (1 is ideal)
+	};
+
+	// Largest differences between vertices and their packed round trip
+	struct PackingError
+	{
+		float position;			// Object-space distance
+		float uv;				// Per-component UV difference
+		float normalDegrees;	// Angle between original and decoded normals
+		float tangentDegrees;	// Angle between original and decoded tangents
+	};
+
+	// Meshlet size limits, small enough for a meshlet's vertices
+	// to stay resident in the post-transform cache
+	const unsigned int MaxMeshletVertices = 64;
+	const unsigned int MaxMeshletTriangles = 124;
+
+	// A small cluster of neighboring triangles stored contiguously
+	// in the index buffer, with bounds for culling the whole cluster
+	struct Meshlet
+	{
+		unsigned int indexStart;		// First index in the mesh's index buffer
+		unsigned int indexCount;		// Three per triangle
+		DirectX::XMFLOAT3 center;		// Object-space bounding sphere
+		float radius;
+		DirectX::XMFLOAT3 coneAxis;		// Average facing direction of the triangles
+		float coneCutoff;				// Sine of the normal cone's half angle, 1 if it can never be backfacing
+	};
+
+	// One level of detail, stored as a range of the mesh's index buffer
+	struct LodLevel
+	{
+		unsigned int indexStart;
+		unsigned int indexCount;
+		float error;			// Approximate object-space deviation from the full mesh
+	};
+
+	// A run of indices to submit with a single DrawIndexed
+	struct DrawRange
+	{
+		unsigned int indexStart;
+		unsigned int indexCount;
+	};
+
+	// Marks an occluder edge with no triangle across it
+	const unsigned int NoNeighbor = 0xFFFFFFFF;
+
+	// Triangles laid out for the CPU occlusion buffer: three corners
+	// each, and for each edge (corner i to i + 1) the triangle across it
+	struct OccluderGeometry
+	{
+		std::vector<DirectX::XMFLOAT3> corners;
+		std::vector<unsigned int> neighbors;
+	};
+
+	// Merge vertices with identical position/uv/normal and rewrite
+	// the index list so triangles share the surviving vertices
+	WeldStats WeldVertices(std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
+	// Reorders triangles so recently used vertices are reused while
+	// they're still in the post-transform cache (Forsyth's algorithm)
+	void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+
+	// Reorders vertices into the order the index buffer first uses them,
+	// so vertex fetches walk memory linearly.  Unused vertices are dropped.
+	void OptimizeVertexFetch(std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
+	// Edge-collapse simplification driven by quadric error.  Returns a
+	// new index list over the same vertices, stopping at targetIndexCount
+	// indices or when every remaining collapse would exceed maxError
+	// (object-space units).  Borders and UV/normal seams only collapse
+	// along themselves, so they can't tear open.  "error" receives the
+	// RMS distance of the worst collapse to its accumulated planes.
+	std::vector<unsigned int> SimplifyMesh(const std::vector<Vertex>& verts, const std::vector<unsigned int>& indices, size_t targetIndexCount, float maxError, float& error);
+
+	// Most levels BuildLods produces, including the full mesh
+	const unsigned int MaxLodLevels = 4;
+
+	// Simplifies the full mesh (all of "indices") to a half, a quarter and
+	// an eighth of its triangles, with error limits that grow with the mesh
+	// bounds.  Each level is cache optimized and appended to "indices".
+	// Levels that barely shrink are dropped, so level 0 may be the only one.
+	std::vector<LodLevel> BuildLods(const std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
+	// Groups triangles into meshlets by growing each one across shared
+	// vertices, then rewrites "indices" meshlet by meshlet.  Each meshlet's
+	// triangles are cache optimized and meshlets are ordered for overdraw.
+	std::vector<Meshlet> BuildMeshlets(
+		std::vector<unsigned int>& indices,
+		const std::vector<Vertex>& verts,
+		unsigned int maxVertices = MaxMeshletVertices,
+		unsigned int maxTriangles = MaxMeshletTriangles);
+
+	// Unrolls a triangle list into occluder corners and finds each edge's
+	// neighbor by position, so seams in normals or UVs don't split the
+	// surface.  Edges used by more than two triangles (or twice in the
+	// same direction) get NoNeighbor, like open borders.
+	OccluderGeometry BuildOccluderGeometry(const DirectX::XMFLOAT3* positions, const unsigned int* indices, size_t indexCount);
+
+	// Inward-facing frustum planes (xyz normal, w distance) from a row-major
+	// matrix.  Passing world * view * projection gives object-space planes.
+	void ExtractFrustumPlanes(const DirectX::XMFLOAT4X4& matrix, DirectX::XMFLOAT4 planes[6]);
+
+	// Whether every triangle in the meshlet faces away from the position
+	bool IsMeshletBackfacing(const Meshlet& meshlet, DirectX::XMFLOAT3 viewPosition);
+
+	// Tests meshlets against object-space frustum planes and, when a
+	// view position is given, their normal cones.  Adjacent visible
+	// meshlets are merged into a single range.  Returns the visible count.
+	unsigned int CullMeshlets(
+		const Meshlet* meshlets,
+		size_t meshletCount,
+		const DirectX::XMFLOAT4 planes[6],
+		const DirectX::XMFLOAT3* viewPosition,
+		std::vector<DrawRange>& ranges);
+
+	// Simulates a FIFO post-transform cache over the index buffer
+	VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = 16);
+
+	// Compresses vertices into the GPU layout.  Positions are quantized
+	// within the given bounds, which the shader needs back as a scale
+	// and offset (see GetPositionDecode)
+	void PackVertices(const Vertex* verts, size_t vertexCount, DirectX::XMFLOAT3 boundsMin, DirectX::XMFLOAT3 boundsMax, std::vector<PackedVertex>& packed);
+
+	// Expands a packed vertex the same way the vertex shader does
+	Vertex UnpackVertex(const PackedVertex& packed, DirectX::XMFLOAT3 positionScale, DirectX::XMFLOAT3 positionOffset);
+
+	// Per-axis scale and offset that turn 16-bit positions back into object space
+	void GetPositionDecode(DirectX::XMFLOAT3 boundsMin, DirectX::XMFLOAT3 boundsMax, DirectX::XMFLOAT3& positionScale, DirectX::XMFLOAT3& positionOffset);
+
+	// Round trips every vertex through the packed layout and reports the worst error
+	PackingError MeasurePackingError(const Vertex* verts, const PackedVertex* packed, size_t vertexCount, DirectX::XMFLOAT3 positionScale, DirectX::XMFLOAT3 positionOffset);
+
+	// Axis-aligned min/max corners of the vertex positions (zeros if there are none)
+	void CalculateBounds(const Vertex* verts, size_t vertexCount, DirectX::XMFLOAT3& boundsMin, DirectX::XMFLOAT3& boundsMax);
+
+	// How each triangle's tangent contributes to its corners
+	enum class TangentWeighting
+	{
+		Classic,	// Raw UV-derived tangents summed as-is, matching CalculateTangentsReference
+		Angle		// MikkTSpace style: projected onto each corner's normal and weighted by the corner's angle
+	};
+
+	// The original scalar tangent generation, kept as a reference for comparisons
+	void CalculateTangentsReference(Vertex* verts, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+
+	// Tangent generation working on four triangles (then four vertices) at a
+	// time in SIMD lanes, spread across threads.  Every vertex sums its own
+	// triangles in index order, so results don't depend on the thread count.
+	// - threadCount of 0 picks a count based on mesh size and core count
+	void CalculateTangents(
+		Vertex* verts,
+		size_t vertexCount,
+		const unsigned int* indices,
+		size_t indexCount,
+		TangentWeighting weighting = TangentWeighting::Classic,
+		unsigned int threadCount = 0);
+}
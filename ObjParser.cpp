@@ -0,0 +1,595 @@
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+
+#include <DirectXMath.h>
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <stdio.h>
+#include <thread>
+
+using namespace DirectX;
+
+// sscanf_s is MSVC-only, but the legacy loader only reads
+// numbers with it, where plain sscanf behaves the same
+#ifndef _MSC_VER
+#define sscanf_s sscanf
+#endif
+
+// Anonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// Files smaller than this are not worth splitting across more threads
+	const size_t MinBytesPerChunk = 128 * 1024;
+
+	// Face indices are either global (zero-based, >= 0), missing,
+	// or relative to the start of the chunk that read them.
+	// Relative ones come from negative OBJ indices and are stored
+	// shifted down by RelativeBias until the chunks are merged.
+	const int MissingIndex = INT_MIN;
+	const int RelativeBias = 1 << 30;
+
+	// One corner of a triangle, indexing into the position/uv/normal lists
+	struct Corner
+	{
+		int Position;
+		int UV;
+		int Normal;
+	};
+
+	// Everything read from one chunk of the file
+	struct ChunkResult
+	{
+		std::vector<XMFLOAT3> positions;
+		std::vector<XMFLOAT2> uvs;
+		std::vector<XMFLOAT3> normals;
+		std::vector<Corner> corners;	// Three per triangle, already in final winding order
+	};
+
+	bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+	const char* SkipSpaces(const char* c, const char* end)
+	{
+		while (c < end && IsSpace(*c))
+			c++;
+		return c;
+	}
+
+	// Powers of ten that are exactly representable as floats
+	const float ExactPowersOfTen[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+	bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+	// --------------------------------------------------------
+	// Reads one float, leaving 0 in place of anything unreadable.
+	//
+	// Plain decimals like "-1.128088" take a fast path: when the digits
+	// fit in a float's 24-bit significand and the power of ten is exact,
+	// a single float multiply/divide is correctly rounded, so the result
+	// is identical to std::from_chars (and sscanf).  Anything else
+	// (exponents, long mantissas, inf/nan) falls back to std::from_chars.
+	// --------------------------------------------------------
+	const char* ParseFloat(const char* c, const char* end, float& out)
+	{
+		c = SkipSpaces(c, end);
+		if (c < end && *c == '+')
+			c++;
+
+		// Fast path
+		const char* p = c;
+		bool negative = (p < end && *p == '-');
+		if (negative)
+			p++;
+
+		unsigned long long mantissa = 0;
+		int digits = 0;
+		int fractionDigits = 0;
+		const char* digitsStart = p;
+		while (p < end && IsDigit(*p) && digits < 19)
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			digits++;
+			p++;
+		}
+		if (p < end && *p == '.')
+		{
+			p++;
+			while (p < end && IsDigit(*p) && digits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				digits++;
+				fractionDigits++;
+				p++;
+			}
+		}
+
+		bool simpleNumber =
+			p > digitsStart && digits > 0 &&
+			(p == end || !(IsDigit(*p) || *p == 'e' || *p == 'E' || *p == '.')) &&
+			mantissa <= (1ull << 24) &&
+			fractionDigits <= 10;
+		if (simpleNumber)
+		{
+			float value = (float)mantissa / ExactPowersOfTen[fractionDigits];
+			out = negative ? -value : value;
+			return p;
+		}
+
+		// Slow path
+		std::from_chars_result result = std::from_chars(c, end, out);
+		if (result.ec != std::errc())
+		{
+			out = 0.0f;
+			return c;
+		}
+		return result.ptr;
+	}
+
+	// Converts a raw OBJ index into our global/relative/missing encoding
+	// - OBJ indices are 1-based, negative ones count back from the newest element
+	int ResolveIndex(int raw, size_t countInChunk)
+	{
+		if (raw > 0) return raw - 1;
+		if (raw < 0) return (int)countInChunk + raw - RelativeBias;
+		return MissingIndex;
+	}
+
+	// Reads a "v", "v/vt", "v//vn" or "v/vt/vn" face corner
+	const char* ParseCorner(const char* c, const char* end, int raw[3])
+	{
+		raw[0] = raw[1] = raw[2] = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			// A number may be absent (as in "v//vn")
+			bool negative = (c < end && *c == '-');
+			const char* digits = negative ? c + 1 : c;
+			// Saturates below RelativeBias, so an absurdly long index
+			// can neither overflow nor collide with the encoding (and
+			// is simply out of range)
+			long long value = 0;
+			while (digits < end && IsDigit(*digits))
+				value = std::min(value * 10 + (*digits++ - '0'), (long long)RelativeBias - 1);
+
+			if (digits > c + (negative ? 1 : 0))
+			{
+				raw[i] = (int)(negative ? -value : value);
+				c = digits;
+			}
+
+			if (c >= end || *c != '/')
+				break;
+			c++;
+		}
+		return c;
+	}
+
+	// --------------------------------------------------------
+	// Parses the lines between begin and end, which must start at
+	// the beginning of a line.  Faces are triangulated as a fan,
+	// matching the winding of the original loader for tris and quads.
+	// --------------------------------------------------------
+	void ParseChunk(const char* begin, const char* end, ChunkResult& out)
+	{
+		// Corners of the face currently being read
+		std::vector<Corner> face;
+
+		const char* c = begin;
+		while (c < end)
+		{
+			// Find the extent of this line
+			const char* lineEnd = (const char*)memchr(c, '\n', end - c);
+			if (!lineEnd)
+				lineEnd = end;
+
+			c = SkipSpaces(c, lineEnd);
+			if (lineEnd - c >= 2)
+			{
+				if (c[0] == 'v' && IsSpace(c[1]))
+				{
+					XMFLOAT3 pos;
+					c = ParseFloat(c + 1, lineEnd, pos.x);
+					c = ParseFloat(c, lineEnd, pos.y);
+					c = ParseFloat(c, lineEnd, pos.z);
+					out.positions.push_back(pos);
+				}
+				else if (c[0] == 'v' && c[1] == 't')
+				{
+					XMFLOAT2 uv;
+					c = ParseFloat(c + 2, lineEnd, uv.x);
+					c = ParseFloat(c, lineEnd, uv.y);
+					out.uvs.push_back(uv);
+				}
+				else if (c[0] == 'v' && c[1] == 'n')
+				{
+					XMFLOAT3 norm;
+					c = ParseFloat(c + 2, lineEnd, norm.x);
+					c = ParseFloat(c, lineEnd, norm.y);
+					c = ParseFloat(c, lineEnd, norm.z);
+					out.normals.push_back(norm);
+				}
+				else if (c[0] == 'f' && IsSpace(c[1]))
+				{
+					// Read every corner on the line (no length limit)
+					face.clear();
+					c = SkipSpaces(c + 1, lineEnd);
+					while (c < lineEnd)
+					{
+						int raw[3];
+						const char* next = ParseCorner(c, lineEnd, raw);
+						if (next == c)
+							break;
+
+						Corner corner;
+						corner.Position = ResolveIndex(raw[0], out.positions.size());
+						corner.UV = ResolveIndex(raw[1], out.uvs.size());
+						corner.Normal = ResolveIndex(raw[2], out.normals.size());
+						face.push_back(corner);
+
+						c = SkipSpaces(next, lineEnd);
+					}
+
+					// Fan triangulate, flipping the winding order for DirectX
+					for (size_t i = 1; i + 1 < face.size(); i++)
+					{
+						out.corners.push_back(face[0]);
+						out.corners.push_back(face[i + 1]);
+						out.corners.push_back(face[i]);
+					}
+				}
+			}
+
+			c = lineEnd + 1;
+		}
+	}
+
+	// Turns an encoded index into a global one, or -1 if it's missing/out of range
+	long long GlobalIndex(int index, size_t chunkOffset, size_t count)
+	{
+		long long global;
+		if (index == MissingIndex) return -1;
+		else if (index >= 0) global = index;
+		else global = (long long)chunkOffset + index + RelativeBias;
+
+		return (global >= 0 && global < (long long)count) ? global : -1;
+	}
+
+	// --------------------------------------------------------
+	// Builds the final vertices for one chunk's corners, applying
+	// the same right-handed to left-handed conversion as the
+	// original loader (flip Z, flip the normal's Z, flip V)
+	// --------------------------------------------------------
+	void BuildVertices(
+		const ChunkResult& chunk,
+		size_t positionOffset, size_t uvOffset, size_t normalOffset,
+		const std::vector<XMFLOAT3>& positions,
+		const std::vector<XMFLOAT2>& uvs,
+		const std::vector<XMFLOAT3>& normals,
+		Vertex* out)
+	{
+		for (size_t i = 0; i < chunk.corners.size(); i++)
+		{
+			const Corner& corner = chunk.corners[i];
+			long long p = GlobalIndex(corner.Position, positionOffset, positions.size());
+			long long t = GlobalIndex(corner.UV, uvOffset, uvs.size());
+			long long n = GlobalIndex(corner.Normal, normalOffset, normals.size());
+
+			// Missing data falls back to zeroes, except that a corner
+			// with no UV ("v//vn") gets the file's first UV if it has
+			// any, as the original loader does
+			Vertex v = {};
+			if (p >= 0) v.Position = positions[p];
+			if (t >= 0) v.UV = uvs[t];
+			else if (corner.UV == MissingIndex && !uvs.empty()) v.UV = uvs[0];
+			if (n >= 0) v.Normal = normals[n];
+
+			v.UV.y = 1.0f - v.UV.y;
+			v.Position.z *= -1.0f;
+			v.Normal.z *= -1.0f;
+
+			out[i] = v;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Loads an OBJ by memory mapping it and parsing chunks of lines
+// on several threads, then merging the results in file order.
+//
+// - Output matches LoadLegacy() for triangles and quads
+// - Lines of any length are supported, and larger polygons are
+//   fan triangulated rather than dropped
+// - Negative (relative) indices are supported
+//
+// Returns false if the file could not be opened
+// --------------------------------------------------------
+bool ObjParser::Load(const char* filename, std::vector<Vertex>& verts, std::vector<unsigned int>& indices, unsigned int threadCount)
+{
+	verts.clear();
+	indices.clear();
+
+	MappedFile file;
+	if (!file.Open(filename))
+		return false;
+
+	const char* data = file.GetData();
+	size_t size = file.GetSize();
+
+	// Pick how many pieces to split the file into
+	if (threadCount == 0)
+	{
+		size_t bySize = size / MinBytesPerChunk + 1;
+		size_t cores = std::thread::hardware_concurrency();
+		threadCount = (unsigned int)(bySize < cores ? bySize : (cores > 0 ? cores : 1));
+	}
+
+	// Chunk boundaries always land just after a newline
+	std::vector<size_t> boundaries(threadCount + 1, size);
+	boundaries[0] = 0;
+	for (unsigned int i = 1; i < threadCount; i++)
+	{
+		size_t b = size * i / threadCount;
+		if (b < boundaries[i - 1]) b = boundaries[i - 1];
+		while (b > 0 && b < size && data[b - 1] != '\n')
+			b++;
+		boundaries[i] = b;
+	}
+
+	// Parse every chunk independently
+	std::vector<ChunkResult> chunks(threadCount);
+	RunParallel(threadCount, [&](size_t i)
+	{
+		ParseChunk(data + boundaries[i], data + boundaries[i + 1], chunks[i]);
+	});
+
+	// Figure out where each chunk's data lands in the merged arrays
+	std::vector<size_t> positionOffsets(threadCount), uvOffsets(threadCount), normalOffsets(threadCount), cornerOffsets(threadCount);
+	size_t positionCount = 0, uvCount = 0, normalCount = 0, cornerCount = 0;
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		positionOffsets[i] = positionCount;	positionCount += chunks[i].positions.size();
+		uvOffsets[i] = uvCount;				uvCount += chunks[i].uvs.size();
+		normalOffsets[i] = normalCount;		normalCount += chunks[i].normals.size();
+		cornerOffsets[i] = cornerCount;		cornerCount += chunks[i].corners.size();
+	}
+
+	// Merge the raw attribute lists in file order
+	std::vector<XMFLOAT3> positions;
+	std::vector<XMFLOAT2> uvs;
+	std::vector<XMFLOAT3> normals;
+	positions.reserve(positionCount);
+	uvs.reserve(uvCount);
+	normals.reserve(normalCount);
+	for (ChunkResult& chunk : chunks)
+	{
+		positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+		uvs.insert(uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+		normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+	}
+
+	// Assemble vertices, again one chunk per thread
+	verts.resize(cornerCount);
+	RunParallel(threadCount, [&](size_t i)
+	{
+		BuildVertices(chunks[i], positionOffsets[i], uvOffsets[i], normalOffsets[i],
+			positions, uvs, normals, verts.data() + cornerOffsets[i]);
+	});
+
+	// Every corner is its own vertex, so the indices are sequential
+	indices.resize(cornerCount);
+	for (size_t i = 0; i < cornerCount; i++)
+		indices[i] = (unsigned int)i;
+
+	return true;
+}
+
+// --------------------------------------------------------
+// The original loader, which reads line by line into a fixed
+// buffer and parses with sscanf.  Kept for comparing output
+// and load times against Load().
+//
+// Returns false if the file could not be opened
+// --------------------------------------------------------
+bool ObjParser::LoadLegacy(const char* filename, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	// Author: Chris Cascioli
+	// Purpose: Basic .OBJ 3D model loading, supporting positions, uvs and normals
+
+	// Start from empty output arrays
+	verts.clear();
+	indices.clear();
+
+	// File input object
+	std::ifstream obj(filename);
+
+	// Check for successful open
+	if (!obj.is_open())
+		return false;
+
+	// Variables used while reading the file
+	std::vector<XMFLOAT3> positions;	// Positions from the file
+	std::vector<XMFLOAT3> normals;		// Normals from the file
+	std::vector<XMFLOAT2> uvs;		// UVs from the file
+	int vertCounter = 0;			// Count of vertices
+	int indexCounter = 0;			// Count of indices
+	char chars[100];			// String for line reading
+
+	// Still have data left?
+	while (obj.good())
+	{
+		// Get the line (100 characters should be more than enough)
+		obj.getline(chars, 100);
+
+		// Check the type of line
+		if (chars[0] == 'v' && chars[1] == 'n')
+		{
+			// Read the 3 numbers directly into an XMFLOAT3
+			XMFLOAT3 norm;
+			sscanf_s(
+				chars,
+				"vn %f %f %f",
+				&norm.x, &norm.y, &norm.z);
+
+			// Add to the list of normals
+			normals.push_back(norm);
+		}
+		else if (chars[0] == 'v' && chars[1] == 't')
+		{
+			// Read the 2 numbers directly into an XMFLOAT2
+			XMFLOAT2 uv;
+			sscanf_s(
+				chars,
+				"vt %f %f",
+				&uv.x, &uv.y);
+
+			// Add to the list of uv's
+			uvs.push_back(uv);
+		}
+		else if (chars[0] == 'v')
+		{
+			// Read the 3 numbers directly into an XMFLOAT3
+			XMFLOAT3 pos;
+			sscanf_s(
+				chars,
+				"v %f %f %f",
+				&pos.x, &pos.y, &pos.z);
+
+			// Add to the positions
+			positions.push_back(pos);
+		}
+		else if (chars[0] == 'f')
+		{
+			// Read the face indices into an array
+			// NOTE: This assumes the given obj file contains
+			//  vertex positions, uv coordinates AND normals.
+			unsigned int i[12];
+			int numbersRead = sscanf_s(
+				chars,
+				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
+				&i[0], &i[1], &i[2],
+				&i[3], &i[4], &i[5],
+				&i[6], &i[7], &i[8],
+				&i[9], &i[10], &i[11]);
+
+			// If we only got the first number, chances are the OBJ
+			// file has no UV coordinates.  This isn't great, but we
+			// still want to load the model without crashing, so we
+			// need to re-read a different pattern (in which we assume
+			// there are no UVs denoted for any of the vertices)
+			if (numbersRead == 1)
+			{
+				// Re-read with a different pattern
+				numbersRead = sscanf_s(
+					chars,
+					"f %d//%d %d//%d %d//%d %d//%d",
+					&i[0], &i[2],
+					&i[3], &i[5],
+					&i[6], &i[8],
+					&i[9], &i[11]);
+
+				// The following indices are where the UVs should 
+				// have been, so give them a valid value
+				i[1] = 1;
+				i[4] = 1;
+				i[7] = 1;
+				i[10] = 1;
+
+				// If we have no UVs, create a single UV coordinate
+				// that will be used for all vertices
+				if (uvs.size() == 0)
+					uvs.push_back(XMFLOAT2(0, 0));
+			}
+
+			// - Create the verts by looking up
+			//    corresponding data from vectors
+			// - OBJ File indices are 1-based, so
+			//    they need to be adusted
+			Vertex v1;
+			v1.Position = positions[i[0] - 1];
+			v1.UV = uvs[i[1] - 1];
+			v1.Normal = normals[i[2] - 1];
+
+			Vertex v2;
+			v2.Position = positions[i[3] - 1];
+			v2.UV = uvs[i[4] - 1];
+			v2.Normal = normals[i[5] - 1];
+
+			Vertex v3;
+			v3.Position = positions[i[6] - 1];
+			v3.UV = uvs[i[7] - 1];
+			v3.Normal = normals[i[8] - 1];
+
+			// The model is most likely in a right-handed space,
+			// especially if it came from Maya.  We want to convert
+			// to a left-handed space for DirectX.  This means we 
+			// need to:
+			//  - Invert the Z position
+			//  - Invert the normal's Z
+			//  - Flip the winding order
+			// We also need to flip the UV coordinate since DirectX
+			// defines (0,0) as the top left of the texture, and many
+			// 3D modeling packages use the bottom left as (0,0)
+
+			// Flip the UV's since they're probably "upside down"
+			v1.UV.y = 1.0f - v1.UV.y;
+			v2.UV.y = 1.0f - v2.UV.y;
+			v3.UV.y = 1.0f - v3.UV.y;
+
+			// Flip Z (LH vs. RH)
+			v1.Position.z *= -1.0f;
+			v2.Position.z *= -1.0f;
+			v3.Position.z *= -1.0f;
+
+			// Flip normal's Z
+			v1.Normal.z *= -1.0f;
+			v2.Normal.z *= -1.0f;
+			v3.Normal.z *= -1.0f;
+
+			// Add the verts to the vector (flipping the winding order)
+			verts.push_back(v1);
+			verts.push_back(v3);
+			verts.push_back(v2);
+			vertCounter += 3;
+
+			// Add three more indices
+			indices.push_back(indexCounter); indexCounter += 1;
+			indices.push_back(indexCounter); indexCounter += 1;
+			indices.push_back(indexCounter); indexCounter += 1;
+
+			// Was there a 4th face?
+			// - 12 numbers read means 4 faces WITH uv's
+			// - 8 numbers read means 4 faces WITHOUT uv's
+			if (numbersRead == 12 || numbersRead == 8)
+			{
+				// Make the last vertex
+				Vertex v4;
+				v4.Position = positions[i[9] - 1];
+				v4.UV = uvs[i[10] - 1];
+				v4.Normal = normals[i[11] - 1];
+
+				// Flip the UV, Z pos and normal's Z
+				v4.UV.y = 1.0f - v4.UV.y;
+				v4.Position.z *= -1.0f;
+				v4.Normal.z *= -1.0f;
+
+				// Add a whole triangle (flipping the winding order)
+				verts.push_back(v1);
+				verts.push_back(v4);
+				verts.push_back(v3);
+				vertCounter += 3;
+
+				// Add three more indices
+				indices.push_back(indexCounter); indexCounter += 1;
+				indices.push_back(indexCounter); indexCounter += 1;
+				indices.push_back(indexCounter); indexCounter += 1;
+			}
+		}
+	}
+
+	// Close the file
+	obj.close();
+	return true;
+}
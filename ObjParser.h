@@ -0,0 +1,22 @@
+#pragma once
+
+#include <vector>
+
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// .OBJ file loading
+//
+// Both loaders produce one vertex per face corner with a
+// sequential index list, converted to DirectX conventions
+// (left-handed, flipped UVs, flipped winding order)
+// --------------------------------------------------------
+namespace ObjParser
+{
+	// Memory maps the file and parses it in parallel chunks
+	// - threadCount of 0 picks a count based on file size and core count
+	bool Load(const char* filename, std::vector<Vertex>& verts, std::vector<unsigned int>& indices, unsigned int threadCount = 0);
+
+	// Original getline + sscanf loader, kept as a reference for comparisons
+	bool LoadLegacy(const char* filename, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+}
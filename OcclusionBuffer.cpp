@@ -0,0 +1,625 @@
+#include "OcclusionBuffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+using namespace DirectX;
+
+// Anonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	double GetMilliseconds()
+	{
+		return std::chrono::duration<double, std::milli>(
+			std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+	}
+
+	// --------------------------------------------------------
+	// Clip-space planes triangles are clipped against: the near
+	// plane, then the sides pushed out past the screen, so the
+	// clipped edges never cut through a visible pixel while the
+	// screen coordinates stay small enough for float edge tests
+	// --------------------------------------------------------
+	const int ClipPlaneCount = 5;
+	const float GuardBand = 1.25f;
+
+	float ClipDistance(const XMFLOAT4& v, int plane)
+	{
+		switch (plane)
+		{
+		case 0: return v.z;
+		case 1: return GuardBand * v.w - v.x;
+		case 2: return GuardBand * v.w + v.x;
+		case 3: return GuardBand * v.w - v.y;
+		default: return GuardBand * v.w + v.y;
+		}
+	}
+
+	XMFLOAT4 Lerp(const XMFLOAT4& a, const XMFLOAT4& b, float t)
+	{
+		return XMFLOAT4(
+			a.x + (b.x - a.x) * t,
+			a.y + (b.y - a.y) * t,
+			a.z + (b.z - a.z) * t,
+			a.w + (b.w - a.w) * t);
+	}
+
+	// --------------------------------------------------------
+	// Sutherland-Hodgman against every clip plane, writing the
+	// clipped polygon over "polygon" and returning its corner
+	// count (each plane adds at most one corner).  "shared" says
+	// whether the edge leaving each corner is shared with another
+	// front face; edges along a clip plane never are.
+	// --------------------------------------------------------
+	const int MaxClippedCorners = 3 + ClipPlaneCount;
+
+	int ClipPolygon(XMFLOAT4 polygon[MaxClippedCorners], bool shared[MaxClippedCorners], int count)
+	{
+		XMFLOAT4 clipped[MaxClippedCorners];
+		bool clippedShared[MaxClippedCorners];
+		for (int plane = 0; plane < ClipPlaneCount && count > 0; plane++)
+		{
+			int clippedCount = 0;
+			for (int i = 0; i < count; i++)
+			{
+				const XMFLOAT4& a = polygon[i];
+				const XMFLOAT4& b = polygon[(i + 1) % count];
+				float da = ClipDistance(a, plane);
+				float db = ClipDistance(b, plane);
+
+				if (da >= 0)
+				{
+					clippedShared[clippedCount] = shared[i];
+					clipped[clippedCount++] = a;
+				}
+				if ((da >= 0) != (db >= 0))
+				{
+					clippedShared[clippedCount] = da < 0 && shared[i];
+					clipped[clippedCount++] = Lerp(a, b, da / (da - db));
+				}
+			}
+
+			count = clippedCount;
+			std::copy(clipped, clipped + count, polygon);
+			std::copy(clippedShared, clippedShared + count, shared);
+		}
+		return count;
+	}
+}
+
+// --------------------------------------------------------
+// Sizes the buffer and its pyramid, which is halved (rounding
+// up) until it's a single texel
+// --------------------------------------------------------
+OcclusionBuffer::OcclusionBuffer(unsigned int width, unsigned int height, unsigned int threadCount) :
+	viewProjection(),
+	renderWorker(1),
+	ready(false),
+	setupMilliseconds(0.0),
+	rasterMilliseconds(0.0),
+	pyramidMilliseconds(0.0)
+{
+	tilesX = std::max((width + TileWidth - 1) / TileWidth, 1u);
+	tilesY = std::max((height + TileHeight - 1) / TileHeight, 1u);
+	this->width = tilesX * TileWidth;
+	this->height = tilesY * TileHeight;
+
+	if (threadCount == 0)
+	{
+		unsigned int cores = std::thread::hardware_concurrency();
+		threadCount = cores > 1 ? cores - 1 : 1;
+	}
+	this->threadCount = std::min(threadCount, tilesX * tilesY);
+	tileWorkers = std::make_unique<WorkerPool>(this->threadCount - 1);
+
+	depth.assign(this->width * this->height, 1.0f);
+	bins.resize(tilesX * tilesY);
+
+	unsigned int w = this->width, h = this->height;
+	levelWidths.push_back(w);
+	levelHeights.push_back(h);
+	minLevels.emplace_back();
+	maxLevels.emplace_back();
+	while (w > 1 || h > 1)
+	{
+		w = (w + 1) / 2;
+		h = (h + 1) / 2;
+		levelWidths.push_back(w);
+		levelHeights.push_back(h);
+		minLevels.emplace_back(w * h, 1.0f);
+		maxLevels.emplace_back(w * h, 1.0f);
+	}
+}
+
+OcclusionBuffer::~OcclusionBuffer()
+{
+	Finish();
+}
+
+void OcclusionBuffer::Begin(const XMFLOAT4X4& view, const XMFLOAT4X4& projection)
+{
+	Finish();
+	ready = false;
+	occluders.clear();
+	XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&projection)));
+}
+
+void OcclusionBuffer::AddOccluder(const XMFLOAT4X4& world, const MeshProcessing::OccluderGeometry& geometry)
+{
+	Occluder occluder = {};
+	occluder.world = world;
+	occluder.geometry = &geometry;
+	occluders.push_back(occluder);
+}
+
+// --------------------------------------------------------
+// Brings each occluder's corners to clip space and finds its
+// front faces (clockwise on screen, like the GPU's), from the
+// sign of the corners' homogeneous determinant so triangles
+// crossing the near plane work too.  Back faces are dropped:
+// on a closed mesh the front faces cover the same pixels
+// nearer, and an open one shouldn't hide anything from behind.
+// Front faces are clipped where needed and fanned out.
+// --------------------------------------------------------
+void OcclusionBuffer::SetupTriangles()
+{
+	triangles.clear();
+	segments.clear();
+	for (std::vector<unsigned int>& bin : bins)
+		bin.clear();
+
+	XMMATRIX vp = XMLoadFloat4x4(&viewProjection);
+	for (unsigned int o = 0; o < (unsigned int)occluders.size(); o++)
+	{
+		const Occluder& occluder = occluders[o];
+		const MeshProcessing::OccluderGeometry& geometry = *occluder.geometry;
+		unsigned int triangleCount = (unsigned int)geometry.corners.size() / 3;
+		XMMATRIX worldViewProjection = XMMatrixMultiply(XMLoadFloat4x4(&occluder.world), vp);
+
+		clipCorners.resize(geometry.corners.size());
+		for (size_t i = 0; i < geometry.corners.size(); i++)
+			XMStoreFloat4(&clipCorners[i], XMVector3Transform(XMLoadFloat3(&geometry.corners[i]), worldViewProjection));
+
+		frontFacing.resize(triangleCount);
+		for (unsigned int t = 0; t < triangleCount; t++)
+		{
+			const XMFLOAT4& p0 = clipCorners[t * 3];
+			const XMFLOAT4& p1 = clipCorners[t * 3 + 1];
+			const XMFLOAT4& p2 = clipCorners[t * 3 + 2];
+			float determinant =
+				p0.x * (p1.y * p2.w - p2.y * p1.w) -
+				p0.y * (p1.x * p2.w - p2.x * p1.w) +
+				p0.w * (p1.x * p2.y - p2.x * p1.y);
+			frontFacing[t] = determinant < 0;
+		}
+
+		for (unsigned int t = 0; t < triangleCount; t++)
+		{
+			if (!frontFacing[t])
+				continue;
+
+			XMFLOAT4 polygon[MaxClippedCorners];
+			bool shared[MaxClippedCorners];
+			unsigned int outside[ClipPlaneCount] = {};
+			bool clip = false;
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int neighbor = geometry.neighbors[t * 3 + k];
+				polygon[k] = clipCorners[t * 3 + k];
+				shared[k] = neighbor != MeshProcessing::NoNeighbor && frontFacing[neighbor];
+				for (int plane = 0; plane < ClipPlaneCount; plane++)
+				{
+					if (ClipDistance(polygon[k], plane) < 0)
+					{
+						outside[plane]++;
+						clip = true;
+					}
+				}
+			}
+
+			// Entirely outside one plane, or partly outside and needing clipping
+			if (std::find(outside, outside + ClipPlaneCount, 3u) != outside + ClipPlaneCount)
+				continue;
+			int count = clip ? ClipPolygon(polygon, shared, 3) : 3;
+
+			// To pixels, with y down and depth in [0, 1]
+			XMFLOAT3 screen[MaxClippedCorners];
+			for (int k = 0; k < count; k++)
+			{
+				float invW = 1.0f / polygon[k].w;
+				screen[k] = XMFLOAT3(
+					(polygon[k].x * invW * 0.5f + 0.5f) * width,
+					(0.5f - polygon[k].y * invW * 0.5f) * height,
+					polygon[k].z * invW);
+			}
+
+			// The fan's inner edges are shared by construction
+			for (int k = 1; k + 1 < count; k++)
+			{
+				bool fanShared[3] = { k == 1 ? shared[0] : true, shared[k], k + 2 == count ? shared[k + 1] : true };
+				AddTriangle(screen[0], screen[k], screen[k + 1], fanShared, o);
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Sets up a clockwise screen-space triangle, and a segment
+// for each of its outline edges, and bins them all into the
+// tiles whose pixels they touch
+// --------------------------------------------------------
+void OcclusionBuffer::AddTriangle(XMFLOAT3 a, XMFLOAT3 b, XMFLOAT3 c, const bool shared[3], unsigned int occluder)
+{
+	// Outline edges first, even on triangles too thin to fill
+	const XMFLOAT3* corners[4] = { &a, &b, &c, &a };
+	for (int e = 0; e < 3; e++)
+	{
+		if (shared[e])
+			continue;
+
+		const XMFLOAT3& p = *corners[e];
+		const XMFLOAT3& q = *corners[e + 1];
+		Segment segment = {};
+		segment.lineA = p.y - q.y;
+		segment.lineB = q.x - p.x;
+		segment.lineC = -(segment.lineA * p.x + segment.lineB * p.y) + 0.5f * (segment.lineA + segment.lineB);
+		segment.slack = 0.5f * (fabsf(segment.lineA) + fabsf(segment.lineB));
+		segment.minX = std::max((int)floorf(std::min(p.x, q.x)), 0);
+		segment.minY = std::max((int)floorf(std::min(p.y, q.y)), 0);
+		segment.maxX = std::min((int)floorf(std::max(p.x, q.x)), (int)width - 1);
+		segment.maxY = std::min((int)floorf(std::max(p.y, q.y)), (int)height - 1);
+		segment.occluder = occluder;
+		if (segment.minX > segment.maxX || segment.minY > segment.maxY)
+			continue;
+
+		segments.push_back(segment);
+		AddToBins((unsigned int)(segments.size() - 1) | SegmentEntry, segment.minX, segment.minY, segment.maxX, segment.maxY);
+	}
+
+	float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	if (area < 1e-6f)
+		return;
+
+	// Every pixel the triangle touches
+	Triangle tri = {};
+	tri.minX = std::max((int)floorf(std::min(a.x, std::min(b.x, c.x))), 0);
+	tri.minY = std::max((int)floorf(std::min(a.y, std::min(b.y, c.y))), 0);
+	tri.maxX = std::min((int)floorf(std::max(a.x, std::max(b.x, c.x))), (int)width - 1);
+	tri.maxY = std::min((int)floorf(std::max(a.y, std::max(b.y, c.y))), (int)height - 1);
+	tri.occluder = occluder;
+	if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+		return;
+
+	// Edges a->b, b->c and c->a, each positive on the inside
+	for (int e = 0; e < 3; e++)
+	{
+		const XMFLOAT3& p = *corners[e];
+		const XMFLOAT3& q = *corners[e + 1];
+		tri.edgeA[e] = p.y - q.y;
+		tri.edgeB[e] = q.x - p.x;
+		tri.edgeC[e] = -(tri.edgeA[e] * p.x + tri.edgeB[e] * p.y) + 0.5f * (tri.edgeA[e] + tri.edgeB[e]);
+		tri.edgeSlack[e] = 0.5f * (fabsf(tri.edgeA[e]) + fabsf(tri.edgeB[e]));
+	}
+
+	// Depth plane, moved to the pixel's furthest corner
+	float dx1 = b.x - a.x, dy1 = b.y - a.y, dz1 = b.z - a.z;
+	float dx2 = c.x - a.x, dy2 = c.y - a.y, dz2 = c.z - a.z;
+	tri.depthA = (dz1 * dy2 - dz2 * dy1) / area;
+	tri.depthB = (dz2 * dx1 - dz1 * dx2) / area;
+	tri.depthC = a.z - tri.depthA * a.x - tri.depthB * a.y +
+		0.5f * (tri.depthA + tri.depthB) + 0.5f * (fabsf(tri.depthA) + fabsf(tri.depthB));
+
+	triangles.push_back(tri);
+	AddToBins((unsigned int)(triangles.size() - 1), tri.minX, tri.minY, tri.maxX, tri.maxY);
+}
+
+void OcclusionBuffer::AddToBins(unsigned int entry, int minX, int minY, int maxX, int maxY)
+{
+	for (int ty = minY / (int)TileHeight; ty <= maxY / (int)TileHeight; ty++)
+	{
+		for (int tx = minX / (int)TileWidth; tx <= maxX / (int)TileWidth; tx++)
+			bins[ty * tilesX + tx].push_back(entry);
+	}
+}
+
+// --------------------------------------------------------
+// Clears one tile and draws its bin one occluder at a time
+// into scratch space: triangles mark the pixels whose centers
+// they contain and raise the furthest depth of every pixel
+// they touch, and segments block the pixels they touch.  The
+// bins are in occluder order, so each occluder is merged into
+// the tile once its entries run out.  Tiles start on a
+// multiple of four, so every group of four pixels stays
+// inside its tile.
+// --------------------------------------------------------
+void OcclusionBuffer::RasterizeTile(unsigned int tile)
+{
+	int tileX = (int)(tile % tilesX) * TileWidth;
+	int tileY = (int)(tile / tilesX) * TileHeight;
+	for (int y = tileY; y < tileY + (int)TileHeight; y++)
+		std::fill_n(&depth[y * width + tileX], TileWidth, 1.0f);
+
+	float occluderDepth[TileWidth * TileHeight];
+	unsigned int covered[TileWidth * TileHeight];
+	unsigned int blocked[TileWidth * TileHeight];
+	unsigned int current = SegmentEntry;
+
+	XMVECTOR laneOffsets = XMVectorSet(0, 1, 2, 3);
+	for (unsigned int entry : bins[tile])
+	{
+		bool isSegment = (entry & SegmentEntry) != 0;
+		unsigned int index = entry & ~SegmentEntry;
+		unsigned int occluder = isSegment ? segments[index].occluder : triangles[index].occluder;
+		if (occluder != current)
+		{
+			if (current != SegmentEntry)
+				MergeOccluder(tileX, tileY, occluderDepth, covered, blocked);
+			std::fill_n(occluderDepth, TileWidth * TileHeight, 0.0f);
+			std::fill_n(covered, TileWidth * TileHeight, 0u);
+			std::fill_n(blocked, TileWidth * TileHeight, 0u);
+			current = occluder;
+		}
+
+		if (isSegment)
+		{
+			const Segment& segment = segments[index];
+			int minX = std::max(segment.minX, tileX);
+			int maxX = std::min(segment.maxX, tileX + (int)TileWidth - 1);
+			int minY = std::max(segment.minY, tileY);
+			int maxY = std::min(segment.maxY, tileY + (int)TileHeight - 1);
+			for (int y = minY; y <= maxY; y++)
+			{
+				for (int x = minX; x <= maxX; x++)
+				{
+					if (fabsf(segment.lineA * x + segment.lineB * y + segment.lineC) <= segment.slack)
+						blocked[(y - tileY) * TileWidth + (x - tileX)] = 0xFFFFFFFF;
+				}
+			}
+			continue;
+		}
+
+		const Triangle& tri = triangles[index];
+		int minX = std::max(tri.minX, tileX) & ~3;
+		int maxX = std::min(tri.maxX, tileX + (int)TileWidth - 1);
+		int minY = std::max(tri.minY, tileY);
+		int maxY = std::min(tri.maxY, tileY + (int)TileHeight - 1);
+
+		XMVECTOR edgeA[3], edgeB[3], edgeC[3], edgeSlack[3];
+		for (int e = 0; e < 3; e++)
+		{
+			edgeA[e] = XMVectorReplicate(tri.edgeA[e]);
+			edgeB[e] = XMVectorReplicate(tri.edgeB[e]);
+			edgeC[e] = XMVectorReplicate(tri.edgeC[e]);
+			edgeSlack[e] = XMVectorReplicate(-tri.edgeSlack[e]);
+		}
+		XMVECTOR depthA = XMVectorReplicate(tri.depthA);
+		XMVECTOR depthB = XMVectorReplicate(tri.depthB);
+		XMVECTOR depthC = XMVectorReplicate(tri.depthC);
+
+		for (int y = minY; y <= maxY; y++)
+		{
+			XMVECTOR py = XMVectorReplicate((float)y);
+			int row = (y - tileY) * TileWidth - tileX;
+			for (int x = minX; x <= maxX; x += 4)
+			{
+				XMVECTOR px = XMVectorAdd(XMVectorReplicate((float)x), laneOffsets);
+
+				XMVECTOR inside = XMVectorTrueInt();
+				XMVECTOR touching = XMVectorTrueInt();
+				for (int e = 0; e < 3; e++)
+				{
+					XMVECTOR value = XMVectorMultiplyAdd(edgeA[e], px, XMVectorMultiplyAdd(edgeB[e], py, edgeC[e]));
+					inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(value, XMVectorZero()));
+					touching = XMVectorAndInt(touching, XMVectorGreaterOrEqual(value, edgeSlack[e]));
+				}
+				if (XMVector4EqualInt(touching, XMVectorZero()))
+					continue;
+
+				XMVECTOR z = XMVectorMultiplyAdd(depthA, px, XMVectorMultiplyAdd(depthB, py, depthC));
+				XMVECTOR furthest = XMLoadFloat4((const XMFLOAT4*)&occluderDepth[row + x]);
+				XMVECTOR coveredMask = XMLoadInt4(&covered[row + x]);
+				XMStoreFloat4((XMFLOAT4*)&occluderDepth[row + x], XMVectorSelect(furthest, XMVectorMax(furthest, z), touching));
+				XMStoreInt4(&covered[row + x], XMVectorOrInt(coveredMask, inside));
+			}
+		}
+	}
+
+	if (current != SegmentEntry)
+		MergeOccluder(tileX, tileY, occluderDepth, covered, blocked);
+}
+
+// Pixels the occluder covers without its outline crossing them take its depth, if nearer
+void OcclusionBuffer::MergeOccluder(int tileX, int tileY, const float* occluderDepth, const unsigned int* covered, const unsigned int* blocked)
+{
+	for (int y = 0; y < (int)TileHeight; y++)
+	{
+		float* row = &depth[(tileY + y) * width + tileX];
+		for (int x = 0; x < (int)TileWidth; x += 4)
+		{
+			unsigned int i = y * TileWidth + x;
+			XMVECTOR write = XMVectorAndCInt(XMLoadInt4(&covered[i]), XMLoadInt4(&blocked[i]));
+			XMVECTOR current = XMLoadFloat4((const XMFLOAT4*)&row[x]);
+			XMVECTOR z = XMLoadFloat4((const XMFLOAT4*)&occluderDepth[i]);
+			XMStoreFloat4((XMFLOAT4*)&row[x], XMVectorSelect(current, XMVectorMin(current, z), write));
+		}
+	}
+}
+
+// Each level's texels hold the nearest and furthest of the (up to) four below
+void OcclusionBuffer::BuildPyramid()
+{
+	for (unsigned int level = 1; level < levelWidths.size(); level++)
+	{
+		const float* belowMin = GetMinLevel(level - 1);
+		const float* belowMax = GetMaxLevel(level - 1);
+		unsigned int belowWidth = levelWidths[level - 1];
+		unsigned int belowHeight = levelHeights[level - 1];
+		float* levelMin = minLevels[level].data();
+		float* levelMax = maxLevels[level].data();
+
+		for (unsigned int y = 0; y < levelHeights[level]; y++)
+		{
+			unsigned int y0 = y * 2 * belowWidth;
+			unsigned int y1 = std::min(y * 2 + 1, belowHeight - 1) * belowWidth;
+			for (unsigned int x = 0; x < levelWidths[level]; x++)
+			{
+				unsigned int x0 = x * 2;
+				unsigned int x1 = std::min(x * 2 + 1, belowWidth - 1);
+				levelMin[y * levelWidths[level] + x] = std::min(
+					std::min(belowMin[y0 + x0], belowMin[y0 + x1]),
+					std::min(belowMin[y1 + x0], belowMin[y1 + x1]));
+				levelMax[y * levelWidths[level] + x] = std::max(
+					std::max(belowMax[y0 + x0], belowMax[y0 + x1]),
+					std::max(belowMax[y1 + x0], belowMax[y1 + x1]));
+			}
+		}
+	}
+}
+
+const float* OcclusionBuffer::GetMinLevel(unsigned int level) const
+{
+	return level == 0 ? depth.data() : minLevels[level].data();
+}
+
+const float* OcclusionBuffer::GetMaxLevel(unsigned int level) const
+{
+	return level == 0 ? depth.data() : maxLevels[level].data();
+}
+
+// --------------------------------------------------------
+// Tiles are handed out one at a time, so a few crowded ones
+// don't hold up a worker while the others sit idle
+// --------------------------------------------------------
+void OcclusionBuffer::Render()
+{
+	double start = GetMilliseconds();
+	SetupTriangles();
+	double setupEnd = GetMilliseconds();
+
+	std::atomic<unsigned int> nextTile(0);
+	unsigned int tileCount = tilesX * tilesY;
+	tileWorkers->Run([&](size_t)
+	{
+		for (unsigned int tile = nextTile++; tile < tileCount; tile = nextTile++)
+			RasterizeTile(tile);
+	});
+	double rasterEnd = GetMilliseconds();
+
+	BuildPyramid();
+	double end = GetMilliseconds();
+
+	setupMilliseconds = setupEnd - start;
+	rasterMilliseconds = rasterEnd - setupEnd;
+	pyramidMilliseconds = end - rasterEnd;
+	ready = true;
+}
+
+void OcclusionBuffer::Start()
+{
+	Finish();
+	renderWorker.Start([this](size_t) { Render(); });
+}
+
+bool OcclusionBuffer::Finish()
+{
+	renderWorker.Wait();
+	return ready;
+}
+
+// --------------------------------------------------------
+// The box's corners give its screen rectangle and nearest
+// depth.  It's hidden if every pixel of that rectangle holds
+// something nearer, which is decided from the coarsest level
+// where the rectangle spans at most two texels each way.
+// --------------------------------------------------------
+bool OcclusionBuffer::IsOccluded(XMFLOAT3 center, XMFLOAT3 extents) const
+{
+	if (!ready)
+		return false;
+
+	XMMATRIX vp = XMLoadFloat4x4(&viewProjection);
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+	float nearest = FLT_MAX;
+	for (int i = 0; i < 8; i++)
+	{
+		XMFLOAT3 corner(
+			center.x + (i & 1 ? extents.x : -extents.x),
+			center.y + (i & 2 ? extents.y : -extents.y),
+			center.z + (i & 4 ? extents.z : -extents.z));
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector3Transform(XMLoadFloat3(&corner), vp));
+
+		// Reaching past the near plane
+		if (clip.z < 0 || clip.w <= 0)
+			return false;
+
+		float invW = 1.0f / clip.w;
+		float x = (clip.x * invW * 0.5f + 0.5f) * width;
+		float y = (0.5f - clip.y * invW * 0.5f) * height;
+		minX = std::min(minX, x); maxX = std::max(maxX, x);
+		minY = std::min(minY, y); maxY = std::max(maxY, y);
+		nearest = std::min(nearest, clip.z * invW);
+	}
+
+	// Every pixel the rectangle touches, clamped to the screen
+	if (maxX < 0 || maxY < 0 || minX >= width || minY >= height)
+		return false;
+	int pixelMinX = std::max((int)floorf(minX), 0);
+	int pixelMinY = std::max((int)floorf(minY), 0);
+	int pixelMaxX = std::min((int)floorf(maxX), (int)width - 1);
+	int pixelMaxY = std::min((int)floorf(maxY), (int)height - 1);
+
+	unsigned int level = 0;
+	while (level + 1 < levelWidths.size() &&
+		((pixelMaxX >> level) - (pixelMinX >> level) > 1 || (pixelMaxY >> level) - (pixelMinY >> level) > 1))
+		level++;
+
+	return IsRectOccluded(level, pixelMinX, pixelMinY, pixelMaxX, pixelMaxY, nearest);
+}
+
+// --------------------------------------------------------
+// Texels wholly nearer than the box settle their part of the
+// rectangle, and any texel whose nearest depth is behind the
+// box means it shows there.  Texels in between are split
+// into their four children, cut down to the rectangle.
+// --------------------------------------------------------
+bool OcclusionBuffer::IsRectOccluded(unsigned int level, int minX, int minY, int maxX, int maxY, float nearestDepth) const
+{
+	const float* levelMin = GetMinLevel(level);
+	const float* levelMax = GetMaxLevel(level);
+	unsigned int levelWidth = levelWidths[level];
+	int size = 1 << level;
+
+	for (int ty = minY >> level; ty <= maxY >> level; ty++)
+	{
+		for (int tx = minX >> level; tx <= maxX >> level; tx++)
+		{
+			unsigned int i = ty * levelWidth + tx;
+			if (nearestDepth <= levelMin[i])
+				return false;
+			if (nearestDepth > levelMax[i])
+				continue;
+
+			if (!IsRectOccluded(level - 1,
+				std::max(minX, tx * size), std::max(minY, ty * size),
+				std::min(maxX, tx * size + size - 1), std::min(maxY, ty * size + size - 1),
+				nearestDepth))
+				return false;
+		}
+	}
+	return true;
+}
+
+// Getters
+unsigned int OcclusionBuffer::GetWidth() const { return width; }
+unsigned int OcclusionBuffer::GetHeight() const { return height; }
+unsigned int OcclusionBuffer::GetThreadCount() const { return threadCount; }
+unsigned int OcclusionBuffer::GetTriangleCount() const { return (unsigned int)triangles.size(); }
+float OcclusionBuffer::GetDepth(unsigned int x, unsigned int y) const { return depth[y * width + x]; }
+double OcclusionBuffer::GetSetupMilliseconds() const { return setupMilliseconds; }
+double OcclusionBuffer::GetRasterMilliseconds() const { return rasterMilliseconds; }
+double OcclusionBuffer::GetPyramidMilliseconds() const { return pyramidMilliseconds; }
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <memory>
+#include <vector>
+
+#include "MeshProcessing.h"
+#include "Parallel.h"
+
+// --------------------------------------------------------
+// Software occlusion culling against a low resolution depth
+// buffer drawn on the CPU
+//
+// A few large occluders (walls, floors) are rasterized depth
+// only: their front faces are clipped, set up and binned into
+// screen tiles, then each tile is filled four pixels at a
+// time on its own worker thread.  Front faces cover the
+// pixels whose centers they contain, so a surface has no
+// cracks, but any pixel its outline (the edges not shared
+// with another front face) passes through is left alone, so
+// only pixels the occluder covers entirely are written.  They
+// get the furthest depth any of its triangles reaches across
+// them, so the buffer errs toward hiding too little.
+//
+// A min/max depth pyramid is built over the result.  Boxes
+// are tested by projecting their corners: the nearest corner
+// depth is compared against the pyramid, starting at a level
+// where the box's screen rectangle spans a few texels and
+// refining only where that can't decide.
+//
+// Start() runs the whole thing on a separate thread, so it
+// can overlap other work on the caller's (the game starts it
+// once the frame's simulation steps are done, and culls the
+// frame against the frustum meanwhile), and Finish() waits
+// for it.
+// Nothing here needs a graphics device.
+// --------------------------------------------------------
+class OcclusionBuffer
+{
+public:
+
+	// Screen tiles each worker fills at a time (the buffer's
+	// size is rounded up to whole tiles)
+	static constexpr unsigned int TileWidth = 32;
+	static constexpr unsigned int TileHeight = 16;
+
+private:
+
+	// An occluder as it was added: its world matrix, and its
+	// geometry, which the caller keeps alive until Finish()
+	struct Occluder
+	{
+		DirectX::XMFLOAT4X4 world;
+		const MeshProcessing::OccluderGeometry* geometry;
+	};
+
+	// A screen-space triangle ready to fill: three edge functions
+	// (positive inside, evaluated at pixel centers, and reaching
+	// -edgeSlack where they first touch a pixel) and a depth plane
+	// (pushed back to the furthest point of each pixel), plus the
+	// pixels it touches and the occluder it came from
+	struct Triangle
+	{
+		float edgeA[3], edgeB[3], edgeC[3];
+		float edgeSlack[3];
+		float depthA, depthB, depthC;
+		int minX, minY, maxX, maxY;		// Inclusive
+		unsigned int occluder;
+	};
+
+	// An outline edge: its line (within +-slack of zero on every
+	// pixel it touches) and the pixels its ends span
+	struct Segment
+	{
+		float lineA, lineB, lineC;
+		float slack;
+		int minX, minY, maxX, maxY;		// Inclusive
+		unsigned int occluder;
+	};
+
+	// Marks bin entries that index "segments" rather than "triangles"
+	static constexpr unsigned int SegmentEntry = 0x80000000;
+
+	unsigned int width;
+	unsigned int height;
+	unsigned int tilesX;
+	unsigned int tilesY;
+	unsigned int threadCount;
+
+	// This frame's camera and occluders
+	DirectX::XMFLOAT4X4 viewProjection;
+	std::vector<Occluder> occluders;
+
+	// Set-up triangles and outline segments, and the ones touching
+	// each tile (in occluder order)
+	std::vector<Triangle> triangles;
+	std::vector<Segment> segments;
+	std::vector<std::vector<unsigned int>> bins;
+
+	// Scratch space for one occluder's corners and facing
+	std::vector<DirectX::XMFLOAT4> clipCorners;
+	std::vector<unsigned char> frontFacing;
+
+	// Depth per pixel (0 near, 1 far), then the pyramid above it:
+	// level l is (width >> l) x (height >> l), rounded up, and
+	// level 0's min and max are both the depth buffer itself
+	std::vector<float> depth;
+	std::vector<std::vector<float>> minLevels;
+	std::vector<std::vector<float>> maxLevels;
+	std::vector<unsigned int> levelWidths;
+	std::vector<unsigned int> levelHeights;
+
+	// The thread Start() renders on, and the ones filling tiles
+	// alongside it, kept for the buffer's lifetime so a frame
+	// doesn't pay for creating them
+	WorkerPool renderWorker;
+	std::unique_ptr<WorkerPool> tileWorkers;
+	bool ready;
+
+	// Timings of the last render
+	double setupMilliseconds;
+	double rasterMilliseconds;
+	double pyramidMilliseconds;
+
+	// Helpers
+	void SetupTriangles();
+	void AddTriangle(DirectX::XMFLOAT3 a, DirectX::XMFLOAT3 b, DirectX::XMFLOAT3 c, const bool shared[3], unsigned int occluder);
+	void AddToBins(unsigned int entry, int minX, int minY, int maxX, int maxY);
+	void RasterizeTile(unsigned int tile);
+	void MergeOccluder(int tileX, int tileY, const float* occluderDepth, const unsigned int* covered, const unsigned int* blocked);
+	void BuildPyramid();
+	const float* GetMinLevel(unsigned int level) const;
+	const float* GetMaxLevel(unsigned int level) const;
+	bool IsRectOccluded(unsigned int level, int minX, int minY, int maxX, int maxY, float nearestDepth) const;
+
+public:
+
+	// Rounds the size up to whole tiles.  Zero threads uses one per
+	// core (less one, which is left for the simulation).
+	OcclusionBuffer(unsigned int width = 256, unsigned int height = 144, unsigned int threadCount = 0);
+	~OcclusionBuffer();
+
+	// Starts a new frame: waits for any render in flight, and drops
+	// the last frame's occluders and depth
+	void Begin(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection);
+
+	// Queues an occluder to be drawn with its world matrix.  The
+	// geometry isn't copied.
+	void AddOccluder(const DirectX::XMFLOAT4X4& world, const MeshProcessing::OccluderGeometry& geometry);
+
+	// Draws the queued occluders and builds the pyramid, either right
+	// here or on a background thread (which Finish() waits for)
+	void Render();
+	void Start();
+
+	// Waits for Start()'s render, returning whether there's a finished
+	// buffer from this frame to test against
+	bool Finish();
+
+	// Is the whole world-space box hidden behind the occluders?  Boxes
+	// crossing the near plane or off the screen never are.
+	bool IsOccluded(DirectX::XMFLOAT3 center, DirectX::XMFLOAT3 extents) const;
+
+	// Getters
+	unsigned int GetWidth() const;
+	unsigned int GetHeight() const;
+	unsigned int GetThreadCount() const;
+	unsigned int GetTriangleCount() const;		// Set up last render (after clipping)
+	float GetDepth(unsigned int x, unsigned int y) const;
+	double GetSetupMilliseconds() const;		// Transforming, clipping and binning
+	double GetRasterMilliseconds() const;		// Filling every tile
+	double GetPyramidMilliseconds() const;		// Building the min/max levels
+};
@@ -0,0 +1,92 @@
+#include "Parallel.h"
+
+WorkerPool::WorkerPool(size_t threadCount) :
+	firstIndex(0),
+	generation(0),
+	running(0),
+	stopping(false)
+{
+	for (size_t i = 0; i < threadCount; i++)
+		threads.emplace_back(&WorkerPool::Work, this, i);
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (std::thread& t : threads)
+		t.join();
+}
+
+// --------------------------------------------------------
+// Each thread sleeps until the generation moves on, runs its
+// part of the job, and the last one to finish wakes Wait()
+// --------------------------------------------------------
+void WorkerPool::Work(size_t thread)
+{
+	unsigned long long seen = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return stopping || generation != seen; });
+			if (stopping)
+				return;
+			seen = generation;
+		}
+
+		// The job isn't replaced until every thread is done with it
+		job(firstIndex + thread);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--running == 0)
+			finished.notify_all();
+	}
+}
+
+void WorkerPool::Start(std::function<void(size_t)> job, size_t firstIndex)
+{
+	Wait();
+
+	// With no threads to hand it to, the caller runs it instead
+	if (threads.empty())
+	{
+		job(firstIndex);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->job = std::move(job);
+		this->firstIndex = firstIndex;
+		running = threads.size();
+		generation++;
+	}
+	wake.notify_all();
+}
+
+void WorkerPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [&] { return running == 0; });
+}
+
+void WorkerPool::Run(std::function<void(size_t)> job)
+{
+	if (threads.empty())
+	{
+		job(0);
+		return;
+	}
+
+	Start(job, 1);
+	job(0);
+	Wait();
+}
+
+// Getters
+size_t WorkerPool::GetThreadCount() const { return threads.size(); }
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// Runs job(i) for i in [0, count), using the calling thread
+// for job 0.  The other threads are created for this call
+// and joined before it returns, which is fine for one-off
+// work like loading, but costs tens of microseconds per
+// thread when done every frame (see WorkerPool).
+// --------------------------------------------------------
+template <typename Job>
+void RunParallel(size_t count, Job job)
+{
+	std::vector<std::thread> workers;
+	for (size_t i = 1; i < count; i++)
+		workers.emplace_back(job, i);
+
+	job(0);
+
+	for (std::thread& t : workers)
+		t.join();
+}
+
+// --------------------------------------------------------
+// Threads that are created once and parked between jobs, for
+// work that forks every frame
+//
+// A pool runs one job at a time: Start() hands it to every
+// thread and returns, and Wait() blocks until they're done.
+// Only one thread should drive a given pool.
+// --------------------------------------------------------
+class WorkerPool
+{
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable finished;
+
+	// The current job, and the index its first thread is given
+	std::function<void(size_t)> job;
+	size_t firstIndex;
+
+	// Bumped for every job, so parked threads know there's a new one
+	unsigned long long generation;
+	size_t running;
+	bool stopping;
+
+	void Work(size_t thread);
+
+public:
+	explicit WorkerPool(size_t threadCount);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	// Runs job(firstIndex + i) on the pool's thread i, in the
+	// background, after waiting for any job still in flight.
+	// A pool with no threads runs job(firstIndex) before returning.
+	void Start(std::function<void(size_t)> job, size_t firstIndex = 0);
+	void Wait();
+
+	// Same as RunParallel(GetThreadCount() + 1, job): the calling
+	// thread takes job 0 and the pool the rest
+	void Run(std::function<void(size_t)> job);
+
+	// Getters
+	size_t GetThreadCount() const;
+};
@@ -63,7 +63,7 @@ float4 main(VertexToPixel input) : SV_TARGET
     
     // Get surface color from texture and color tint
     // Be sure to un-gamma correct the surface color so it is accurate when re-corrected later
-    float3 albedoColor = pow(Albedo.Sample(BasicSampler, input.uv).rgb, 2.2f);
+    float3 albedoColor = pow(Albedo.Sample(BasicSampler, input.uv).rgb, 2.2f) * input.colorTint;
     
     // Unpack normal from normal map
     float3 unpackedNormal = NormalMap.Sample(BasicSampler, input.uv).rgb * 2 - 1;
@@ -0,0 +1,68 @@
+#include "RecordingBackend.h"
+
+RecordingBackend::RecordingBackend(bool keepCommands) :
+	stats(),
+	keepCommands(keepCommands)
+{
+}
+
+void RecordingBackend::Execute(const CommandBuffer& commands)
+{
+	if (keepCommands)
+		recorded.Append(commands);
+
+	stats.streamCount++;
+	stats.streamBytes += commands.GetSize();
+	for (const CommandBuffer::Header* command = commands.GetFirst(); command; command = commands.GetNext(command))
+	{
+		if (command->type >= CommandBuffer::TypeCount)
+			continue;
+
+		stats.commandCounts[command->type]++;
+		stats.commandCount++;
+		switch (command->type)
+		{
+		case CommandBuffer::TypeSetConstants:
+			stats.constantBytes += ((const CommandBuffer::SetConstantsCommand*)command)->dataSize;
+			break;
+
+		case CommandBuffer::TypeUpdateBuffer:
+			stats.uploadBytes += ((const CommandBuffer::UpdateBufferCommand*)command)->dataSize;
+			break;
+
+		case CommandBuffer::TypeDraw:
+			stats.drawCount++;
+			stats.vertexCount += ((const CommandBuffer::DrawCommand*)command)->vertexCount;
+			stats.instanceCount++;
+			break;
+
+		case CommandBuffer::TypeDrawIndexed:
+			stats.drawCount++;
+			stats.vertexCount += ((const CommandBuffer::DrawIndexedCommand*)command)->indexCount;
+			stats.instanceCount++;
+			break;
+
+		case CommandBuffer::TypeDrawIndexedInstanced:
+		{
+			const CommandBuffer::DrawIndexedInstancedCommand* c = (const CommandBuffer::DrawIndexedInstancedCommand*)command;
+			stats.drawCount++;
+			stats.vertexCount += (unsigned long long)c->indexCount * c->instanceCount;
+			stats.instanceCount += c->instanceCount;
+			break;
+		}
+
+		default:
+			break;
+		}
+	}
+}
+
+void RecordingBackend::Reset()
+{
+	stats = {};
+	recorded.Clear();
+}
+
+// Getters
+const RecordingBackend::Stats& RecordingBackend::GetStats() const { return stats; }
+const CommandBuffer& RecordingBackend::GetRecorded() const { return recorded; }
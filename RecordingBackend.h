@@ -0,0 +1,51 @@
+#pragma once
+
+#include "CommandBuffer.h"
+
+// --------------------------------------------------------
+// A backend that executes nothing, only tallying what it's
+// handed: commands by type, draws and their sizes, and the
+// bytes that would have gone to the GPU.  It can also keep
+// every stream it sees, stitched together in order, so a
+// frame can be inspected or replayed somewhere else.
+//
+// It never dereferences a handle, so streams recorded with
+// made-up ones (or with no device at all) are fine.
+// --------------------------------------------------------
+class RecordingBackend : public CommandBackend
+{
+public:
+
+	// Everything executed since the last Reset()
+	struct Stats
+	{
+		unsigned int commandCounts[CommandBuffer::TypeCount];
+		unsigned int commandCount;
+		unsigned int drawCount;			// Draw commands of any kind
+		unsigned long long vertexCount;	// Vertices and indices submitted, over every instance
+		unsigned long long instanceCount;
+		unsigned long long constantBytes;	// Constant buffer contents uploaded
+		unsigned long long uploadBytes;		// Other buffer contents uploaded
+		unsigned long long streamBytes;		// Size of the streams themselves
+		unsigned int streamCount;
+	};
+
+private:
+
+	Stats stats;
+	bool keepCommands;
+	CommandBuffer recorded;
+
+public:
+
+	RecordingBackend(bool keepCommands = false);
+
+	void Execute(const CommandBuffer& commands) override;
+
+	// Forgets the stats (and any kept commands)
+	void Reset();
+
+	// Getters
+	const Stats& GetStats() const;
+	const CommandBuffer& GetRecorded() const;	// Empty unless keeping commands
+};
@@ -0,0 +1,179 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <numeric>
+
+// Anonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// Where each field starts in a key
+	constexpr unsigned int DepthShift = 0;
+	constexpr unsigned int MeshShift = DepthShift + RenderQueue::DepthBits;
+	constexpr unsigned int MaterialShift = MeshShift + RenderQueue::MeshBits;
+	constexpr unsigned int ShaderShift = MaterialShift + RenderQueue::MaterialBits;
+	constexpr unsigned int PassShift = ShaderShift + RenderQueue::ShaderBits;
+	static_assert(PassShift + RenderQueue::PassBits == 64, "Render key fields must fill 64 bits");
+
+	uint64_t Field(unsigned int value, unsigned int bits, unsigned int shift)
+	{
+		return ((uint64_t)value & ((1ull << bits) - 1)) << shift;
+	}
+}
+
+RenderQueue::RenderQueue() :
+	skippedPasses(0)
+{
+}
+
+uint64_t RenderQueue::MakeKey(unsigned int pass, unsigned int shader, unsigned int material, unsigned int mesh, unsigned int depth)
+{
+	return
+		Field(pass, PassBits, PassShift) |
+		Field(shader, ShaderBits, ShaderShift) |
+		Field(material, MaterialBits, MaterialShift) |
+		Field(mesh, MeshBits, MeshShift) |
+		Field(depth, DepthBits, DepthShift);
+}
+
+// --------------------------------------------------------
+// Linear steps from the eye out to farZ.  Anything behind the
+// eye goes first and anything past farZ (or NaN) goes last.
+// --------------------------------------------------------
+unsigned int RenderQueue::QuantizeDepth(float depth, float farZ)
+{
+	const unsigned int maxDepth = (1u << DepthBits) - 1;
+	if (!(depth > 0.0f))
+		return depth <= 0.0f ? 0 : maxDepth;
+	if (!(depth < farZ))
+		return maxDepth;
+
+	return (unsigned int)(depth / farZ * maxDepth);
+}
+
+unsigned int RenderQueue::GetPass(uint64_t key)
+{
+	return (unsigned int)(key >> PassShift);
+}
+
+unsigned int RenderQueue::GetShaderId(const void* vertexShader, const void* pixelShader)
+{
+	auto found = shaderIds.emplace(std::make_pair(vertexShader, pixelShader), (unsigned int)shaderIds.size());
+	return found.first->second;
+}
+
+unsigned int RenderQueue::GetMaterialId(const void* material)
+{
+	auto found = materialIds.emplace(material, (unsigned int)materialIds.size());
+	return found.first->second;
+}
+
+unsigned int RenderQueue::GetMeshId(const void* mesh)
+{
+	auto found = meshIds.emplace(mesh, (unsigned int)meshIds.size());
+	return found.first->second;
+}
+
+void RenderQueue::Clear()
+{
+	keys.clear();
+	values.clear();
+}
+
+void RenderQueue::Add(uint64_t key, unsigned int value)
+{
+	keys.push_back(key);
+	values.push_back(value);
+}
+
+// --------------------------------------------------------
+// Least significant byte first, so each pass only has to be
+// stable.  One sweep counts all eight bytes up front, and a
+// byte that's the same in every key (unused ids, a single
+// pass) is skipped rather than copied through unchanged.
+// --------------------------------------------------------
+void RenderQueue::Sort()
+{
+	size_t count = keys.size();
+	skippedPasses = 0;
+	if (count < 2)
+		return;
+
+	unsigned int histograms[8][256] = {};
+	for (uint64_t key : keys)
+		for (unsigned int b = 0; b < 8; b++)
+			histograms[b][(key >> (b * 8)) & 0xFF]++;
+
+	scratchKeys.resize(count);
+	scratchValues.resize(count);
+
+	for (unsigned int b = 0; b < 8; b++)
+	{
+		unsigned int* counts = histograms[b];
+		if (counts[(keys[0] >> (b * 8)) & 0xFF] == count)
+		{
+			skippedPasses++;
+			continue;
+		}
+
+		// Counts to starting offsets
+		unsigned int offset = 0;
+		for (unsigned int d = 0; d < 256; d++)
+		{
+			unsigned int c = counts[d];
+			counts[d] = offset;
+			offset += c;
+		}
+
+		const uint64_t* srcKeys = keys.data();
+		const unsigned int* srcValues = values.data();
+		uint64_t* dstKeys = scratchKeys.data();
+		unsigned int* dstValues = scratchValues.data();
+		for (size_t i = 0; i < count; i++)
+		{
+			unsigned int slot = counts[(srcKeys[i] >> (b * 8)) & 0xFF]++;
+			dstKeys[slot] = srcKeys[i];
+			dstValues[slot] = srcValues[i];
+		}
+
+		keys.swap(scratchKeys);
+		values.swap(scratchValues);
+	}
+}
+
+void RenderQueue::SortReference()
+{
+	std::vector<unsigned int> order(keys.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(),
+		[&](unsigned int a, unsigned int b) { return keys[a] < keys[b]; });
+
+	scratchKeys.resize(keys.size());
+	scratchValues.resize(values.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		scratchKeys[i] = keys[order[i]];
+		scratchValues[i] = values[order[i]];
+	}
+	keys.swap(scratchKeys);
+	values.swap(scratchValues);
+}
+
+unsigned int RenderQueue::GetPassRange(unsigned int pass, unsigned int& first)
+{
+	uint64_t start = Field(pass, PassBits, PassShift);
+	auto begin = std::lower_bound(keys.begin(), keys.end(), start);
+	auto end = keys.end();
+	if (pass + 1 < (1u << PassBits))
+		end = std::lower_bound(begin, keys.end(), Field(pass + 1, PassBits, PassShift));
+
+	first = (unsigned int)(begin - keys.begin());
+	return (unsigned int)(end - begin);
+}
+
+// Getters
+
+unsigned int RenderQueue::GetCount() { return (unsigned int)keys.size(); }
+uint64_t RenderQueue::GetKey(unsigned int index) { return keys[index]; }
+unsigned int RenderQueue::GetValue(unsigned int index) { return values[index]; }
+unsigned int RenderQueue::GetSkippedPasses() { return skippedPasses; }
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// --------------------------------------------------------
+// A frame's draws, sorted so that neighbours share state.
+//
+// Each draw is a 64-bit key plus a value (normally an entity
+// row).  The key packs, from the most significant bits down:
+//
+//   pass (4) | shader (12) | material (16) | mesh (16) | depth (16)
+//
+// so sorting groups draws by pass, then by shader program,
+// material and mesh, and within each of those puts the
+// nearest first (front-to-back, for early depth rejection).
+//
+// Shaders, materials and meshes are named by small ids handed
+// out per pointer.  Ids that don't fit their field wrap, which
+// only costs some batching, so whoever submits the draws should
+// still compare the real resources before skipping a bind.
+//
+// Sorting is a stable LSD radix sort, a byte at a time, that
+// skips any byte every key agrees on.  Nothing here knows
+// about a graphics API.
+// --------------------------------------------------------
+class RenderQueue
+{
+public:
+
+	// Which part of the frame a draw belongs to, in drawing order
+	enum Pass
+	{
+		PassShadow = 0,
+		PassOpaque = 1,
+		PassCount
+	};
+
+	// Field widths
+	static constexpr unsigned int PassBits = 4;
+	static constexpr unsigned int ShaderBits = 12;
+	static constexpr unsigned int MaterialBits = 16;
+	static constexpr unsigned int MeshBits = 16;
+	static constexpr unsigned int DepthBits = 16;
+
+private:
+
+	std::vector<uint64_t> keys;
+	std::vector<unsigned int> values;
+
+	// Ping-pong buffers for the sort, kept to avoid reallocating
+	std::vector<uint64_t> scratchKeys;
+	std::vector<unsigned int> scratchValues;
+
+	// Dense ids for the resources draws refer to
+	std::map<std::pair<const void*, const void*>, unsigned int> shaderIds;
+	std::unordered_map<const void*, unsigned int> materialIds;
+	std::unordered_map<const void*, unsigned int> meshIds;
+
+	// Radix passes skipped by the last Sort()
+	unsigned int skippedPasses;
+
+public:
+
+	RenderQueue();
+
+	// Packs a key from its fields (each masked to its width)
+	static uint64_t MakeKey(unsigned int pass, unsigned int shader, unsigned int material, unsigned int mesh, unsigned int depth);
+
+	// Maps a view depth in [0, farZ] to the depth field, nearest first
+	static unsigned int QuantizeDepth(float depth, float farZ);
+
+	// Reads the pass back out of a key
+	static unsigned int GetPass(uint64_t key);
+
+	// Ids for resources, stable for as long as the queue lives
+	unsigned int GetShaderId(const void* vertexShader, const void* pixelShader);
+	unsigned int GetMaterialId(const void* material);
+	unsigned int GetMeshId(const void* mesh);
+
+	// Empties the queue (keeping its memory and ids)
+	void Clear();
+
+	// Adds one draw
+	void Add(uint64_t key, unsigned int value);
+
+	// Orders the draws by key, keeping the order they were added
+	// in for equal keys
+	void Sort();
+
+	// The same ordering with std::stable_sort, for checking Sort()
+	void SortReference();
+
+	// Finds the draws for one pass (the queue must be sorted),
+	// returning how many there are
+	unsigned int GetPassRange(unsigned int pass, unsigned int& first);
+
+	// Getters
+	unsigned int GetCount();
+	uint64_t GetKey(unsigned int index);
+	unsigned int GetValue(unsigned int index);
+	unsigned int GetSkippedPasses();
+};
@@ -0,0 +1,732 @@
+#include "SceneFile.h"
+
+#include <charconv>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+#include <unordered_map>
+
+using namespace DirectX;
+
+// Records are written and mapped as they are, so they must stay plain
+static_assert(sizeof(Light) == 64, "Lights are stored as they're sent to the GPU");
+static_assert(sizeof(SceneFile::EntityRecord) % 4 == 0, "Records should be made of 4-byte fields");
+
+const char* const SceneFile::TextureNames[SceneFile::TextureSlotCount] =
+{
+	"Albedo",
+	"NormalMap",
+	"RoughnessMap",
+	"MetalnessMap"
+};
+
+// Anonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// Blocks start on 16-byte boundaries
+	const uint64_t BlockAlignment = 16;
+
+	uint64_t AlignUp(uint64_t value)
+	{
+		return (value + BlockAlignment - 1) & ~(BlockAlignment - 1);
+	}
+
+	// Size and last write time of a file, or false if it doesn't exist
+	bool GetFileDetails(const char* path, uint64_t& size, uint64_t& timestamp)
+	{
+		std::error_code error;
+		std::filesystem::path p(path);
+
+		size = (uint64_t)std::filesystem::file_size(p, error);
+		if (error) return false;
+
+		timestamp = (uint64_t)std::filesystem::last_write_time(p, error).time_since_epoch().count();
+		return !error;
+	}
+
+	// Is the block of "count" records of "stride" bytes inside the file?
+	bool IsBlockInside(uint64_t offset, uint64_t count, uint64_t stride, uint64_t fileSize)
+	{
+		return offset <= fileSize && count * stride <= fileSize - offset;
+	}
+
+	// --------------------------------------------------------
+	// Keyed fields of the text form.  Each names a run of 4-byte
+	// values in a record: floats, string offsets or an index, or
+	// a flag that's set to 1 by its key alone.
+	// --------------------------------------------------------
+	enum FieldKind
+	{
+		FieldFloats,
+		FieldString,
+		FieldIndex,
+		FieldFlag
+	};
+
+	struct Field
+	{
+		const char* key;
+		FieldKind kind;
+		unsigned int count;
+		size_t offset;
+	};
+
+	const Field MaterialFields[] =
+	{
+		{ "shader",			FieldString, 1, offsetof(SceneFile::MaterialRecord, PixelShader) },
+		{ "tint",			FieldFloats, 3, offsetof(SceneFile::MaterialRecord, ColorTint) },
+		{ "roughness",		FieldFloats, 1, offsetof(SceneFile::MaterialRecord, Roughness) },
+		{ "uvScale",		FieldFloats, 1, offsetof(SceneFile::MaterialRecord, UVScale) },
+		{ "uvOffset",		FieldFloats, 1, offsetof(SceneFile::MaterialRecord, UVOffset) },
+		{ "albedo",			FieldString, 1, offsetof(SceneFile::MaterialRecord, Textures) + SceneFile::TextureAlbedo * sizeof(uint32_t) },
+		{ "normalMap",		FieldString, 1, offsetof(SceneFile::MaterialRecord, Textures) + SceneFile::TextureNormalMap * sizeof(uint32_t) },
+		{ "roughnessMap",	FieldString, 1, offsetof(SceneFile::MaterialRecord, Textures) + SceneFile::TextureRoughnessMap * sizeof(uint32_t) },
+		{ "metalnessMap",	FieldString, 1, offsetof(SceneFile::MaterialRecord, Textures) + SceneFile::TextureMetalnessMap * sizeof(uint32_t) },
+	};
+
+	const Field EntityFields[] =
+	{
+		{ "parent",		FieldIndex,  1, offsetof(SceneFile::EntityRecord, Parent) },
+		{ "position",	FieldFloats, 3, offsetof(SceneFile::EntityRecord, Position) },
+		{ "rotation",	FieldFloats, 4, offsetof(SceneFile::EntityRecord, Rotation) },
+		{ "scale",		FieldFloats, 3, offsetof(SceneFile::EntityRecord, Scale) },
+		{ "tint",		FieldFloats, 3, offsetof(SceneFile::EntityRecord, ColorTint) },
+		{ "uvScale",	FieldFloats, 1, offsetof(SceneFile::EntityRecord, UVScale) },
+		{ "uvOffset",	FieldFloats, 1, offsetof(SceneFile::EntityRecord, UVOffset) },
+		{ "occluder",	FieldFlag,   1, offsetof(SceneFile::EntityRecord, Occluder) },
+		{ "animated",	FieldFlag,   1, offsetof(SceneFile::EntityRecord, Animated) },
+	};
+
+	const Field LightFields[] =
+	{
+		{ "direction",	FieldFloats, 3, offsetof(Light, Direction) },
+		{ "position",	FieldFloats, 3, offsetof(Light, Position) },
+		{ "color",		FieldFloats, 3, offsetof(Light, Color) },
+		{ "intensity",	FieldFloats, 1, offsetof(Light, Intensity) },
+		{ "range",		FieldFloats, 1, offsetof(Light, Range) },
+		{ "innerAngle",	FieldFloats, 1, offsetof(Light, SpotInnerAngle) },
+		{ "outerAngle",	FieldFloats, 1, offsetof(Light, SpotOuterAngle) },
+	};
+
+	const Field CameraFields[] =
+	{
+		{ "position",		FieldFloats, 3, offsetof(SceneFile::CameraRecord, Position) },
+		{ "orientation",	FieldFloats, 3, offsetof(SceneFile::CameraRecord, Orientation) },
+		{ "fov",			FieldFloats, 1, offsetof(SceneFile::CameraRecord, FieldOfView) },
+		{ "near",			FieldFloats, 1, offsetof(SceneFile::CameraRecord, NearClip) },
+		{ "far",			FieldFloats, 1, offsetof(SceneFile::CameraRecord, FarClip) },
+		{ "moveSpeed",		FieldFloats, 1, offsetof(SceneFile::CameraRecord, MoveSpeed) },
+		{ "lookSpeed",		FieldFloats, 1, offsetof(SceneFile::CameraRecord, LookSpeed) },
+	};
+
+	const char* const LightTypeNames[] = { "directional", "point", "spot" };
+
+	// --------------------------------------------------------
+	// Splits text into tokens one line at a time: bare words
+	// (names and numbers) and quoted strings, where \" and \\
+	// stand for a quote and a backslash
+	// --------------------------------------------------------
+	struct Tokenizer
+	{
+		const char* cursor;
+		const char* end;
+		const char* lineEnd;
+		unsigned int lineNumber;
+
+		// Moves to the next line with anything on it, skipping comments
+		bool NextLine()
+		{
+			while (true)
+			{
+				if (lineNumber > 0)
+					cursor = lineEnd < end ? lineEnd + 1 : end;
+				if (cursor >= end)
+					return false;
+
+				lineNumber++;
+				lineEnd = (const char*)memchr(cursor, '\n', end - cursor);
+				if (!lineEnd) lineEnd = end;
+
+				SkipSpaces();
+				if (cursor < lineEnd && *cursor != '#')
+					return true;
+			}
+		}
+
+		void SkipSpaces()
+		{
+			while (cursor < lineEnd && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r'))
+				cursor++;
+		}
+
+		bool AtLineEnd()
+		{
+			SkipSpaces();
+			return cursor >= lineEnd;
+		}
+
+		bool ReadWord(const char*& first, const char*& last)
+		{
+			SkipSpaces();
+			first = cursor;
+			while (cursor < lineEnd && *cursor != ' ' && *cursor != '\t' && *cursor != '\r' && *cursor != '"')
+				cursor++;
+			last = cursor;
+			return first != last;
+		}
+
+		bool ReadWord(std::string& word)
+		{
+			const char* first;
+			const char* last;
+			if (!ReadWord(first, last))
+				return false;
+			word.assign(first, last);
+			return true;
+		}
+
+		bool ReadFloat(float& value)
+		{
+			const char* first;
+			const char* last;
+			return ReadWord(first, last) && std::from_chars(first, last, value).ptr == last;
+		}
+
+		bool ReadIndex(uint32_t& value)
+		{
+			const char* first;
+			const char* last;
+			return ReadWord(first, last) && std::from_chars(first, last, value).ptr == last;
+		}
+
+		bool ReadString(std::string& text)
+		{
+			SkipSpaces();
+			if (cursor >= lineEnd || *cursor != '"')
+				return false;
+
+			text.clear();
+			for (cursor++; cursor < lineEnd; cursor++)
+			{
+				if (*cursor == '"')
+				{
+					cursor++;
+					return true;
+				}
+				if (*cursor == '\\' && cursor + 1 < lineEnd)
+					cursor++;
+				text.push_back(*cursor);
+			}
+			return false;
+		}
+	};
+
+	// Reads "key value..." pairs to the end of the line into a record
+	bool ParseFields(Tokenizer& tokens, const Field* fields, size_t fieldCount, void* record, SceneFile::Scene& scene)
+	{
+		std::string word;
+		while (!tokens.AtLineEnd())
+		{
+			if (!tokens.ReadWord(word))
+				return false;
+
+			const Field* field = 0;
+			for (size_t i = 0; i < fieldCount && !field; i++)
+			{
+				if (word == fields[i].key)
+					field = &fields[i];
+			}
+			if (!field)
+				return false;
+
+			char* values = (char*)record + field->offset;
+			if (field->kind == FieldFlag)
+			{
+				*(uint32_t*)values = 1;
+				continue;
+			}
+
+			for (unsigned int i = 0; i < field->count; i++)
+			{
+				bool read = false;
+				if (field->kind == FieldFloats)
+					read = tokens.ReadFloat(((float*)values)[i]);
+				else if (field->kind == FieldIndex)
+					read = tokens.ReadIndex(((uint32_t*)values)[i]);
+				else if (tokens.ReadString(word))
+				{
+					((uint32_t*)values)[i] = SceneFile::AddString(scene, word);
+					read = true;
+				}
+
+				if (!read)
+					return false;
+			}
+		}
+		return true;
+	}
+
+	void AppendString(std::string& out, const char* text)
+	{
+		out += " \"";
+		for (; *text; text++)
+		{
+			if (*text == '"' || *text == '\\')
+				out += '\\';
+			out += *text;
+		}
+		out += '"';
+	}
+
+	// Shortest text that reads back as exactly the same float
+	void AppendFloat(std::string& out, float value)
+	{
+		char buffer[32];
+		std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+		out += ' ';
+		out.append(buffer, result.ptr);
+	}
+
+	// Writes every field that differs from the default record's
+	void FormatFields(std::string& out, const Field* fields, size_t fieldCount, const void* record, const void* defaults, const SceneFile::Scene& scene)
+	{
+		for (size_t i = 0; i < fieldCount; i++)
+		{
+			const Field& field = fields[i];
+			const char* values = (const char*)record + field.offset;
+			if (memcmp(values, (const char*)defaults + field.offset, field.count * sizeof(uint32_t)) == 0)
+				continue;
+
+			out += ' ';
+			out += field.key;
+			for (unsigned int v = 0; field.kind != FieldFlag && v < field.count; v++)
+			{
+				if (field.kind == FieldFloats)
+					AppendFloat(out, ((const float*)values)[v]);
+				else if (field.kind == FieldIndex)
+					out += ' ' + std::to_string(((const uint32_t*)values)[v]);
+				else
+					AppendString(out, SceneFile::GetString(scene, ((const uint32_t*)values)[v]));
+			}
+		}
+	}
+}
+
+// Default records
+SceneFile::MaterialRecord SceneFile::DefaultMaterial()
+{
+	MaterialRecord material = {};
+	material.ColorTint = XMFLOAT3(1, 1, 1);
+	material.Roughness = 0.5f;
+	material.UVScale = 1.0f;
+	return material;
+}
+
+SceneFile::EntityRecord SceneFile::DefaultEntity()
+{
+	EntityRecord entity = {};
+	entity.Parent = None;
+	entity.Rotation = XMFLOAT4(0, 0, 0, 1);
+	entity.Scale = XMFLOAT3(1, 1, 1);
+	entity.ColorTint = XMFLOAT3(1, 1, 1);
+	entity.UVScale = 1.0f;
+	return entity;
+}
+
+Light SceneFile::DefaultLight()
+{
+	Light light = {};
+	light.Color = XMFLOAT3(1, 1, 1);
+	light.Intensity = 1.0f;
+	return light;
+}
+
+// Matches the Camera constructor's defaults
+SceneFile::CameraRecord SceneFile::DefaultCamera()
+{
+	CameraRecord camera = {};
+	camera.FieldOfView = XM_PIDIV4;
+	camera.NearClip = 0.1f;
+	camera.FarClip = 100.0f;
+	camera.MoveSpeed = 5.0f;
+	camera.LookSpeed = 0.05f;
+	return camera;
+}
+
+// Strings are appended as they come; the empty string is always at offset 0
+uint32_t SceneFile::AddString(Scene& scene, const std::string& text)
+{
+	if (scene.Strings.empty())
+		scene.Strings.push_back('\0');
+	if (text.empty())
+		return 0;
+
+	uint32_t offset = (uint32_t)scene.Strings.size();
+	scene.Strings.insert(scene.Strings.end(), text.c_str(), text.c_str() + text.size() + 1);
+	return offset;
+}
+
+const char* SceneFile::GetString(const Scene& scene, uint32_t offset)
+{
+	return offset < scene.Strings.size() ? &scene.Strings[offset] : "";
+}
+
+// --------------------------------------------------------
+// Maps a scene file and validates its header, block ranges
+// and every reference between records, so loaders can index
+// with them directly.  The returned header (and the blocks
+// behind it) live as long as the mapping stays open.
+// --------------------------------------------------------
+const SceneFile::Header* SceneFile::Open(const char* scenePath, const char* sourcePath, MappedFile& file)
+{
+	if (!file.Open(scenePath))
+		return 0;
+
+	// Check the header itself
+	size_t size = file.GetSize();
+	const Header* header = (const Header*)file.GetData();
+	bool valid =
+		size >= sizeof(Header) &&
+		memcmp(header->Magic, "SCNE", 4) == 0 &&
+		header->Version == Version;
+
+	// Make sure the blocks are inside the file
+	valid = valid &&
+		IsBlockInside(header->StringOffset, header->StringBytes, 1, size) &&
+		IsBlockInside(header->MeshOffset, header->MeshCount, sizeof(MeshRecord), size) &&
+		IsBlockInside(header->MaterialOffset, header->MaterialCount, sizeof(MaterialRecord), size) &&
+		IsBlockInside(header->EntityOffset, header->EntityCount, sizeof(EntityRecord), size) &&
+		IsBlockInside(header->LightOffset, header->LightCount, sizeof(Light), size) &&
+		IsBlockInside(header->CameraOffset, header->CameraCount, sizeof(CameraRecord), size);
+
+	// Strings must be terminated, and start with the empty one
+	const char* strings = (const char*)header + (valid ? header->StringOffset : 0);
+	valid = valid &&
+		header->StringBytes > 0 &&
+		strings[0] == '\0' &&
+		strings[header->StringBytes - 1] == '\0';
+
+	for (uint32_t i = 0; valid && i < header->MeshCount; i++)
+	{
+		const MeshRecord& mesh = GetMeshes(header)[i];
+		valid = mesh.Name < header->StringBytes && mesh.Path < header->StringBytes;
+	}
+
+	for (uint32_t i = 0; valid && i < header->MaterialCount; i++)
+	{
+		const MaterialRecord& material = GetMaterials(header)[i];
+		valid = material.Name < header->StringBytes && material.PixelShader < header->StringBytes;
+		for (int t = 0; valid && t < TextureSlotCount; t++)
+			valid = material.Textures[t] < header->StringBytes;
+	}
+
+	// Parents come first, so creating entities in order never
+	// refers ahead (and there can't be any loops)
+	for (uint32_t i = 0; valid && i < header->EntityCount; i++)
+	{
+		const EntityRecord& entity = GetEntities(header)[i];
+		valid =
+			entity.Mesh < header->MeshCount &&
+			entity.Material < header->MaterialCount &&
+			(entity.Parent == None || entity.Parent < i);
+	}
+
+	for (uint32_t i = 0; valid && i < header->LightCount; i++)
+	{
+		int type = GetLights(header)[i].Type;
+		valid = type == LIGHT_TYPE_DIRECTIONAL || type == LIGHT_TYPE_POINT || type == LIGHT_TYPE_SPOT;
+	}
+
+	// A missing text file leaves the binary as the only copy, so it's kept
+	uint64_t sourceSize, sourceTimestamp;
+	if (valid && sourcePath && GetFileDetails(sourcePath, sourceSize, sourceTimestamp))
+		valid = sourceSize == header->SourceSize && sourceTimestamp == header->SourceTimestamp;
+
+	if (!valid)
+	{
+		file.Close();
+		return 0;
+	}
+
+	return header;
+}
+
+// Block accessors
+const char* SceneFile::GetString(const Header* header, uint32_t offset)
+{
+	return (const char*)header + header->StringOffset + offset;
+}
+
+const SceneFile::MeshRecord* SceneFile::GetMeshes(const Header* header)
+{
+	return (const MeshRecord*)((const char*)header + header->MeshOffset);
+}
+
+const SceneFile::MaterialRecord* SceneFile::GetMaterials(const Header* header)
+{
+	return (const MaterialRecord*)((const char*)header + header->MaterialOffset);
+}
+
+const SceneFile::EntityRecord* SceneFile::GetEntities(const Header* header)
+{
+	return (const EntityRecord*)((const char*)header + header->EntityOffset);
+}
+
+const Light* SceneFile::GetLights(const Header* header)
+{
+	return (const Light*)((const char*)header + header->LightOffset);
+}
+
+const SceneFile::CameraRecord* SceneFile::GetCameras(const Header* header)
+{
+	return (const CameraRecord*)((const char*)header + header->CameraOffset);
+}
+
+void SceneFile::Read(const Header* header, Scene& scene)
+{
+	scene.Strings.assign(GetString(header, 0), GetString(header, 0) + header->StringBytes);
+	scene.Meshes.assign(GetMeshes(header), GetMeshes(header) + header->MeshCount);
+	scene.Materials.assign(GetMaterials(header), GetMaterials(header) + header->MaterialCount);
+	scene.Entities.assign(GetEntities(header), GetEntities(header) + header->EntityCount);
+	scene.Lights.assign(GetLights(header), GetLights(header) + header->LightCount);
+	scene.Cameras.assign(GetCameras(header), GetCameras(header) + header->CameraCount);
+}
+
+// --------------------------------------------------------
+// Writes the header and data blocks to a temporary file, then
+// renames it over the scene so a partial write is never read
+// --------------------------------------------------------
+bool SceneFile::Write(const char* scenePath, const char* sourcePath, const Scene& scene)
+{
+	Header header = {};
+	memcpy(header.Magic, "SCNE", 4);
+	header.Version = Version;
+	if (sourcePath)
+		GetFileDetails(sourcePath, header.SourceSize, header.SourceTimestamp);
+
+	// A scene with no strings still has the empty one
+	const char emptyString = '\0';
+	const char* strings = scene.Strings.empty() ? &emptyString : scene.Strings.data();
+	header.StringBytes = scene.Strings.empty() ? 1 : (uint32_t)scene.Strings.size();
+	header.MeshCount = (uint32_t)scene.Meshes.size();
+	header.MaterialCount = (uint32_t)scene.Materials.size();
+	header.EntityCount = (uint32_t)scene.Entities.size();
+	header.LightCount = (uint32_t)scene.Lights.size();
+	header.CameraCount = (uint32_t)scene.Cameras.size();
+
+	// Lay out the blocks after the header
+	const void* blocks[] = { strings, scene.Meshes.data(), scene.Materials.data(), scene.Entities.data(), scene.Lights.data(), scene.Cameras.data() };
+	uint64_t bytes[] =
+	{
+		header.StringBytes,
+		(uint64_t)sizeof(MeshRecord) * header.MeshCount,
+		(uint64_t)sizeof(MaterialRecord) * header.MaterialCount,
+		(uint64_t)sizeof(EntityRecord) * header.EntityCount,
+		(uint64_t)sizeof(Light) * header.LightCount,
+		(uint64_t)sizeof(CameraRecord) * header.CameraCount
+	};
+	uint64_t* offsets[] = { &header.StringOffset, &header.MeshOffset, &header.MaterialOffset, &header.EntityOffset, &header.LightOffset, &header.CameraOffset };
+
+	uint64_t end = sizeof(Header);
+	for (int i = 0; i < 6; i++)
+	{
+		*offsets[i] = AlignUp(end);
+		end = *offsets[i] + bytes[i];
+	}
+
+	std::string tempPath = std::string(scenePath) + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+			return false;
+
+		const char padding[BlockAlignment] = {};
+		out.write((const char*)&header, sizeof(Header));
+		end = sizeof(Header);
+		for (int i = 0; i < 6; i++)
+		{
+			out.write(padding, *offsets[i] - end);
+			out.write((const char*)blocks[i], bytes[i]);
+			end = *offsets[i] + bytes[i];
+		}
+
+		if (!out.good())
+			return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, scenePath, error);
+	return !error;
+}
+
+// --------------------------------------------------------
+// Reads the text form line by line.  Meshes and materials
+// are referred to by name, so each must be declared before
+// anything uses it.  Fields are keyed and default when left
+// out, so text from any earlier version still reads.
+// --------------------------------------------------------
+bool SceneFile::ParseText(const char* text, size_t length, Scene& scene)
+{
+	scene = Scene();
+	AddString(scene, "");
+
+	Tokenizer tokens = { text, text + length, text, 0 };
+	std::unordered_map<std::string, uint32_t> meshIndices;
+	std::unordered_map<std::string, uint32_t> materialIndices;
+	std::string type, name, path;
+	uint32_t version = 0;
+
+	bool valid =
+		tokens.NextLine() &&
+		tokens.ReadWord(type) && type == "scene" &&
+		tokens.ReadIndex(version) && version >= 1 && version <= Version &&
+		tokens.AtLineEnd();
+
+	while (valid && tokens.NextLine())
+	{
+		valid = tokens.ReadWord(type);
+		if (!valid)
+			break;
+
+		if (type == "mesh")
+		{
+			MeshRecord mesh = {};
+			valid = tokens.ReadString(name) && tokens.ReadString(path) && tokens.AtLineEnd() &&
+				meshIndices.emplace(name, (uint32_t)scene.Meshes.size()).second;
+			mesh.Name = AddString(scene, name);
+			mesh.Path = AddString(scene, path);
+			scene.Meshes.push_back(mesh);
+		}
+		else if (type == "material")
+		{
+			MaterialRecord material = DefaultMaterial();
+			valid = tokens.ReadString(name) &&
+				materialIndices.emplace(name, (uint32_t)scene.Materials.size()).second;
+			material.Name = AddString(scene, name);
+			valid = valid && ParseFields(tokens, MaterialFields, std::size(MaterialFields), &material, scene);
+			scene.Materials.push_back(material);
+		}
+		else if (type == "entity")
+		{
+			EntityRecord entity = DefaultEntity();
+			valid = tokens.ReadString(name);
+			auto mesh = meshIndices.find(name);
+			valid = valid && mesh != meshIndices.end() && tokens.ReadString(name);
+			auto material = materialIndices.find(name);
+			valid = valid && material != materialIndices.end() &&
+				ParseFields(tokens, EntityFields, std::size(EntityFields), &entity, scene) &&
+				(entity.Parent == None || entity.Parent < scene.Entities.size());
+			if (valid)
+			{
+				entity.Mesh = mesh->second;
+				entity.Material = material->second;
+				scene.Entities.push_back(entity);
+			}
+		}
+		else if (type == "light")
+		{
+			Light light = DefaultLight();
+			light.Type = -1;
+			valid = tokens.ReadWord(name);
+			for (int i = 0; i < (int)std::size(LightTypeNames); i++)
+			{
+				if (name == LightTypeNames[i])
+					light.Type = i;
+			}
+			valid = valid && light.Type >= 0 &&
+				ParseFields(tokens, LightFields, std::size(LightFields), &light, scene);
+			scene.Lights.push_back(light);
+		}
+		else if (type == "camera")
+		{
+			CameraRecord camera = DefaultCamera();
+			valid = ParseFields(tokens, CameraFields, std::size(CameraFields), &camera, scene);
+			scene.Cameras.push_back(camera);
+		}
+		else
+		{
+			valid = false;
+		}
+	}
+
+	if (!valid)
+		printf("Scene text: can't read line %u\n", tokens.lineNumber);
+	return valid;
+}
+
+// Writes each record on its own line, in the order it was stored
+std::string SceneFile::FormatText(const Scene& scene)
+{
+	std::string out = "scene " + std::to_string(Version) + "\n";
+
+	for (const MeshRecord& mesh : scene.Meshes)
+	{
+		out += "mesh";
+		AppendString(out, GetString(scene, mesh.Name));
+		AppendString(out, GetString(scene, mesh.Path));
+		out += '\n';
+	}
+
+	MaterialRecord defaultMaterial = DefaultMaterial();
+	for (const MaterialRecord& material : scene.Materials)
+	{
+		out += "material";
+		AppendString(out, GetString(scene, material.Name));
+		FormatFields(out, MaterialFields, std::size(MaterialFields), &material, &defaultMaterial, scene);
+		out += '\n';
+	}
+
+	EntityRecord defaultEntity = DefaultEntity();
+	for (const EntityRecord& entity : scene.Entities)
+	{
+		out += "entity";
+		AppendString(out, GetString(scene, scene.Meshes[entity.Mesh].Name));
+		AppendString(out, GetString(scene, scene.Materials[entity.Material].Name));
+		FormatFields(out, EntityFields, std::size(EntityFields), &entity, &defaultEntity, scene);
+		out += '\n';
+	}
+
+	Light defaultLight = DefaultLight();
+	for (const Light& light : scene.Lights)
+	{
+		out += "light ";
+		out += LightTypeNames[light.Type];
+		FormatFields(out, LightFields, std::size(LightFields), &light, &defaultLight, scene);
+		out += '\n';
+	}
+
+	CameraRecord defaultCamera = DefaultCamera();
+	for (const CameraRecord& camera : scene.Cameras)
+	{
+		out += "camera";
+		FormatFields(out, CameraFields, std::size(CameraFields), &camera, &defaultCamera, scene);
+		out += '\n';
+	}
+
+	return out;
+}
+
+bool SceneFile::ReadText(const char* path, Scene& scene)
+{
+	MappedFile file;
+	if (!file.Open(path))
+		return false;
+
+	return ParseText(file.GetData(), file.GetSize(), scene);
+}
+
+bool SceneFile::WriteText(const char* path, const Scene& scene)
+{
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+		return false;
+
+	std::string text = FormatText(scene);
+	out.write(text.data(), text.size());
+	return out.good();
+}
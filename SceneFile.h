@@ -0,0 +1,186 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Lights.h"
+#include "MappedFile.h"
+
+// --------------------------------------------------------
+// Versioned binary scene format, with a text form that
+// converts to and from it exactly
+//
+// A scene is a table of meshes and materials, referenced by
+// index from its entities, plus its lights and cameras.
+// Meshes and textures are stored as paths, and pixel shaders
+// by name, for the loader to resolve.  Every record is plain
+// data with no pointers, so an opened file is read straight
+// out of the mapping, and a whole block of entity records
+// can be created in one pass (see EntityStore::CreateFromScene).
+//
+// The text form has one record per line:
+//
+//   scene 3
+//   mesh "Cube" "../../Assets/Models/cube.obj"
+//   material "Wood" shader "PixelShader" albedo "wood_albedo.png" ...
+//   entity "Cube" "Wood" position 0 -3 0 scale 25 1 25 occluder
+//   entity "Cube" "Scratched" position -6 0 0 animated
+//   light point position 1.5 0 0 color 1 1 1 intensity 0.3 range 12
+//   camera position 0 2 -20 fov 0.785398185
+//
+// Entities and materials name their mesh, material and shader,
+// then list any keyed fields that differ from the defaults
+// (flags like "occluder" and "animated" are just the key).
+// A parent is given as the index of an earlier entity.
+// Lines starting with '#' are comments.  The text form reads
+// any version up to the current one; the binary form only
+// opens at exactly this version.
+// --------------------------------------------------------
+namespace SceneFile
+{
+	// Bump this whenever the layout of any record changes
+	const uint32_t Version = 3;
+
+	// Entity (or index) that refers to nothing
+	const uint32_t None = 0xFFFFFFFF;
+
+	// Textures a material can have, in record order
+	enum TextureSlot
+	{
+		TextureAlbedo,
+		TextureNormalMap,
+		TextureRoughnessMap,
+		TextureMetalnessMap,
+		TextureSlotCount
+	};
+
+	// Shader variable each texture slot is bound to
+	extern const char* const TextureNames[TextureSlotCount];
+
+	// Fixed-size header at the start of every scene file
+	struct Header
+	{
+		char Magic[4];				// Always "SCNE"
+		uint32_t Version;			// Must match SceneFile::Version
+
+		// Details of the text file this was built from (if any)
+		uint64_t SourceSize;
+		uint64_t SourceTimestamp;
+
+		// Data blocks, as byte offsets from the start of the file
+		uint32_t StringBytes;		// Null-terminated strings, starting with an empty one
+		uint32_t MeshCount;
+		uint32_t MaterialCount;
+		uint32_t EntityCount;
+		uint32_t LightCount;
+		uint32_t CameraCount;
+		uint64_t StringOffset;
+		uint64_t MeshOffset;
+		uint64_t MaterialOffset;
+		uint64_t EntityOffset;
+		uint64_t LightOffset;
+		uint64_t CameraOffset;
+	};
+
+	// Strings are byte offsets into the string block, where
+	// offset 0 is the empty string (so "no texture")
+	struct MeshRecord
+	{
+		uint32_t Name;
+		uint32_t Path;
+	};
+
+	struct MaterialRecord
+	{
+		uint32_t Name;
+		uint32_t PixelShader;
+		uint32_t Textures[TextureSlotCount];
+		DirectX::XMFLOAT3 ColorTint;
+		float Roughness;
+		float UVScale;
+		float UVOffset;
+	};
+
+	// Transform components are relative to the parent, which
+	// must come earlier in the entity block
+	struct EntityRecord
+	{
+		uint32_t Mesh;
+		uint32_t Material;
+		uint32_t Parent;				// None for the top of the hierarchy
+		DirectX::XMFLOAT3 Position;
+		DirectX::XMFLOAT4 Rotation;		// Unit quaternion
+		DirectX::XMFLOAT3 Scale;
+		DirectX::XMFLOAT3 ColorTint;	// Surface overrides on top of the material's
+		float UVScale;
+		float UVOffset;
+		uint32_t Occluder;				// Nonzero to draw into the occlusion buffer
+		uint32_t Animated;				// Nonzero for the entity the simulation moves (its children follow)
+	};
+
+	// The aspect ratio comes from the window, not the file
+	struct CameraRecord
+	{
+		DirectX::XMFLOAT3 Position;
+		DirectX::XMFLOAT3 Orientation;	// Pitch, yaw and roll
+		float FieldOfView;
+		float NearClip;
+		float FarClip;
+		float MoveSpeed;
+		float LookSpeed;
+	};
+
+	// A scene being built or converted, with the same records
+	// as the file and the string block they point into
+	struct Scene
+	{
+		std::vector<char> Strings;
+		std::vector<MeshRecord> Meshes;
+		std::vector<MaterialRecord> Materials;
+		std::vector<EntityRecord> Entities;
+		std::vector<Light> Lights;
+		std::vector<CameraRecord> Cameras;
+	};
+
+	// Records with every field at its default
+	MaterialRecord DefaultMaterial();
+	EntityRecord DefaultEntity();
+	Light DefaultLight();
+	CameraRecord DefaultCamera();
+
+	// Adds a string to a scene's string block, returning its offset
+	uint32_t AddString(Scene& scene, const std::string& text);
+	const char* GetString(const Scene& scene, uint32_t offset);
+
+	// Maps a scene file and checks its header, blocks and references.
+	// Returns the header (pointing into the mapping), or null if the
+	// file is missing or malformed, or older than its text source
+	// (when one is given and still exists).
+	const Header* Open(const char* scenePath, const char* sourcePath, MappedFile& file);
+
+	// Access the data blocks of an opened scene
+	const char* GetString(const Header* header, uint32_t offset);
+	const MeshRecord* GetMeshes(const Header* header);
+	const MaterialRecord* GetMaterials(const Header* header);
+	const EntityRecord* GetEntities(const Header* header);
+	const Light* GetLights(const Header* header);
+	const CameraRecord* GetCameras(const Header* header);
+
+	// Copies an opened scene's records out of the mapping
+	void Read(const Header* header, Scene& scene);
+
+	// Saves a scene, along with a snapshot of the text file it was
+	// built from (null if none)
+	bool Write(const char* scenePath, const char* sourcePath, const Scene& scene);
+
+	// Converts between a scene and its text form.  Parsing replaces
+	// the scene's contents and prints the first error it finds.
+	bool ParseText(const char* text, size_t length, Scene& scene);
+	std::string FormatText(const Scene& scene);
+
+	// The same, from and to text files
+	bool ReadText(const char* path, Scene& scene);
+	bool WriteText(const char* path, const Scene& scene);
+}
@@ -0,0 +1,60 @@
+#include "ShaderCommands.h"
+
+#include <cstring>
+
+using namespace DirectX;
+
+void ShaderCommands::SetShaders(CommandBuffer& commands, SimpleVertexShader* vs, SimplePixelShader* ps)
+{
+	commands.SetPipeline(
+		vs->GetDirectXShader().Get(),
+		vs->GetInputLayout().Get(),
+		ps ? ps->GetDirectXShader().Get() : 0);
+}
+
+ShaderCommands::Constants ShaderCommands::SetConstants(CommandBuffer& commands, ISimpleShader* shader, CommandBuffer::Stage stage, unsigned int bufferIndex)
+{
+	Constants constants = { shader, bufferIndex, 0 };
+	const SimpleConstantBuffer* buffer = shader->GetBufferInfo(bufferIndex);
+	if (!buffer || buffer->Type != D3D11_CT_CBUFFER)
+		return constants;
+
+	constants.data = (unsigned char*)commands.SetConstants(
+		stage,
+		buffer->BindIndex,
+		buffer->ConstantBuffer.Get(),
+		buffer->LocalDataBuffer,
+		buffer->Size);
+	return constants;
+}
+
+void ShaderCommands::SetData(Constants& constants, const char* name, const void* data, unsigned int size)
+{
+	if (!constants.data)
+		return;
+
+	const SimpleShaderVariable* variable = constants.shader->GetVariableInfo(name);
+	if (!variable || variable->ConstantBufferIndex != constants.bufferIndex || size > variable->Size)
+		return;
+
+	memcpy(constants.data + variable->ByteOffset, data, size);
+}
+
+void ShaderCommands::SetInt(Constants& constants, const char* name, int data) { SetData(constants, name, &data, sizeof(int)); }
+void ShaderCommands::SetFloat(Constants& constants, const char* name, float data) { SetData(constants, name, &data, sizeof(float)); }
+void ShaderCommands::SetFloat3(Constants& constants, const char* name, XMFLOAT3 data) { SetData(constants, name, &data, sizeof(XMFLOAT3)); }
+void ShaderCommands::SetMatrix4x4(Constants& constants, const char* name, const XMFLOAT4X4& data) { SetData(constants, name, &data, sizeof(XMFLOAT4X4)); }
+
+void ShaderCommands::SetShaderResourceView(CommandBuffer& commands, ISimpleShader* shader, CommandBuffer::Stage stage, const char* name, ID3D11ShaderResourceView* srv)
+{
+	const SimpleSRV* info = shader->GetShaderResourceViewInfo(name);
+	if (info)
+		commands.SetResource(stage, info->BindIndex, srv);
+}
+
+void ShaderCommands::SetSamplerState(CommandBuffer& commands, ISimpleShader* shader, CommandBuffer::Stage stage, const char* name, ID3D11SamplerState* sampler)
+{
+	const SimpleSampler* info = shader->GetSamplerInfo(name);
+	if (info)
+		commands.SetSampler(stage, info->BindIndex, sampler);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include "CommandBuffer.h"
+#include "SimpleShader.h"
+
+// --------------------------------------------------------
+// Records SimpleShader bindings into a command stream rather
+// than sending them to the device.
+//
+// Constants start as a copy of the shader's own local data
+// (whatever SetMatrix4x4() and friends last left there) and
+// are then overridden in the stream, so per-draw values never
+// touch the shader.  Recording only ever reads a shader, so
+// several threads can record with the same one as long as
+// nothing is setting its variables meanwhile.
+// --------------------------------------------------------
+namespace ShaderCommands
+{
+	// One constant buffer's contents inside a stream.  Only valid
+	// until the next command is recorded into that stream.
+	struct Constants
+	{
+		ISimpleShader* shader;
+		unsigned int bufferIndex;
+		unsigned char* data;	// Null if the shader has no such buffer
+	};
+
+	// Binds the shaders and the vertex shader's input layout (no
+	// pixel shader draws depth only)
+	void SetShaders(CommandBuffer& commands, SimpleVertexShader* vs, SimplePixelShader* ps);
+
+	// Uploads and binds one of the shader's constant buffers,
+	// returning its contents for overriding
+	Constants SetConstants(CommandBuffer& commands, ISimpleShader* shader, CommandBuffer::Stage stage, unsigned int bufferIndex = 0);
+
+	// Overrides a variable in recorded constants (ignored if the
+	// buffer has no such variable, or it's too small for the data)
+	void SetData(Constants& constants, const char* name, const void* data, unsigned int size);
+	void SetInt(Constants& constants, const char* name, int data);
+	void SetFloat(Constants& constants, const char* name, float data);
+	void SetFloat3(Constants& constants, const char* name, DirectX::XMFLOAT3 data);
+	void SetMatrix4x4(Constants& constants, const char* name, const DirectX::XMFLOAT4X4& data);
+
+	// Binds a texture or sampler to the slot the shader gives it by name
+	void SetShaderResourceView(CommandBuffer& commands, ISimpleShader* shader, CommandBuffer::Stage stage, const char* name, ID3D11ShaderResourceView* srv);
+	void SetSamplerState(CommandBuffer& commands, ISimpleShader* shader, CommandBuffer::Stage stage, const char* name, ID3D11SamplerState* sampler);
+}
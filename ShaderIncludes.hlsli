@@ -4,12 +4,34 @@
 // Structs
 
 // Struct representing a single vertex worth of data
+// - Matches PackedVertex in Vertex.h, use the Decode functions below
 struct VertexShaderInput
 {
-    float3 localPosition    : POSITION; // XYZ position
-    float2 uv               : TEXCOORD; // UV texture coordinate
-    float3 normal           : NORMAL;   // Surface normal vector
-    float3 tangent          : TANGENT;   // Vector tangent to the normal
+    uint2 packedPosition    : POSITION; // 16-bit XYZ normalized to the mesh bounds
+    uint packedUV           : TEXCOORD; // Two half float UV coordinates
+    uint packedNormal       : NORMAL;   // Octahedral encoded surface normal
+    uint packedTangent      : TANGENT;  // Octahedral encoded tangent
+};
+
+// The same vertex plus one entity's data, for instanced drawing
+// - "_PER_INSTANCE" semantics are read from input slot 1, once per instance
+// - Must match InstanceBatcher::InstanceData on the C++ side
+struct VertexShaderInput_Instanced
+{
+    uint2 packedPosition    : POSITION;
+    uint packedUV           : TEXCOORD;
+    uint packedNormal       : NORMAL;
+    uint packedTangent      : TANGENT;
+    float4 world0           : WORLD_PER_INSTANCE0;  // Rows of the world matrix
+    float4 world1           : WORLD_PER_INSTANCE1;
+    float4 world2           : WORLD_PER_INSTANCE2;
+    float4 world3           : WORLD_PER_INSTANCE3;
+    float4 worldInvTranspose0 : WORLD_INV_TRANSPOSE_PER_INSTANCE0;
+    float4 worldInvTranspose1 : WORLD_INV_TRANSPOSE_PER_INSTANCE1;
+    float4 worldInvTranspose2 : WORLD_INV_TRANSPOSE_PER_INSTANCE2;
+    float4 worldInvTranspose3 : WORLD_INV_TRANSPOSE_PER_INSTANCE3;
+    float4 tintAndUVScale   : TINT_UV_SCALE_PER_INSTANCE;   // RGB tint, then UV scale
+    float uvOffset          : UV_OFFSET_PER_INSTANCE;
 };
 
 // Struct representing the data we're sending down the pipeline
@@ -22,6 +44,7 @@ struct VertexToPixel
     float3 tangent          : TANGENT;          // Vector tangent to the normal
     float3 worldPosition    : POSITION;         // position in world space
     float4 shadowMapPos     : SHADOW_POSITION;  // position in the shadow map
+    float3 colorTint        : COLOR;            // Material tint times the entity's
 };
 
 // Struct for data in the Skybox shaders
@@ -52,6 +75,34 @@ struct Light
     float2 Padding;
 };
 
+// Vertex decoding functions
+
+// Position from 16-bit values, using the mesh's positionScale/positionOffset
+float3 DecodePosition(uint2 packed, float3 scale, float3 offset)
+{
+    uint3 q = uint3(packed.x & 0xFFFF, packed.x >> 16, packed.y & 0xFFFF);
+    return offset + float3(q) * scale;
+}
+
+// UV from a pair of half floats
+float2 DecodeUV(uint packed)
+{
+    return float2(f16tof32(packed), f16tof32(packed >> 16));
+}
+
+// Unit vector from two octahedral 16-bit snorms
+float3 DecodeOctahedral(uint packed)
+{
+    int2 q = int2(packed << 16, packed) >> 16;
+    float2 f = max(float2(q) / 32767.0f, -1.0f);
+    float3 n = float3(f, 1.0f - abs(f.x) - abs(f.y));
+
+    // Unfold the lower hemisphere
+    float t = saturate(-n.z);
+    n.xy += n.xy >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
 // Lighting functions
 
 float Attenuate(Light light, float3 worldPos)
@@ -1,4 +1,5 @@
 #include "SimpleShader.h"
+#include "Graphics.h"
 
 // Default error reporting state
 bool ISimpleShader::ReportErrors = false;
@@ -197,6 +198,7 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		newBuffDesc.MiscFlags = 0;
 		newBuffDesc.StructureByteStride = 0;
 		device->CreateBuffer(&newBuffDesc, 0, constantBuffers[b].ConstantBuffer.GetAddressOf());
+		Graphics::TrackResource(constantBuffers[b].ConstantBuffer.Get());
 
 		// Set up the data buffer for this constant buffer
 		constantBuffers[b].Size = bufferDesc.Size;
@@ -756,6 +758,7 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 		shaderBlob->GetBufferSize(),
 		0,
 		shader.GetAddressOf());
+	Graphics::TrackShader(shader.Get());
 
 	// Did the creation work?
 	if (result != S_OK)
@@ -997,6 +1000,7 @@ bool SimplePixelShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob
 		shaderBlob->GetBufferSize(),
 		0,
 		shader.GetAddressOf());
+	Graphics::TrackShader(shader.Get());
 
 	// Check the result
 	return (result == S_OK);
@@ -1141,6 +1145,7 @@ bool SimpleDomainShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 		shaderBlob->GetBufferSize(),
 		0,
 		shader.GetAddressOf());
+	Graphics::TrackShader(shader.Get());
 
 	// Check the result
 	return (result == S_OK);
@@ -1284,6 +1289,7 @@ bool SimpleHullShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob)
 		shaderBlob->GetBufferSize(),
 		0,
 		shader.GetAddressOf());
+	Graphics::TrackShader(shader.Get());
 
 	// Check the result
 	return (result == S_OK);
@@ -1436,6 +1442,7 @@ bool SimpleGeometryShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderB
 		shaderBlob->GetBufferSize(),
 		0,
 		shader.GetAddressOf());
+	Graphics::TrackShader(shader.Get());
 
 	// Check the result
 	return (result == S_OK);
@@ -1508,6 +1515,7 @@ bool SimpleGeometryShader::CreateShaderWithStreamOut(Microsoft::WRL::ComPtr<ID3D
 		rast,                           // Index of the stream to rasterize (if any)
 		NULL,                           // Not using class linkage
 		shader.GetAddressOf());
+	Graphics::TrackShader(shader.Get());
 	
 	return (result == S_OK);
 }
@@ -1550,6 +1558,7 @@ bool SimpleGeometryShader::CreateCompatibleStreamOutBuffer(Microsoft::WRL::ComPt
 
 	// Attempt to create the buffer and return the result
 	HRESULT result = device->CreateBuffer(&desc, 0, buffer.GetAddressOf());
+	Graphics::TrackResource(buffer.Get());
 	return (result == S_OK);
 }
 
@@ -1725,6 +1734,7 @@ bool SimpleComputeShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBl
 		shaderBlob->GetBufferSize(),
 		0,
 		shader.GetAddressOf());
+	Graphics::TrackShader(shader.Get());
 
 	// Was the shader created correctly?
 	if (result != S_OK)
@@ -1,5 +1,6 @@
 #include "Sky.h"
 #include "Graphics.h"
+#include "ShaderCommands.h"
 
 using namespace DirectX;
 
@@ -24,30 +25,32 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Sky::GetSkyTexture()
 	return skySRV;
 }
 
-void Sky::Draw(std::shared_ptr<Camera> camera)
+void Sky::Draw(CommandBuffer& commands, std::shared_ptr<Camera> camera)
 {
 	// Change necessary render states
-	Graphics::Context->RSSetState(skyRasterState.Get());
-	Graphics::Context->OMSetDepthStencilState(skyDepthState.Get(), 0);
+	commands.SetRasterizerState(skyRasterState.Get());
+	commands.SetDepthState(skyDepthState.Get());
 
 	// Prepare sky shaders for drawing
-	skyVS->SetShader();
-	skyPS->SetShader();
+	ShaderCommands::SetShaders(commands, skyVS.get(), skyPS.get());
 
 	// Pass data to shaders
-	skyVS->SetMatrix4x4("view", camera->GetViewMatrix());
-	skyVS->SetMatrix4x4("projection", camera->GetProjectionMatrix());
-	skyVS->CopyAllBufferData();
+	ShaderCommands::Constants constants = ShaderCommands::SetConstants(commands, skyVS.get(), CommandBuffer::StageVertex);
+	ShaderCommands::SetMatrix4x4(constants, "view", camera->GetViewMatrix());
+	ShaderCommands::SetMatrix4x4(constants, "projection", camera->GetProjectionMatrix());
+	ShaderCommands::SetFloat3(constants, "positionScale", skyBoxMesh->GetPositionScale());
+	ShaderCommands::SetFloat3(constants, "positionOffset", skyBoxMesh->GetPositionOffset());
+	ShaderCommands::SetConstants(commands, skyPS.get(), CommandBuffer::StagePixel);
 
-	skyPS->SetShaderResourceView("SkyTexture", skySRV);
-	skyPS->SetSamplerState("BasicSampler", samplerOptions);
+	ShaderCommands::SetShaderResourceView(commands, skyPS.get(), CommandBuffer::StagePixel, "SkyTexture", skySRV.Get());
+	ShaderCommands::SetSamplerState(commands, skyPS.get(), CommandBuffer::StagePixel, "BasicSampler", samplerOptions.Get());
 
 	// Draw the skybox
-	skyBoxMesh->Draw();
+	skyBoxMesh->Draw(commands);
 
 	// Reset render states to default
-	Graphics::Context->RSSetState(0);
-	Graphics::Context->OMSetDepthStencilState(0, 0);
+	commands.SetRasterizerState(0);
+	commands.SetDepthState(0);
 }
 
 
@@ -93,6 +96,8 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Sky::CreateCubemap(
 	CreateWICTextureFromFile(Graphics::Device.Get(), down, (ID3D11Resource**)textures[3].GetAddressOf(), 0);
 	CreateWICTextureFromFile(Graphics::Device.Get(), front, (ID3D11Resource**)textures[4].GetAddressOf(), 0);
 	CreateWICTextureFromFile(Graphics::Device.Get(), back, (ID3D11Resource**)textures[5].GetAddressOf(), 0);
+	for (int i = 0; i < 6; i++)
+		Graphics::TrackResource(textures[i].Get());
 
 	// We'll assume all of the textures are the same color format and resolution,
 	// so get the description of the first shader resource view
@@ -118,7 +123,7 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Sky::CreateCubemap(
 
 	// Create the final texture resource to hold the cube map
 	Microsoft::WRL::ComPtr<ID3D11Texture2D> cubeMapTexture;
-	Graphics::Device->CreateTexture2D(&cubeDesc, 0, cubeMapTexture.GetAddressOf());
+	Graphics::CreateTexture2D(&cubeDesc, 0, cubeMapTexture.GetAddressOf());
 
 	// Loop through the individual face textures and copy them,
 	// one at a time, to the cube map texure
@@ -3,6 +3,7 @@
 #include "Mesh.h"
 #include "SimpleShader.h"
 #include "Camera.h"
+#include "CommandBuffer.h"
 #include "WICTextureLoader.h"
 
 #include <memory>
@@ -57,7 +58,7 @@ public:
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetSkyTexture();
 
 	// Functions
-	void Draw(std::shared_ptr<Camera> camera);
+	void Draw(CommandBuffer& commands, std::shared_ptr<Camera> camera);
 
 };
 
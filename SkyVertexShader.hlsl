@@ -5,6 +5,8 @@ cbuffer ExternalData : register(b0)
 {
     matrix view;
     matrix projection;
+    float3 positionScale;
+    float3 positionOffset;
 }
 
 // --------------------------------------------------------
@@ -26,14 +28,15 @@ VertexToPixel_Sky main(VertexShaderInput input)
     viewNoTranslation._34 = 0;
     
     // Apply projection and view by the local position to get screen position
+    float3 localPosition = DecodePosition(input.packedPosition, positionScale, positionOffset);
     matrix vp = mul(projection, viewNoTranslation);
-    output.screenPosition = mul(vp, float4(input.localPosition, 1.0f));
+    output.screenPosition = mul(vp, float4(localPosition, 1.0f));
     
     // Set sky z value to be w so it is exactly on the far clip plane
     output.screenPosition.z = output.screenPosition.w;
     
     // Use position of the vertex for the direction in the cube map
-    output.sampleDir = input.localPosition;
+    output.sampleDir = localPosition;
 
     // Whatever we return will make its way through the pipeline to the
 	// next programmable stage we're using (the pixel shader for now)
@@ -4,15 +4,44 @@
 
 using namespace DirectX;
 
-// Initialize default transform values
+// Initialize default transform values in the shared system
 Transform::Transform() :
-	position(0, 0, 0),
-	rotation(0, 0, 0),
-	scale(1, 1, 1)
+	Transform(TransformSystem::Default())
 {
-	XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
-	XMStoreFloat4x4(&worldInverseTransposeMatrix, XMMatrixIdentity());
-	dirtyMatrices = false;
+}
+// Initialize default transform values in a specific system
+Transform::Transform(TransformSystem& system) :
+	system(&system),
+	slot(system.Create())
+{
+}
+
+// Take over another handle's slot, leaving it with none
+Transform::Transform(Transform&& other) noexcept :
+	system(other.system),
+	slot(other.slot)
+{
+	other.system = 0;
+}
+
+Transform& Transform::operator=(Transform&& other) noexcept
+{
+	if (this != &other)
+	{
+		if (system)
+			system->Destroy(slot);
+		system = other.system;
+		slot = other.slot;
+		other.system = 0;
+	}
+	return *this;
+}
+
+// Give the slot back for reuse (unless it was moved away)
+Transform::~Transform()
+{
+	if (system)
+		system->Destroy(slot);
 }
 
 // Setters
@@ -20,96 +49,110 @@ Transform::Transform() :
 // Overwrite position value with new x, y, z values
 void Transform::SetPosition(float x, float y, float z)
 {
-	position.x = x;
-	position.y = y;
-	position.z = z;
-	dirtyMatrices = true;
+	system->SetPosition(slot, XMFLOAT3(x, y, z));
 }
 // Overwrite position value with new XMFLOAT3 value
 void Transform::SetPosition(XMFLOAT3 position)
 {
-	this->position = position;
-	dirtyMatrices = true;
+	system->SetPosition(slot, position);
 }
 
 // Overwrite rotation value with new pitch, yaw, roll values
 void Transform::SetRotation(float pitch, float yaw, float roll)
 {
-	rotation.x = pitch;
-	rotation.y = yaw;
-	rotation.z = roll;
-	dirtyMatrices = true;
+	system->SetPitchYawRoll(slot, XMFLOAT3(pitch, yaw, roll));
 }
 // Overwrite rotation value with new XMFLOAT3 value
 void Transform::SetRotation(XMFLOAT3 rotation)
 {
-	this->rotation = rotation;
-	dirtyMatrices = true;
+	system->SetPitchYawRoll(slot, rotation);
+}
+// Overwrite rotation with a quaternion (the Euler angles follow it)
+void Transform::SetRotationQuaternion(XMFLOAT4 quaternion)
+{
+	system->SetRotation(slot, quaternion);
 }
 
 // Overwrite scale value with new x, y, z values
 void Transform::SetScale(float x, float y, float z)
 {
-	scale.x = x;
-	scale.y = y;
-	scale.z = z;
-	dirtyMatrices = true;
+	system->SetScale(slot, XMFLOAT3(x, y, z));
 }
 // Overwrite scale value with new XMFLOAT3 value
 void Transform::SetScale(XMFLOAT3 scale)
 {
-	this->scale = scale;
-	dirtyMatrices = true;
+	system->SetScale(slot, scale);
+}
+
+// Link under another transform, or detach with null
+bool Transform::SetParent(Transform* parent)
+{
+	if (parent && parent->system != system)
+		return false;
+	return system->SetParent(slot, parent ? parent->slot : TransformSystem::NoParent);
 }
 
 // Getters
 
 // Return transformation values
-XMFLOAT3 Transform::GetPosition() {	return position; }
-XMFLOAT3 Transform::GetPitchYawRoll() {	return rotation; }
-XMFLOAT3 Transform::GetScale() { return scale; }
+XMFLOAT3 Transform::GetPosition() {	return system->GetPosition(slot); }
+XMFLOAT3 Transform::GetPitchYawRoll() {	return system->GetPitchYawRoll(slot); }
+XMFLOAT4 Transform::GetRotationQuaternion() { return system->GetRotation(slot); }
+XMFLOAT3 Transform::GetScale() { return system->GetScale(slot); }
+bool Transform::HasParent() { return system->GetParent(slot) != TransformSystem::NoParent; }
 
 // Calculate and return the directional vectors relative to transform's orientation
-DirectX::XMFLOAT3 Transform::GetRight()   { return GetRelativeVector(XMFLOAT3(1, 0, 0)); }
-DirectX::XMFLOAT3 Transform::GetUp()	  { return GetRelativeVector(XMFLOAT3(0, 1, 0)); }
-DirectX::XMFLOAT3 Transform::GetForward() {	return GetRelativeVector(XMFLOAT3(0, 0, 1)); }
+DirectX::XMFLOAT3 Transform::GetRight()   { return system->GetRight(slot); }
+DirectX::XMFLOAT3 Transform::GetUp()	  { return system->GetUp(slot); }
+DirectX::XMFLOAT3 Transform::GetForward() {	return system->GetForward(slot); }
 
-// Recalculate and return World Matrix Value
+// Return World Matrix Value (recalculated if it's still dirty)
 XMFLOAT4X4 Transform::GetWorldMatrix()
 {
-	RecalculateMatrices();
-	return worldMatrix;
+	return system->GetWorldMatrix(slot);
 }
 
 // Return world Inverse Transpose Matrix
 XMFLOAT4X4 Transform::GetWorldInverseTransposeMatrix()
 {
-	RecalculateMatrices();
-	return worldInverseTransposeMatrix;
+	return system->GetWorldInverseTransposeMatrix(slot);
 }
 
+// Matrices for drawing between simulation steps
+void Transform::GetInterpolatedMatrices(float alpha, XMFLOAT4X4& world, XMFLOAT4X4& worldInverseTranspose)
+{
+	system->GetInterpolatedMatrices(slot, alpha, world, worldInverseTranspose);
+}
+
+// Rebuild the matrices if needed so the version is current
+unsigned int Transform::GetVersion()
+{
+	return system->GetVersion(slot);
+}
+
+unsigned int Transform::GetSlot() { return slot; }
+
 // Transformers
 
 // Move object without respect to its orientation
 void Transform::MoveAbsolute(float x, float y, float z)
 {
+	XMFLOAT3 position = GetPosition();
 	position.x += x;
 	position.y += y;
 	position.z += z;
-	dirtyMatrices = true;
+	SetPosition(position);
 }
 // Move object without respect to its orientation
 void Transform::MoveAbsolute(XMFLOAT3 offset)
 {
 	MoveAbsolute(offset.x, offset.y, offset.z);
-	dirtyMatrices = true;
 }
 
 // Move object with respect to its orientation
 void Transform::MoveRelative(float x, float y, float z)
 {
 	MoveRelative(XMFLOAT3(x, y, z));
-	dirtyMatrices = true;
 }
 // Move object with respect to its orientation
 void Transform::MoveRelative(DirectX::XMFLOAT3 offset)
@@ -120,43 +163,66 @@ void Transform::MoveRelative(DirectX::XMFLOAT3 offset)
 	XMVECTOR move = XMLoadFloat3(&relativeOffset);
 
 	// Move the position by the new rotated offset
+	XMFLOAT3 position = GetPosition();
 	XMVECTOR pos = XMLoadFloat3(&position);
 	pos = XMVectorAdd(pos, move);
 
 	// Store the pos value back in position storage type
 	XMStoreFloat3(&position, pos);
-
-	dirtyMatrices = true;
+	SetPosition(position);
 }
 
 // Rotate object by a certain amount
 void Transform::Rotate(float pitch, float yaw, float roll)
 {
+	XMFLOAT3 rotation = GetPitchYawRoll();
 	rotation.x += pitch;
 	rotation.y += yaw;
 	rotation.z += roll;
-	dirtyMatrices = true;
+	SetRotation(rotation);
 }
 // Rotate object by a certain amount
 void Transform::Rotate(XMFLOAT3 rotation)
 {
 	Rotate(rotation.x, rotation.y, rotation.z);
-	dirtyMatrices = true;
+}
+// Rotate object by a quaternion, after its current rotation
+void Transform::RotateQuaternion(XMFLOAT4 quaternion)
+{
+	XMFLOAT4 current = GetRotationQuaternion();
+	XMFLOAT4 rotated;
+	XMStoreFloat4(&rotated, XMQuaternionMultiply(XMLoadFloat4(&current), XMLoadFloat4(&quaternion)));
+	SetRotationQuaternion(rotated);
+}
+// Rotate object around an axis by an angle in radians
+void Transform::RotateAxisAngle(XMFLOAT3 axis, float angle)
+{
+	XMFLOAT4 quaternion;
+	XMStoreFloat4(&quaternion, XMQuaternionRotationAxis(XMLoadFloat3(&axis), angle));
+	RotateQuaternion(quaternion);
+}
+// Blend toward another orientation
+void Transform::SlerpRotation(XMFLOAT4 target, float t)
+{
+	XMFLOAT4 current = GetRotationQuaternion();
+	XMFLOAT4 blended;
+	XMStoreFloat4(&blended, XMQuaternionSlerp(XMLoadFloat4(&current), XMLoadFloat4(&target), t));
+	SetRotationQuaternion(blended);
 }
 
 // Scale object by a certain amount
 void Transform::Scale(float x, float y, float z)
 {
+	XMFLOAT3 scale = GetScale();
 	scale.x *= x;
 	scale.y *= y;
 	scale.z *= z;
-	dirtyMatrices = true;
+	SetScale(scale);
 }
 // Scale object by a certain amount
 void Transform::Scale(float scale)
 {
 	Scale(scale, scale, scale);
-	dirtyMatrices = true;
 }
 
 // Helpers
@@ -167,7 +233,8 @@ DirectX::XMFLOAT3 Transform::GetRelativeVector(DirectX::XMFLOAT3 absVector)
 	// Load the absolute vector as a math type
 	XMVECTOR absVec = XMLoadFloat3(&absVector);
 	// Quaternrion representing current rotation
-	XMVECTOR quat = XMQuaternionRotationRollPitchYaw(rotation.x, rotation.y, rotation.z);
+	XMFLOAT4 rotation = GetRotationQuaternion();
+	XMVECTOR quat = XMLoadFloat4(&rotation);
 
 	// Rotate the vector by the quaternion to get the vector in relative space
 	XMVECTOR relVec = XMVector3Rotate(absVec, quat);
@@ -178,31 +245,3 @@ DirectX::XMFLOAT3 Transform::GetRelativeVector(DirectX::XMFLOAT3 absVector)
 	return ret;
 }
 
-// Recalculate the World and WorldInverseTranspose Matrices
-void Transform::RecalculateMatrices()
-{
-	if (!dirtyMatrices)
-		return;
-
-	// Recalculate the World Matrix
-	// translation matrix
-	XMVECTOR pos = XMLoadFloat3(&position);
-	XMMATRIX t = XMMatrixTranslationFromVector(pos);
-
-	// rotation matrix
-	XMVECTOR rot = XMLoadFloat3(&rotation);
-	XMMATRIX r = XMMatrixRotationRollPitchYawFromVector(rot);
-
-	// scaling matrix
-	XMVECTOR sca = XMLoadFloat3(&scale);
-	XMMATRIX s = XMMatrixScalingFromVector(sca);
-
-	// world matrix
-	XMMATRIX world = XMMatrixMultiply(XMMatrixMultiply(s, r), t);
-
-	// Store World and Inverse Transpose Matrices in storage types
-	XMStoreFloat4x4(&worldMatrix, world);
-	XMStoreFloat4x4(&worldInverseTransposeMatrix, XMMatrixInverse(0, XMMatrixTranspose(world)));
-
-	dirtyMatrices = false;
-}
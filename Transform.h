@@ -1,27 +1,33 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include "TransformSystem.h"
 
+// --------------------------------------------------------
+// Handle to one transform's slot in a TransformSystem, which
+// holds the actual components and matrices
+// --------------------------------------------------------
 class Transform
 {
 private:
 
-	// Transform float values
-	DirectX::XMFLOAT3 position;
-	DirectX::XMFLOAT3 rotation;
-	DirectX::XMFLOAT3 scale;
-
-	// Transform world matrices
-	DirectX::XMFLOAT4X4 worldMatrix;
-	DirectX::XMFLOAT4X4 worldInverseTransposeMatrix;
-	
-	void RecalculateMatrices();
-	bool dirtyMatrices;
+	// Where this transform's data lives
+	TransformSystem* system;
+	unsigned int slot;
 
 public:
 
-	// Constructor
+	// Constructors (the default uses the shared system)
 	Transform();
+	Transform(TransformSystem& system);
+	~Transform();
+
+	// Each handle owns its slot, which can be handed to another
+	// handle (so transforms can be stored by value and moved around)
+	Transform(const Transform&) = delete;
+	Transform& operator=(const Transform&) = delete;
+	Transform(Transform&& other) noexcept;
+	Transform& operator=(Transform&& other) noexcept;
 
 	// Setters - Overwrite transform values
 	void SetPosition(float x, float y, float z);
@@ -29,15 +35,24 @@ public:
 
 	void SetRotation(float pitch, float yaw, float roll);
 	void SetRotation(DirectX::XMFLOAT3 rotation);
+	void SetRotationQuaternion(DirectX::XMFLOAT4 quaternion);
 
 	void SetScale(float x, float y, float z);
 	void SetScale(DirectX::XMFLOAT3 scale);
 
+	// Makes the position, rotation and scale relative to another transform
+	// in the same system (null to detach).  Fails if it would make a loop.
+	bool SetParent(Transform* parent);
+
 	// Getters - Return transform values
 	DirectX::XMFLOAT3 GetPosition();
 	DirectX::XMFLOAT3 GetPitchYawRoll();
+	DirectX::XMFLOAT4 GetRotationQuaternion();
 	DirectX::XMFLOAT3 GetScale();
+	bool HasParent();
 
+	// World-space directions, including any parent's rotation (cached
+	// with the world matrix)
 	DirectX::XMFLOAT3 GetRight();
 	DirectX::XMFLOAT3 GetUp();
 	DirectX::XMFLOAT3 GetForward();
@@ -45,6 +60,17 @@ public:
 	DirectX::XMFLOAT4X4 GetWorldMatrix();
 	DirectX::XMFLOAT4X4 GetWorldInverseTransposeMatrix();
 
+	// Both matrices blended between the last saved simulation state
+	// (alpha 0) and the current one (alpha 1)
+	void GetInterpolatedMatrices(float alpha, DirectX::XMFLOAT4X4& world, DirectX::XMFLOAT4X4& worldInverseTranspose);
+
+	// Changes whenever the world matrix does, so anything derived
+	// from it can be cached until the version moves on
+	unsigned int GetVersion();
+
+	// Where this transform lives in its system (see TransformSystem::TakeMovedSlots)
+	unsigned int GetSlot();
+
 	// Transformers - Adjust existing transform values
 	void MoveAbsolute(float x, float y, float z);
 	void MoveAbsolute(DirectX::XMFLOAT3 offset);
@@ -55,6 +81,13 @@ public:
 	void Rotate(float pitch, float yaw, float roll);
 	void Rotate(DirectX::XMFLOAT3 rotation);
 
+	// Quaternion rotation, applied after the current one (in the parent's space)
+	void RotateQuaternion(DirectX::XMFLOAT4 quaternion);
+	void RotateAxisAngle(DirectX::XMFLOAT3 axis, float angle);
+
+	// Turns a fraction t of the way toward another orientation along the shortest arc
+	void SlerpRotation(DirectX::XMFLOAT4 target, float t);
+
 	void Scale(float x, float y, float z);
 	void Scale(float scale);
 
@@ -0,0 +1,904 @@
+#include "TransformSystem.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <thread>
+
+using namespace DirectX;
+
+// Anonymous namespace to hold helpers
+// only accessible in this file
+namespace
+{
+	// --------------------------------------------------------
+	// Euler angles of a unit quaternion, matching the order of
+	// XMQuaternionRotationRollPitchYaw (roll, then pitch, then yaw).
+	// Read from the elements of the rotation matrix it makes.
+	// --------------------------------------------------------
+	XMFLOAT3 QuaternionToPitchYawRoll(XMFLOAT4 q)
+	{
+		float m01 = 2.0f * (q.x * q.y + q.z * q.w);
+		float m11 = 1.0f - 2.0f * (q.x * q.x + q.z * q.z);
+		float m20 = 2.0f * (q.x * q.z + q.y * q.w);
+		float m21 = 2.0f * (q.y * q.z - q.x * q.w);
+		float m22 = 1.0f - 2.0f * (q.x * q.x + q.y * q.y);
+
+		float sinPitch = -m21;
+		if (sinPitch > 0.9999f || sinPitch < -0.9999f)
+		{
+			// Looking straight up or down: yaw and roll turn about the
+			// same axis, so put it all in yaw
+			float m00 = 1.0f - 2.0f * (q.y * q.y + q.z * q.z);
+			float m02 = 2.0f * (q.x * q.z - q.y * q.w);
+			return XMFLOAT3(sinPitch > 0.0f ? XM_PIDIV2 : -XM_PIDIV2, atan2f(-m02, m00), 0.0f);
+		}
+
+		return XMFLOAT3(asinf(sinPitch), atan2f(m20, m22), atan2f(m01, m11));
+	}
+}
+
+TransformSystem::TransformSystem() :
+	dirtyCount(0),
+	slotCount(0),
+	childSlotCount(0),
+	hierarchyChanged(false),
+	propagationNeeded(false)
+{
+}
+
+// The system used by Transform's default constructor
+TransformSystem& TransformSystem::Default()
+{
+	static TransformSystem system;
+	return system;
+}
+
+// --------------------------------------------------------
+// The world matrix is [S*R, 0; t, 1], so its inverse is
+// [R^T * S^-1, 0; -t * R^T * S^-1, 1].  Transposed, the upper
+// 3x3 is S^-1 * R (row i of R over scale i) and the last column
+// is minus each of those rows dotted with the translation.
+// --------------------------------------------------------
+XMMATRIX TransformSystem::InverseTranspose(FXMMATRIX rotation, XMFLOAT3 scale, XMFLOAT3 position)
+{
+	XMMATRIX normal = rotation;
+	if (scale.x == scale.y && scale.y == scale.z)
+	{
+		if (scale.x != 1.0f)
+		{
+			float inverse = 1.0f / scale.x;
+			normal.r[0] = XMVectorScale(normal.r[0], inverse);
+			normal.r[1] = XMVectorScale(normal.r[1], inverse);
+			normal.r[2] = XMVectorScale(normal.r[2], inverse);
+		}
+	}
+	else
+	{
+		normal.r[0] = XMVectorScale(normal.r[0], 1.0f / scale.x);
+		normal.r[1] = XMVectorScale(normal.r[1], 1.0f / scale.y);
+		normal.r[2] = XMVectorScale(normal.r[2], 1.0f / scale.z);
+	}
+
+	XMVECTOR t = XMLoadFloat3(&position);
+	normal.r[0] = XMVectorSetW(normal.r[0], -XMVectorGetX(XMVector3Dot(normal.r[0], t)));
+	normal.r[1] = XMVectorSetW(normal.r[1], -XMVectorGetX(XMVector3Dot(normal.r[1], t)));
+	normal.r[2] = XMVectorSetW(normal.r[2], -XMVectorGetX(XMVector3Dot(normal.r[2], t)));
+	normal.r[3] = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+	return normal;
+}
+
+// --------------------------------------------------------
+// Hands out a slot, reusing destroyed ones first.  The slot
+// starts dirty so its first read (or the next batch) builds
+// its matrices.
+// --------------------------------------------------------
+unsigned int TransformSystem::Create()
+{
+	unsigned int slot;
+	if (!freeSlots.empty())
+	{
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		slot = slotCount++;
+
+		// Components are padded to whole groups of four so the batch
+		// update can always load a full SIMD register
+		size_t padded = (slotCount + 3) & ~3u;
+		if (positionX.size() < padded)
+		{
+			positionX.resize(padded, 0.0f); positionY.resize(padded, 0.0f); positionZ.resize(padded, 0.0f);
+			rotationX.resize(padded, 0.0f); rotationY.resize(padded, 0.0f); rotationZ.resize(padded, 0.0f); rotationW.resize(padded, 1.0f);
+			scaleX.resize(padded, 1.0f); scaleY.resize(padded, 1.0f); scaleZ.resize(padded, 1.0f);
+
+			previousPositionX.resize(padded, 0.0f); previousPositionY.resize(padded, 0.0f); previousPositionZ.resize(padded, 0.0f);
+			previousRotationX.resize(padded, 0.0f); previousRotationY.resize(padded, 0.0f); previousRotationZ.resize(padded, 0.0f); previousRotationW.resize(padded, 1.0f);
+			previousScaleX.resize(padded, 1.0f); previousScaleY.resize(padded, 1.0f); previousScaleZ.resize(padded, 1.0f);
+		}
+
+		pitchYawRolls.emplace_back();
+		worldMatrices.emplace_back();
+		worldInverseTransposeMatrices.emplace_back();
+		versions.push_back(0);
+		rights.emplace_back();
+		ups.emplace_back();
+		forwards.emplace_back();
+		if (dirtyBits.size() * 64 < slotCount)
+		{
+			dirtyBits.push_back(0);
+			movedBits.push_back(0);
+		}
+
+		parents.push_back(NoParent);
+		childCounts.push_back(0);
+		parentVersions.push_back(0);
+		if (!localMatrices.empty())
+		{
+			localMatrices.emplace_back();
+			localInverseTransposeMatrices.emplace_back();
+		}
+	}
+
+	positionX[slot] = 0.0f; positionY[slot] = 0.0f; positionZ[slot] = 0.0f;
+	rotationX[slot] = 0.0f; rotationY[slot] = 0.0f; rotationZ[slot] = 0.0f; rotationW[slot] = 1.0f;
+	pitchYawRolls[slot] = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	scaleX[slot] = 1.0f; scaleY[slot] = 1.0f; scaleZ[slot] = 1.0f;
+
+	// A reused slot mustn't blend from whatever was there before
+	previousPositionX[slot] = 0.0f; previousPositionY[slot] = 0.0f; previousPositionZ[slot] = 0.0f;
+	previousRotationX[slot] = 0.0f; previousRotationY[slot] = 0.0f; previousRotationZ[slot] = 0.0f; previousRotationW[slot] = 1.0f;
+	previousScaleX[slot] = 1.0f; previousScaleY[slot] = 1.0f; previousScaleZ[slot] = 1.0f;
+	MarkDirty(slot);
+
+	return slot;
+}
+
+// --------------------------------------------------------
+// Grows every per-slot array's capacity up front.  Reused
+// slots need no room, so only new ones are counted.  Local
+// matrices are left alone until there's a hierarchy.
+// --------------------------------------------------------
+void TransformSystem::Reserve(unsigned int count)
+{
+	size_t freeCount = freeSlots.size();
+	if (count <= freeCount)
+		return;
+
+	size_t total = slotCount + (count - freeCount);
+	size_t padded = (total + 3) & ~(size_t)3;
+
+	positionX.reserve(padded); positionY.reserve(padded); positionZ.reserve(padded);
+	rotationX.reserve(padded); rotationY.reserve(padded); rotationZ.reserve(padded); rotationW.reserve(padded);
+	scaleX.reserve(padded); scaleY.reserve(padded); scaleZ.reserve(padded);
+
+	previousPositionX.reserve(padded); previousPositionY.reserve(padded); previousPositionZ.reserve(padded);
+	previousRotationX.reserve(padded); previousRotationY.reserve(padded); previousRotationZ.reserve(padded); previousRotationW.reserve(padded);
+	previousScaleX.reserve(padded); previousScaleY.reserve(padded); previousScaleZ.reserve(padded);
+
+	pitchYawRolls.reserve(total);
+	worldMatrices.reserve(total);
+	worldInverseTransposeMatrices.reserve(total);
+	versions.reserve(total);
+	rights.reserve(total);
+	ups.reserve(total);
+	forwards.reserve(total);
+	dirtyBits.reserve((total + 63) / 64);
+	movedBits.reserve((total + 63) / 64);
+
+	parents.reserve(total);
+	childCounts.reserve(total);
+	parentVersions.reserve(total);
+	if (!localMatrices.empty())
+	{
+		localMatrices.reserve(total);
+		localInverseTransposeMatrices.reserve(total);
+	}
+}
+
+// Returns a slot for reuse; it's skipped by batches until then
+void TransformSystem::Destroy(unsigned int slot)
+{
+	// Unlink from both ends of the hierarchy first
+	if (childCounts[slot] > 0)
+	{
+		for (unsigned int child = 0; child < slotCount; child++)
+		{
+			if (parents[child] == slot)
+				SetParent(child, NoParent);
+		}
+	}
+	SetParent(slot, NoParent);
+
+	unsigned long long bit = 1ull << (slot % 64);
+	if (dirtyBits[slot / 64] & bit)
+	{
+		dirtyBits[slot / 64] &= ~bit;
+		dirtyCount--;
+	}
+	movedBits[slot / 64] &= ~bit;
+	freeSlots.push_back(slot);
+}
+
+// --------------------------------------------------------
+// Links a slot under a parent (or back to the top with NoParent).
+// The components are kept as they are, and are now relative to
+// the new parent.
+// --------------------------------------------------------
+bool TransformSystem::SetParent(unsigned int slot, unsigned int parent)
+{
+	if (parents[slot] == parent)
+		return true;
+
+	// Refuse links that would make a loop
+	for (unsigned int ancestor = parent; ancestor != NoParent; ancestor = parents[ancestor])
+	{
+		if (ancestor == slot)
+			return false;
+	}
+
+	// Local matrices only exist once there's a hierarchy
+	if (localMatrices.size() < slotCount)
+	{
+		localMatrices.resize(slotCount);
+		localInverseTransposeMatrices.resize(slotCount);
+	}
+
+	if (parents[slot] != NoParent)
+	{
+		childCounts[parents[slot]]--;
+		childSlotCount--;
+	}
+	if (parent != NoParent)
+	{
+		childCounts[parent]++;
+		childSlotCount++;
+	}
+	parents[slot] = parent;
+	hierarchyChanged = true;
+
+	// The matrices move between local and world storage, so rebuild them
+	MarkDirty(slot);
+	return true;
+}
+
+unsigned int TransformSystem::GetParent(unsigned int slot) { return parents[slot]; }
+
+// Component access
+
+XMFLOAT3 TransformSystem::GetPosition(unsigned int slot) { return XMFLOAT3(positionX[slot], positionY[slot], positionZ[slot]); }
+XMFLOAT4 TransformSystem::GetRotation(unsigned int slot) { return XMFLOAT4(rotationX[slot], rotationY[slot], rotationZ[slot], rotationW[slot]); }
+XMFLOAT3 TransformSystem::GetPitchYawRoll(unsigned int slot) { return pitchYawRolls[slot]; }
+XMFLOAT3 TransformSystem::GetScale(unsigned int slot) { return XMFLOAT3(scaleX[slot], scaleY[slot], scaleZ[slot]); }
+
+void TransformSystem::SetPosition(unsigned int slot, XMFLOAT3 position)
+{
+	positionX[slot] = position.x;
+	positionY[slot] = position.y;
+	positionZ[slot] = position.z;
+	MarkDirty(slot);
+}
+
+// Normalizes the quaternion and works out matching Euler angles
+void TransformSystem::SetRotation(unsigned int slot, XMFLOAT4 quaternion)
+{
+	XMStoreFloat4(&quaternion, XMQuaternionNormalize(XMLoadFloat4(&quaternion)));
+	rotationX[slot] = quaternion.x;
+	rotationY[slot] = quaternion.y;
+	rotationZ[slot] = quaternion.z;
+	rotationW[slot] = quaternion.w;
+	pitchYawRolls[slot] = QuaternionToPitchYawRoll(quaternion);
+	MarkDirty(slot);
+}
+
+// Keeps the angles exactly as given and converts them once
+void TransformSystem::SetPitchYawRoll(unsigned int slot, XMFLOAT3 rotation)
+{
+	XMFLOAT4 quaternion;
+	XMStoreFloat4(&quaternion, XMQuaternionRotationRollPitchYaw(rotation.x, rotation.y, rotation.z));
+	rotationX[slot] = quaternion.x;
+	rotationY[slot] = quaternion.y;
+	rotationZ[slot] = quaternion.z;
+	rotationW[slot] = quaternion.w;
+	pitchYawRolls[slot] = rotation;
+	MarkDirty(slot);
+}
+
+void TransformSystem::SetScale(unsigned int slot, XMFLOAT3 scale)
+{
+	scaleX[slot] = scale.x;
+	scaleY[slot] = scale.y;
+	scaleZ[slot] = scale.z;
+	MarkDirty(slot);
+}
+
+// Matrices
+
+XMFLOAT4X4 TransformSystem::GetWorldMatrix(unsigned int slot)
+{
+	Clean(slot);
+	return worldMatrices[slot];
+}
+
+XMFLOAT4X4 TransformSystem::GetWorldInverseTransposeMatrix(unsigned int slot)
+{
+	Clean(slot);
+	return worldInverseTransposeMatrices[slot];
+}
+
+unsigned int TransformSystem::GetVersion(unsigned int slot)
+{
+	Clean(slot);
+	return versions[slot];
+}
+
+// Axes
+
+XMFLOAT3 TransformSystem::GetRight(unsigned int slot)
+{
+	Clean(slot);
+	return rights[slot];
+}
+
+XMFLOAT3 TransformSystem::GetUp(unsigned int slot)
+{
+	Clean(slot);
+	return ups[slot];
+}
+
+XMFLOAT3 TransformSystem::GetForward(unsigned int slot)
+{
+	Clean(slot);
+	return forwards[slot];
+}
+
+// Interpolation
+
+// Straight array copies, so this costs the same however many slots moved
+void TransformSystem::SaveState()
+{
+	previousPositionX = positionX; previousPositionY = positionY; previousPositionZ = positionZ;
+	previousRotationX = rotationX; previousRotationY = rotationY; previousRotationZ = rotationZ; previousRotationW = rotationW;
+	previousScaleX = scaleX; previousScaleY = scaleY; previousScaleZ = scaleZ;
+}
+
+// --------------------------------------------------------
+// Blends each link of the chain from the top down: positions
+// and scales linearly, orientations along the shortest arc.
+// If nothing in the chain moved since SaveState() (or alpha is
+// 1), the cached matrices are already the answer.
+// --------------------------------------------------------
+void TransformSystem::GetInterpolatedMatrices(unsigned int slot, float alpha, XMFLOAT4X4& world, XMFLOAT4X4& worldInverseTranspose)
+{
+	bool moved = false;
+	interpolationChain.clear();
+	for (unsigned int ancestor = slot; ancestor != NoParent; ancestor = parents[ancestor])
+	{
+		interpolationChain.push_back(ancestor);
+		moved = moved || HasMoved(ancestor);
+	}
+
+	if (!moved || alpha >= 1.0f)
+	{
+		world = GetWorldMatrix(slot);
+		worldInverseTranspose = GetWorldInverseTransposeMatrix(slot);
+		return;
+	}
+
+	XMMATRIX blendedWorld = XMMatrixIdentity();
+	XMMATRIX blendedNormal = XMMatrixIdentity();
+	for (size_t i = interpolationChain.size(); i-- > 0;)
+	{
+		unsigned int current = interpolationChain[i];
+
+		XMVECTOR position = XMVectorLerp(
+			XMVectorSet(previousPositionX[current], previousPositionY[current], previousPositionZ[current], 0.0f),
+			XMVectorSet(positionX[current], positionY[current], positionZ[current], 0.0f), alpha);
+		XMVECTOR scale = XMVectorLerp(
+			XMVectorSet(previousScaleX[current], previousScaleY[current], previousScaleZ[current], 0.0f),
+			XMVectorSet(scaleX[current], scaleY[current], scaleZ[current], 0.0f), alpha);
+		XMVECTOR rotation = XMQuaternionSlerp(
+			XMVectorSet(previousRotationX[current], previousRotationY[current], previousRotationZ[current], previousRotationW[current]),
+			XMVectorSet(rotationX[current], rotationY[current], rotationZ[current], rotationW[current]), alpha);
+
+		XMFLOAT3 p, s;
+		XMStoreFloat3(&p, position);
+		XMStoreFloat3(&s, scale);
+		XMMATRIX r = XMMatrixRotationQuaternion(rotation);
+		XMMATRIX local = XMMatrixMultiply(XMMatrixMultiply(XMMatrixScaling(s.x, s.y, s.z), r), XMMatrixTranslation(p.x, p.y, p.z));
+
+		blendedWorld = XMMatrixMultiply(local, blendedWorld);
+		blendedNormal = XMMatrixMultiply(InverseTranspose(r, s, p), blendedNormal);
+	}
+
+	XMStoreFloat4x4(&world, blendedWorld);
+	XMStoreFloat4x4(&worldInverseTranspose, blendedNormal);
+}
+
+// Dirty tracking
+
+void TransformSystem::MarkDirty(unsigned int slot)
+{
+	unsigned long long bit = 1ull << (slot % 64);
+	if (!(dirtyBits[slot / 64] & bit))
+	{
+		dirtyBits[slot / 64] |= bit;
+		dirtyCount++;
+	}
+}
+
+bool TransformSystem::IsDirty(unsigned int slot)
+{
+	return (dirtyBits[slot / 64] >> (slot % 64)) & 1;
+}
+
+// --------------------------------------------------------
+// Rebuilds every dirty slot, in two steps:
+//  - Local matrices from the components.  The bitset is split
+//    into even ranges of words, one per thread, so threads never
+//    touch the same slot, and clean words are skipped 64 slots
+//    at a time.  Slots at the top are finished here.
+//  - World matrices of children, one depth level at a time so
+//    parents are always done first.  A child is only rebuilt if
+//    it was dirty or its parent's version moved on.
+// --------------------------------------------------------
+unsigned int TransformSystem::UpdateMatrices(unsigned int threadCount)
+{
+	if (dirtyCount == 0 && !(propagationNeeded && childSlotCount > 0))
+		return 0;
+
+	unsigned int cores = std::thread::hardware_concurrency();
+	if (cores == 0)
+		cores = 1;
+	unsigned int maxThreads = threadCount > 0 ? threadCount : cores;
+
+	unsigned int updated = 0;
+	if (dirtyCount > 0)
+	{
+		unsigned int bySize = dirtyCount / MinTransformsPerThread + 1;
+		unsigned int wordThreads = threadCount > 0 ? threadCount : (bySize < cores ? bySize : cores);
+
+		size_t wordCount = dirtyBits.size();
+		if (wordThreads > wordCount)
+			wordThreads = (unsigned int)wordCount;
+
+		std::vector<unsigned int> counts(wordThreads);
+		RunParallel(wordThreads, [&](size_t thread)
+		{
+			counts[thread] = UpdateWords(wordCount * thread / wordThreads, wordCount * (thread + 1) / wordThreads);
+		});
+		for (unsigned int count : counts)
+			updated += count;
+	}
+
+	if (childSlotCount > 0)
+	{
+		if (hierarchyChanged)
+			BuildHierarchyOrder();
+
+		for (size_t level = 0; level + 1 < levelStarts.size(); level++)
+		{
+			size_t first = levelStarts[level];
+			size_t count = levelStarts[level + 1] - first;
+			unsigned int levelThreads = (unsigned int)(count / MinTransformsPerThread + 1);
+			if (levelThreads > maxThreads)
+				levelThreads = maxThreads;
+
+			std::vector<unsigned int> counts(levelThreads);
+			if (movedChildren.size() < levelThreads)
+				movedChildren.resize(levelThreads);
+			RunParallel(levelThreads, [&](size_t thread)
+			{
+				movedChildren[thread].clear();
+				counts[thread] = UpdateChildren(first + count * thread / levelThreads, first + count * (thread + 1) / levelThreads, movedChildren[thread]);
+			});
+			for (unsigned int levelCount : counts)
+				updated += levelCount;
+
+			// Siblings on different threads can share a word, so their
+			// moved bits are set here rather than by the threads
+			for (unsigned int thread = 0; thread < levelThreads; thread++)
+			{
+				for (unsigned int slot : movedChildren[thread])
+					movedBits[slot / 64] |= 1ull << (slot % 64);
+			}
+		}
+
+		// Children's bits were left for the second step to read
+		std::fill(dirtyBits.begin(), dirtyBits.end(), 0ull);
+	}
+
+	dirtyCount = 0;
+	propagationNeeded = false;
+	return updated;
+}
+
+// --------------------------------------------------------
+// Hands out the moved slots 64 at a time, skipping words
+// where nothing moved
+// --------------------------------------------------------
+void TransformSystem::TakeMovedSlots(std::vector<unsigned int>& slots)
+{
+	slots.clear();
+	for (size_t word = 0; word < movedBits.size(); word++)
+	{
+		unsigned long long bits = movedBits[word];
+		while (bits != 0)
+		{
+			slots.push_back((unsigned int)word * 64 + std::countr_zero(bits));
+			bits &= bits - 1;
+		}
+		movedBits[word] = 0;
+	}
+}
+
+// Getters
+
+unsigned int TransformSystem::GetCount() { return slotCount - (unsigned int)freeSlots.size(); }
+unsigned int TransformSystem::GetDirtyCount() { return dirtyCount; }
+unsigned int TransformSystem::GetChildCount() { return childSlotCount; }
+
+unsigned int TransformSystem::GetDepthCount()
+{
+	if (childSlotCount == 0)
+		return 1;
+	if (hierarchyChanged)
+		BuildHierarchyOrder();
+	return (unsigned int)levelStarts.size();
+}
+
+// Helpers
+
+// --------------------------------------------------------
+// Rebuilds the dirty slots of a range of bitset words, one
+// group of four at a time.  Returns how many world matrices
+// were finished (slots with a parent still need the second
+// step, so their bits are kept for it).
+// --------------------------------------------------------
+unsigned int TransformSystem::UpdateWords(size_t firstWord, size_t endWord)
+{
+	unsigned int updated = 0;
+	for (size_t word = firstWord; word < endWord; word++)
+	{
+		unsigned long long bits = dirtyBits[word];
+		if (bits == 0)
+			continue;
+
+		for (unsigned int group = 0; group < 16; group++)
+		{
+			unsigned int laneMask = (unsigned int)(bits >> (group * 4)) & 0xF;
+			if (laneMask != 0)
+				updated += UpdateGroup((unsigned int)word * 64 + group * 4, laneMask);
+		}
+
+		if (childSlotCount == 0)
+			dirtyBits[word] = 0;
+	}
+	return updated;
+}
+
+// --------------------------------------------------------
+// Builds matrices for four consecutive slots at once, each
+// lane of a register holding one transform.  Only the lanes
+// in laneMask are written back: as the world matrix for slots
+// at the top, or the local matrix for slots with a parent.
+//
+// The rotation comes straight from the quaternion (the same
+// expansion as XMMatrixRotationQuaternion), each row is scaled,
+// and the position becomes the last row.  The unscaled rows are
+// the axes of slots at the top.  The inverse-transpose is built
+// the same way as InverseTranspose(), four lanes at a time.
+// --------------------------------------------------------
+unsigned int TransformSystem::UpdateGroup(unsigned int firstSlot, unsigned int laneMask)
+{
+	XMVECTOR qx = XMLoadFloat4((const XMFLOAT4*)&rotationX[firstSlot]);
+	XMVECTOR qy = XMLoadFloat4((const XMFLOAT4*)&rotationY[firstSlot]);
+	XMVECTOR qz = XMLoadFloat4((const XMFLOAT4*)&rotationZ[firstSlot]);
+	XMVECTOR qw = XMLoadFloat4((const XMFLOAT4*)&rotationW[firstSlot]);
+
+	XMVECTOR sx = XMLoadFloat4((const XMFLOAT4*)&scaleX[firstSlot]);
+	XMVECTOR sy = XMLoadFloat4((const XMFLOAT4*)&scaleY[firstSlot]);
+	XMVECTOR sz = XMLoadFloat4((const XMFLOAT4*)&scaleZ[firstSlot]);
+
+	XMVECTOR one = XMVectorSplatOne();
+	XMVECTOR x2 = qx + qx, y2 = qy + qy, z2 = qz + qz;
+	XMVECTOR xx = qx * x2, yy = qy * y2, zz = qz * z2;
+	XMVECTOR xy = qx * y2, xz = qx * z2, yz = qy * z2;
+	XMVECTOR wx = qw * x2, wy = qw * y2, wz = qw * z2;
+
+	// Upper 3x3 of the rotation, one element per register
+	XMFLOAT4A r[9];
+	XMStoreFloat4A(&r[0], one - (yy + zz));
+	XMStoreFloat4A(&r[1], xy + wz);
+	XMStoreFloat4A(&r[2], xz - wy);
+	XMStoreFloat4A(&r[3], xy - wz);
+	XMStoreFloat4A(&r[4], one - (xx + zz));
+	XMStoreFloat4A(&r[5], yz + wx);
+	XMStoreFloat4A(&r[6], xz + wy);
+	XMStoreFloat4A(&r[7], yz - wx);
+	XMStoreFloat4A(&r[8], one - (xx + yy));
+
+	// The same rows scaled
+	XMFLOAT4A m[9];
+	for (int i = 0; i < 9; i++)
+		XMStoreFloat4A(&m[i], XMLoadFloat4A(&r[i]) * (i < 3 ? sx : (i < 6 ? sy : sz)));
+
+	// Rows over their scale for the inverse-transpose, skipping the
+	// reciprocals when every lane is unscaled and sharing one when
+	// every lane's scale is uniform
+	bool uniform = true;
+	bool unscaled = true;
+	for (unsigned int lane = 0; lane < 4; lane++)
+	{
+		float x = scaleX[firstSlot + lane];
+		uniform = uniform && x == scaleY[firstSlot + lane] && x == scaleZ[firstSlot + lane];
+		unscaled = unscaled && x == 1.0f;
+	}
+
+	XMVECTOR inverseX = one, inverseY = one, inverseZ = one;
+	if (!(uniform && unscaled))
+	{
+		inverseX = XMVectorReciprocal(sx);
+		inverseY = uniform ? inverseX : XMVectorReciprocal(sy);
+		inverseZ = uniform ? inverseX : XMVectorReciprocal(sz);
+	}
+
+	XMVECTOR px = XMLoadFloat4((const XMFLOAT4*)&positionX[firstSlot]);
+	XMVECTOR py = XMLoadFloat4((const XMFLOAT4*)&positionY[firstSlot]);
+	XMVECTOR pz = XMLoadFloat4((const XMFLOAT4*)&positionZ[firstSlot]);
+
+	XMFLOAT4A n[12];
+	for (int row = 0; row < 3; row++)
+	{
+		XMVECTOR inverse = row == 0 ? inverseX : (row == 1 ? inverseY : inverseZ);
+		XMVECTOR a = XMLoadFloat4A(&r[row * 3]) * inverse;
+		XMVECTOR b = XMLoadFloat4A(&r[row * 3 + 1]) * inverse;
+		XMVECTOR c = XMLoadFloat4A(&r[row * 3 + 2]) * inverse;
+		XMStoreFloat4A(&n[row * 4], a);
+		XMStoreFloat4A(&n[row * 4 + 1], b);
+		XMStoreFloat4A(&n[row * 4 + 2], c);
+		XMStoreFloat4A(&n[row * 4 + 3], -(a * px + b * py + c * pz));
+	}
+
+	unsigned int finished = 0;
+	for (unsigned int lane = 0; lane < 4; lane++)
+	{
+		if (!(laneMask & (1u << lane)))
+			continue;
+
+		unsigned int slot = firstSlot + lane;
+		bool topLevel = parents[slot] == NoParent;
+
+		const float* e[9] = { &m[0].x, &m[1].x, &m[2].x, &m[3].x, &m[4].x, &m[5].x, &m[6].x, &m[7].x, &m[8].x };
+		XMFLOAT4X4& matrix = topLevel ? worldMatrices[slot] : localMatrices[slot];
+		matrix = XMFLOAT4X4(
+			e[0][lane], e[1][lane], e[2][lane], 0.0f,
+			e[3][lane], e[4][lane], e[5][lane], 0.0f,
+			e[6][lane], e[7][lane], e[8][lane], 0.0f,
+			positionX[slot], positionY[slot], positionZ[slot], 1.0f);
+
+		const float* ne[12] = { &n[0].x, &n[1].x, &n[2].x, &n[3].x, &n[4].x, &n[5].x, &n[6].x, &n[7].x, &n[8].x, &n[9].x, &n[10].x, &n[11].x };
+		XMFLOAT4X4& normal = topLevel ? worldInverseTransposeMatrices[slot] : localInverseTransposeMatrices[slot];
+		normal = XMFLOAT4X4(
+			ne[0][lane], ne[1][lane], ne[2][lane], ne[3][lane],
+			ne[4][lane], ne[5][lane], ne[6][lane], ne[7][lane],
+			ne[8][lane], ne[9][lane], ne[10][lane], ne[11][lane],
+			0.0f, 0.0f, 0.0f, 1.0f);
+
+		if (topLevel)
+		{
+			const float* a[9] = { &r[0].x, &r[1].x, &r[2].x, &r[3].x, &r[4].x, &r[5].x, &r[6].x, &r[7].x, &r[8].x };
+			rights[slot] = XMFLOAT3(a[0][lane], a[1][lane], a[2][lane]);
+			ups[slot] = XMFLOAT3(a[3][lane], a[4][lane], a[5][lane]);
+			forwards[slot] = XMFLOAT3(a[6][lane], a[7][lane], a[8][lane]);
+			versions[slot]++;
+			movedBits[slot / 64] |= 1ull << (slot % 64);
+			finished++;
+		}
+	}
+	return finished;
+}
+
+// --------------------------------------------------------
+// Combines local and parent matrices for a range of one depth
+// level.  Siblings sit next to each other, so the parent's
+// matrices are only loaded once per run of siblings.  The
+// inverse-transpose of a product is the product of the inverse-
+// transposes in the same order, so no inverse is needed here.
+// --------------------------------------------------------
+unsigned int TransformSystem::UpdateChildren(size_t first, size_t end, std::vector<unsigned int>& moved)
+{
+	unsigned int updated = 0;
+	unsigned int loadedParent = NoParent;
+	XMMATRIX parentWorld = XMMatrixIdentity();
+	XMMATRIX parentInverseTranspose = XMMatrixIdentity();
+
+	for (size_t i = first; i < end; i++)
+	{
+		unsigned int slot = hierarchyOrder[i];
+		unsigned int parent = parents[slot];
+		bool dirty = (dirtyBits[slot / 64] >> (slot % 64)) & 1;
+		if (!dirty && parentVersions[slot] == versions[parent])
+			continue;
+
+		if (parent != loadedParent)
+		{
+			parentWorld = XMLoadFloat4x4(&worldMatrices[parent]);
+			parentInverseTranspose = XMLoadFloat4x4(&worldInverseTransposeMatrices[parent]);
+			loadedParent = parent;
+		}
+
+		XMMATRIX world = XMMatrixMultiply(XMLoadFloat4x4(&localMatrices[slot]), parentWorld);
+		XMStoreFloat4x4(&worldMatrices[slot], world);
+		XMStoreFloat4x4(&worldInverseTransposeMatrices[slot],
+			XMMatrixMultiply(XMLoadFloat4x4(&localInverseTransposeMatrices[slot]), parentInverseTranspose));
+		StoreChildAxes(slot, world);
+		parentVersions[slot] = versions[parent];
+		versions[slot]++;
+		moved.push_back(slot);
+		updated++;
+	}
+	return updated;
+}
+
+// --------------------------------------------------------
+// A child's axes are its world matrix rows with the scale
+// (its own and everything above it) normalized away
+// --------------------------------------------------------
+void TransformSystem::StoreChildAxes(unsigned int slot, FXMMATRIX world)
+{
+	XMStoreFloat3(&rights[slot], XMVector3Normalize(world.r[0]));
+	XMStoreFloat3(&ups[slot], XMVector3Normalize(world.r[1]));
+	XMStoreFloat3(&forwards[slot], XMVector3Normalize(world.r[2]));
+}
+
+// --------------------------------------------------------
+// Lays out every slot with a parent breadth first: all the
+// children of top-level slots, then all of their children, and
+// so on.  Each parent's children end up next to each other.
+// --------------------------------------------------------
+void TransformSystem::BuildHierarchyOrder()
+{
+	hierarchyOrder.clear();
+	levelStarts.clear();
+	levelStarts.push_back(0);
+	hierarchyChanged = false;
+
+	// Children of each slot, grouped by parent
+	std::vector<unsigned int> childStarts(slotCount + 1, 0);
+	for (unsigned int slot = 0; slot < slotCount; slot++)
+	{
+		if (parents[slot] != NoParent)
+			childStarts[parents[slot] + 1]++;
+	}
+	for (unsigned int slot = 0; slot < slotCount; slot++)
+		childStarts[slot + 1] += childStarts[slot];
+
+	std::vector<unsigned int> children(childSlotCount);
+	std::vector<unsigned int> cursors(childStarts.begin(), childStarts.end() - 1);
+	for (unsigned int slot = 0; slot < slotCount; slot++)
+	{
+		if (parents[slot] != NoParent)
+			children[cursors[parents[slot]]++] = slot;
+	}
+
+	// First level under the top, then each level's children in turn
+	hierarchyOrder.reserve(childSlotCount);
+	for (unsigned int slot = 0; slot < slotCount; slot++)
+	{
+		if (parents[slot] == NoParent)
+			hierarchyOrder.insert(hierarchyOrder.end(), children.begin() + childStarts[slot], children.begin() + childStarts[slot + 1]);
+	}
+
+	size_t levelStart = 0;
+	while (levelStart < hierarchyOrder.size())
+	{
+		size_t levelEnd = hierarchyOrder.size();
+		levelStarts.push_back((unsigned int)levelEnd);
+
+		for (size_t i = levelStart; i < levelEnd; i++)
+		{
+			unsigned int slot = hierarchyOrder[i];
+			hierarchyOrder.insert(hierarchyOrder.end(), children.begin() + childStarts[slot], children.begin() + childStarts[slot + 1]);
+		}
+		levelStart = levelEnd;
+	}
+}
+
+// --------------------------------------------------------
+// Rebuilds one slot's matrices on the spot: the components if
+// they changed, then the parent's world matrix if it has one.
+// This is the per-object path Transform always used before.
+// --------------------------------------------------------
+void TransformSystem::RebuildSlot(unsigned int slot)
+{
+	unsigned int parent = parents[slot];
+	unsigned long long bit = 1ull << (slot % 64);
+	if (dirtyBits[slot / 64] & bit)
+	{
+		XMMATRIX t = XMMatrixTranslation(positionX[slot], positionY[slot], positionZ[slot]);
+		XMMATRIX r = XMMatrixRotationQuaternion(XMVectorSet(rotationX[slot], rotationY[slot], rotationZ[slot], rotationW[slot]));
+		XMMATRIX s = XMMatrixScaling(scaleX[slot], scaleY[slot], scaleZ[slot]);
+		XMMATRIX matrix = XMMatrixMultiply(XMMatrixMultiply(s, r), t);
+
+		bool topLevel = parent == NoParent;
+		XMStoreFloat4x4(topLevel ? &worldMatrices[slot] : &localMatrices[slot], matrix);
+		XMStoreFloat4x4(topLevel ? &worldInverseTransposeMatrices[slot] : &localInverseTransposeMatrices[slot],
+			InverseTranspose(r, GetScale(slot), GetPosition(slot)));
+
+		if (topLevel)
+		{
+			XMStoreFloat3(&rights[slot], r.r[0]);
+			XMStoreFloat3(&ups[slot], r.r[1]);
+			XMStoreFloat3(&forwards[slot], r.r[2]);
+		}
+
+		dirtyBits[slot / 64] &= ~bit;
+		dirtyCount--;
+	}
+
+	if (parent != NoParent)
+	{
+		XMMATRIX world = XMMatrixMultiply(
+			XMLoadFloat4x4(&localMatrices[slot]),
+			XMLoadFloat4x4(&worldMatrices[parent]));
+		XMStoreFloat4x4(&worldMatrices[slot], world);
+		XMStoreFloat4x4(&worldInverseTransposeMatrices[slot], XMMatrixMultiply(
+			XMLoadFloat4x4(&localInverseTransposeMatrices[slot]),
+			XMLoadFloat4x4(&worldInverseTransposeMatrices[parent])));
+		StoreChildAxes(slot, world);
+		parentVersions[slot] = versions[parent];
+	}
+
+	versions[slot]++;
+	movedBits[slot / 64] |= 1ull << (slot % 64);
+
+	// Children still point at the old version; the next batch catches them up
+	if (childCounts[slot] > 0)
+		propagationNeeded = true;
+}
+
+// --------------------------------------------------------
+// Makes a slot's matrices current for a read between batches,
+// bringing its ancestors up to date first (top down)
+// --------------------------------------------------------
+void TransformSystem::Clean(unsigned int slot)
+{
+	if (parents[slot] == NoParent)
+	{
+		if (IsDirty(slot))
+			RebuildSlot(slot);
+		return;
+	}
+
+	cleanChain.clear();
+	for (unsigned int ancestor = slot; ancestor != NoParent; ancestor = parents[ancestor])
+		cleanChain.push_back(ancestor);
+
+	for (size_t i = cleanChain.size(); i-- > 0;)
+	{
+		unsigned int current = cleanChain[i];
+		unsigned int parent = parents[current];
+		if (IsDirty(current) || (parent != NoParent && parentVersions[current] != versions[parent]))
+			RebuildSlot(current);
+	}
+}
+
+// Whether any component differs from the saved state
+bool TransformSystem::HasMoved(unsigned int slot)
+{
+	return
+		positionX[slot] != previousPositionX[slot] ||
+		positionY[slot] != previousPositionY[slot] ||
+		positionZ[slot] != previousPositionZ[slot] ||
+		rotationX[slot] != previousRotationX[slot] ||
+		rotationY[slot] != previousRotationY[slot] ||
+		rotationZ[slot] != previousRotationZ[slot] ||
+		rotationW[slot] != previousRotationW[slot] ||
+		scaleX[slot] != previousScaleX[slot] ||
+		scaleY[slot] != previousScaleY[slot] ||
+		scaleZ[slot] != previousScaleZ[slot];
+}
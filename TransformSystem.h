@@ -0,0 +1,179 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Storage for transforms as structure-of-arrays: one array per
+// component float, plus the cached matrices and a dirty bitset.
+//
+// Changing a component only sets the slot's dirty bit.  Once a
+// frame, UpdateMatrices() rebuilds every dirty matrix in one
+// pass, four transforms per SIMD register (split across threads
+// for large counts).  Reading a matrix that is still dirty
+// rebuilds just that slot, so results are always current.
+//
+// Slots can have a parent, in which case their components are
+// relative to it.  Children are kept in a separate order sorted
+// by depth, with siblings next to each other, so world matrices
+// flow down the tree in one linear pass that only rebuilds the
+// children of parents that changed.
+//
+// Transform objects are thin handles to a slot in here
+// --------------------------------------------------------
+class TransformSystem
+{
+private:
+
+	// Components, padded to whole groups of four.  Orientation is a
+	// unit quaternion; the Euler angles are kept in step with it so
+	// editing them doesn't drift through repeated conversions.
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+	std::vector<float> scaleX, scaleY, scaleZ;
+	std::vector<DirectX::XMFLOAT3> pitchYawRolls;
+
+	// Components as of the last SaveState(), for drawing between
+	// two simulation steps
+	std::vector<float> previousPositionX, previousPositionY, previousPositionZ;
+	std::vector<float> previousRotationX, previousRotationY, previousRotationZ, previousRotationW;
+	std::vector<float> previousScaleX, previousScaleY, previousScaleZ;
+
+	// Cached results
+	std::vector<DirectX::XMFLOAT4X4> worldMatrices;
+	std::vector<DirectX::XMFLOAT4X4> worldInverseTransposeMatrices;
+	std::vector<unsigned int> versions;		// Bumped every time a slot's matrices are rebuilt
+
+	// World-space unit axes, rebuilt along with the world matrix
+	std::vector<DirectX::XMFLOAT3> rights;
+	std::vector<DirectX::XMFLOAT3> ups;
+	std::vector<DirectX::XMFLOAT3> forwards;
+
+	// One bit per slot, set when its components have changed
+	std::vector<unsigned long long> dirtyBits;
+	unsigned int dirtyCount;
+
+	// One bit per slot, set whenever its matrices are rebuilt (by a
+	// batch or a read) until TakeMovedSlots() hands it out, plus the
+	// children each thread rebuilt in the current level
+	std::vector<unsigned long long> movedBits;
+	std::vector<std::vector<unsigned int>> movedChildren;
+
+	unsigned int slotCount;
+	std::vector<unsigned int> freeSlots;
+
+	// Hierarchy links for every slot
+	std::vector<unsigned int> parents;
+	std::vector<unsigned int> childCounts;
+	std::vector<unsigned int> parentVersions;	// Parent's version when the world matrix was built
+	unsigned int childSlotCount;
+
+	// Matrices from the components alone, for slots with a parent
+	// (empty until the first parent is set)
+	std::vector<DirectX::XMFLOAT4X4> localMatrices;
+	std::vector<DirectX::XMFLOAT4X4> localInverseTransposeMatrices;
+
+	// Every slot with a parent, one depth level after another,
+	// and where each level starts (rebuilt when links change)
+	std::vector<unsigned int> hierarchyOrder;
+	std::vector<unsigned int> levelStarts;
+	bool hierarchyChanged;
+
+	// Set when a single-slot rebuild may have left children behind
+	bool propagationNeeded;
+
+	// Scratch lists of ancestors for Clean() and interpolation
+	std::vector<unsigned int> cleanChain;
+	std::vector<unsigned int> interpolationChain;
+
+	// Helpers
+	unsigned int UpdateGroup(unsigned int firstSlot, unsigned int laneMask);
+	unsigned int UpdateWords(size_t firstWord, size_t endWord);
+	unsigned int UpdateChildren(size_t first, size_t end, std::vector<unsigned int>& moved);
+	void BuildHierarchyOrder();
+	void RebuildSlot(unsigned int slot);
+	void StoreChildAxes(unsigned int slot, DirectX::FXMMATRIX world);
+	void Clean(unsigned int slot);
+	bool HasMoved(unsigned int slot);
+
+public:
+
+	// Transforms per thread below which splitting isn't worth it
+	static constexpr unsigned int MinTransformsPerThread = 16 * 1024;
+
+	// Parent of a slot at the top of the hierarchy
+	static constexpr unsigned int NoParent = 0xFFFFFFFF;
+
+	TransformSystem();
+
+	// Shared by every Transform that isn't given its own system
+	static TransformSystem& Default();
+
+	// Inverse-transpose of scale * rotation * translation, built from the
+	// pieces instead of a general inverse: each rotation row divided by its
+	// scale, plus the last column that undoes the translation.  Uniform
+	// scales take one reciprocal and unit scales none.
+	static DirectX::XMMATRIX InverseTranspose(DirectX::FXMMATRIX rotation, DirectX::XMFLOAT3 scale, DirectX::XMFLOAT3 position);
+
+	// Slot management (new slots are at the origin, unrotated and unscaled).
+	// Destroying a parent leaves its children at the top of the hierarchy.
+	unsigned int Create();
+	void Destroy(unsigned int slot);
+
+	// Makes room for this many more slots, so creating them in bulk
+	// never reallocates
+	void Reserve(unsigned int count);
+
+	// Hierarchy (fails if the parent is the slot or one of its descendants)
+	bool SetParent(unsigned int slot, unsigned int parent);
+	unsigned int GetParent(unsigned int slot);
+
+	// Component access
+	DirectX::XMFLOAT3 GetPosition(unsigned int slot);
+	DirectX::XMFLOAT4 GetRotation(unsigned int slot);
+	DirectX::XMFLOAT3 GetPitchYawRoll(unsigned int slot);
+	DirectX::XMFLOAT3 GetScale(unsigned int slot);
+
+	void SetPosition(unsigned int slot, DirectX::XMFLOAT3 position);
+	void SetRotation(unsigned int slot, DirectX::XMFLOAT4 quaternion);
+	void SetPitchYawRoll(unsigned int slot, DirectX::XMFLOAT3 rotation);
+	void SetScale(unsigned int slot, DirectX::XMFLOAT3 scale);
+
+	// Matrices (rebuilt on the spot if the slot is dirty)
+	DirectX::XMFLOAT4X4 GetWorldMatrix(unsigned int slot);
+	DirectX::XMFLOAT4X4 GetWorldInverseTransposeMatrix(unsigned int slot);
+	unsigned int GetVersion(unsigned int slot);
+
+	// World-space unit axes (rebuilt with the matrices)
+	DirectX::XMFLOAT3 GetRight(unsigned int slot);
+	DirectX::XMFLOAT3 GetUp(unsigned int slot);
+	DirectX::XMFLOAT3 GetForward(unsigned int slot);
+
+	// Interpolation between simulation steps.  SaveState() copies every
+	// slot's components aside before a step changes them; the matrices
+	// are then blended from the saved state (alpha 0) to the current one
+	// (alpha 1), through the whole parent chain.
+	void SaveState();
+	void GetInterpolatedMatrices(unsigned int slot, float alpha, DirectX::XMFLOAT4X4& world, DirectX::XMFLOAT4X4& worldInverseTranspose);
+
+	// Dirty tracking
+	void MarkDirty(unsigned int slot);
+	bool IsDirty(unsigned int slot);
+
+	// Rebuilds every dirty slot and every child of a changed parent in one
+	// batch, returning how many world matrices changed.  A thread count
+	// of zero picks one based on the amount of work.
+	unsigned int UpdateMatrices(unsigned int threadCount = 0);
+
+	// Fills "slots" with every slot whose matrices were rebuilt since the
+	// last call, in slot order, and forgets them.  Whatever caches data
+	// derived from world matrices can refresh just these, without asking
+	// every slot for its version.  Only one consumer should take them.
+	void TakeMovedSlots(std::vector<unsigned int>& slots);
+
+	// Getters
+	unsigned int GetCount();		// Live transforms
+	unsigned int GetDirtyCount();
+	unsigned int GetChildCount();	// Live transforms with a parent
+	unsigned int GetDepthCount();	// Levels in the hierarchy, including the top
+};
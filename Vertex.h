@@ -13,4 +13,20 @@ struct Vertex
 	DirectX::XMFLOAT2 UV;			// UV texture coordinates
 	DirectX::XMFLOAT3 Normal;		// Normal value of the vertex
 	DirectX::XMFLOAT3 Tangent;		// Tangent value to normal
+};
+
+// --------------------------------------------------------
+// The compressed vertex layout actually stored on the GPU
+//
+// 20 bytes instead of 44, decoded in ShaderIncludes.hlsli:
+//  - Position is 16 bits per axis, normalized to the mesh's bounds
+//  - UV is a pair of half floats
+//  - Normal and tangent are octahedral encoded as two 16-bit snorms
+// --------------------------------------------------------
+struct PackedVertex
+{
+	unsigned short Position[4];		// XYZ quantized within the bounds, W unused
+	unsigned int UV;				// U in the low 16 bits, V in the high 16 bits
+	unsigned int Normal;			// Octahedral X in the low 16 bits, Y in the high 16 bits
+	unsigned int Tangent;			// Same encoding as the normal
 };
\ No newline at end of file
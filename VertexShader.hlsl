@@ -10,6 +10,8 @@ cbuffer ExternalData : register(b0)
     matrix worldInvTranspose;
     matrix lightView;
     matrix lightProjection;
+    float3 positionScale;
+    float3 positionOffset;
 }
 
 // --------------------------------------------------------
@@ -32,18 +34,20 @@ VertexToPixel main( VertexShaderInput input )
 	// - Each of these components is then automatically divided by the W component, 
 	//   which we're leaving at 1.0 for now (this is more useful when dealing with 
 	//   a perspective projection matrix, which we'll get to in the future).
+    float3 localPosition = DecodePosition(input.packedPosition, positionScale, positionOffset);
     matrix wvp = mul(projection, mul(view, world));
-    output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
+    output.screenPosition = mul(wvp, float4(localPosition, 1.0f));
 	
 	// Calculate WVP for shadow map
     matrix shadowWVP = mul(lightProjection, mul(lightView, world));
-    output.shadowMapPos = mul(shadowWVP, float4(input.localPosition, 1.0f));
+    output.shadowMapPos = mul(shadowWVP, float4(localPosition, 1.0f));
 	
 	// Send other vertex data through the pipeline
-    output.uv = input.uv;
-    output.normal = mul((float3x3) worldInvTranspose, input.normal);
-    output.tangent = mul((float3x3) world, input.tangent);
-    output.worldPosition = mul(world, float4(input.localPosition, 1)).xyz;
+    output.uv = DecodeUV(input.packedUV);
+    output.normal = mul((float3x3) worldInvTranspose, DecodeOctahedral(input.packedNormal));
+    output.tangent = mul((float3x3) world, DecodeOctahedral(input.packedTangent));
+    output.worldPosition = mul(world, float4(localPosition, 1)).xyz;
+    output.colorTint = colorTint;
 
 	// Whatever we return will make its way through the pipeline to the
 	// next programmable stage we're using (the pixel shader for now)
@@ -158,6 +158,27 @@ HRESULT Window::Create(
 }
 
 
+// --------------------------------------------------------
+// Stands in for Create() when running headless: there's no
+// OS-level window (its handle stays null), only the size
+// everything else reads
+// 
+// width  - Width to report
+// height - Height to report
+// --------------------------------------------------------
+HRESULT Window::CreateHeadless(unsigned int width, unsigned int height)
+{
+	// Verify
+	if (windowCreated)
+		return E_FAIL;
+
+	windowWidth = width;
+	windowHeight = height;
+	windowCreated = true;
+	return S_OK;
+}
+
+
 // --------------------------------------------------------
 // Updates the window's title bar with several stats once
 // per second, including:
@@ -256,6 +277,46 @@ void Window::CreateConsoleWindow(int bufferLines, int bufferColumns, int windowL
 }
 
 
+// --------------------------------------------------------
+// Sends printf() to the console this process was started
+// from instead, so the output is still there after it exits.
+// Output already redirected to a file or pipe is left alone.
+// 
+// Returns false if there's no such console, in which case
+// CreateConsoleWindow() is the fallback
+// --------------------------------------------------------
+bool Window::AttachParentConsole()
+{
+	// Only allow this once
+	if (consoleCreated)
+		return true;
+
+	// Redirected, so stdout already goes somewhere that lasts
+	HANDLE output = GetStdHandle(STD_OUTPUT_HANDLE);
+	if (output != 0 && output != INVALID_HANDLE_VALUE && GetFileType(output) != FILE_TYPE_UNKNOWN)
+	{
+		consoleCreated = true;
+		return true;
+	}
+
+	if (!AttachConsole(ATTACH_PARENT_PROCESS))
+		return false;
+
+	FILE* stream;
+	freopen_s(&stream, "CONOUT$", "w", stdout);
+	freopen_s(&stream, "CONOUT$", "w", stderr);
+
+	// Colored output, as in a console of our own
+	DWORD currentMode = 0;
+	GetConsoleMode(GetStdHandle(STD_OUTPUT_HANDLE), &currentMode);
+	SetConsoleMode(GetStdHandle(STD_OUTPUT_HANDLE),
+		currentMode | ENABLE_PROCESSED_OUTPUT | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+
+	consoleCreated = true;
+	return true;
+}
+
+
 // --------------------------------------------------------
 // Handles messages that are sent to our window by the
 // operating system.  Ignoring these would cause our program
@@ -21,11 +21,13 @@ namespace Window
 		std::wstring titleBarText,
 		bool statsInTitleBar,
 		void (*resizeCallback)());
+	HRESULT CreateHeadless(unsigned int width, unsigned int height);
 	void UpdateStats(float totalTime);
 	void Quit();
 
 	// Helper function for allocating a console window
 	void CreateConsoleWindow(int bufferLines, int bufferColumns, int windowLines, int windowColumns);
+	bool AttachParentConsole();
 
 	// OS-level message handling
 	LRESULT ProcessMessage(